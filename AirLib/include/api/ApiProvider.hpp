@@ -7,6 +7,7 @@
 #include "VehicleApiBase.hpp"
 #include "VehicleSimApiBase.hpp"
 #include "WorldSimApiBase.hpp"
+#include "TelemetryPublisher.hpp"
 #include <map>
 #include "common/common_utils/UniqueValueMap.hpp"
 
@@ -42,6 +43,12 @@ namespace airlib
             return vehicle_sim_apis_.findOrDefault(vehicle_name, nullptr);
         }
 
+        //streams vehicle telemetry, the sim mode must tick it together with the vehicles
+        TelemetryPublisher* getTelemetryPublisher()
+        {
+            return &telemetry_publisher_;
+        }
+
         size_t getVehicleCount() const
         {
             return vehicle_apis_.valsSize();
@@ -77,6 +84,7 @@ namespace airlib
 
         common_utils::UniqueValueMap<std::string, VehicleApiBase*> vehicle_apis_;
         common_utils::UniqueValueMap<std::string, VehicleSimApiBase*> vehicle_sim_apis_;
+        TelemetryPublisher telemetry_publisher_;
     };
 }
 } //namespace
@@ -15,6 +15,22 @@ namespace airlib
     class ApiServerBase
     {
     public:
+        //threads serving cheap queries, heavy rendering/SDF calls and commands, call before start();
+        //0 keeps the server's default for that class
+        virtual void setDispatchThreadCounts(std::size_t query_threads, std::size_t heavy_threads, std::size_t command_threads)
+        {
+            unused(query_threads);
+            unused(heavy_threads);
+            unused(command_threads);
+        }
+
+        //calls of one class that may run or wait at the same time before further ones fail, call before start();
+        //0 queues every call
+        virtual void setMaxPendingCalls(std::size_t max_pending_calls)
+        {
+            unused(max_pending_calls);
+        }
+
         virtual void start(bool block, std::size_t thread_count) = 0;
         virtual void stop() = 0;
 
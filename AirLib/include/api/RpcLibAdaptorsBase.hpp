@@ -11,11 +11,16 @@
 #include "common/ImageCaptureBase.hpp"
 #include "safety/SafetyEval.hpp"
 #include "api/WorldSimApiBase.hpp"
+#include "sensors/lidar/LidarPointRing.hpp"
 
 #include "common/common_utils/WindowsApisCommonPre.hpp"
 #include "rpc/msgpack.hpp"
 #include "common/common_utils/WindowsApisCommonPost.hpp"
 
+#ifndef RPCLIB_MSGPACK
+#define RPCLIB_MSGPACK clmdep_msgpack
+#endif // !RPCLIB_MSGPACK
+
 namespace msr
 {
 namespace airlib_rpclib
@@ -648,6 +653,104 @@ namespace airlib_rpclib
             }
         };
 
+        //array of time_stamp, pose, point count and one bin of LidarPoint records. Points are
+        //packed straight from the sensor's frame and unpacked as a reference into the received
+        //buffer, so the caller has to keep that buffer alive for as long as it uses the points.
+        struct LidarPointCloud
+        {
+            msr::airlib::TTimePoint time_stamp = 0;
+            Pose pose;
+            std::shared_ptr<const msr::airlib::LidarPointFrame> frame; //set when packing
+            const char* point_data = nullptr; //set when unpacking
+            uint32_t point_count = 0;
+
+            LidarPointCloud()
+            {
+            }
+
+            LidarPointCloud(std::shared_ptr<const msr::airlib::LidarPointFrame> s)
+                : time_stamp(s->time_stamp), pose(s->pose), frame(std::move(s))
+            {
+                point_count = static_cast<uint32_t>(frame->points.size());
+                point_data = reinterpret_cast<const char*>(frame->points.data());
+            }
+
+            template <typename Packer>
+            void msgpack_pack(Packer& packer) const
+            {
+                const uint32_t point_bytes = point_count * static_cast<uint32_t>(sizeof(msr::airlib::LidarPoint));
+                packer.pack_array(4);
+                packer.pack(time_stamp);
+                packer.pack(pose);
+                packer.pack(point_count);
+                packer.pack_bin(point_bytes);
+                packer.pack_bin_body(point_data, point_bytes);
+            }
+
+            void msgpack_unpack(const RPCLIB_MSGPACK::object& o)
+            {
+                if (o.type != RPCLIB_MSGPACK::type::ARRAY || o.via.array.size != 4)
+                    throw RPCLIB_MSGPACK::type_error();
+                const RPCLIB_MSGPACK::object* fields = o.via.array.ptr;
+                fields[0].convert(time_stamp);
+                fields[1].convert(pose);
+                fields[2].convert(point_count);
+                if (fields[3].type != RPCLIB_MSGPACK::type::BIN || fields[3].via.bin.size != point_count * sizeof(msr::airlib::LidarPoint))
+                    throw RPCLIB_MSGPACK::type_error();
+                point_data = fields[3].via.bin.ptr;
+            }
+
+            //owner must keep point_data alive
+            msr::airlib::LidarPointCloud to(std::shared_ptr<const void> owner) const
+            {
+                msr::airlib::LidarPointCloud d(std::move(owner), point_data, point_count);
+                d.time_stamp = time_stamp;
+                d.pose = pose.to();
+                return d;
+            }
+        };
+
+        struct RpcMethodMetrics
+        {
+            std::string method;
+            std::string dispatch_class;
+            uint64_t calls = 0;
+            uint64_t errors = 0;
+            double total_ms = 0;
+            double max_ms = 0;
+            std::vector<uint64_t> latency_histogram;
+
+            MSGPACK_DEFINE_MAP(method, dispatch_class, calls, errors, total_ms, max_ms, latency_histogram);
+
+            RpcMethodMetrics()
+            {
+            }
+
+            RpcMethodMetrics(const msr::airlib::RpcMethodMetrics& s)
+            {
+                method = s.method;
+                dispatch_class = s.dispatch_class;
+                calls = s.calls;
+                errors = s.errors;
+                total_ms = s.total_ms;
+                max_ms = s.max_ms;
+                latency_histogram = s.latency_histogram;
+            }
+
+            msr::airlib::RpcMethodMetrics to() const
+            {
+                msr::airlib::RpcMethodMetrics d;
+                d.method = method;
+                d.dispatch_class = dispatch_class;
+                d.calls = calls;
+                d.errors = errors;
+                d.total_ms = total_ms;
+                d.max_ms = max_ms;
+                d.latency_histogram = latency_histogram;
+                return d;
+            }
+        };
+
         struct ImuData
         {
             msr::airlib::TTimePoint time_stamp;
@@ -917,6 +1020,24 @@ namespace airlib_rpclib
                 return response_adapter;
             }
         };
+
+        //one call inside batchCall, args is the packed argument tuple exactly as a normal call sends it
+        struct BatchCall
+        {
+            std::string method;
+            std::vector<char> args;
+
+            MSGPACK_DEFINE_MAP(method, args);
+        };
+
+        //packed return value of a BatchCall, or the error it threw
+        struct BatchResult
+        {
+            std::string error;
+            std::vector<char> value;
+
+            MSGPACK_DEFINE_MAP(error, value);
+        };
     };
 }
 } //namespace
@@ -0,0 +1,205 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_RpcLibBatch_hpp
+#define air_RpcLibBatch_hpp
+
+#include "common/Common.hpp"
+#include "api/RpcLibAdaptorsBase.hpp"
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#ifndef RPCLIB_MSGPACK
+#define RPCLIB_MSGPACK clmdep_msgpack
+#endif // !RPCLIB_MSGPACK
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+Server side of batchCall. Methods bound through the dispatcher are registered with the rpclib
+server as usual and can also be called inside a batch, so a client can fetch everything it
+needs for one control tick in a single round trip. Calls in a batch run one after another;
+the runner passed to dispatch() decides where, the server runs each of them on the dispatch
+pool of its own method. Only bind quick queries here, not long running commands.
+*/
+    class RpcLibBatchDispatcher
+    {
+    public:
+        typedef msr::airlib_rpclib::RpcLibAdaptorsBase::BatchCall BatchCall;
+        typedef msr::airlib_rpclib::RpcLibAdaptorsBase::BatchResult BatchResult;
+
+        template <typename TServer, typename TFunc>
+        void bind(TServer& server, const std::string& name, TFunc func)
+        {
+            server.bind(name, func);
+            handlers_[name] = makeHandler(func, &TFunc::operator());
+        }
+
+        //runs the calls on the calling thread
+        std::vector<BatchResult> dispatch(const std::vector<BatchCall>& calls) const
+        {
+            InlineRunner runner;
+            return dispatch(calls, runner);
+        }
+
+        //runs each call through runner.call(method, call), a failing call only sets the error of its own result
+        template <typename TRunner>
+        std::vector<BatchResult> dispatch(const std::vector<BatchCall>& calls, TRunner& runner) const
+        {
+            std::vector<BatchResult> results(calls.size());
+            for (size_t i = 0; i < calls.size(); ++i) {
+                const BatchCall& call = calls[i];
+                BatchResult& result = results[i];
+
+                const auto handler = handlers_.find(call.method);
+                if (handler == handlers_.end()) {
+                    result.error = "Method '" + call.method + "' is not available in a batch";
+                    continue;
+                }
+
+                try {
+                    RPCLIB_MSGPACK::object_handle args = RPCLIB_MSGPACK::unpack(call.args.data(), call.args.size());
+                    RPCLIB_MSGPACK::sbuffer value;
+                    runner.call(call.method, [&]() { handler->second(args.get(), value); });
+                    result.value.assign(value.data(), value.data() + value.size());
+                }
+                catch (const std::exception& ex) {
+                    result.error = ex.what();
+                }
+            }
+            return results;
+        }
+
+    private:
+        typedef std::function<void(const RPCLIB_MSGPACK::object& args, RPCLIB_MSGPACK::sbuffer& value)> Handler;
+
+        struct InlineRunner
+        {
+            template <typename TCall>
+            void call(const std::string& method, const TCall& call)
+            {
+                unused(method);
+                call();
+            }
+        };
+
+        template <typename TFunc, typename TResult, typename TClass, typename... TArgs>
+        static Handler makeHandler(TFunc func, TResult (TClass::*)(TArgs...) const)
+        {
+            return [func](const RPCLIB_MSGPACK::object& packed_args, RPCLIB_MSGPACK::sbuffer& value) {
+                std::tuple<typename std::decay<TArgs>::type...> args;
+                packed_args.convert(args);
+                invoke(func, args, value, std::index_sequence_for<TArgs...>(), std::is_void<TResult>());
+            };
+        }
+
+        template <typename TFunc, typename TTuple, size_t... I>
+        static void invoke(const TFunc& func, TTuple& args, RPCLIB_MSGPACK::sbuffer& value, std::index_sequence<I...>, std::false_type)
+        {
+            RPCLIB_MSGPACK::pack(value, func(std::get<I>(args)...));
+        }
+
+        template <typename TFunc, typename TTuple, size_t... I>
+        static void invoke(const TFunc& func, TTuple& args, RPCLIB_MSGPACK::sbuffer& value, std::index_sequence<I...>, std::true_type)
+        {
+            func(std::get<I>(args)...);
+            RPCLIB_MSGPACK::pack(value, RPCLIB_MSGPACK::type::nil_t());
+        }
+
+    private:
+        std::unordered_map<std::string, Handler> handlers_;
+    };
+
+    /*
+Client side of batchCall. add() queues a call with the same arguments the regular RPC takes
+and returns a handle typed with the adaptor the RPC returns. After RpcLibClientBase::callBatch
+get() decodes each result; a call that failed on the server throws from its own get() only.
+
+    RpcLibBatch batch;
+    auto state = batch.add<MultirotorRpcLibAdaptors::MultirotorState>("getMultirotorState", vehicle_name);
+    auto gate = batch.add<RpcLibAdaptorsBase::Pose>("simGetObjectPose", gate_name);
+    client.callBatch(batch);
+    MultirotorState s = batch.get(state).to();
+*/
+    class RpcLibBatch
+    {
+    public:
+        typedef msr::airlib_rpclib::RpcLibAdaptorsBase::BatchCall BatchCall;
+        typedef msr::airlib_rpclib::RpcLibAdaptorsBase::BatchResult BatchResult;
+
+        template <typename TResult>
+        struct Handle
+        {
+            size_t index;
+        };
+
+        template <typename TResult, typename... TArgs>
+        Handle<TResult> add(const std::string& method, const TArgs&... args)
+        {
+            RPCLIB_MSGPACK::sbuffer packed_args;
+            RPCLIB_MSGPACK::pack(packed_args, std::make_tuple(args...));
+
+            BatchCall call;
+            call.method = method;
+            call.args.assign(packed_args.data(), packed_args.data() + packed_args.size());
+            calls_.push_back(std::move(call));
+            return Handle<TResult>{ calls_.size() - 1 };
+        }
+
+        template <typename TResult>
+        TResult get(const Handle<TResult>& handle) const
+        {
+            if (handle.index >= results_.size())
+                throw std::logic_error("Batch result requested before the batch was called");
+
+            const BatchResult& result = results_[handle.index];
+            if (!result.error.empty())
+                throw std::runtime_error(calls_[handle.index].method + ": " + result.error);
+
+            RPCLIB_MSGPACK::object_handle value = RPCLIB_MSGPACK::unpack(result.value.data(), result.value.size());
+            return value.get().as<TResult>();
+        }
+
+        size_t size() const
+        {
+            return calls_.size();
+        }
+
+        //drops results only, so the same calls can be sent again every tick
+        void clearResults()
+        {
+            results_.clear();
+        }
+
+        void clear()
+        {
+            calls_.clear();
+            results_.clear();
+        }
+
+        const std::vector<BatchCall>& getCalls() const
+        {
+            return calls_;
+        }
+
+        void setResults(std::vector<BatchResult>&& results)
+        {
+            if (results.size() != calls_.size())
+                throw std::runtime_error("Server returned " + std::to_string(results.size()) + " results for " + std::to_string(calls_.size()) + " batched calls");
+            results_ = std::move(results);
+        }
+
+    private:
+        std::vector<BatchCall> calls_;
+        std::vector<BatchResult> results_;
+    };
+}
+} //namespace
+#endif
@@ -12,15 +12,19 @@
 #include "sensors/magnetometer/MagnetometerBase.hpp"
 #include "sensors/gps/GpsBase.hpp"
 #include "sensors/distance/DistanceBase.hpp"
+#include "sensors/lidar/LidarPointRing.hpp"
 #include "physics/Kinematics.hpp"
 #include "physics/Environment.hpp"
 #include "api/WorldSimApiBase.hpp"
+#include "api/TelemetryStream.hpp"
 
 namespace msr
 {
 namespace airlib
 {
 
+    class RpcLibBatch;
+
     //common methods for RCP clients of different vehicles
     class RpcLibClientBase
     {
@@ -43,8 +47,16 @@ namespace airlib
 
         ConnectionState getConnectionState();
         bool ping();
+        //sends every call queued in batch in one round trip, see RpcLibBatch.hpp
+        void callBatch(RpcLibBatch& batch);
         int getClientVersion() const;
         int getServerVersion() const;
+        //switches pose, kinematics, IMU, lidar, SDF and point plotting calls to the positional
+        //encoding if the server supports it, returns false and keeps the map encoding otherwise
+        bool enableCompactProtocol();
+        bool isCompactProtocolEnabled() const;
+        //per method call counts and latencies measured by the server, optionally restarting the counts
+        vector<RpcMethodMetrics> getRpcMethodMetrics(bool reset = false);
         int getMinRequiredServerVersion() const;
         int getMinRequiredClientVersion() const;
 
@@ -98,12 +110,22 @@ namespace airlib
 
         // sensor APIs
         msr::airlib::LidarData getLidarData(const std::string& lidar_name = "", const std::string& vehicle_name = "") const;
+        //same scan as getLidarData, sent as one binary buffer that the returned cloud refers to
+        msr::airlib::LidarPointCloud getLidarPointCloud(const std::string& lidar_name = "", const std::string& vehicle_name = "") const;
         msr::airlib::ImuBase::Output getImuData(const std::string& imu_name = "", const std::string& vehicle_name = "") const;
         msr::airlib::BarometerBase::Output getBarometerData(const std::string& barometer_name = "", const std::string& vehicle_name = "") const;
         msr::airlib::MagnetometerBase::Output getMagnetometerData(const std::string& magnetometer_name = "", const std::string& vehicle_name = "") const;
         msr::airlib::GpsBase::Output getGpsData(const std::string& gps_name = "", const std::string& vehicle_name = "") const;
         msr::airlib::DistanceSensorData getDistanceSensorData(const std::string& distance_sensor_name = "", const std::string& vehicle_name = "") const;
 
+        // streamed telemetry, channels is a mask of TelemetryStream::Channel values. Frames are sampled
+        // on the physics thread (the game thread in car and CV modes) and buffered on the server until read. readTelemetry blocks for up to
+        // max_wait_sec, so use a separate client for it when other calls must not wait behind it.
+        int subscribeTelemetry(const vector<std::string>& vehicle_names, uint32_t channels, float rate_hz);
+        //decodes every buffered frame into handler and returns the number of frames the server had to drop
+        uint64_t readTelemetry(int subscription_id, msr::airlib::TelemetryStream::Handler& handler, float max_wait_sec = 0.1f);
+        void unsubscribeTelemetry(int subscription_id);
+
         Pose simGetVehiclePose(const std::string& vehicle_name = "") const;
         void simSetVehiclePose(const Pose& pose, bool ignore_collision, const std::string& vehicle_name = "");
         void simSetTraceLine(const std::vector<float>& color_rgba, float thickness = 3.0f, const std::string& vehicle_name = "");
@@ -146,10 +168,12 @@ namespace airlib
 
         // SDF APIs:
         bool simBuildSDF(const Vector3r& position, const double& x_size, const double& y_size, const double& z_size, const float& res);
+        bool simBuildSparseSDF(const Vector3r& position, const double& x_size, const double& y_size, const double& z_size, const float& res, const double& truncation_distance);
         Vector3r simProjectToFreeSpace(const Vector3r& position, const double& mindist);
         double simGetSignedDistance(const Vector3r& position);
         std::vector<double> simGetSignedDistances(const vector<Vector3r>& positions);
         Vector3r simGetSDFGradient(const Vector3r& position);
+        std::vector<Vector3r> simGetSDFGradients(const vector<Vector3r>& positions);
         bool simCheckOccupancy(const Vector3r& position);
         bool simCheckInVolume(const Vector3r& position, std::string& volume_object_name);
         bool simLoadSDF(const std::string& filepath);
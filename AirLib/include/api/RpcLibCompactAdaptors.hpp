@@ -0,0 +1,254 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_RpcLibCompactAdaptors_hpp
+#define air_RpcLibCompactAdaptors_hpp
+
+#include "common/Common.hpp"
+#include "common/CommonStructs.hpp"
+#include "physics/Kinematics.hpp"
+#include "sensors/imu/ImuBase.hpp"
+#include "sensors/lidar/LidarBase.hpp"
+#include <cstring>
+#include <stdexcept>
+
+#include "common/common_utils/WindowsApisCommonPre.hpp"
+#include "rpc/msgpack.hpp"
+#include "common/common_utils/WindowsApisCommonPost.hpp"
+
+namespace msr
+{
+namespace airlib_rpclib
+{
+
+    /*
+Positional encoding of the adaptors that dominate traffic. RpcLibAdaptorsBase encodes structs as
+maps, so every value goes out with its field name; these encode the same fields as fixed arrays
+and point lists as one binary blob of packed floats. They are only used by the *Compact variants
+of the RPCs, which servers from kServerVersion on provide, so old clients keep the map format.
+*/
+    class RpcLibCompactAdaptors
+    {
+    public:
+        //first server version that has the *Compact RPCs
+        static constexpr int kServerVersion = 2;
+
+        struct Vector3r
+        {
+            msr::airlib::real_T x_val = 0, y_val = 0, z_val = 0;
+            MSGPACK_DEFINE_ARRAY(x_val, y_val, z_val);
+
+            Vector3r()
+            {
+            }
+
+            Vector3r(const msr::airlib::Vector3r& s)
+            {
+                x_val = s.x();
+                y_val = s.y();
+                z_val = s.z();
+            }
+            msr::airlib::Vector3r to() const
+            {
+                return msr::airlib::Vector3r(x_val, y_val, z_val);
+            }
+        };
+
+        struct Quaternionr
+        {
+            msr::airlib::real_T w_val = 1, x_val = 0, y_val = 0, z_val = 0;
+            MSGPACK_DEFINE_ARRAY(w_val, x_val, y_val, z_val);
+
+            Quaternionr()
+            {
+            }
+
+            Quaternionr(const msr::airlib::Quaternionr& s)
+            {
+                w_val = s.w();
+                x_val = s.x();
+                y_val = s.y();
+                z_val = s.z();
+            }
+            msr::airlib::Quaternionr to() const
+            {
+                return msr::airlib::Quaternionr(w_val, x_val, y_val, z_val);
+            }
+        };
+
+        struct Pose
+        {
+            Vector3r position;
+            Quaternionr orientation;
+            MSGPACK_DEFINE_ARRAY(position, orientation);
+
+            Pose()
+            {
+            }
+            Pose(const msr::airlib::Pose& s)
+            {
+                position = s.position;
+                orientation = s.orientation;
+            }
+            msr::airlib::Pose to() const
+            {
+                return msr::airlib::Pose(position.to(), orientation.to());
+            }
+        };
+
+        struct KinematicsState
+        {
+            Vector3r position;
+            Quaternionr orientation;
+            Vector3r linear_velocity;
+            Vector3r angular_velocity;
+            Vector3r linear_acceleration;
+            Vector3r angular_acceleration;
+
+            MSGPACK_DEFINE_ARRAY(position, orientation, linear_velocity, angular_velocity, linear_acceleration, angular_acceleration);
+
+            KinematicsState()
+            {
+            }
+
+            KinematicsState(const msr::airlib::Kinematics::State& s)
+            {
+                position = s.pose.position;
+                orientation = s.pose.orientation;
+                linear_velocity = s.twist.linear;
+                angular_velocity = s.twist.angular;
+                linear_acceleration = s.accelerations.linear;
+                angular_acceleration = s.accelerations.angular;
+            }
+
+            msr::airlib::Kinematics::State to() const
+            {
+                msr::airlib::Kinematics::State s;
+                s.pose.position = position.to();
+                s.pose.orientation = orientation.to();
+                s.twist.linear = linear_velocity.to();
+                s.twist.angular = angular_velocity.to();
+                s.accelerations.linear = linear_acceleration.to();
+                s.accelerations.angular = angular_acceleration.to();
+
+                return s;
+            }
+        };
+
+        struct ImuData
+        {
+            msr::airlib::TTimePoint time_stamp = 0;
+            Quaternionr orientation;
+            Vector3r angular_velocity;
+            Vector3r linear_acceleration;
+
+            MSGPACK_DEFINE_ARRAY(time_stamp, orientation, angular_velocity, linear_acceleration);
+
+            ImuData()
+            {
+            }
+
+            ImuData(const msr::airlib::ImuBase::Output& s)
+            {
+                time_stamp = s.time_stamp;
+                orientation = s.orientation;
+                angular_velocity = s.angular_velocity;
+                linear_acceleration = s.linear_acceleration;
+            }
+
+            msr::airlib::ImuBase::Output to() const
+            {
+                msr::airlib::ImuBase::Output d;
+
+                d.time_stamp = time_stamp;
+                d.orientation = orientation.to();
+                d.angular_velocity = angular_velocity.to();
+                d.linear_acceleration = linear_acceleration.to();
+
+                return d;
+            }
+        };
+
+        struct LidarData
+        {
+            msr::airlib::TTimePoint time_stamp = 0;
+            std::vector<char> point_cloud; //packed floats
+            Pose pose;
+            std::vector<int> segmentation;
+
+            MSGPACK_DEFINE_ARRAY(time_stamp, point_cloud, pose, segmentation);
+
+            LidarData()
+            {
+            }
+
+            LidarData(const msr::airlib::LidarData& s)
+            {
+                time_stamp = s.time_stamp;
+                point_cloud = packValues(s.point_cloud);
+                pose = s.pose;
+                segmentation = s.segmentation;
+            }
+
+            msr::airlib::LidarData to() const
+            {
+                msr::airlib::LidarData d;
+
+                d.time_stamp = time_stamp;
+                d.point_cloud = unpackValues<float>(point_cloud);
+                d.pose = pose.to();
+                d.segmentation = segmentation;
+
+                return d;
+            }
+        };
+
+        //values are copied as they are in memory, client and server are little endian everywhere we run
+        template <typename T>
+        static std::vector<char> packValues(const std::vector<T>& values)
+        {
+            std::vector<char> packed(values.size() * sizeof(T));
+            if (!values.empty())
+                std::memcpy(packed.data(), values.data(), packed.size());
+            return packed;
+        }
+
+        template <typename T>
+        static std::vector<T> unpackValues(const std::vector<char>& packed)
+        {
+            if (packed.size() % sizeof(T) != 0)
+                throw std::invalid_argument("Packed value list has a partial value");
+            std::vector<T> values(packed.size() / sizeof(T));
+            if (!values.empty())
+                std::memcpy(values.data(), packed.data(), packed.size());
+            return values;
+        }
+
+        static std::vector<char> packPoints(const std::vector<msr::airlib::Vector3r>& points)
+        {
+            std::vector<float> values;
+            values.reserve(points.size() * 3);
+            for (const auto& point : points) {
+                values.push_back(point.x());
+                values.push_back(point.y());
+                values.push_back(point.z());
+            }
+            return packValues(values);
+        }
+
+        static std::vector<msr::airlib::Vector3r> unpackPoints(const std::vector<char>& packed)
+        {
+            const std::vector<float> values = unpackValues<float>(packed);
+            if (values.size() % 3 != 0)
+                throw std::invalid_argument("Packed point list has a partial point");
+            std::vector<msr::airlib::Vector3r> points;
+            points.reserve(values.size() / 3);
+            for (size_t i = 0; i < values.size(); i += 3)
+                points.push_back(msr::airlib::Vector3r(values[i], values[i + 1], values[i + 2]));
+            return points;
+        }
+    };
+}
+} //namespace
+
+#endif
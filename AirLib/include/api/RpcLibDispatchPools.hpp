@@ -0,0 +1,297 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_RpcLibDispatchPools_hpp
+#define air_RpcLibDispatchPools_hpp
+
+#include "common/Common.hpp"
+#include "common/CommonStructs.hpp"
+#include "common/common_utils/ctpl_stl.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace msr
+{
+namespace airlib
+{
+
+    enum class RpcDispatchClass : uint
+    {
+        Query = 0, //cheap state reads
+        Heavy, //rendering, SDF, mesh and level work
+        Command, //control commands, some of which run until the vehicle gets somewhere
+        Batch, //batchCall, whose calls each run on the pool of their own class
+        Count
+    };
+
+    /*
+Runs every RPC on the worker pool of its dispatch class and keeps call counts and latency
+histograms per method. rpclib runs handlers on its own I/O threads, which wait here for the
+pool to finish the call, so a queue of slow image or SDF calls holds back other heavy calls on
+their pool. Calls queue on their pool however many there are. Waiting calls do hold I/O threads
+though, so a long enough queue of one class can still leave none for the others;
+setMaxPendingCalls() opts into failing calls of a class right away once it has that many
+pending, which keeps the remaining I/O threads free for the other classes.
+
+Latency is measured from the moment the call arrives on the I/O thread, so it includes the time
+spent waiting for a free worker of its class.
+*/
+    class RpcLibDispatchPools
+    {
+    public:
+        //histogram bucket i counts calls faster than 2^i microseconds that did not fit bucket i-1,
+        //the last bucket counts everything slower
+        static constexpr uint kHistogramBuckets = 22;
+
+        //0 keeps the default, which start() derives from the thread count the server is started with
+        void setThreadCount(RpcDispatchClass dispatch_class, size_t thread_count)
+        {
+            thread_counts_[static_cast<uint>(dispatch_class)] = thread_count;
+        }
+
+        //0, the default, queues every call; otherwise a class with that many calls running or waiting
+        //fails further calls until some of them finish
+        void setMaxPendingCalls(size_t max_pending_calls)
+        {
+            max_pending_calls_ = max_pending_calls;
+        }
+
+        void start(size_t default_thread_count)
+        {
+            for (uint i = 0; i < kClassCount; ++i) {
+                const size_t thread_count = std::max<size_t>(1, thread_counts_[i] ? thread_counts_[i] : default_thread_count);
+                pools_[i].reset(new ctpl::thread_pool(static_cast<int>(thread_count)));
+            }
+        }
+
+        static RpcDispatchClass classify(const std::string& method)
+        {
+            static const char* const heavy_methods[] = {
+                "simGetImages", "simGetImage", "simGetMeshPositionVertexBuffers", "simListSceneObjects",
+                "simBuildSDF", "simBuildSparseSDF", "simLoadSDF", "simSaveSDF", "simCreateVoxelGrid", "simProjectToFreeSpace",
+                "simLoadLevel", "simSwapTextures", "simSetObjectMaterial", "simSetObjectMaterialFromTexture",
+                "simSpawnObject", "simGetWorldExtents", "loadSplineCollisionSdf"
+            };
+            static const char* const query_prefixes[] = {
+                "get", "is", "ping", "simGet", "simIs", "simCheck", "simTest"
+            };
+
+            if (method == "batchCall")
+                return RpcDispatchClass::Batch;
+            for (const char* heavy_method : heavy_methods)
+                if (method == heavy_method)
+                    return RpcDispatchClass::Heavy;
+            for (const char* prefix : query_prefixes)
+                if (method.compare(0, std::strlen(prefix), prefix) == 0)
+                    return RpcDispatchClass::Query;
+            return RpcDispatchClass::Command;
+        }
+
+        static const char* getClassName(RpcDispatchClass dispatch_class)
+        {
+            switch (dispatch_class) {
+            case RpcDispatchClass::Query:
+                return "Query";
+            case RpcDispatchClass::Heavy:
+                return "Heavy";
+            case RpcDispatchClass::Batch:
+                return "Batch";
+            default:
+                return "Command";
+            }
+        }
+
+        //returns func wrapped so that calls run on the method's pool and are measured
+        template <typename TFunc>
+        auto wrap(const std::string& method, TFunc func)
+        {
+            return wrap(method, func, &TFunc::operator());
+        }
+
+        //runs one call of a batch on the pool of the method's own class and measures it as that method
+        template <typename TCall>
+        void call(const std::string& method, const TCall& call)
+        {
+            run<void>(*addMethod(method), call);
+        }
+
+        //calls of the class that are running or waiting for a worker
+        size_t getPendingCount(RpcDispatchClass dispatch_class) const
+        {
+            const size_t pending = pending_[static_cast<uint>(dispatch_class)].load();
+            return max_pending_calls_ ? std::min(pending, max_pending_calls_) : pending;
+        }
+
+        vector<RpcMethodMetrics> getMetrics(bool reset)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            vector<RpcMethodMetrics> metrics;
+            for (auto& entry : methods_) {
+                MethodStats& stats = *entry.second;
+                RpcMethodMetrics m;
+                m.method = entry.first;
+                m.dispatch_class = getClassName(stats.dispatch_class);
+                m.calls = reset ? stats.calls.exchange(0) : stats.calls.load();
+                m.errors = reset ? stats.errors.exchange(0) : stats.errors.load();
+                m.total_ms = (reset ? stats.total_nanos.exchange(0) : stats.total_nanos.load()) / 1.0E6;
+                m.max_ms = (reset ? stats.max_nanos.exchange(0) : stats.max_nanos.load()) / 1.0E6;
+                for (auto& bucket : stats.histogram)
+                    m.latency_histogram.push_back(reset ? bucket.exchange(0) : bucket.load());
+                metrics.push_back(m);
+            }
+            return metrics;
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+        static constexpr uint kClassCount = static_cast<uint>(RpcDispatchClass::Count);
+
+        struct MethodStats
+        {
+            RpcDispatchClass dispatch_class;
+            std::atomic<uint64_t> calls{ 0 };
+            std::atomic<uint64_t> errors{ 0 };
+            std::atomic<uint64_t> total_nanos{ 0 };
+            std::atomic<uint64_t> max_nanos{ 0 };
+            std::atomic<uint64_t> histogram[kHistogramBuckets];
+
+            MethodStats(RpcDispatchClass dispatch_class_val)
+                : dispatch_class(dispatch_class_val)
+            {
+                for (auto& bucket : histogram)
+                    bucket = 0;
+            }
+
+            void record(uint64_t nanos, bool failed)
+            {
+                ++calls;
+                if (failed)
+                    ++errors;
+                total_nanos += nanos;
+
+                uint64_t max = max_nanos.load();
+                while (nanos > max && !max_nanos.compare_exchange_weak(max, nanos)) {
+                }
+
+                uint bucket = 0;
+                for (uint64_t micros = nanos / 1000; micros > 0 && bucket + 1 < kHistogramBuckets; micros >>= 1)
+                    ++bucket;
+                ++histogram[bucket];
+            }
+        };
+
+        template <typename TFunc, typename TResult, typename TClass, typename... TArgs>
+        std::function<TResult(TArgs...)> wrap(const std::string& method, TFunc func, TResult (TClass::*)(TArgs...) const)
+        {
+            MethodStats* stats = addMethod(method);
+            return [this, func, stats](TArgs... args) -> TResult {
+                return run<TResult>(*stats, [&]() -> TResult { return func(args...); });
+            };
+        }
+
+        //records the call when it goes out of scope, also when the call threw
+        struct CallRecorder
+        {
+            MethodStats& stats;
+            const Clock::time_point start = Clock::now();
+            bool failed = false;
+
+            CallRecorder(MethodStats& stats_val)
+                : stats(stats_val)
+            {
+            }
+            ~CallRecorder()
+            {
+                stats.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count(), failed);
+            }
+        };
+
+        template <typename TResult, typename TCall>
+        TResult run(MethodStats& stats, const TCall& call)
+        {
+            CallRecorder recorder(stats);
+            PendingCall pending(*this, stats.dispatch_class);
+            if (!pending.admitted) {
+                recorder.failed = true;
+                throw std::runtime_error(std::string("Too many pending ") + getClassName(stats.dispatch_class) + " calls, try again later");
+            }
+            std::future<TResult> result = pools_[static_cast<uint>(stats.dispatch_class)]->push([&call, &recorder](int id) -> TResult {
+                unused(id);
+                try {
+                    return call();
+                }
+                catch (...) {
+                    recorder.failed = true;
+                    throw;
+                }
+            });
+            //rethrows what the call threw so that rpclib reports it to the client
+            return result.get();
+        }
+
+        //counts the call as pending of its class while it runs or waits for its pool
+        struct PendingCall
+        {
+            std::atomic<size_t>& pending;
+            bool admitted;
+
+            PendingCall(RpcLibDispatchPools& pools, RpcDispatchClass dispatch_class)
+                : pending(pools.pending_[static_cast<uint>(dispatch_class)])
+            {
+                const size_t count = ++pending;
+                admitted = pools.max_pending_calls_ == 0 || count <= pools.max_pending_calls_;
+            }
+            ~PendingCall()
+            {
+                --pending;
+            }
+        };
+
+        MethodStats* addMethod(const std::string& method)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::unique_ptr<MethodStats>& stats = methods_[method];
+            if (stats == nullptr)
+                stats.reset(new MethodStats(classify(method)));
+            return stats.get();
+        }
+
+    private:
+        size_t thread_counts_[kClassCount] = {};
+        size_t max_pending_calls_ = 0;
+        std::atomic<size_t> pending_[kClassCount] = {};
+        std::unique_ptr<ctpl::thread_pool> pools_[kClassCount];
+        std::map<std::string, std::unique_ptr<MethodStats>> methods_;
+        std::mutex mutex_;
+    };
+
+    //binds methods to an rpclib server through RpcLibDispatchPools, has the same bind() as the server
+    template <typename TServer>
+    class RpcLibMethodBinder
+    {
+    public:
+        RpcLibMethodBinder(TServer& server, RpcLibDispatchPools& pools)
+            : server_(server), pools_(pools)
+        {
+        }
+
+        template <typename TFunc>
+        void bind(const std::string& method, TFunc func)
+        {
+            server_.bind(method, pools_.wrap(method, func));
+        }
+
+    private:
+        TServer& server_;
+        RpcLibDispatchPools& pools_;
+    };
+}
+} //namespace
+#endif
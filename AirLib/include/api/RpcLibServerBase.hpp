@@ -13,6 +13,8 @@ namespace msr
 namespace airlib
 {
 
+    class RpcLibBatchDispatcher;
+
     class RpcLibServerBase : public ApiServerBase
     {
     public:
@@ -21,6 +23,9 @@ namespace airlib
 
         virtual void start(bool block, std::size_t thread_count) override;
         virtual void stop() override;
+        //threads for each RpcDispatchClass, see RpcLibDispatchPools.hpp
+        virtual void setDispatchThreadCounts(std::size_t query_threads, std::size_t heavy_threads, std::size_t command_threads) override;
+        virtual void setMaxPendingCalls(std::size_t max_pending_calls) override;
 
         class ApiNotSupported : public std::runtime_error
         {
@@ -33,6 +38,10 @@ namespace airlib
 
     protected:
         void* getServer() const;
+        //RpcLibMethodBinder<rpc::server>, bind methods through this so they run on their dispatch pool and are measured
+        void* getMethodBinder() const;
+        //bind queries through this instead of getServer() so they can also be called in batchCall
+        RpcLibBatchDispatcher* getBatchDispatcher() const;
 
         virtual VehicleApiBase* getVehicleApi(const std::string& vehicle_name)
         {
@@ -0,0 +1,235 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_TelemetryPublisher_hpp
+#define air_TelemetryPublisher_hpp
+
+#include "common/Common.hpp"
+#include "common/UpdatableObject.hpp"
+#include "api/TelemetryStream.hpp"
+#include "api/VehicleApiBase.hpp"
+#include "api/VehicleSimApiBase.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+Samples subscribed vehicles on every physics tick and buffers the samples as TelemetryStream
+frames until a reader drains them. Insert it into the physics world like a vehicle so that
+update() runs on the physics thread between vehicle updates, which means every frame of a tick
+sees one consistent state and readers never touch the sensors themselves. Sim modes without a
+physics world update it from their game tick instead.
+
+A subscription cannot be sampled faster than the physics loop runs. When a reader falls behind,
+new frames are dropped once the buffer is full and the count is reported with the next batch.
+*/
+    class TelemetryPublisher : public UpdatableObject
+    {
+    public:
+        struct Source
+        {
+            VehicleApiBase* api = nullptr; //may be null for sim-only vehicles
+            VehicleSimApiBase* sim_api = nullptr;
+        };
+
+        TelemetryPublisher()
+        {
+            setName("TelemetryPublisher");
+        }
+
+        //returns id to read from, throws if a vehicle is missing a sensor for one of the channels
+        int subscribe(const std::vector<Source>& sources, uint32_t channels, float rate_hz,
+                      size_t max_buffered_bytes = 4 * 1024 * 1024)
+        {
+            if (sources.empty() || sources.size() > 256)
+                throw std::invalid_argument("Telemetry subscription needs between 1 and 256 vehicles");
+            if (!(rate_hz > 0))
+                throw std::invalid_argument("Telemetry rate must be positive");
+
+            std::unique_ptr<Subscription> subscription(new Subscription());
+            subscription->period_nanos = static_cast<TTimePoint>(1.0E9 / rate_hz);
+            subscription->max_buffered_bytes = max_buffered_bytes;
+            for (const Source& source : sources)
+                subscription->vehicles.push_back(resolve(source, channels));
+            TelemetryStream::beginBatch(subscription->buffer);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            const int id = next_id_++;
+            subscriptions_[id] = std::move(subscription);
+            return id;
+        }
+
+        void unsubscribe(int id)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            subscriptions_.erase(id);
+            //wake up reader blocked on this subscription
+            data_ready_.notify_all();
+        }
+
+        //waits up to max_wait_sec for at least one frame, then hands over everything buffered
+        void read(int id, float max_wait_sec, std::vector<uint8_t>& batch)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            Subscription* subscription = find(id);
+            if (subscription->frame_count == 0 && max_wait_sec > 0) {
+                const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<float>(max_wait_sec);
+                data_ready_.wait_until(lock, deadline, [&]() {
+                    subscription = findOrNull(id);
+                    return subscription == nullptr || subscription->frame_count > 0;
+                });
+                subscription = find(id);
+            }
+
+            TelemetryStream::endBatch(subscription->buffer, subscription->frame_count, subscription->dropped_frames);
+            batch.swap(subscription->buffer);
+            TelemetryStream::beginBatch(subscription->buffer);
+            subscription->frame_count = 0;
+            subscription->dropped_frames = 0;
+        }
+
+        //*** Start: UpdatableState implementation ***//
+        virtual void resetImplementation() override
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            //clock may have been reset, start sampling again right away
+            for (auto& entry : subscriptions_)
+                entry.second->next_sample_nanos = 0;
+        }
+
+        virtual void update() override
+        {
+            UpdatableObject::update();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (subscriptions_.empty())
+                return;
+
+            const TTimePoint now = clock()->nowNanos();
+            bool has_data = false;
+            for (auto& entry : subscriptions_) {
+                Subscription& subscription = *entry.second;
+                if (now < subscription.next_sample_nanos)
+                    continue;
+                //don't try to catch up after a stall or on the first sample, resume at the requested rate
+                subscription.next_sample_nanos += subscription.period_nanos;
+                if (subscription.next_sample_nanos <= now)
+                    subscription.next_sample_nanos = now + subscription.period_nanos;
+                sample(subscription, now);
+                has_data = true;
+            }
+            if (has_data)
+                data_ready_.notify_all();
+        }
+        //*** End: UpdatableState implementation ***//
+
+    private:
+        struct VehicleSensors
+        {
+            const ImuBase* imu = nullptr;
+            const GpsBase* gps = nullptr;
+            const BarometerBase* barometer = nullptr;
+            const MagnetometerBase* magnetometer = nullptr;
+            const Kinematics::State* kinematics = nullptr;
+        };
+
+        struct Subscription
+        {
+            std::vector<VehicleSensors> vehicles;
+            TTimePoint period_nanos = 0;
+            TTimePoint next_sample_nanos = 0;
+            size_t max_buffered_bytes = 0;
+            std::vector<uint8_t> buffer;
+            uint32_t frame_count = 0;
+            uint64_t dropped_frames = 0;
+        };
+
+        static bool hasChannel(uint32_t channels, TelemetryStream::Channel channel)
+        {
+            return (channels & static_cast<uint32_t>(channel)) != 0;
+        }
+
+        static const SensorBase* findSensor(const Source& source, SensorBase::SensorType type, const char* type_name)
+        {
+            const SensorBase* sensor = source.api ? source.api->getSensors().getByType(type) : nullptr;
+            if (sensor == nullptr)
+                throw std::invalid_argument(std::string("Vehicle has no ") + type_name + " for telemetry subscription");
+            return sensor;
+        }
+
+        static VehicleSensors resolve(const Source& source, uint32_t channels)
+        {
+            VehicleSensors sensors;
+            if (hasChannel(channels, TelemetryStream::Channel::Imu))
+                sensors.imu = static_cast<const ImuBase*>(findSensor(source, SensorBase::SensorType::Imu, "IMU"));
+            if (hasChannel(channels, TelemetryStream::Channel::Gps))
+                sensors.gps = static_cast<const GpsBase*>(findSensor(source, SensorBase::SensorType::Gps, "GPS"));
+            if (hasChannel(channels, TelemetryStream::Channel::Barometer))
+                sensors.barometer = static_cast<const BarometerBase*>(findSensor(source, SensorBase::SensorType::Barometer, "barometer"));
+            if (hasChannel(channels, TelemetryStream::Channel::Magnetometer))
+                sensors.magnetometer = static_cast<const MagnetometerBase*>(findSensor(source, SensorBase::SensorType::Magnetometer, "magnetometer"));
+            if (hasChannel(channels, TelemetryStream::Channel::Kinematics)) {
+                if (source.sim_api == nullptr)
+                    throw std::invalid_argument("Ground truth kinematics is only available in simulation");
+                sensors.kinematics = source.sim_api->getGroundTruthKinematics();
+            }
+            return sensors;
+        }
+
+        void sample(Subscription& subscription, TTimePoint now)
+        {
+            std::vector<uint8_t>& out = subscription.buffer;
+            for (size_t i = 0; i < subscription.vehicles.size(); ++i) {
+                const VehicleSensors& sensors = subscription.vehicles[i];
+                const uint8_t vehicle_index = static_cast<uint8_t>(i);
+                const uint32_t frames = (sensors.imu ? 1 : 0) + (sensors.gps ? 1 : 0) + (sensors.barometer ? 1 : 0) +
+                                        (sensors.magnetometer ? 1 : 0) + (sensors.kinematics ? 1 : 0);
+                if (out.size() >= subscription.max_buffered_bytes) {
+                    subscription.dropped_frames += frames;
+                    continue;
+                }
+
+                if (sensors.imu)
+                    TelemetryStream::encodeImu(out, vehicle_index, sensors.imu->getOutput());
+                if (sensors.gps)
+                    TelemetryStream::encodeGps(out, vehicle_index, sensors.gps->getOutput());
+                if (sensors.barometer)
+                    TelemetryStream::encodeBarometer(out, vehicle_index, sensors.barometer->getOutput());
+                if (sensors.magnetometer)
+                    TelemetryStream::encodeMagnetometer(out, vehicle_index, sensors.magnetometer->getOutput());
+                if (sensors.kinematics)
+                    TelemetryStream::encodeKinematics(out, vehicle_index, now, *sensors.kinematics);
+                subscription.frame_count += frames;
+            }
+        }
+
+        Subscription* findOrNull(int id)
+        {
+            auto it = subscriptions_.find(id);
+            return it == subscriptions_.end() ? nullptr : it->second.get();
+        }
+
+        Subscription* find(int id)
+        {
+            Subscription* subscription = findOrNull(id);
+            if (subscription == nullptr)
+                throw std::invalid_argument("Unknown telemetry subscription " + std::to_string(id));
+            return subscription;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable data_ready_;
+        std::map<int, std::unique_ptr<Subscription>> subscriptions_;
+        int next_id_ = 1;
+    };
+}
+} //namespace
+#endif
@@ -0,0 +1,284 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_TelemetryStream_hpp
+#define air_TelemetryStream_hpp
+
+#include "common/Common.hpp"
+#include "physics/Kinematics.hpp"
+#include "sensors/imu/ImuBase.hpp"
+#include "sensors/gps/GpsBase.hpp"
+#include "sensors/barometer/BarometerBase.hpp"
+#include "sensors/magnetometer/MagnetometerBase.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+Binary encoding of streamed telemetry. A batch is a 16 byte header followed by frames:
+
+    batch header: uint16 version, uint16 reserved, uint32 frame_count, uint64 dropped_frames
+    frame header: uint8 channel, uint8 vehicle_index, uint16 payload_bytes, uint64 time_stamp
+    payload:      fixed layout per channel, see the encode* functions
+
+vehicle_index refers to the vehicle list given when subscribing. Numbers are written in host
+byte order, which is little endian on every platform we ship for; the version field lets a
+reader reject anything else. Unknown channels can be skipped using payload_bytes.
+*/
+    class TelemetryStream
+    {
+    public:
+        enum class Channel : uint8_t
+        {
+            Imu = 1,
+            Gps = 2,
+            Barometer = 4,
+            Magnetometer = 8,
+            Kinematics = 16
+        };
+
+        static constexpr uint16_t kVersion = 1;
+        static constexpr size_t kBatchHeaderBytes = 16;
+        static constexpr size_t kFrameHeaderBytes = 12;
+
+        //receives decoded frames, override the channels of interest
+        class Handler
+        {
+        public:
+            virtual ~Handler() = default;
+
+            virtual void onImu(uint vehicle_index, const ImuBase::Output& output)
+            {
+                unused(vehicle_index);
+                unused(output);
+            }
+            virtual void onGps(uint vehicle_index, const GpsBase::Output& output)
+            {
+                unused(vehicle_index);
+                unused(output);
+            }
+            virtual void onBarometer(uint vehicle_index, const BarometerBase::Output& output)
+            {
+                unused(vehicle_index);
+                unused(output);
+            }
+            virtual void onMagnetometer(uint vehicle_index, const MagnetometerBase::Output& output)
+            {
+                unused(vehicle_index);
+                unused(output);
+            }
+            virtual void onKinematics(uint vehicle_index, TTimePoint time_stamp, const Kinematics::State& state)
+            {
+                unused(vehicle_index);
+                unused(time_stamp);
+                unused(state);
+            }
+        };
+
+        static void beginBatch(std::vector<uint8_t>& batch)
+        {
+            batch.clear();
+            batch.resize(kBatchHeaderBytes, 0);
+            const uint16_t version = kVersion;
+            std::memcpy(batch.data(), &version, sizeof(version));
+        }
+
+        static void endBatch(std::vector<uint8_t>& batch, uint32_t frame_count, uint64_t dropped_frames)
+        {
+            std::memcpy(batch.data() + 4, &frame_count, sizeof(frame_count));
+            std::memcpy(batch.data() + 8, &dropped_frames, sizeof(dropped_frames));
+        }
+
+        static void encodeImu(std::vector<uint8_t>& out, uint8_t vehicle_index, const ImuBase::Output& output)
+        {
+            const size_t payload = beginFrame(out, Channel::Imu, vehicle_index, output.time_stamp, 10 * sizeof(float));
+            writeQuaternion(out, payload, output.orientation);
+            writeVector(out, payload + 16, output.angular_velocity);
+            writeVector(out, payload + 28, output.linear_acceleration);
+        }
+
+        static void encodeGps(std::vector<uint8_t>& out, uint8_t vehicle_index, const GpsBase::Output& output)
+        {
+            const size_t payload = beginFrame(out, Channel::Gps, vehicle_index, output.time_stamp, 56);
+            const GpsBase::GnssReport& gnss = output.gnss;
+            write(out, payload, gnss.geo_point.latitude);
+            write(out, payload + 8, gnss.geo_point.longitude);
+            write(out, payload + 16, gnss.geo_point.altitude);
+            write(out, payload + 20, static_cast<float>(gnss.eph));
+            write(out, payload + 24, static_cast<float>(gnss.epv));
+            writeVector(out, payload + 28, gnss.velocity);
+            write(out, payload + 40, gnss.time_utc);
+            write(out, payload + 48, static_cast<uint32_t>(gnss.fix_type));
+            write(out, payload + 52, static_cast<uint32_t>(output.is_valid ? 1 : 0));
+        }
+
+        static void encodeBarometer(std::vector<uint8_t>& out, uint8_t vehicle_index, const BarometerBase::Output& output)
+        {
+            const size_t payload = beginFrame(out, Channel::Barometer, vehicle_index, output.time_stamp, 3 * sizeof(float));
+            write(out, payload, static_cast<float>(output.altitude));
+            write(out, payload + 4, static_cast<float>(output.pressure));
+            write(out, payload + 8, static_cast<float>(output.qnh));
+        }
+
+        static void encodeMagnetometer(std::vector<uint8_t>& out, uint8_t vehicle_index, const MagnetometerBase::Output& output)
+        {
+            const size_t payload = beginFrame(out, Channel::Magnetometer, vehicle_index, output.time_stamp, 3 * sizeof(float));
+            writeVector(out, payload, output.magnetic_field_body);
+        }
+
+        static void encodeKinematics(std::vector<uint8_t>& out, uint8_t vehicle_index, TTimePoint time_stamp, const Kinematics::State& state)
+        {
+            const size_t payload = beginFrame(out, Channel::Kinematics, vehicle_index, time_stamp, 19 * sizeof(float));
+            writeVector(out, payload, state.pose.position);
+            writeQuaternion(out, payload + 12, state.pose.orientation);
+            writeVector(out, payload + 28, state.twist.linear);
+            writeVector(out, payload + 40, state.twist.angular);
+            writeVector(out, payload + 52, state.accelerations.linear);
+            writeVector(out, payload + 64, state.accelerations.angular);
+        }
+
+        //calls handler for every frame in batch and returns the number of frames the server dropped
+        static uint64_t decode(const std::vector<uint8_t>& batch, Handler& handler)
+        {
+            if (batch.size() < kBatchHeaderBytes)
+                throw std::invalid_argument("Telemetry batch is truncated");
+            uint16_t version;
+            uint32_t frame_count;
+            uint64_t dropped_frames;
+            std::memcpy(&version, batch.data(), sizeof(version));
+            std::memcpy(&frame_count, batch.data() + 4, sizeof(frame_count));
+            std::memcpy(&dropped_frames, batch.data() + 8, sizeof(dropped_frames));
+            if (version != kVersion)
+                throw std::invalid_argument("Unsupported telemetry batch version " + std::to_string(version));
+
+            size_t offset = kBatchHeaderBytes;
+            for (uint32_t i = 0; i < frame_count; ++i) {
+                if (offset + kFrameHeaderBytes > batch.size())
+                    throw std::invalid_argument("Telemetry batch is truncated");
+                const Channel channel = static_cast<Channel>(batch[offset]);
+                const uint vehicle_index = batch[offset + 1];
+                const uint16_t payload_bytes = read<uint16_t>(batch, offset + 2);
+                const TTimePoint time_stamp = read<uint64_t>(batch, offset + 4);
+                const size_t payload = offset + kFrameHeaderBytes;
+                if (payload + payload_bytes > batch.size())
+                    throw std::invalid_argument("Telemetry batch is truncated");
+
+                switch (channel) {
+                case Channel::Imu: {
+                    ImuBase::Output output;
+                    output.time_stamp = time_stamp;
+                    output.orientation = readQuaternion(batch, payload);
+                    output.angular_velocity = readVector(batch, payload + 16);
+                    output.linear_acceleration = readVector(batch, payload + 28);
+                    handler.onImu(vehicle_index, output);
+                    break;
+                }
+                case Channel::Gps: {
+                    GpsBase::Output output;
+                    output.time_stamp = time_stamp;
+                    output.gnss.geo_point.latitude = read<double>(batch, payload);
+                    output.gnss.geo_point.longitude = read<double>(batch, payload + 8);
+                    output.gnss.geo_point.altitude = read<float>(batch, payload + 16);
+                    output.gnss.eph = read<float>(batch, payload + 20);
+                    output.gnss.epv = read<float>(batch, payload + 24);
+                    output.gnss.velocity = readVector(batch, payload + 28);
+                    output.gnss.time_utc = read<uint64_t>(batch, payload + 40);
+                    output.gnss.fix_type = static_cast<GpsBase::GnssFixType>(read<uint32_t>(batch, payload + 48));
+                    output.is_valid = read<uint32_t>(batch, payload + 52) != 0;
+                    handler.onGps(vehicle_index, output);
+                    break;
+                }
+                case Channel::Barometer: {
+                    BarometerBase::Output output;
+                    output.time_stamp = time_stamp;
+                    output.altitude = read<float>(batch, payload);
+                    output.pressure = read<float>(batch, payload + 4);
+                    output.qnh = read<float>(batch, payload + 8);
+                    handler.onBarometer(vehicle_index, output);
+                    break;
+                }
+                case Channel::Magnetometer: {
+                    MagnetometerBase::Output output;
+                    output.time_stamp = time_stamp;
+                    output.magnetic_field_body = readVector(batch, payload);
+                    handler.onMagnetometer(vehicle_index, output);
+                    break;
+                }
+                case Channel::Kinematics: {
+                    Kinematics::State state;
+                    state.pose.position = readVector(batch, payload);
+                    state.pose.orientation = readQuaternion(batch, payload + 12);
+                    state.twist.linear = readVector(batch, payload + 28);
+                    state.twist.angular = readVector(batch, payload + 40);
+                    state.accelerations.linear = readVector(batch, payload + 52);
+                    state.accelerations.angular = readVector(batch, payload + 64);
+                    handler.onKinematics(vehicle_index, time_stamp, state);
+                    break;
+                }
+                default:
+                    //newer server, skip what we don't understand
+                    break;
+                }
+
+                offset = payload + payload_bytes;
+            }
+
+            return dropped_frames;
+        }
+
+    private:
+        static size_t beginFrame(std::vector<uint8_t>& out, Channel channel, uint8_t vehicle_index, TTimePoint time_stamp, uint16_t payload_bytes)
+        {
+            const size_t offset = out.size();
+            out.resize(offset + kFrameHeaderBytes + payload_bytes);
+            out[offset] = static_cast<uint8_t>(channel);
+            out[offset + 1] = vehicle_index;
+            write(out, offset + 2, payload_bytes);
+            write(out, offset + 4, static_cast<uint64_t>(time_stamp));
+            return offset + kFrameHeaderBytes;
+        }
+
+        template <typename T>
+        static void write(std::vector<uint8_t>& out, size_t offset, const T& value)
+        {
+            std::memcpy(out.data() + offset, &value, sizeof(T));
+        }
+
+        template <typename T>
+        static T read(const std::vector<uint8_t>& in, size_t offset)
+        {
+            T value;
+            std::memcpy(&value, in.data() + offset, sizeof(T));
+            return value;
+        }
+
+        static void writeVector(std::vector<uint8_t>& out, size_t offset, const Vector3r& v)
+        {
+            const float values[3] = { static_cast<float>(v.x()), static_cast<float>(v.y()), static_cast<float>(v.z()) };
+            std::memcpy(out.data() + offset, values, sizeof(values));
+        }
+
+        static void writeQuaternion(std::vector<uint8_t>& out, size_t offset, const Quaternionr& q)
+        {
+            const float values[4] = { static_cast<float>(q.w()), static_cast<float>(q.x()), static_cast<float>(q.y()), static_cast<float>(q.z()) };
+            std::memcpy(out.data() + offset, values, sizeof(values));
+        }
+
+        static Vector3r readVector(const std::vector<uint8_t>& in, size_t offset)
+        {
+            return Vector3r(read<float>(in, offset), read<float>(in, offset + 4), read<float>(in, offset + 8));
+        }
+
+        static Quaternionr readQuaternion(const std::vector<uint8_t>& in, size_t offset)
+        {
+            return Quaternionr(read<float>(in, offset), read<float>(in, offset + 4), read<float>(in, offset + 8), read<float>(in, offset + 12));
+        }
+    };
+}
+} //namespace
+#endif
@@ -114,7 +114,7 @@ Some methods may not be applicable to specific vehicle in which case an exceptio
         }
 
         // Lidar APIs
-        virtual const LidarData& getLidarData(const std::string& lidar_name) const
+        virtual LidarData getLidarData(const std::string& lidar_name) const
         {
             auto* lidar = static_cast<const LidarBase*>(findSensorByName(lidar_name, SensorBase::SensorType::Lidar));
             if (lidar == nullptr)
@@ -123,6 +123,18 @@ Some methods may not be applicable to specific vehicle in which case an exceptio
             return lidar->getOutput();
         }
 
+        virtual std::shared_ptr<const LidarPointFrame> getLidarPointFrame(const std::string& lidar_name) const
+        {
+            auto* lidar = static_cast<const LidarBase*>(findSensorByName(lidar_name, SensorBase::SensorType::Lidar));
+            if (lidar == nullptr)
+                throw VehicleControllerException(Utils::stringf("No lidar with name %s exist on vehicle", lidar_name.c_str()));
+
+            auto frame = lidar->getPointFrame();
+            if (frame == nullptr)
+                throw VehicleControllerException(Utils::stringf("Lidar %s has not completed a scan yet", lidar_name.c_str()));
+            return frame;
+        }
+
         // IMU API
         virtual const ImuBase::Output& getImuData(const std::string& imu_name) const
         {
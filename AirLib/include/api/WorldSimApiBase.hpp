@@ -78,10 +78,14 @@ namespace airlib
 
         // SDF APIs
         virtual bool buildSDF(const Vector3r& position, const double& x_size, const double& y_size, const double& z_size, const float& res) = 0;
+        // Narrow-band SDF that only stores chunks within truncation_distance of a surface, for courses too large for buildSDF.
+        // Queries answer from it until the next buildSDF or loadSDF.
+        virtual bool buildSparseSDF(const Vector3r& position, const double& x_size, const double& y_size, const double& z_size, const float& res, const double& truncation_distance) = 0;
         virtual Vector3r projectToCollisionFree(const Vector3r& position, const double& mindist) = 0;
         virtual double getSignedDistance(const Vector3r& position) = 0;
         virtual std::vector<double> getSignedDistances(const std::vector<Vector3r>& positions) = 0;
         virtual Vector3r getSDFGradient(const Vector3r& position) = 0;
+        virtual std::vector<Vector3r> getSDFGradients(const std::vector<Vector3r>& positions) = 0;
         virtual bool checkInVolume(const Vector3r& position, const std::string& volume_object_name) = 0;
         virtual bool isOccupied(const Vector3r& position) = 0;
         virtual bool saveSDF(const std::string& filepath) = 0;
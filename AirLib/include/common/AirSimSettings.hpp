@@ -377,7 +377,15 @@ namespace airlib
         bool enable_rpc = true;
         std::string api_server_address = "";
         int api_port = RpcLibPort;
+        //worker threads per class of RPC calls, 0 keeps the server default
+        uint rpc_query_threads = 0;
+        uint rpc_heavy_threads = 0;
+        uint rpc_command_threads = 0;
+        //calls of one class that may be pending before further ones fail, 0 queues every call
+        uint rpc_max_pending_calls = 0;
         std::string physics_engine_name = "";
+        uint physics_update_threads = 1;
+        std::string physics_wait_strategy = "Spin";
 
         std::string clock_type = "";
         float clock_speed = 1.0f;
@@ -580,6 +588,14 @@ namespace airlib
                 else
                     physics_engine_name = "PhysX"; //this value is only informational for now
             }
+
+            //vehicles are updated concurrently on this many threads, 1 means serial update
+            physics_update_threads = static_cast<uint>(std::max(1, settings_json.getInt("PhysicsUpdateThreads", 1)));
+
+            //how the physics loop waits for the next period: Spin or Hybrid (sleep, then spin the last 200us)
+            physics_wait_strategy = settings_json.getString("PhysicsWaitStrategy", "Spin");
+            if (physics_wait_strategy != "Spin" && physics_wait_strategy != "Hybrid")
+                throw std::invalid_argument(std::string("PhysicsWaitStrategy must be Spin or Hybrid, not ") + physics_wait_strategy);
         }
 
         void loadLevelSettings(const Settings& settings_json)
@@ -1108,6 +1124,10 @@ namespace airlib
             //don't work
             api_server_address = settings_json.getString("LocalHostIp", "");
             api_port = settings_json.getInt("ApiServerPort", RpcLibPort);
+            rpc_query_threads = static_cast<uint>(std::max(0, settings_json.getInt("RpcQueryThreads", 0)));
+            rpc_heavy_threads = static_cast<uint>(std::max(0, settings_json.getInt("RpcHeavyThreads", 0)));
+            rpc_command_threads = static_cast<uint>(std::max(0, settings_json.getInt("RpcCommandThreads", 0)));
+            rpc_max_pending_calls = static_cast<uint>(std::max(0, settings_json.getInt("RpcMaxPendingCalls", 0)));
             is_record_ui_visible = settings_json.getBool("RecordUIVisible", true);
             engine_sound = settings_json.getBool("EngineSound", false);
             enable_rpc = settings_json.getBool("EnableRpc", enable_rpc);
@@ -5,7 +5,9 @@
 #define airsim_core_ClockFactory_hpp
 
 #include "ScalableClock.hpp"
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 namespace msr
 {
@@ -16,19 +18,60 @@ namespace airlib
     {
     public:
         //output of this function should not be stored as pointer might change
+        //if calling thread has a scoped clock, that clock is returned instead of the process wide one
         static ClockBase* get(std::shared_ptr<ClockBase> val = nullptr)
         {
-            static std::shared_ptr<ClockBase> clock;
+            ProcessClock& process = processClock();
 
-            if (val != nullptr)
-                clock = val;
+            if (val != nullptr) {
+                std::lock_guard<std::mutex> lock(process.mutex);
+                process.clock = val;
+                process.current = val.get();
+                return val.get();
+            }
 
-            if (clock == nullptr)
-                clock = std::make_shared<ScalableClock>();
+            ClockBase* thread_clock = threadClock();
+            if (thread_clock != nullptr)
+                return thread_clock;
 
-            return clock.get();
+            //worlds on several threads may ask for the default clock at the same time
+            ClockBase* clock = process.current;
+            if (clock == nullptr) {
+                std::lock_guard<std::mutex> lock(process.mutex);
+                if (process.clock == nullptr) {
+                    process.clock = std::make_shared<ScalableClock>();
+                    process.current = process.clock.get();
+                }
+                clock = process.current;
+            }
+
+            return clock;
         }
 
+        //Makes get() return given clock on the current thread for the lifetime of this object.
+        //World uses this while updating so that code without access to the world's clock,
+        //such as Waiter or firmware boards, still reads the right time when several
+        //independent worlds run in one process.
+        class ScopedThreadClock
+        {
+        public:
+            explicit ScopedThreadClock(ClockBase* clock)
+                : previous_(threadClock())
+            {
+                threadClock() = clock;
+            }
+            ~ScopedThreadClock()
+            {
+                threadClock() = previous_;
+            }
+
+            ScopedThreadClock(ScopedThreadClock const&) = delete;
+            void operator=(ScopedThreadClock const&) = delete;
+
+        private:
+            ClockBase* previous_;
+        };
+
         //don't allow multiple instances of this class
         ClockFactory(ClockFactory const&) = delete;
         void operator=(ClockFactory const&) = delete;
@@ -36,6 +79,26 @@ namespace airlib
     private:
         //disallow instance creation
         ClockFactory() {}
+
+        struct ProcessClock
+        {
+            std::mutex mutex;
+            std::shared_ptr<ClockBase> clock;
+            //lets get() skip the lock once the clock exists
+            std::atomic<ClockBase*> current{ nullptr };
+        };
+
+        static ProcessClock& processClock()
+        {
+            static ProcessClock process;
+            return process;
+        }
+
+        static ClockBase*& threadClock()
+        {
+            thread_local ClockBase* clock = nullptr;
+            return clock;
+        }
     };
 }
 } //namespace
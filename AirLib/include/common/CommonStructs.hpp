@@ -399,6 +399,20 @@ namespace airlib
         }
     };
 
+    //calls and latency of one RPC method since the server started or metrics were last reset
+    struct RpcMethodMetrics
+    {
+        std::string method;
+        std::string dispatch_class;
+        uint64_t calls = 0;
+        uint64_t errors = 0;
+        double total_ms = 0;
+        double max_ms = 0;
+        //bucket i counts calls that took less than 2^i microseconds and did not fit bucket i-1,
+        //the last bucket counts everything slower
+        vector<uint64_t> latency_histogram;
+    };
+
     struct DistanceSensorData
     {
         TTimePoint time_stamp;
@@ -67,15 +67,30 @@ init->reset calls for base-derived class that would be incorrect.
             return nullptr;
         }
 
+        //clock assigned to this object, otherwise the one of its parent, otherwise ClockFactory
         virtual ClockBase* clock()
         {
+            if (clock_)
+                return clock_.get();
+            if (parent_)
+                return parent_->clock();
             return ClockFactory::get();
         }
         virtual const ClockBase* clock() const
         {
+            if (clock_)
+                return clock_.get();
+            if (parent_)
+                return static_cast<const UpdatableObject*>(parent_)->clock();
             return ClockFactory::get();
         }
 
+        //give this object and everything parented to it its own clock
+        void setClock(std::shared_ptr<ClockBase> clock)
+        {
+            clock_ = clock;
+        }
+
         UpdatableObject* getParent()
         {
             return parent_;
@@ -108,6 +123,7 @@ init->reset calls for base-derived class that would be incorrect.
         bool update_called = false;
         bool reset_in_progress = false;
         UpdatableObject* parent_ = nullptr;
+        std::shared_ptr<ClockBase> clock_;
         std::string name_;
     };
 }
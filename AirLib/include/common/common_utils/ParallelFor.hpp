@@ -0,0 +1,99 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef commn_utils_ParallelFor_hpp
+#define commn_utils_ParallelFor_hpp
+
+#include "ctpl_stl.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace common_utils
+{
+
+/*
+Runs func(index) for index in [0, count) on a fixed pool of worker threads and returns
+only after all indices are done, so each run() is a barrier.
+
+Indices are not pre-assigned to threads: every participant, including the calling thread,
+claims the next unclaimed index from a shared atomic counter. A thread that finishes a cheap
+item immediately takes more work, so uneven items are balanced the same way a work stealing
+pool would balance them.
+
+The first exception thrown by func is re-thrown from run() after all participants are done.
+*/
+class ParallelFor
+{
+public:
+    //thread_count includes the calling thread, 0 means use all hardware threads
+    explicit ParallelFor(unsigned int thread_count = 0)
+    {
+        if (thread_count == 0)
+            thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+        thread_count_ = thread_count;
+        if (thread_count > 1)
+            workers_.resize(static_cast<int>(thread_count - 1));
+    }
+
+    unsigned int getThreadCount() const
+    {
+        return thread_count_;
+    }
+
+    void run(size_t count, const std::function<void(size_t)>& func)
+    {
+        const size_t helper_count = std::min(static_cast<size_t>(thread_count_ - 1), count > 0 ? count - 1 : 0);
+        if (helper_count == 0) {
+            for (size_t i = 0; i < count; ++i)
+                func(i);
+            return;
+        }
+
+        std::atomic<size_t> next_index(0);
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto drain = [&]() {
+            try {
+                for (size_t i = next_index++; i < count; i = next_index++)
+                    func(i);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                //stop others from picking up new work
+                next_index = count;
+            }
+        };
+
+        std::vector<std::future<void>> helpers;
+        helpers.reserve(helper_count);
+        for (size_t h = 0; h < helper_count; ++h)
+            helpers.push_back(workers_.push([&drain](int id) {
+                (void)id;
+                drain();
+            }));
+
+        drain();
+
+        for (auto& helper : helpers)
+            helper.wait();
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+private:
+    unsigned int thread_count_;
+    ctpl::thread_pool workers_;
+};
+}
+#endif
@@ -11,6 +11,11 @@
 #include <system_error>
 #include <mutex>
 #include <cstdint>
+#include <array>
+#if defined(__linux__)
+#include <time.h>
+#include <cerrno>
+#endif
 
 namespace common_utils
 {
@@ -18,6 +23,34 @@ namespace common_utils
 class ScheduledExecutor
 {
 public:
+    enum class WaitStrategy
+    {
+        //sleep for long delays, spin for anything below 5ms
+        Spin,
+        //sleep to an absolute deadline slightly before the period end, then spin for the rest
+        Hybrid
+    };
+    static constexpr uint64_t kDefaultSpinWindowNanos = 200000;
+
+    //upper edges of jitter histogram bins, last bin collects everything above
+    static constexpr size_t kJitterBinCount = 7;
+    static const std::array<uint64_t, kJitterBinCount - 1>& jitterBinEdgesNanos()
+    {
+        static const std::array<uint64_t, kJitterBinCount - 1> edges = { 10000, 50000, 100000, 250000, 500000, 1000000 };
+        return edges;
+    }
+
+    struct TimingStats
+    {
+        uint64_t period_count = 0;
+        //periods where callback took longer than period so there was no sleep at all
+        uint64_t overrun_count = 0;
+        //how late we woke up with respect to the end of period
+        uint64_t max_jitter_nanos = 0;
+        std::array<uint64_t, kJitterBinCount> jitter_histogram{};
+        double sleep_time_avg = 0;
+    };
+
     ScheduledExecutor()
     {
     }
@@ -48,6 +81,7 @@ public:
         initializePauseState();
 
         sleep_time_avg_ = 0;
+        resetTimingStats();
         Utils::cleanupThread(th_);
         th_ = std::thread(&ScheduledExecutor::executorLoop, this);
     }
@@ -119,6 +153,37 @@ public:
         return sleep_time_avg_;
     }
 
+    void setWaitStrategy(WaitStrategy wait_strategy, uint64_t spin_window_nanos = kDefaultSpinWindowNanos)
+    {
+        wait_strategy_ = wait_strategy;
+        spin_window_nanos_ = spin_window_nanos;
+    }
+    WaitStrategy getWaitStrategy() const
+    {
+        return wait_strategy_;
+    }
+
+    TimingStats getTimingStats() const
+    {
+        TimingStats stats;
+        stats.period_count = period_count_;
+        stats.overrun_count = overrun_count_;
+        stats.max_jitter_nanos = max_jitter_nanos_;
+        for (size_t i = 0; i < kJitterBinCount; ++i)
+            stats.jitter_histogram[i] = jitter_histogram_[i];
+        stats.sleep_time_avg = sleep_time_avg_;
+        return stats;
+    }
+
+    void resetTimingStats()
+    {
+        period_count_ = 0;
+        overrun_count_ = 0;
+        max_jitter_nanos_ = 0;
+        for (auto& bin : jitter_histogram_)
+            bin = 0;
+    }
+
     void lock()
     {
         mutex_.lock();
@@ -148,8 +213,20 @@ private:
         return clock::now().time_since_epoch().count();
     }
 
-    static void sleep_for(TTimePoint delay_nanos)
+    void sleep_for(TTimePoint delay_nanos)
     {
+        if (wait_strategy_ == WaitStrategy::Hybrid) {
+            //OS sleep gives up the core but wakes up late by scheduler latency,
+            //so only sleep up to spin window before deadline and spin the rest
+            auto start = nanos();
+            if (delay_nanos > spin_window_nanos_)
+                sleepMonotonic(delay_nanos - spin_window_nanos_);
+            while ((nanos() - start) < delay_nanos) {
+                std::this_thread::yield();
+            }
+            return;
+        }
+
         /*
         This is spin loop implementation which may be suitable for sub-millisecond resolution.
         //TODO: investigate below alternatives
@@ -171,6 +248,45 @@ private:
         }
     }
 
+    static void sleepMonotonic(TTimeDelta delay_nanos)
+    {
+#if defined(__linux__)
+        //absolute deadline so that signal interruptions don't extend the sleep
+        timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += static_cast<time_t>(delay_nanos / 1000000000LL);
+        deadline.tv_nsec += static_cast<long>(delay_nanos % 1000000000LL);
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_nsec -= 1000000000L;
+            ++deadline.tv_sec;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+        }
+#else
+        std::this_thread::sleep_until(std::chrono::steady_clock::now() + std::chrono::nanoseconds(delay_nanos));
+#endif
+    }
+
+    void recordPeriod(TTimeDelta delay_nanos, TTimePoint wake_deadline)
+    {
+        ++period_count_;
+        if (delay_nanos == 0) {
+            ++overrun_count_;
+            return;
+        }
+
+        TTimePoint now = nanos();
+        TTimeDelta jitter = now > wake_deadline ? now - wake_deadline : 0;
+        if (jitter > max_jitter_nanos_)
+            max_jitter_nanos_ = jitter;
+
+        const auto& edges = jitterBinEdgesNanos();
+        size_t bin = 0;
+        while (bin < edges.size() && jitter >= edges[bin])
+            ++bin;
+        ++jitter_histogram_[bin];
+    }
+
     void executorLoop()
     {
         TTimePoint call_end = nanos();
@@ -216,8 +332,13 @@ private:
             TTimeDelta delay_nanos = period_nanos_ > elapsed_period ? period_nanos_ - elapsed_period : 0;
             //moving average of how much we are sleeping
             sleep_time_avg_ = 0.25f * sleep_time_avg_ + 0.75f * delay_nanos;
-            if (delay_nanos > 0 && started_)
+            if (delay_nanos > 0 && started_) {
+                TTimePoint wake_deadline = nanos() + delay_nanos;
                 sleep_for(delay_nanos);
+                recordPeriod(delay_nanos, wake_deadline);
+            }
+            else if (started_ && !is_first_period_)
+                recordPeriod(0, 0);
         }
     }
 
@@ -236,6 +357,15 @@ private:
 
     double sleep_time_avg_;
 
+    //Hybrid is opt in, e.g. with the PhysicsWaitStrategy setting, default Windows timer resolution is too coarse for it
+    std::atomic<WaitStrategy> wait_strategy_{ WaitStrategy::Spin };
+    std::atomic<uint64_t> spin_window_nanos_{ kDefaultSpinWindowNanos };
+
+    std::atomic<uint64_t> period_count_{ 0 };
+    std::atomic<uint64_t> overrun_count_{ 0 };
+    std::atomic<uint64_t> max_jitter_nanos_{ 0 };
+    std::array<std::atomic<uint64_t>, kJitterBinCount> jitter_histogram_{};
+
     std::mutex mutex_;
 };
 }
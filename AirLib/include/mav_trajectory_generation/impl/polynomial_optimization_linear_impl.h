@@ -24,6 +24,7 @@
 #define GLOG_NO_ABBREVIATED_SEVERITIES
 #include <glog/logging.h>
 #include <Eigen/Sparse>
+#include <algorithm>
 #include <set>
 #include <tuple>
 
@@ -36,6 +37,8 @@
 #endif
 
 #include "mav_trajectory_generation/convolution.h"
+#include "mav_trajectory_generation/polynomial_evaluator.h"
+#include "mav_trajectory_generation/timing.h"
 
 
 
@@ -49,7 +52,8 @@ PolynomialOptimization<_N>::PolynomialOptimization(size_t dimension)
       n_segments_(0),
       n_all_constraints_(0),
       n_fixed_constraints_(0),
-      n_free_constraints_(0) {
+      n_free_constraints_(0),
+      linear_solver_type_(kSparseQR) {
   fixed_constraints_compact_.resize(dimension_);
   free_constraints_compact_.resize(dimension_);
 }
@@ -106,6 +110,8 @@ bool PolynomialOptimization<_N>::setupFromVertices(
   }
   updateSegmentTimes(times);
   setupConstraintReorderingMatrix();
+  cached_factorization_.reset();
+  resetLinearSolveStats();
   return true;
 }
 
@@ -258,6 +264,15 @@ void PolynomialOptimization<_N>::setupConstraintReorderingMatrix() {
 
   constraint_reordering_.setFromTriplets(reordering_list.begin(),
                                          reordering_list.end());
+
+  reordered_constraint_idx_.assign(n_all_constraints_, 0);
+  for (int k = 0; k < constraint_reordering_.outerSize(); ++k) {
+    for (Eigen::SparseMatrix<double>::InnerIterator it(constraint_reordering_,
+                                                       k);
+         it; ++it) {
+      reordered_constraint_idx_[it.row()] = it.col();
+    }
+  }
 }
 
 template <int _N>
@@ -336,6 +351,42 @@ void PolynomialOptimization<_N>::constructR(
        constraint_reordering_;
 }
 
+template <int _N>
+void PolynomialOptimization<_N>::constructRppAndRpf(
+    Eigen::SparseMatrix<double>* Rpp, Eigen::SparseMatrix<double>* Rpf) const {
+  CHECK_NOTNULL(Rpp);
+  CHECK_NOTNULL(Rpf);
+  typedef Eigen::Triplet<double> Triplet;
+  std::vector<Triplet> rpp_triplets, rpf_triplets;
+  rpp_triplets.reserve(N * N * n_segments_);
+  rpf_triplets.reserve(N * N * n_segments_);
+
+  // Every row and column of C holding a single one, the entries of
+  // R = C^T * H * C are sums of entries of the block-H.
+  const int n_fixed = n_fixed_constraints_;
+  for (size_t i = 0; i < n_segments_; ++i) {
+    const SquareMatrix& Ai = inverse_mapping_matrices_[i];
+    const SquareMatrix& Q = cost_matrices_[i];
+    const SquareMatrix H = Ai.transpose() * Q * Ai;
+    const int* idx = &reordered_constraint_idx_[i * N];
+    for (int row = 0; row < N; ++row) {
+      if (idx[row] < n_fixed) continue;
+      for (int col = 0; col < N; ++col) {
+        if (idx[col] < n_fixed) {
+          rpf_triplets.emplace_back(idx[row] - n_fixed, idx[col], H(row, col));
+        } else {
+          rpp_triplets.emplace_back(idx[row] - n_fixed, idx[col] - n_fixed,
+                                    H(row, col));
+        }
+      }
+    }
+  }
+  *Rpp = Eigen::SparseMatrix<double>(n_free_constraints_, n_free_constraints_);
+  Rpp->setFromTriplets(rpp_triplets.begin(), rpp_triplets.end());
+  *Rpf = Eigen::SparseMatrix<double>(n_free_constraints_, n_fixed_constraints_);
+  Rpf->setFromTriplets(rpf_triplets.begin(), rpf_triplets.end());
+}
+
 template <int _N>
 bool PolynomialOptimization<_N>::solveLinear() {
   CHECK(derivative_to_optimize_ >= 0 &&
@@ -352,33 +403,96 @@ bool PolynomialOptimization<_N>::solveLinear() {
   // TODO(acmarkus): figure out if sparse becomes less efficient for small
   // problems, and switch back to dense in case.
 
-  // Compute cost matrix for the unconstrained optimization problem.
-  // Block-wise H = A^{-T}QA^{-1} according to [1]
-  Eigen::SparseMatrix<double> R;
-  constructR(&R);
-
-  // Extract block matrices and prepare solver.
-  Eigen::SparseMatrix<double> Rpf = R.block(
-      n_fixed_constraints_, 0, n_free_constraints_, n_fixed_constraints_);
-  Eigen::SparseMatrix<double> Rpp =
-      R.block(n_fixed_constraints_, n_fixed_constraints_, n_free_constraints_,
-              n_free_constraints_);
-  Eigen::SparseQR<Eigen::SparseMatrix<double>, Eigen::COLAMDOrdering<int>>
-      solver;
-  solver.compute(Rpp);
-
-  // Compute dp_opt for every dimension.
+  timing::MiniTimer timer;
+  ++linear_solve_stats_.n_solves;
+
+  // Compute the blocks of the cost matrix for the unconstrained optimization
+  // problem. Block-wise H = A^{-T}QA^{-1} according to [1]
+  Eigen::SparseMatrix<double> Rpp, Rpf;
+  constructRppAndRpf(&Rpp, &Rpf);
+  linear_solve_stats_.construct_time += timer.stop();
+
+  std::vector<Eigen::VectorXd> df(dimension_);
   for (size_t dimension_idx = 0; dimension_idx < dimension_; ++dimension_idx) {
-    Eigen::VectorXd df =
+    df[dimension_idx] =
         -Rpf * fixed_constraints_compact_[dimension_idx];  // Rpf = Rfp^T
-    free_constraints_compact_[dimension_idx] =
-        solver.solve(df);  // dp = -Rpp^-1 * Rpf * df
+  }
+
+  // Compute dp_opt for every dimension, dp = -Rpp^-1 * Rpf * df.
+  bool solved = false;
+  if (linear_solver_type_ == kCachedCholesky) {
+    timer.start();
+    bool pattern_analyzed = false;
+    const bool factorized =
+        cached_factorization_.compute(Rpp, &pattern_analyzed);
+    if (pattern_analyzed) ++linear_solve_stats_.n_pattern_analyses;
+    linear_solve_stats_.factorize_time += timer.stop();
+
+    timer.start();
+    solved = factorized;
+    for (size_t dimension_idx = 0; solved && dimension_idx < dimension_;
+         ++dimension_idx) {
+      const Eigen::VectorXd& b = df[dimension_idx];
+      Eigen::VectorXd dp = cached_factorization_.solve(b);
+      // The LDL^T factorization does not pivot, check that it held up.
+      solved = dp.allFinite() &&
+               (Rpp * dp - b).norm() <= 1e-8 * std::max(b.norm(), 1.0);
+      free_constraints_compact_[dimension_idx] = dp;
+    }
+    linear_solve_stats_.solve_time += timer.stop();
+    if (!solved) ++linear_solve_stats_.n_fallbacks;
+  }
+
+  if (!solved) {
+    timer.start();
+    Eigen::SparseQR<Eigen::SparseMatrix<double>, Eigen::COLAMDOrdering<int>>
+        solver;
+    solver.compute(Rpp);
+    linear_solve_stats_.factorize_time += timer.stop();
+
+    timer.start();
+    for (size_t dimension_idx = 0; dimension_idx < dimension_;
+         ++dimension_idx) {
+      free_constraints_compact_[dimension_idx] =
+          solver.solve(df[dimension_idx]);
+    }
+    linear_solve_stats_.solve_time += timer.stop();
   }
 
   updateSegmentsFromCompactConstraints();
   return true;
 }
 
+template <int _N>
+bool PolynomialOptimization<_N>::CachedFactorization::compute(
+    const Eigen::SparseMatrix<double>& Rpp, bool* pattern_analyzed) {
+  CHECK(Rpp.isCompressed());
+  const int n_outer = Rpp.outerSize() + 1;
+  const int n_nonzeros = Rpp.nonZeros();
+  const bool same_pattern =
+      outer_index_.size() == static_cast<size_t>(n_outer) &&
+      inner_index_.size() == static_cast<size_t>(n_nonzeros) &&
+      std::equal(outer_index_.begin(), outer_index_.end(),
+                 Rpp.outerIndexPtr()) &&
+      std::equal(inner_index_.begin(), inner_index_.end(),
+                 Rpp.innerIndexPtr());
+
+  *pattern_analyzed = !same_pattern;
+  if (!same_pattern) {
+    outer_index_.assign(Rpp.outerIndexPtr(), Rpp.outerIndexPtr() + n_outer);
+    inner_index_.assign(Rpp.innerIndexPtr(),
+                        Rpp.innerIndexPtr() + n_nonzeros);
+    solver_.analyzePattern(Rpp);
+  }
+  solver_.factorize(Rpp);
+  if (solver_.info() != Eigen::Success) {
+    // Analyze again next time, the failure may have left the solver unusable.
+    reset();
+    return false;
+  }
+  return true;
+}
+
 template <int _N>
 void PolynomialOptimization<_N>::printReorderingMatrix(
     std::ostream& stream) const {
@@ -415,31 +529,41 @@ void PolynomialOptimization<_N>::
     computeSegmentMaximumMagnitudeCandidatesBySampling(
         const Segment& segment, double t_start, double t_stop, double dt,
         std::vector<double>* candidates) {
-  Eigen::VectorXd value_old, value_start;
-  value_start = segment.evaluate(t_start - dt, Derivative);
-
-  value_old = segment.evaluate(t_start, Derivative);
+  // Sample times are t_start - dt, t_start and then steps of dt until
+  // t_stop + dt, all of them are evaluated in one batch.
+  std::vector<double> times;
+  times.push_back(t_start - dt);
+  times.push_back(t_start);
+  for (double t = t_start + dt; t < t_stop + dt; t += dt) {
+    times.push_back(t);
+  }
+  const int D = segment.D();
+  std::vector<double> values(times.size() * D);
+  evaluateSegment(segment, Derivative, times.data(), times.size(),
+                  values.data());
+  const Eigen::Map<const Eigen::MatrixXd> samples(values.data(), D,
+                                                  times.size());
 
   // Determine initial direction from t_start -dt to t_start.
   // t_start may be an extremum, especially for start and end vertices!
-  double direction = value_old.norm() - value_start.norm();
+  double norm_old = samples.col(1).norm();
+  double direction = norm_old - samples.col(0).norm();
 
   // Continue with direction from t_start to t_start + dt until t_stop + dt.
   // Again, there may be an extremum at t_stop (e.g. end vertex).
-  for (double t = t_start + dt; t < t_stop + dt; t += dt) {
-    Eigen::VectorXd value_new;
-    value_new = segment.evaluate(t, Derivative);
-
-    double direction_new = value_new.norm() - value_old.norm();
+  for (size_t i = 2; i < times.size(); ++i) {
+    const double norm_new = samples.col(i).norm();
+    double direction_new = norm_new - norm_old;
 
     if (std::signbit(direction) != std::signbit(direction_new)) {
-      Eigen::VectorXd value_deriv = segment.evaluate(t - dt, Derivative + 1);
+      Eigen::VectorXd value_deriv =
+          segment.evaluate(times[i - 1], Derivative + 1);
       if (value_deriv.norm() < 1e-2) {
-        candidates->push_back(t - dt);  // extremum was at last dt
+        candidates->push_back(times[i - 1]);  // extremum was at last dt
       }
     }
 
-    value_old = value_new;
+    norm_old = norm_new;
     direction = direction_new;
   }
 }
@@ -458,17 +582,25 @@ Extremum PolynomialOptimization<_N>::computeMaximumOfMagnitude(
 
   int segment_idx = 0;
   Extremum extremum;
+  std::vector<double> extrema_times;
+  std::vector<double> values;
   for (const Segment& s : segments_) {
-    std::vector<double> extrema_times;
+    extrema_times.clear();
     extrema_times.reserve(N - 1);
     // Add the beginning as well. Call below appends its extrema.
     extrema_times.push_back(0.0);
     computeSegmentMaximumMagnitudeCandidates(derivative, s, 0.0, s.getTime(),
                                              &extrema_times);
 
-    for (double t : extrema_times) {
-      const Extremum candidate(t, s.evaluate(t, derivative).norm(),
-                               segment_idx);
+    const int D = s.D();
+    values.resize(extrema_times.size() * D);
+    evaluateSegment(s, derivative, extrema_times.data(), extrema_times.size(),
+                    values.data());
+    for (size_t i = 0; i < extrema_times.size(); ++i) {
+      const double t = extrema_times[i];
+      const Extremum candidate(
+          t, Eigen::Map<const Eigen::VectorXd>(values.data() + i * D, D).norm(),
+          segment_idx);
       if (extremum < candidate) extremum = candidate;
       if (candidates != nullptr) candidates->emplace_back(candidate);
     }
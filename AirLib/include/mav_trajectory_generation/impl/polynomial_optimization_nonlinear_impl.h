@@ -19,8 +19,10 @@
 #define MAV_TRAJECTORY_GENERATION_IMPL_POLYNOMIAL_OPTIMIZATION_NONLINEAR_IMPL_H_
 
 #include <chrono>
+#include <cmath>
 #include <numeric>
 
+#include "mav_trajectory_generation/polynomial_evaluator.h"
 #include "mav_trajectory_generation/polynomial_optimization_linear.h"
 #include "mav_trajectory_generation/timing.h"
 
@@ -37,6 +39,15 @@ inline std::ostream& operator<<(std::ostream& stream,
   stream << "  cost time:             " << val.cost_time << std::endl;
   stream << "  cost soft constraints: " << val.cost_soft_constraints
          << std::endl;
+  stream << "  cost collision:        " << val.cost_collision << std::endl;
+  const LinearSolveStats& linear = val.linear_solve_stats;
+  stream << "  linear solves:         " << linear.n_solves << " ("
+         << linear.n_pattern_analyses << " pattern analyses, "
+         << linear.n_fallbacks << " QR fallbacks)" << std::endl;
+  stream << "  linear solve time:     " << linear.meanSolveTime()
+         << " mean, construct " << linear.construct_time << " factorize "
+         << linear.factorize_time << " solve " << linear.solve_time
+         << std::endl;
   stream << "  maxima: " << std::endl;
   for (const auto& m : val.maxima) {
     stream << "    " << positionDerivativeToString(m.first) << ": "
@@ -57,6 +68,10 @@ bool PolynomialOptimizationNonLinear<_N>::setupFromVertices(
     int derivative_to_optimize) {
   bool ret = poly_opt_.setupFromVertices(vertices, segment_times,
                                          derivative_to_optimize);
+  poly_opt_.setLinearSolverType(
+      optimization_parameters_.cache_linear_factorization
+          ? PolynomialOptimization<N>::kCachedCholesky
+          : PolynomialOptimization<N>::kSparseQR);
 
   size_t n_optimization_parameters;
   switch (optimization_parameters_.time_alloc_method) {
@@ -97,8 +112,22 @@ bool PolynomialOptimizationNonLinear<_N>::solveLinear() {
 template <int _N>
 int PolynomialOptimizationNonLinear<_N>::optimize() {
   optimization_info_ = OptimizationInfo();
+  poly_opt_.resetLinearSolveStats();
   int result = nlopt::FAILURE;
 
+  if (collision_cost_) {
+    // Keep the samples per segment fixed, so that the collision cost does not
+    // jump when a segment gains or loses a sample.
+    std::vector<double> segment_times;
+    poly_opt_.getSegmentTimes(segment_times);
+    collision_cost_->samples_per_segment.clear();
+    for (double t : segment_times) {
+      collision_cost_->samples_per_segment.push_back(std::max(
+          1, static_cast<int>(
+                 std::ceil(t / collision_cost_->sampling_interval))));
+    }
+  }
+
   const std::chrono::high_resolution_clock::time_point t_start =
       std::chrono::high_resolution_clock::now();
 
@@ -126,6 +155,7 @@ int PolynomialOptimizationNonLinear<_N>::optimize() {
           .count();
 
   optimization_info_.stopping_reason = result;
+  optimization_info_.linear_solve_stats = poly_opt_.getLinearSolveStats();
 
   return result;
 }
@@ -283,8 +313,9 @@ double PolynomialOptimizationNonLinear<_N>::getTotalCostWithSoftConstraints()
   double cost_constraints = evaluateMaximumMagnitudeAsSoftConstraint(
       inequality_constraints_, optimization_parameters_.soft_constraint_weight,
       1e9);
+  double cost_collision = evaluateCollisionCost();
 
-  return cost_trajectory + cost_time + cost_constraints;
+  return cost_trajectory + cost_time + cost_constraints + cost_collision;
 }
 
 template <int _N>
@@ -294,7 +325,20 @@ double PolynomialOptimizationNonLinear<_N>::getCostAndGradientMellinger(
   // Retrieve the current segment times
   std::vector<double> segment_times;
   poly_opt_.getSegmentTimes(segment_times);
-  const double J_d = poly_opt_.computeCost();
+  double J_d = poly_opt_.computeCost();
+
+  // The collision cost is added to J_d. For the gradient it is linearized
+  // around the current samples with the distance gradient, so the perturbed
+  // trajectories below do not query the distance function again.
+  Eigen::Matrix3Xd collision_positions, collision_penalty_gradients;
+  Eigen::VectorXd collision_lengths, collision_penalties;
+  if (collision_cost_) {
+    const double J_c = evaluateCollisionCost(
+        &collision_positions, &collision_lengths, &collision_penalties,
+        gradients != NULL ? &collision_penalty_gradients : nullptr);
+    optimization_info_.cost_collision = J_c;
+    J_d += J_c;
+  }
 
   if (poly_opt_.getNumberSegments() == 1) {
     if (gradients != NULL) {
@@ -350,7 +394,22 @@ double PolynomialOptimizationNonLinear<_N>::getCostAndGradientMellinger(
       poly_opt_.solveLinear();
 
       // Calculate cost and gradient with new segment time
-      const double J_d_bigger = poly_opt_.computeCost();
+      double J_d_bigger = poly_opt_.computeCost();
+      if (collision_cost_) {
+        Eigen::Matrix3Xd positions_bigger;
+        Eigen::VectorXd lengths_bigger;
+        getCollisionSamples(&positions_bigger, &lengths_bigger);
+        const double J_c_change =
+            collision_cost_->weight *
+            ((lengths_bigger - collision_lengths).dot(collision_penalties) +
+             collision_lengths.dot(
+                 (collision_penalty_gradients.cwiseProduct(
+                      positions_bigger - collision_positions))
+                     .colwise()
+                     .sum()
+                     .transpose()));
+        J_d_bigger += optimization_info_.cost_collision + J_c_change;
+      }
       const double dJd_dt = (J_d_bigger - J_d) / increment_time;
 
       // Calculate the gradient
@@ -556,6 +615,110 @@ bool PolynomialOptimizationNonLinear<_N>::addMaximumMagnitudeConstraint(
   return true;
 }
 
+template <int _N>
+bool PolynomialOptimizationNonLinear<_N>::addCollisionCost(
+    const DistanceFunction& distance_function, double clearance,
+    double weight, double sampling_interval) {
+  CHECK(distance_function);
+  CHECK_GE(poly_opt_.getDimension(), 3u)
+      << "The collision cost needs a 3D position.";
+  CHECK_GE(weight, 0.0);
+  CHECK_GT(sampling_interval, 0.0);
+
+  collision_cost_ = std::make_shared<CollisionCostData>();
+  collision_cost_->distance_function = distance_function;
+  collision_cost_->clearance = clearance;
+  collision_cost_->weight = weight;
+  collision_cost_->sampling_interval = sampling_interval;
+  return true;
+}
+
+template <int _N>
+void PolynomialOptimizationNonLinear<_N>::getCollisionSamples(
+    Eigen::Matrix3Xd* positions, Eigen::VectorXd* lengths) const {
+  CHECK_NOTNULL(positions);
+  CHECK_NOTNULL(lengths);
+  CHECK(collision_cost_);
+
+  Segment::Vector segments;
+  poly_opt_.getSegments(&segments);
+
+  // Samples per segment are only fixed once the optimization runs.
+  std::vector<int> n_samples = collision_cost_->samples_per_segment;
+  if (n_samples.size() != segments.size()) {
+    n_samples.clear();
+    for (const Segment& segment : segments) {
+      n_samples.push_back(std::max(
+          1, static_cast<int>(std::ceil(segment.getTime() /
+                                        collision_cost_->sampling_interval))));
+    }
+  }
+
+  const int n_total = std::accumulate(n_samples.begin(), n_samples.end(), 0);
+  Eigen::MatrixXd values(poly_opt_.getDimension(), n_total);
+  Eigen::MatrixXd velocities(poly_opt_.getDimension(), n_total);
+  lengths->resize(n_total);
+  std::vector<double> times;
+  int first = 0;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    // Midpoints of n_samples[i] equal slices of the segment.
+    const double slice = segments[i].getTime() / n_samples[i];
+    times.resize(n_samples[i]);
+    for (int j = 0; j < n_samples[i]; ++j) {
+      times[j] = (j + 0.5) * slice;
+    }
+    evaluateSegment(segments[i], derivative_order::POSITION, times.data(),
+                    times.size(), values.col(first).data());
+    evaluateSegment(segments[i], derivative_order::VELOCITY, times.data(),
+                    times.size(), velocities.col(first).data());
+    lengths->segment(first, n_samples[i]) =
+        velocities.block(0, first, 3, n_samples[i])
+            .colwise()
+            .norm()
+            .transpose() *
+        slice;
+    first += n_samples[i];
+  }
+  *positions = values.topRows<3>();
+}
+
+template <int _N>
+double PolynomialOptimizationNonLinear<_N>::evaluateCollisionCost(
+    Eigen::Matrix3Xd* positions, Eigen::VectorXd* lengths,
+    Eigen::VectorXd* penalties, Eigen::Matrix3Xd* penalty_gradients) const {
+  if (!collision_cost_) {
+    return 0.0;
+  }
+
+  Eigen::Matrix3Xd sample_positions;
+  Eigen::VectorXd sample_lengths;
+  getCollisionSamples(&sample_positions, &sample_lengths);
+
+  Eigen::VectorXd distances;
+  Eigen::Matrix3Xd distance_gradients;
+  collision_cost_->distance_function(
+      sample_positions, &distances,
+      penalty_gradients != nullptr ? &distance_gradients : nullptr);
+  CHECK_EQ(distances.size(), sample_positions.cols());
+
+  const Eigen::ArrayXd violation =
+      (collision_cost_->clearance - distances.array()).max(0.0);
+  const double cost =
+      collision_cost_->weight *
+      (sample_lengths.array() * violation.square()).sum();
+
+  if (positions != nullptr) *positions = sample_positions;
+  if (lengths != nullptr) *lengths = sample_lengths;
+  if (penalties != nullptr) *penalties = violation.square().matrix();
+  if (penalty_gradients != nullptr) {
+    CHECK_EQ(distance_gradients.cols(), sample_positions.cols());
+    // d/dp max(0, clearance - d(p))^2 = -2 * max(0, clearance - d(p)) * dd/dp
+    *penalty_gradients =
+        distance_gradients * (-2.0 * violation).matrix().asDiagonal();
+  }
+  return cost;
+}
+
 template <int _N>
 double PolynomialOptimizationNonLinear<_N>::objectiveFunctionTime(
     const std::vector<double>& segment_times, std::vector<double>& gradient,
@@ -602,9 +765,12 @@ double PolynomialOptimizationNonLinear<_N>::objectiveFunctionTime(
             optimization_data->inequality_constraints_,
             optimization_data->optimization_parameters_.soft_constraint_weight);
   }
+  const double cost_collision = optimization_data->evaluateCollisionCost();
 
   if (optimization_data->optimization_parameters_.print_debug_info) {
-    std::cout << "  sum: " << cost_trajectory + cost_time + cost_constraints
+    std::cout << "  collision: " << cost_collision << std::endl;
+    std::cout << "  sum: "
+              << cost_trajectory + cost_time + cost_constraints + cost_collision
               << std::endl;
     std::cout << "  total time: " << total_time << std::endl;
   }
@@ -614,8 +780,9 @@ double PolynomialOptimizationNonLinear<_N>::objectiveFunctionTime(
   optimization_data->optimization_info_.cost_time = cost_time;
   optimization_data->optimization_info_.cost_soft_constraints =
       cost_constraints;
+  optimization_data->optimization_info_.cost_collision = cost_collision;
 
-  return cost_trajectory + cost_time + cost_constraints;
+  return cost_trajectory + cost_time + cost_constraints + cost_collision;
 }
 
 template <int _N>
@@ -654,8 +821,10 @@ PolynomialOptimizationNonLinear<_N>::objectiveFunctionTimeMellingerOuterLoop(
     std::cout << "  sum: " << cost_trajectory << std::endl;
   }
 
+  // getCostAndGradientMellinger() already stored the collision part.
   optimization_data->optimization_info_.n_iterations++;
-  optimization_data->optimization_info_.cost_trajectory = cost_trajectory;
+  optimization_data->optimization_info_.cost_trajectory =
+      cost_trajectory - optimization_data->optimization_info_.cost_collision;
 
   return cost_trajectory;
 }
@@ -729,9 +898,12 @@ double PolynomialOptimizationNonLinear<_N>::objectiveFunctionTimeAndConstraints(
             optimization_data->inequality_constraints_,
             optimization_data->optimization_parameters_.soft_constraint_weight);
   }
+  const double cost_collision = optimization_data->evaluateCollisionCost();
 
   if (optimization_data->optimization_parameters_.print_debug_info) {
-    std::cout << "  sum: " << cost_trajectory + cost_time + cost_constraints
+    std::cout << "  collision: " << cost_collision << std::endl;
+    std::cout << "  sum: "
+              << cost_trajectory + cost_time + cost_constraints + cost_collision
               << std::endl;
     std::cout << "  total time: " << total_time << std::endl;
   }
@@ -741,8 +913,9 @@ double PolynomialOptimizationNonLinear<_N>::objectiveFunctionTimeAndConstraints(
   optimization_data->optimization_info_.cost_time = cost_time;
   optimization_data->optimization_info_.cost_soft_constraints =
       cost_constraints;
+  optimization_data->optimization_info_.cost_collision = cost_collision;
 
-  return cost_trajectory + cost_time + cost_constraints;
+  return cost_trajectory + cost_time + cost_constraints + cost_collision;
 }
 
 template <int _N>
@@ -122,11 +122,10 @@ class Polynomial {
 
     const int tmp = N_ - 1;
     for (int i = 0; i < max_deg; i++) {
-      Eigen::RowVectorXd row = base_coefficients_.block(i, 0, 1, N_);
-      double acc = row[tmp] * coefficients_[tmp];
+      double acc = base_coefficients_(i, tmp) * coefficients_[tmp];
       for (int j = tmp - 1; j >= i; --j) {
         acc *= t;
-        acc += row[j] * coefficients_[j];
+        acc += base_coefficients_(i, j) * coefficients_[j];
       }
       (*result)[i] = acc;
     }
@@ -140,11 +139,10 @@ class Polynomial {
     }
     double result;
     const int tmp = N_ - 1;
-    Eigen::RowVectorXd row = base_coefficients_.block(derivative, 0, 1, N_);
-    result = row[tmp] * coefficients_[tmp];
+    result = base_coefficients_(derivative, tmp) * coefficients_[tmp];
     for (int j = tmp - 1; j >= derivative; --j) {
       result *= t;
-      result += row[j] * coefficients_[j];
+      result += base_coefficients_(derivative, j) * coefficients_[j];
     }
     return result;
   }
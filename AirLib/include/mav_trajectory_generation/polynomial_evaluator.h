@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef MAV_TRAJECTORY_GENERATION_POLYNOMIAL_EVALUATOR_H_
+#define MAV_TRAJECTORY_GENERATION_POLYNOMIAL_EVALUATOR_H_
+
+#include <Eigen/Core>
+#include <algorithm>
+
+#include "mav_trajectory_generation/segment.h"
+
+namespace mav_trajectory_generation {
+
+// Evaluates one derivative of all dimensions of a segment with a compile time
+// number of coefficients N and dimensions D.
+// The derivative factors are folded into a copy of the coefficients when the
+// evaluator is made, so evaluation is a Horner pass where each step is one
+// multiply-add over all dimensions. Dimensions are padded to an even count so
+// Eigen vectorizes that step. Batches run kBatch Horner chains side by side,
+// which hides the latency of the dependent multiply-adds of a single chain.
+// Nothing is allocated.
+template <int N, int D>
+class FixedSegmentEvaluator {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  static constexpr int kPaddedD = (D + 1) / 2 * 2;
+  static constexpr int kBatch = 4;
+  typedef Eigen::Matrix<double, D, 1> Vector;
+
+  FixedSegmentEvaluator(const Segment& segment, int derivative)
+      : n_terms_(std::max(N - derivative, 0)) {
+    CHECK_EQ(segment.N(), N);
+    CHECK_EQ(segment.D(), D);
+    coefficients_.setZero();
+    if (n_terms_ == 0) {
+      return;
+    }
+    for (int d = 0; d < D; ++d) {
+      coefficients_.row(d) =
+          segment[d].getCoefficients(derivative).transpose();
+    }
+  }
+
+  Vector evaluate(double t) const {
+    PaddedVector acc = coefficients_.col(std::max(n_terms_ - 1, 0));
+    for (int j = n_terms_ - 2; j >= 0; --j) {
+      acc = acc * t + coefficients_.col(j);
+    }
+    return acc.template head<D>();
+  }
+
+  // Writes the values at times[0..count) to result, D doubles per time.
+  void evaluate(const double* times, size_t count, double* result) const {
+    size_t i = 0;
+    for (; i + kBatch <= count; i += kBatch) {
+      PaddedVector acc[kBatch];
+      for (int k = 0; k < kBatch; ++k) {
+        acc[k] = coefficients_.col(std::max(n_terms_ - 1, 0));
+      }
+      for (int j = n_terms_ - 2; j >= 0; --j) {
+        for (int k = 0; k < kBatch; ++k) {
+          acc[k] = acc[k] * times[i + k] + coefficients_.col(j);
+        }
+      }
+      for (int k = 0; k < kBatch; ++k) {
+        Eigen::Map<Vector>(result + (i + k) * D) = acc[k].template head<D>();
+      }
+    }
+    for (; i < count; ++i) {
+      Eigen::Map<Vector>(result + i * D) = evaluate(times[i]);
+    }
+  }
+
+ private:
+  typedef Eigen::Matrix<double, kPaddedD, 1> PaddedVector;
+
+  // column j is multiplied with t^j, padding rows stay zero
+  Eigen::Matrix<double, kPaddedD, N> coefficients_;
+  int n_terms_;
+};
+
+// Evaluates the given derivative of all dimensions of segment at
+// times[0..count) and writes the values to result, segment.D() doubles per
+// time. Segments with the N and D used for planning go through
+// FixedSegmentEvaluator, others are evaluated one polynomial at a time.
+void evaluateSegment(const Segment& segment, int derivative,
+                     const double* times, size_t count, double* result);
+
+}  // namespace mav_trajectory_generation
+
+#endif  // MAV_TRAJECTORY_GENERATION_POLYNOMIAL_EVALUATOR_H_
@@ -34,6 +34,25 @@
 
 namespace mav_trajectory_generation {
 
+// Counters and accumulated wall times in seconds of solveLinear() since the
+// last setupFromVertices() or resetLinearSolveStats().
+struct LinearSolveStats {
+  int n_solves = 0;
+  // Number of times the sparsity pattern of Rpp was analyzed.
+  int n_pattern_analyses = 0;
+  // Number of solves that fell back to the sparse QR solver.
+  int n_fallbacks = 0;
+  double construct_time = 0.0;
+  double factorize_time = 0.0;
+  double solve_time = 0.0;
+
+  double meanSolveTime() const {
+    return n_solves > 0
+               ? (construct_time + factorize_time + solve_time) / n_solves
+               : 0.0;
+  }
+};
+
 // Implements the unconstrained optimization of paths consisting of
 // polynomial segments as described in [1]
 // [1]: Polynomial Trajectory Planning for Aggressive Quadrotor Flight in Dense
@@ -49,6 +68,12 @@ class PolynomialOptimization {
  public:
   enum { N = _N };
   static constexpr int kHighestDerivativeToOptimize = N / 2 - 1;
+  // kSparseQR factorizes Rpp from scratch in every solve.
+  // kCachedCholesky analyzes the sparsity pattern of Rpp once and only
+  // refactorizes numerically while the pattern stays the same, which is the
+  // case when updateSegmentTimes() is called in a loop. Solves whose residual
+  // is off, e.g. because Rpp is close to singular, are repeated with kSparseQR.
+  enum LinearSolverType { kSparseQR, kCachedCholesky };
   typedef Eigen::Matrix<double, N, N> SquareMatrix;
   typedef std::vector<SquareMatrix, Eigen::aligned_allocator<SquareMatrix> >
       SquareMatrixVector;
@@ -107,6 +132,14 @@ class PolynomialOptimization {
   //    course differ.
   bool solveLinear();
 
+  void setLinearSolverType(LinearSolverType type) { linear_solver_type_ = type; }
+  LinearSolverType getLinearSolverType() const { return linear_solver_type_; }
+
+  const LinearSolveStats& getLinearSolveStats() const {
+    return linear_solve_stats_;
+  }
+  void resetLinearSolveStats() { linear_solve_stats_ = LinearSolveStats(); }
+
   // Returns the trajectory created by the optimization.
   // Only valid after solveLinear() is called. This is the preferred external
   // interface for getting information back out of the solver.
@@ -235,6 +268,11 @@ class PolynomialOptimization {
   // Constructs the sparse R (cost) matrix.
   void constructR(Eigen::SparseMatrix<double>* R) const;
 
+  // Constructs the blocks of R that solveLinear() needs directly from the
+  // segment cost blocks, without the products with the reordering matrix.
+  void constructRppAndRpf(Eigen::SparseMatrix<double>* Rpp,
+                          Eigen::SparseMatrix<double>* Rpf) const;
+
   // Sets up the matrix (C in [1]) that reorders constraints for the
   // optimization problem.
   // This matrix is the same for each dimension, i.e. each dimension must have
@@ -245,10 +283,45 @@ class PolynomialOptimization {
   // and free constraints.
   void updateSegmentsFromCompactConstraints();
 
+  // Sparse Cholesky factorization of Rpp that keeps the analysis of the
+  // sparsity pattern between solves. Copies start without a factorization.
+  class CachedFactorization {
+   public:
+    CachedFactorization() {}
+    CachedFactorization(const CachedFactorization&) {}
+    CachedFactorization& operator=(const CachedFactorization&) {
+      reset();
+      return *this;
+    }
+
+    void reset() {
+      outer_index_.clear();
+      inner_index_.clear();
+    }
+
+    // Factorizes Rpp, analyzing its pattern first if it differs from the
+    // previous one. Returns false if the factorization failed.
+    bool compute(const Eigen::SparseMatrix<double>& Rpp,
+                 bool* pattern_analyzed);
+
+    Eigen::VectorXd solve(const Eigen::VectorXd& b) const {
+      return solver_.solve(b);
+    }
+
+   private:
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double> > solver_;
+    std::vector<int> outer_index_;
+    std::vector<int> inner_index_;
+  };
+
   // Matrix consisting of entries with value 1 to reorder free and fixed
   // constraints (C in [1]).
   Eigen::SparseMatrix<double> constraint_reordering_;
 
+  // Column of the only nonzero of each row of constraint_reordering_, i.e.
+  // the index in [d_f; d_p] of each segment boundary constraint.
+  std::vector<int> reordered_constraint_idx_;
+
   // Original vertices containing the constraints.
   Vertex::Vector vertices_;
 
@@ -282,6 +355,10 @@ class PolynomialOptimization {
   size_t n_all_constraints_;
   size_t n_fixed_constraints_;
   size_t n_free_constraints_;
+
+  LinearSolverType linear_solver_type_;
+  CachedFactorization cached_factorization_;
+  LinearSolveStats linear_solve_stats_;
 };
 
 // Constraint class that aggregates all constraints from incoming Vertices.
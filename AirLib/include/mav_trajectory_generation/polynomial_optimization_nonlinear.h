@@ -21,6 +21,7 @@
 #ifndef MAV_TRAJECTORY_GENERATION_POLYNOMIAL_OPTIMIZATION_NONLINEAR_H_
 #define MAV_TRAJECTORY_GENERATION_POLYNOMIAL_OPTIMIZATION_NONLINEAR_H_
 
+#include <functional>
 #include <memory>
 #include <nlopt.hpp>
 
@@ -94,6 +95,10 @@ struct NonlinearOptimizationParameters {
     kUnknown
   } time_alloc_method = kSquaredTimeAndConstraints;
 
+  // Keep the sparsity analysis of the linear problem between the iterations,
+  // see PolynomialOptimization::kCachedCholesky.
+  bool cache_linear_factorization = true;
+
   bool print_debug_info = false;
   bool print_debug_info_time_allocation = false;
 };
@@ -104,12 +109,22 @@ struct OptimizationInfo {
   double cost_trajectory = 0.0;
   double cost_time = 0.0;
   double cost_soft_constraints = 0.0;
+  double cost_collision = 0.0;
   double optimization_time = 0.0;
+  LinearSolveStats linear_solve_stats;
   std::map<int, Extremum> maxima;
 };
 
 std::ostream& operator<<(std::ostream& stream, const OptimizationInfo& val);
 
+// Writes the signed distance to the closest obstacle at each column of
+// positions to distances and, if gradients is not null, the gradient of the
+// distance at each position to the columns of gradients.
+typedef std::function<void(const Eigen::Matrix3Xd& positions,
+                           Eigen::VectorXd* distances,
+                           Eigen::Matrix3Xd* gradients)>
+    DistanceFunction;
+
 // Implements a nonlinear optimization of the unconstrained optimization
 // of paths consisting of polynomial segments as described in [1]
 // [1]: Polynomial Trajectory Planning for Aggressive Quadrotor Flight in Dense
@@ -158,6 +173,20 @@ class PolynomialOptimizationNonLinear {
   bool addMaximumMagnitudeConstraint(int derivative_order,
                                      double maximum_value);
 
+  // Adds a collision cost to the optimization problem, which penalizes
+  // positions closer to an obstacle than the given clearance:
+  // cost = weight * sum_k ds_k * max(0, clearance - distance_k)^2
+  // where ds_k is the path length sample k stands for, so the cost can not be
+  // lowered by flying faster through an obstacle. The first three dimensions
+  // are the position. The trajectory is sampled at sampling_interval apart
+  // for the initial segment times, every segment keeps its number of samples
+  // during the optimization.
+  // The time allocation of the Mellinger outer loop uses the distance
+  // gradient for the change of this cost with the segment times.
+  bool addCollisionCost(const DistanceFunction& distance_function,
+                        double clearance, double weight,
+                        double sampling_interval = 0.1);
+
   // Solves the linear optimization problem according to [1].
   // The solver is re-used for every dimension, which means:
   //  - segment times are equal for each dimension.
@@ -215,6 +244,31 @@ class PolynomialOptimizationNonLinear {
     double value;
   };
 
+  // Holds the data for the collision cost.
+  struct CollisionCostData {
+    DistanceFunction distance_function;
+    double clearance;
+    double weight;
+    double sampling_interval;
+    // Fixed when the optimization starts.
+    std::vector<int> samples_per_segment;
+  };
+
+  // Collision samples of the current trajectory: the positions at evenly
+  // spaced times on every segment and the path length each sample stands for.
+  void getCollisionSamples(Eigen::Matrix3Xd* positions,
+                           Eigen::VectorXd* lengths) const;
+
+  // Collision cost of the current trajectory, see addCollisionCost().
+  // If positions is not null, the samples the cost was evaluated at are
+  // returned together with the path length each of them stands for and the
+  // derivative of their penalty with respect to their position.
+  double evaluateCollisionCost(Eigen::Matrix3Xd* positions = nullptr,
+                               Eigen::VectorXd* lengths = nullptr,
+                               Eigen::VectorXd* penalties = nullptr,
+                               Eigen::Matrix3Xd* penalty_gradients =
+                                   nullptr) const;
+
   // Objective function for the time-only version.
   // Input: segment_times = Segment times in the current iteration.
   // Input: gradient = Gradient of the objective function w.r.t. changes of
@@ -306,6 +360,9 @@ class PolynomialOptimizationNonLinear {
   // Holds the data for evaluating inequality constraints.
   std::vector<std::shared_ptr<ConstraintData> > inequality_constraints_;
 
+  // Set by addCollisionCost().
+  std::shared_ptr<CollisionCostData> collision_cost_;
+
   OptimizationInfo optimization_info_;
 };
 
@@ -120,6 +120,13 @@ class Trajectory {
                      int derivative_order, std::vector<Eigen::VectorXd>* result,
                      std::vector<double>* sampling_times = nullptr) const;
 
+  // Same samples as above as the columns of a D x n_samples matrix. The
+  // samples of each segment are evaluated in one batch, see
+  // polynomial_evaluator.h, and no vector is allocated per sample.
+  void evaluateRange(double t_start, double t_end, double dt,
+                     int derivative_order, Eigen::MatrixXd* result,
+                     std::vector<double>* sampling_times = nullptr) const;
+
   // Compute the analytic minimum and maximum of magnitude for a given
   // derivative and dimensions, e.g., [0, 1, 2] for position or [3] for yaw.
   // Returns false in case of extremum calculation failure.
@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef MAV_TRAJECTORY_GENERATION_TRAJECTORY_EVALUATOR_H_
+#define MAV_TRAJECTORY_GENERATION_TRAJECTORY_EVALUATOR_H_
+
+#include <mav_msgs/eigen_mav_msgs.h>
+#include <vector>
+
+#include "mav_trajectory_generation/trajectory.h"
+
+namespace mav_trajectory_generation {
+
+// Evaluates a trajectory at arbitrary times without sampling it first, so a
+// controller can query its reference at whatever rate it runs.
+// The start time of every segment is cached, and the segment of the last
+// query is remembered. A caller that steps forward in time finds its segment
+// in O(1), instead of the linear scan of Trajectory::evaluate. Jumps to other
+// times fall back to a binary search. Queries from several threads need to
+// be serialized by the caller.
+class TrajectoryEvaluator {
+ public:
+  TrajectoryEvaluator() {}
+  explicit TrajectoryEvaluator(const Trajectory& trajectory) {
+    setTrajectory(trajectory);
+  }
+
+  void setTrajectory(const Trajectory& trajectory);
+  void clear();
+
+  bool empty() const { return trajectory_.empty(); }
+  double getMaxTime() const { return trajectory_.getMaxTime(); }
+  const Trajectory& getTrajectory() const { return trajectory_; }
+
+  // Index of the segment that contains t, clamped to the trajectory. Like
+  // Trajectory::evaluate, a time on a vertex picks the segment after it.
+  size_t getSegmentIndex(double t) const;
+
+  // Times outside [0, getMaxTime()] are clamped to the trajectory.
+  Eigen::VectorXd evaluate(
+      double t, int derivative_order = derivative_order::POSITION) const;
+
+  // Fills position, velocity and acceleration of the first three dimensions.
+  // Jerk and snap are left unchanged because the tracker does not use them.
+  void sample(double t, mav_msgs::EigenTrajectoryPoint* state) const;
+
+ private:
+  Trajectory trajectory_;
+  std::vector<double> segment_start_times_;
+  mutable size_t last_segment_ = 0;
+};
+
+}  // namespace mav_trajectory_generation
+
+#endif  // MAV_TRAJECTORY_GENERATION_TRAJECTORY_EVALUATOR_H_
@@ -13,6 +13,8 @@
 #include "common/CommonStructs.hpp"
 #include "common/SteppableClock.hpp"
 #include <cinttypes>
+#include <array>
+#include <cmath>
 
 namespace msr
 {
@@ -22,8 +24,8 @@ namespace airlib
     class FastPhysicsEngine : public PhysicsEngineBase
     {
     public:
-        FastPhysicsEngine(bool enable_ground_lock = true, Vector3r wind = Vector3r::Zero())
-            : enable_ground_lock_(enable_ground_lock), wind_(wind)
+        FastPhysicsEngine(bool enable_ground_lock = true, Vector3r wind = Vector3r::Zero(), bool enable_batched_update = false)
+            : enable_ground_lock_(enable_ground_lock), enable_batched_update_(enable_batched_update), wind_(wind)
         {
             setName("FastPhysicsEngine");
         }
@@ -47,8 +49,13 @@ namespace airlib
         {
             PhysicsEngineBase::update();
 
-            for (PhysicsBody* body_ptr : *this) {
-                updatePhysics(*body_ptr);
+            if (enable_batched_update_) {
+                updatePhysicsBatched();
+            }
+            else {
+                for (PhysicsBody* body_ptr : *this) {
+                    updatePhysics(*body_ptr);
+                }
             }
         }
         virtual void reportState(StateReporter& reporter) override
@@ -70,6 +77,17 @@ namespace airlib
             wind_ = wind;
         }
 
+        //when enabled, all bodies without pending collision response are integrated together
+        //in one pass over structure-of-arrays buffers instead of one body at a time
+        void setBatchedUpdate(bool enable_batched_update)
+        {
+            enable_batched_update_ = enable_batched_update;
+        }
+        bool isBatchedUpdate() const
+        {
+            return enable_batched_update_;
+        }
+
     private:
         void initPhysicsBody(PhysicsBody* body_ptr)
         {
@@ -81,6 +99,18 @@ namespace airlib
             TTimeDelta dt = clock()->updateSince(body.last_kinematics_time);
 
             body.lock();
+            updatePhysicsLocked(body, dt);
+            body.unlock();
+
+            //TODO: this is now being done in PawnSimApi::update. We need to re-think this sequence
+            //with below commented out - Arducopter GPS may not work.
+            //body.getEnvironment().setPosition(next.pose.position);
+            //body.getEnvironment().update();
+        }
+
+        //caller must hold the body lock
+        void updatePhysicsLocked(PhysicsBody& body, TTimeDelta dt)
+        {
             //get current kinematics state of the body - this state existed since last dt seconds
             const Kinematics::State& current = body.getKinematics();
             Kinematics::State next;
@@ -106,12 +136,51 @@ namespace airlib
 
             body.setWrench(next_wrench);
             body.updateKinematics(next);
-            body.unlock();
+        }
 
-            //TODO: this is now being done in PawnSimApi::update. We need to re-think this sequence
-            //with below commented out - Arducopter GPS may not work.
-            //body.getEnvironment().setPosition(next.pose.position);
-            //body.getEnvironment().update();
+        //bodies that are grounded or have unanswered collision must go through collision response
+        static bool hasPendingCollision(const PhysicsBody& body)
+        {
+            const CollisionInfo& collision_info = body.getCollisionInfo();
+            return body.isGrounded() ||
+                   (collision_info.has_collided && body.getCollisionResponseInfo().collision_time_stamp != collision_info.time_stamp);
+        }
+
+        void updatePhysicsBatched()
+        {
+            batch_.clear();
+
+            //gather: bodies needing collision response take the regular path, others are packed in to batch
+            for (PhysicsBody* body_ptr : *this) {
+                PhysicsBody& body = *body_ptr;
+                TTimeDelta dt = clock()->updateSince(body.last_kinematics_time);
+
+                body.lock();
+                if (hasPendingCollision(body)) {
+                    updatePhysicsLocked(body, dt);
+                    body.unlock();
+                }
+                else //body stays locked until scatter
+                    batch_.add(body, static_cast<real_T>(dt), wind_);
+            }
+
+            //integrate all packed bodies in one pass
+            batch_.integrate();
+
+            //scatter results back to bodies
+            for (uint i = 0; i < batch_.size(); ++i) {
+                PhysicsBody& body = *batch_.body(i);
+                Wrench next_wrench;
+                Kinematics::State next;
+                batch_.getNext(i, next, next_wrench);
+
+                if (VectorMath::hasNan(next.pose.orientation))
+                    Utils::log("orientation had NaN!", Utils::kLogLevelError);
+
+                body.setWrench(next_wrench);
+                body.updateKinematics(next);
+                body.unlock();
+            }
         }
 
         static void updateCollisionResponseInfo(const CollisionInfo& collision_info, const Kinematics::State& next,
@@ -449,6 +518,263 @@ namespace airlib
                 next.pose.orientation = current_pose.orientation;
         }
 
+    private:
+        //Structure-of-arrays buffers for bodies integrated without collision response.
+        //Each field is a contiguous array indexed by slot, the integration works on whole
+        //fields with Eigen array expressions which use SIMD packets, including sin and cos.
+        class BodyBatch
+        {
+        public:
+            uint size() const
+            {
+                return static_cast<uint>(bodies_.size());
+            }
+            PhysicsBody* body(uint index) const
+            {
+                return bodies_[index];
+            }
+            void clear()
+            {
+                bodies_.clear();
+                for (auto& field : fields_)
+                    field.clear();
+            }
+
+            void add(PhysicsBody& body, real_T dt, const Vector3r& wind)
+            {
+                const Kinematics::State& current = body.getKinematics();
+
+                //wrench needs virtual vertex access so it is computed per body while packing
+                const Wrench body_wrench = getBodyWrench(body, current.pose.orientation);
+                const Vector3r avg_linear = current.twist.linear + current.accelerations.linear * (0.5f * dt);
+                const Vector3r avg_angular = current.twist.angular + current.accelerations.angular * (0.5f * dt);
+                const Wrench next_wrench = body_wrench + getDragWrench(body, current.pose.orientation, avg_linear, avg_angular, wind);
+
+                bodies_.push_back(&body);
+                push(Dt, dt);
+                push(Mass, body.getMass());
+                push3(PosX, current.pose.position);
+                push(OriW, current.pose.orientation.w());
+                push(OriX, current.pose.orientation.x());
+                push(OriY, current.pose.orientation.y());
+                push(OriZ, current.pose.orientation.z());
+                push3(LinVelX, current.twist.linear);
+                push3(AngVelX, current.twist.angular);
+                push3(LinAccX, current.accelerations.linear);
+                push3(AngAccX, current.accelerations.angular);
+                push3(ForceX, next_wrench.force);
+                push3(TorqueX, next_wrench.torque);
+                push3(GravityX, body.getEnvironment().getState().gravity);
+                for (int r = 0; r < 3; ++r) {
+                    for (int c = 0; c < 3; ++c) {
+                        push(static_cast<Field>(Inertia00 + r * 3 + c), body.getInertia()(r, c));
+                        push(static_cast<Field>(InertiaInv00 + r * 3 + c), body.getInertiaInv()(r, c));
+                    }
+                }
+            }
+
+            void integrate()
+            {
+                const uint n = size();
+                for (uint f = NextPosX; f < FieldCount; ++f)
+                    fields_[f].resize(n);
+
+                integrateTwist();
+                clipTwist(n);
+                integratePose();
+            }
+
+            void getNext(uint i, Kinematics::State& next, Wrench& next_wrench) const
+            {
+                next.pose.position = get3(NextPosX, i);
+                next.pose.orientation = Quaternionr(get(NextOriW, i), get(NextOriX, i), get(NextOriY, i), get(NextOriZ, i));
+                next.twist.linear = get3(NextLinVelX, i);
+                next.twist.angular = get3(NextAngVelX, i);
+                next.accelerations.linear = get3(NextLinAccX, i);
+                next.accelerations.angular = get3(NextAngAccX, i);
+                next_wrench.force = get3(ForceX, i);
+                next_wrench.torque = get3(TorqueX, i);
+            }
+
+        private:
+            enum Field : uint
+            {
+                //inputs
+                Dt,
+                Mass,
+                PosX,
+                PosY,
+                PosZ,
+                OriW,
+                OriX,
+                OriY,
+                OriZ,
+                LinVelX,
+                LinVelY,
+                LinVelZ,
+                AngVelX,
+                AngVelY,
+                AngVelZ,
+                LinAccX,
+                LinAccY,
+                LinAccZ,
+                AngAccX,
+                AngAccY,
+                AngAccZ,
+                ForceX,
+                ForceY,
+                ForceZ,
+                TorqueX,
+                TorqueY,
+                TorqueZ,
+                GravityX,
+                GravityY,
+                GravityZ,
+                Inertia00,
+                InertiaInv00 = Inertia00 + 9,
+                //outputs
+                NextPosX = InertiaInv00 + 9,
+                NextPosY,
+                NextPosZ,
+                NextOriW,
+                NextOriX,
+                NextOriY,
+                NextOriZ,
+                NextLinVelX,
+                NextLinVelY,
+                NextLinVelZ,
+                NextAngVelX,
+                NextAngVelY,
+                NextAngVelZ,
+                NextLinAccX,
+                NextLinAccY,
+                NextLinAccZ,
+                NextAngAccX,
+                NextAngAccY,
+                NextAngAccZ,
+                AvgLinX,
+                AvgLinY,
+                AvgLinZ,
+                AvgAngX,
+                AvgAngY,
+                AvgAngZ,
+                FieldCount
+            };
+
+            typedef Eigen::Array<real_T, Eigen::Dynamic, 1> Column;
+
+            //a field as Eigen array, so the integration is written as array expressions that Eigen vectorizes
+            Eigen::Map<Column> col(uint field)
+            {
+                return Eigen::Map<Column>(fields_[field].data(), fields_[field].size());
+            }
+            real_T get(uint field, uint i) const
+            {
+                return fields_[field][i];
+            }
+            Vector3r get3(uint field, uint i) const
+            {
+                return Vector3r(fields_[field][i], fields_[field + 1][i], fields_[field + 2][i]);
+            }
+            void push(Field field, real_T value)
+            {
+                fields_[field].push_back(value);
+            }
+            void push3(Field field, const Vector3r& value)
+            {
+                for (uint k = 0; k < 3; ++k)
+                    fields_[field + k].push_back(value[k]);
+            }
+
+            //same math as getNextKinematicsNoCollision for a body that is not grounded
+            void integrateTwist()
+            {
+                const Column half_dt = 0.5f * col(Dt);
+                const auto mass = col(Mass);
+
+                for (uint k = 0; k < 3; ++k) {
+                    col(AvgLinX + k) = col(LinVelX + k) + col(LinAccX + k) * half_dt;
+                    col(AvgAngX + k) = col(AngVelX + k) + col(AngAccX + k) * half_dt;
+                    col(NextLinAccX + k) = col(ForceX + k) / mass + col(GravityX + k);
+                    //Verlet integration
+                    col(NextLinVelX + k) = col(LinVelX + k) + (col(LinAccX + k) + col(NextLinAccX + k)) * half_dt;
+                }
+
+                //Euler's rotation equation, angular momentum L = I * omega
+                const auto wx = col(AvgAngX), wy = col(AvgAngY), wz = col(AvgAngZ);
+                const Column lx = col(Inertia00) * wx + col(Inertia00 + 1) * wy + col(Inertia00 + 2) * wz;
+                const Column ly = col(Inertia00 + 3) * wx + col(Inertia00 + 4) * wy + col(Inertia00 + 5) * wz;
+                const Column lz = col(Inertia00 + 6) * wx + col(Inertia00 + 7) * wy + col(Inertia00 + 8) * wz;
+                const Column rx = col(TorqueX) - (wy * lz - wz * ly);
+                const Column ry = col(TorqueY) - (wz * lx - wx * lz);
+                const Column rz = col(TorqueZ) - (wx * ly - wy * lx);
+                for (uint k = 0; k < 3; ++k) {
+                    col(NextAngAccX + k) = col(InertiaInv00 + 3 * k) * rx + col(InertiaInv00 + 3 * k + 1) * ry + col(InertiaInv00 + 3 * k + 2) * rz;
+                    col(NextAngVelX + k) = col(AngVelX + k) + (col(AngAccX + k) + col(NextAngAccX + k)) * half_dt;
+                }
+            }
+
+            //if controller has bug, velocities can increase idenfinitely so we clip them;
+            //this is rare so it is done as scalar fix up after the vector pass
+            void clipTwist(uint n)
+            {
+                constexpr real_T c = static_cast<real_T>(EarthUtils::SpeedOfLight);
+                for (uint i = 0; i < n; ++i) {
+                    clip(i, NextLinVelX, NextLinAccX, c);
+                    clip(i, NextAngVelX, NextAngAccX, c);
+                }
+            }
+            void clip(uint i, uint vel_field, uint acc_field, real_T max_speed)
+            {
+                Vector3r vel = get3(vel_field, i);
+                if (vel.squaredNorm() > max_speed * max_speed) {
+                    vel /= (vel.norm() / max_speed);
+                    for (uint k = 0; k < 3; ++k) {
+                        fields_[vel_field + k][i] = vel[k];
+                        fields_[acc_field + k][i] = 0;
+                    }
+                }
+            }
+
+            //same math as computeNextPose
+            void integratePose()
+            {
+                const auto dt = col(Dt);
+                for (uint k = 0; k < 3; ++k)
+                    col(NextPosX + k) = col(PosX + k) + col(AvgLinX + k) * dt;
+
+                const auto wx = col(AvgAngX), wy = col(AvgAngY), wz = col(AvgAngZ);
+                const auto qw = col(OriW), qx = col(OriX), qy = col(OriY), qz = col(OriZ);
+                const Column angle_per_unit = (wx.square() + wy.square() + wz.square()).sqrt();
+                //Utils::isDefinitelyGreaterThan(angle_per_unit, 0) for every body,
+                //no change in angle otherwise because the normalized vector is undefined
+                const Eigen::Array<bool, Eigen::Dynamic, 1> rotates = (angle_per_unit > Utils::epsilon<real_T>()) ||
+                                                                      (angle_per_unit > angle_per_unit.abs() * Utils::epsilon<real_T>());
+                const Column half_angle = 0.5f * angle_per_unit * dt;
+                const Column s = rotates.select(half_angle.sin() / angle_per_unit, Column::Zero(angle_per_unit.size()));
+                //change in angle as unit quaternion, new attitude is q0 * q1
+                const Column dw = rotates.select(half_angle.cos(), Column::Ones(angle_per_unit.size()));
+                const Column dx = wx * s, dy = wy * s, dz = wz * s;
+
+                const Column w = qw * dw - qx * dx - qy * dy - qz * dz;
+                const Column x = qw * dx + qx * dw + qy * dz - qz * dy;
+                const Column y = qw * dy - qx * dz + qy * dw + qz * dx;
+                const Column z = qw * dz + qx * dy - qy * dx + qz * dw;
+
+                //re-normalize quaternion to avoid accumulating error
+                const Column norm = (w.square() + x.square() + y.square() + z.square()).sqrt();
+                const Column scale = (rotates && norm > 0).select(norm.inverse(), Column::Ones(norm.size()));
+                col(NextOriW) = rotates.select(w * scale, qw);
+                col(NextOriX) = rotates.select(x * scale, qx);
+                col(NextOriY) = rotates.select(y * scale, qy);
+                col(NextOriZ) = rotates.select(z * scale, qz);
+            }
+
+        private:
+            vector<PhysicsBody*> bodies_;
+            std::array<vector<real_T>, FieldCount> fields_;
+        };
+
     private:
         static constexpr uint kCollisionResponseCycles = 1;
         static constexpr float kAxisTolerance = 0.25f;
@@ -457,6 +783,8 @@ namespace airlib
 
         std::stringstream debug_string_;
         bool enable_ground_lock_;
+        bool enable_batched_update_;
+        BodyBatch batch_;
         TTimePoint last_message_time;
         Vector3r wind_;
     };
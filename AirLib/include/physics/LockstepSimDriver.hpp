@@ -0,0 +1,123 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef airsim_core_LockstepSimDriver_hpp
+#define airsim_core_LockstepSimDriver_hpp
+
+#include "common/Common.hpp"
+#include "common/ClockFactory.hpp"
+#include "common/SteppableClock.hpp"
+#include "PhysicsWorld.hpp"
+#include <functional>
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+    Headless driver that advances PhysicsWorld in lock step with a SteppableClock instead of
+    the wall clock paced async updator. Each step advances simulated time by exactly step_size
+    and the next step starts as soon as the previous one is done, so simulation runs as fast
+    as the CPU allows.
+
+    Controllers can either be driven from the step callback on the stepping thread, or run
+    their blocking API calls on another thread: those wait on the steppable clock and make
+    progress as the driver steps. Such threads should hold ClockFactory::ScopedThreadClock
+    with getClock().
+
+    The clock belongs to this driver only, so several drivers can run concurrently on
+    different threads of one process.
+    */
+    class LockstepSimDriver
+    {
+    public:
+        //return false to stop stepping early
+        typedef std::function<bool(uint64_t step_count)> StepCallback;
+
+        LockstepSimDriver(std::unique_ptr<PhysicsEngineBase> physics_engine, const std::vector<UpdatableObject*>& bodies,
+                          TTimeDelta step_size = 3E-3f)
+            : clock_(std::make_shared<SteppableClock>(step_size))
+        {
+            //bodies record their start times when world resets them so they must see our clock
+            ClockFactory::ScopedThreadClock clock_scope(clock_.get());
+            physics_world_.reset(new PhysicsWorld(std::move(physics_engine), bodies,
+                                                  static_cast<uint64_t>(step_size * 1E9), false, false, clock_));
+        }
+
+        void reset()
+        {
+            ClockFactory::ScopedThreadClock clock_scope(clock_.get());
+            physics_world_->reset();
+            step_count_ = 0;
+            wall_nanos_ = 0;
+        }
+
+        void setStepCallback(const StepCallback& callback)
+        {
+            step_callback_ = callback;
+        }
+
+        //returns number of steps actually taken
+        uint64_t step(uint64_t steps = 1)
+        {
+            TTimePoint wall_start = Utils::getTimeSinceEpochNanos();
+
+            uint64_t taken = 0;
+            for (; taken < steps; ++taken) {
+                physics_world_->step();
+                ++step_count_;
+
+                if (step_callback_ && !step_callback_(step_count_)) {
+                    ++taken;
+                    break;
+                }
+            }
+
+            wall_nanos_ += Utils::getTimeSinceEpochNanos() - wall_start;
+            return taken;
+        }
+
+        uint64_t runFor(TTimeDelta sim_seconds)
+        {
+            return step(static_cast<uint64_t>(std::ceil(sim_seconds / clock_->getStepSize())));
+        }
+
+        TTimeDelta getSimTime() const
+        {
+            return clock_->elapsedSince(clock_->getStart());
+        }
+
+        uint64_t getStepCount() const
+        {
+            return step_count_;
+        }
+
+        //simulated seconds per wall clock second spent inside step() since last reset
+        double getRealTimeFactor() const
+        {
+            if (wall_nanos_ == 0)
+                return 0;
+            return (step_count_ * clock_->getStepSize()) / (wall_nanos_ / 1.0E9);
+        }
+
+        PhysicsWorld& getPhysicsWorld()
+        {
+            return *physics_world_;
+        }
+
+        SteppableClock& getClock()
+        {
+            return *clock_;
+        }
+
+    private:
+        std::shared_ptr<SteppableClock> clock_;
+        std::unique_ptr<PhysicsWorld> physics_world_;
+        StepCallback step_callback_;
+        uint64_t step_count_ = 0;
+        uint64_t wall_nanos_ = 0;
+    };
+}
+} //namespace
+#endif
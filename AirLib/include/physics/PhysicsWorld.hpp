@@ -21,8 +21,8 @@ namespace airlib
     public:
         PhysicsWorld(std::unique_ptr<PhysicsEngineBase> physics_engine, const std::vector<UpdatableObject*>& bodies,
                      uint64_t update_period_nanos = 3000000LL, bool state_reporter_enabled = false,
-                     bool start_async_updator = true)
-            : world_(std::move(physics_engine))
+                     bool start_async_updator = true, std::shared_ptr<ClockBase> clock = nullptr)
+            : world_(std::move(physics_engine), clock)
         {
             setName("PhysicsWorld");
             enableStateReport(state_reporter_enabled);
@@ -54,11 +54,26 @@ namespace airlib
             unlock();
         }
 
+        //clock that drives this world, threads calling blocking vehicle APIs of this world
+        //should hold ClockFactory::ScopedThreadClock with it
+        ClockBase* getClock()
+        {
+            return world_.clock();
+        }
+
         uint64_t getUpdatePeriodNanos() const
         {
             return update_period_nanos_;
         }
 
+        //advance world by one tick on the calling thread, for use when async updator is not running
+        void step()
+        {
+            lock();
+            world_.update();
+            unlock();
+        }
+
         void startAsyncUpdator()
         {
             world_.startAsyncUpdator(update_period_nanos_);
@@ -111,6 +126,18 @@ namespace airlib
             world_.setFrameNumber(frameNumber);
         }
 
+        void setParallelUpdate(uint thread_count)
+        {
+            lock();
+            world_.setParallelUpdate(thread_count);
+            unlock();
+        }
+
+        void setWaitStrategy(common_utils::ScheduledExecutor::WaitStrategy wait_strategy)
+        {
+            world_.setWaitStrategy(wait_strategy);
+        }
+
         void resetImplementation() override {}
 
     private:
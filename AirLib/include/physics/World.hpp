@@ -10,6 +10,7 @@
 #include "PhysicsEngineBase.hpp"
 #include "PhysicsBody.hpp"
 #include "common/common_utils/ScheduledExecutor.hpp"
+#include "common/common_utils/ParallelFor.hpp"
 #include "common/ClockFactory.hpp"
 
 namespace msr
@@ -20,9 +21,11 @@ namespace airlib
     class World : public UpdatableContainer<UpdatableObject*>
     {
     public:
-        World(std::unique_ptr<PhysicsEngineBase> physics_engine)
+        //if clock is null, world uses the process wide clock from ClockFactory
+        World(std::unique_ptr<PhysicsEngineBase> physics_engine, std::shared_ptr<ClockBase> clock = nullptr)
             : physics_engine_(std::move(physics_engine))
         {
+            setClock(clock);
             World::clear();
             setName("World");
             physics_engine_->setParent(this);
@@ -42,10 +45,17 @@ namespace airlib
 
         virtual void update() override
         {
-            ClockFactory::get()->step();
+            //everything updated below on this thread sees our clock even if it is not parented to us
+            ClockBase* world_clock = clock();
+            ClockFactory::ScopedThreadClock clock_scope(world_clock);
+
+            world_clock->step();
 
             //first update our objects
-            UpdatableContainer::update();
+            if (parallel_updater_)
+                updateMembersParallel();
+            else
+                UpdatableContainer::update();
 
             //now update kinematics state
             if (physics_engine_)
@@ -54,7 +64,17 @@ namespace airlib
 
         virtual void reportState(StateReporter& reporter) override
         {
-            reporter.writeValue("Sleep", 1.0f / executor_.getSleepTimeAvg());
+            const common_utils::ScheduledExecutor::TimingStats stats = executor_.getTimingStats();
+            reporter.writeValue("Sleep", 1.0f / stats.sleep_time_avg);
+            reporter.writeValue("Periods", stats.period_count);
+            reporter.writeValue("Overruns", stats.overrun_count);
+            reporter.writeValue("Max Jitter (us)", stats.max_jitter_nanos / 1000);
+            reporter.writeNameOnly("Jitter Hist (us)");
+            const auto& edges = common_utils::ScheduledExecutor::jitterBinEdgesNanos();
+            for (size_t bin = 0; bin < stats.jitter_histogram.size(); ++bin) {
+                const std::string label = bin < edges.size() ? "<" + std::to_string(edges[bin] / 1000) : ">=" + std::to_string(edges.back() / 1000);
+                reporter.writeValueOnly(label + ":" + std::to_string(stats.jitter_histogram[bin]), bin + 1 == stats.jitter_histogram.size());
+            }
             if (physics_engine_)
                 physics_engine_->reportState(reporter);
 
@@ -99,6 +119,14 @@ namespace airlib
         {
             executor_.stop();
         }
+        void setWaitStrategy(common_utils::ScheduledExecutor::WaitStrategy wait_strategy)
+        {
+            executor_.setWaitStrategy(wait_strategy);
+        }
+        common_utils::ScheduledExecutor::TimingStats getTimingStats() const
+        {
+            return executor_.getTimingStats();
+        }
         void lock()
         {
             executor_.lock();
@@ -143,7 +171,54 @@ namespace airlib
             executor_.setFrameNumber(frameNumber);
         }
 
+        //Update members that own a physics body (vehicle with its sensors and firmware) concurrently
+        //on thread_count threads. Physics engine still runs after all members are done so results
+        //are same as serial update. thread_count <= 1 restores serial update.
+        void setParallelUpdate(uint thread_count)
+        {
+            if (thread_count > 1)
+                parallel_updater_.reset(new common_utils::ParallelFor(thread_count));
+            else
+                parallel_updater_.reset();
+        }
+
+        uint getParallelUpdateThreadCount() const
+        {
+            return parallel_updater_ ? parallel_updater_->getThreadCount() : 1;
+        }
+
     private:
+        void updateMembersParallel()
+        {
+            UpdatableObject::update();
+
+            //members without physics body such as state reporter or telemetry publisher are cheap, may not be
+            //thread safe and may read the vehicles, so they run on this thread once the vehicles before them
+            //in member order are done, which keeps the order of the serial update
+            parallel_members_.clear();
+            for (UpdatableObject* member : *this) {
+                if (member->getPhysicsBody() != nullptr)
+                    parallel_members_.push_back(member);
+                else {
+                    updateParallelMembers();
+                    member->update();
+                }
+            }
+            updateParallelMembers();
+        }
+
+        void updateParallelMembers()
+        {
+            //each vehicle subtree only touches its own state so order of completion doesn't matter
+            ClockBase* world_clock = clock();
+            parallel_updater_->run(parallel_members_.size(), [this, world_clock](size_t i) {
+                ClockFactory::ScopedThreadClock clock_scope(world_clock);
+                parallel_members_[i]->update();
+            });
+            parallel_members_.clear();
+        }
+
+
         bool worldUpdatorAsync(uint64_t dt_nanos)
         {
             unused(dt_nanos);
@@ -166,6 +241,9 @@ namespace airlib
     private:
         std::unique_ptr<PhysicsEngineBase> physics_engine_ = nullptr;
         common_utils::ScheduledExecutor executor_;
+
+        std::unique_ptr<common_utils::ParallelFor> parallel_updater_;
+        vector<UpdatableObject*> parallel_members_;
     };
 }
 } //namespace
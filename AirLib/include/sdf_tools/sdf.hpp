@@ -10,6 +10,7 @@
 #include <sdf_utils/eigen_helpers.hpp>
 #include <sdf_utils/serialization.hpp>
 #include <sdf_utils/voxel_grid.hpp>
+#include <sdf_utils/mappable_vector.hpp>
 #include <sdf_utils/pretty_print.hpp>
 
 #include <omp.h>
@@ -18,7 +19,10 @@ namespace sdf_tools
 {
 using VoxelGrid::GRID_INDEX;
 
-class SignedDistanceField : public VoxelGrid::VoxelGrid<float>
+// SDF cells live in a MappableVector so that files saved uncompressed can be mapped in place
+typedef VoxelGrid::VoxelGrid<float, sdf_utils::MappableVector<float>> SignedDistanceFieldGrid;
+
+class SignedDistanceField : public SignedDistanceFieldGrid
 {
 protected:
 
@@ -38,9 +42,9 @@ public:
                              double y_size,
                              double z_size,
                              float OOB_value)
-    : VoxelGrid::VoxelGrid<float>(resolution,
-                                  x_size, y_size, z_size,
-                                  OOB_value),
+    : SignedDistanceFieldGrid(resolution,
+                              x_size, y_size, z_size,
+                              OOB_value),
       frame_(frame), locked_(false) {}
 
   inline SignedDistanceField(const Eigen::Isometry3d& origin_transform,
@@ -50,9 +54,9 @@ public:
                              double y_size,
                              double z_size,
                              float OOB_value)
-    : VoxelGrid::VoxelGrid<float>(origin_transform, resolution,
-                                  x_size, y_size, z_size,
-                                  OOB_value),
+    : SignedDistanceFieldGrid(origin_transform, resolution,
+                              x_size, y_size, z_size,
+                              OOB_value),
       frame_(frame), locked_(false) {}
 
   inline SignedDistanceField(const std::string& frame,
@@ -61,9 +65,9 @@ public:
                              int64_t y_cells,
                              int64_t z_cells,
                              float OOB_value)
-    : VoxelGrid::VoxelGrid<float>(resolution,
-                                  x_cells, y_cells, z_cells,
-                                  OOB_value),
+    : SignedDistanceFieldGrid(resolution,
+                              x_cells, y_cells, z_cells,
+                              OOB_value),
       frame_(frame), locked_(false) {}
 
   inline SignedDistanceField(const Eigen::Isometry3d& origin_transform,
@@ -73,15 +77,15 @@ public:
                              int64_t y_cells,
                              int64_t z_cells,
                              float OOB_value)
-    : VoxelGrid::VoxelGrid<float>(origin_transform, resolution,
-                                  x_cells, y_cells, z_cells,
-                                  OOB_value),
+    : SignedDistanceFieldGrid(origin_transform, resolution,
+                              x_cells, y_cells, z_cells,
+                              OOB_value),
       frame_(frame), locked_(false) {}
 
   inline SignedDistanceField()
-    : VoxelGrid::VoxelGrid<float>(), frame_(""), locked_(false) {}
+    : SignedDistanceFieldGrid(), frame_(""), locked_(false) {}
 
-  virtual VoxelGrid<float>* Clone() const
+  virtual SignedDistanceFieldGrid* Clone() const
   {
     return new SignedDistanceField(
           static_cast<const SignedDistanceField&>(*this));
@@ -961,6 +965,226 @@ public:
     }
   }
 
+  /////////////////////////////////////////////////////////////////////
+  // Batch estimate distance functions
+  /////////////////////////////////////////////////////////////////////
+
+  /*
+   * Distances at count points stored as contiguous xyz triples, written to
+   * distances[count]. When gradients is non-null the gradient at every point
+   * is written there as xyz triples. Out-of-bounds points get the OOB value
+   * and a zero gradient. Values match EstimateDistance3d and
+   * GetAutoDiffGradient3d; the gradient is the analytic derivative of the
+   * same trilinear interpolation. Points are processed in blocks: the frame
+   * transform and the interpolation run as Eigen array expressions over the
+   * whole block so they vectorize, only the cell lookup and corner gather
+   * are per point, and blocks are spread over OpenMP threads. Returns the
+   * number of in-bounds points.
+   */
+  inline size_t EstimateDistancesBatch3d(const double* points,
+                                         const size_t count,
+                                         double* distances,
+                                         double* gradients = nullptr) const
+  {
+    const int64_t num_blocks
+        = (int64_t)((count + kBatchBlockSize - 1) / kBatchBlockSize);
+    int64_t num_in_bounds = 0;
+    #pragma omp parallel for reduction(+:num_in_bounds) if(num_blocks > 1)
+    for (int64_t block = 0; block < num_blocks; block++)
+    {
+      const size_t first = (size_t)block * kBatchBlockSize;
+      const size_t block_count
+          = std::min(count - first, (size_t)kBatchBlockSize);
+      num_in_bounds += (int64_t)EstimateDistancesBlock3d(
+                         points + (3 * first), block_count,
+                         distances + first,
+                         (gradients != nullptr)
+                           ? (gradients + (3 * first)) : nullptr);
+    }
+    return (size_t)num_in_bounds;
+  }
+
+  inline size_t EstimateDistancesBatch3d(
+      const std::vector<double>& points,
+      std::vector<double>& distances) const
+  {
+    distances.resize(points.size() / 3);
+    return EstimateDistancesBatch3d(points.data(), distances.size(),
+                                    distances.data());
+  }
+
+  inline size_t EstimateDistancesAndGradientsBatch3d(
+      const std::vector<double>& points,
+      std::vector<double>& distances,
+      std::vector<double>& gradients) const
+  {
+    distances.resize(points.size() / 3);
+    gradients.resize(distances.size() * 3);
+    return EstimateDistancesBatch3d(points.data(), distances.size(),
+                                    distances.data(), gradients.data());
+  }
+
+protected:
+
+  static const size_t kBatchBlockSize = 256;
+  typedef Eigen::Array<double, kBatchBlockSize, 1> BatchArray;
+
+  // Same result as GetAxisInterpolationIndices, but written so the compiler
+  // emits conditional moves; query offsets in a batch are not predictable.
+  static inline std::pair<int64_t, int64_t>
+  GetAxisInterpolationIndicesBranchless(const int64_t initial_index,
+                                        const int64_t axis_size,
+                                        const double axis_offset)
+  {
+    const int64_t lower
+        = std::max<int64_t>(0, std::min<int64_t>(
+                                 initial_index - (int64_t)(axis_offset < 0.0),
+                                 axis_size - 2));
+    const int64_t upper = std::min<int64_t>(lower + 1, axis_size - 1);
+    return std::make_pair(lower, upper);
+  }
+
+  inline size_t EstimateDistancesBlock3d(const double* points,
+                                         const size_t count,
+                                         double* distances,
+                                         double* gradients) const
+  {
+    const double resolution = GetResolution();
+    const double half_resolution = resolution * 0.5;
+    const double inv_resolution = 1.0 / resolution;
+    // Transform the whole block into the grid frame at once
+    BatchArray gx, gy, gz;
+    for (size_t idx = 0; idx < kBatchBlockSize; idx++)
+    {
+      const size_t src = (idx < count) ? idx : 0;
+      gx(idx) = points[3 * src];
+      gy(idx) = points[(3 * src) + 1];
+      gz(idx) = points[(3 * src) + 2];
+    }
+    const Eigen::Matrix4d& inverse = inverse_origin_transform_.matrix();
+    const BatchArray px = gx;
+    const BatchArray py = gy;
+    gx = inverse(0, 0) * px + inverse(0, 1) * py + inverse(0, 2) * gz
+         + inverse(0, 3);
+    gy = inverse(1, 0) * px + inverse(1, 1) * py + inverse(1, 2) * gz
+         + inverse(1, 3);
+    gz = inverse(2, 0) * px + inverse(2, 1) * py + inverse(2, 2) * gz
+         + inverse(2, 3);
+    // Fractional position between the lower and upper cell centers
+    BatchArray tx, ty, tz;
+    // Center distances of the 8 corners, indexed by xyz bits
+    BatchArray corners[8];
+    bool in_bounds[kBatchBlockSize];
+    size_t num_in_bounds = 0;
+    for (size_t idx = 0; idx < kBatchBlockSize; idx++)
+    {
+      const GRID_INDEX index
+          = PointInFrameToGridIndex3d(Eigen::Vector3d(gx(idx), gy(idx),
+                                                      gz(idx)));
+      in_bounds[idx] = (idx < count) && IndexInBounds(index);
+      if (!in_bounds[idx])
+      {
+        tx(idx) = ty(idx) = tz(idx) = 0.0;
+        for (int corner = 0; corner < 8; corner++)
+        {
+          corners[corner](idx) = 0.0;
+        }
+        continue;
+      }
+      num_in_bounds++;
+      const std::pair<int64_t, int64_t> x_axis_indices
+          = GetAxisInterpolationIndicesBranchless(
+              index.x, GetNumXCells(),
+              gx(idx) - (resolution * ((double)index.x + 0.5)));
+      const std::pair<int64_t, int64_t> y_axis_indices
+          = GetAxisInterpolationIndicesBranchless(
+              index.y, GetNumYCells(),
+              gy(idx) - (resolution * ((double)index.y + 0.5)));
+      const std::pair<int64_t, int64_t> z_axis_indices
+          = GetAxisInterpolationIndicesBranchless(
+              index.z, GetNumZCells(),
+              gz(idx) - (resolution * ((double)index.z + 0.5)));
+      tx(idx) = (double)x_axis_indices.first + 0.5;
+      ty(idx) = (double)y_axis_indices.first + 0.5;
+      tz(idx) = (double)z_axis_indices.first + 0.5;
+      const int64_t xs[2] = {x_axis_indices.first, x_axis_indices.second};
+      const int64_t ys[2] = {y_axis_indices.first, y_axis_indices.second};
+      const int64_t zs[2] = {z_axis_indices.first, z_axis_indices.second};
+      for (int corner = 0; corner < 8; corner++)
+      {
+        // Indices are known to be in bounds, skip GetImmutable's checks
+        corners[corner](idx)
+            = (double)data_[(size_t)((xs[(corner >> 2) & 1] * stride1_)
+                                     + (ys[(corner >> 1) & 1] * stride2_)
+                                     + zs[corner & 1])];
+      }
+    }
+    // Same correction as GetCorrectedCenterDistance, without the branches
+    for (int corner = 0; corner < 8; corner++)
+    {
+      corners[corner] = (corners[corner] >= 0.0)
+                          .select(corners[corner] - half_resolution,
+                                  corners[corner] + half_resolution);
+    }
+    // tx/ty/tz hold the lower corner in cells, turn them into fractions
+    tx = gx * inv_resolution - tx;
+    ty = gy * inv_resolution - ty;
+    tz = gz * inv_resolution - tz;
+    // corners[xyz]: bit 2 is +x, bit 1 is +y, bit 0 is +z
+    const BatchArray one_tx = 1.0 - tx;
+    const BatchArray one_ty = 1.0 - ty;
+    const BatchArray one_tz = 1.0 - tz;
+    const BatchArray y0z0 = one_tx * corners[0] + tx * corners[4];
+    const BatchArray y1z0 = one_tx * corners[2] + tx * corners[6];
+    const BatchArray y0z1 = one_tx * corners[1] + tx * corners[5];
+    const BatchArray y1z1 = one_tx * corners[3] + tx * corners[7];
+    const BatchArray z0 = one_ty * y0z0 + ty * y1z0;
+    const BatchArray z1 = one_ty * y0z1 + ty * y1z1;
+    const BatchArray distance = z0 + tz * (z1 - z0);
+    const double oob_value = (double)GetOOBValue();
+    for (size_t idx = 0; idx < count; idx++)
+    {
+      distances[idx] = in_bounds[idx] ? distance(idx) : oob_value;
+    }
+    if (gradients == nullptr)
+    {
+      return num_in_bounds;
+    }
+    const BatchArray grad_x
+        = (one_tz * (one_ty * (corners[4] - corners[0])
+                     + ty * (corners[6] - corners[2]))
+           + tz * (one_ty * (corners[5] - corners[1])
+                   + ty * (corners[7] - corners[3]))) * inv_resolution;
+    const BatchArray grad_y
+        = (one_tz * (one_tx * (corners[2] - corners[0])
+                     + tx * (corners[6] - corners[4]))
+           + tz * (one_tx * (corners[3] - corners[1])
+                   + tx * (corners[7] - corners[5]))) * inv_resolution;
+    const BatchArray grad_z = (z1 - z0) * inv_resolution;
+    // Rotate from the grid frame back to the query frame
+    const Eigen::Matrix3d rotation = origin_transform_.linear();
+    for (size_t idx = 0; idx < count; idx++)
+    {
+      double* gradient = gradients + (3 * idx);
+      if (in_bounds[idx])
+      {
+        for (int axis = 0; axis < 3; axis++)
+        {
+          gradient[axis] = rotation(axis, 0) * grad_x(idx)
+                           + rotation(axis, 1) * grad_y(idx)
+                           + rotation(axis, 2) * grad_z(idx);
+        }
+      }
+      else
+      {
+        gradient[0] = gradient[1] = gradient[2] = 0.0;
+      }
+    }
+    return num_in_bounds;
+  }
+
+public:
+
   inline std::pair<double, bool> DistanceToBoundary(const double x,
                                                     const double y,
                                                     const double z) const
@@ -1234,11 +1458,32 @@ public:
         const std::vector<uint8_t>&, const uint64_t)>& value_deserializer
       = sdf_utils::DeserializeFixedSizePOD<float>);
 
+  /*
+   * Files are written in a versioned format: a header padded to a page
+   * boundary followed by the raw float cells, which LoadFromFile maps into
+   * memory and uses in place (copy-on-write) instead of reading them. With
+   * compress the cells are instead stored as independently compressed
+   * blocks that are decompressed in parallel on load. Files in the older
+   * serialized format are still loaded.
+   */
   static void SaveToFile(const SignedDistanceField& sdf,
                          const std::string& filepath,
                          const bool compress);
 
-  static SignedDistanceField LoadFromFile(const std::string& filepath);
+  static SignedDistanceField LoadFromFile(const std::string& filepath,
+                                          const bool map_file=true);
+
+  inline bool IsMapped() const
+  {
+    return data_.IsMapped();
+  }
+
+protected:
+
+  uint64_t SerializeMetadata(std::vector<uint8_t>& buffer) const;
+
+  uint64_t DeserializeMetadata(const std::vector<uint8_t>& buffer,
+                               const uint64_t current);
 };
 }
 
@@ -5,6 +5,9 @@
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 #include <Eigen/Geometry>
 #include <sdf_utils/eigen_helpers.hpp>
 #include <sdf_utils/voxel_grid.hpp>
@@ -16,6 +19,12 @@
 
 namespace sdf_generation
 {
+    // Algorithm used to turn the occupancy into distances. The bucket queue propagates from the
+    // site cells through their neighbours and can overestimate by a fraction of a cell in rare
+    // configurations. The EDT runs the exact separable transform (Felzenszwalb & Huttenlocher)
+    // one axis at a time with the lines of each axis split across OpenMP threads.
+    enum GENERATION_BACKEND : uint8_t { BUCKET_QUEUE=0x00, PARALLEL_EDT=0x01 };
+
     struct bucket_cell
     {
         double distance_square;
@@ -206,6 +215,177 @@ namespace sdf_generation
         return distance_field;
     }
 
+    // Exact 1D squared distance transform of the strided line in place. Cells hold 0 for sites
+    // and infinity otherwise (or squared distances from a previous axis). The scratch vectors
+    // are passed in so that each thread reuses its own storage across lines.
+    inline void SquaredDistanceTransform1d(double* line,
+                                           const int64_t stride,
+                                           const int64_t num_cells,
+                                           std::vector<double>& f,
+                                           std::vector<int64_t>& v,
+                                           std::vector<double>& z)
+    {
+        f.resize(num_cells);
+        v.resize(num_cells);
+        z.resize(num_cells + 1);
+        for (int64_t q = 0; q < num_cells; q++)
+        {
+            f[q] = line[q * stride];
+        }
+        // Build the lower envelope of the parabolas rooted at finite cells
+        int64_t k = -1;
+        for (int64_t q = 0; q < num_cells; q++)
+        {
+            if (std::isinf(f[q]))
+            {
+                continue;
+            }
+            double s = -std::numeric_limits<double>::infinity();
+            while (k >= 0)
+            {
+                const int64_t p = v[k];
+                s = ((f[q] + (double)(q * q)) - (f[p] + (double)(p * p))) / (2.0 * (double)(q - p));
+                if (s > z[k])
+                {
+                    break;
+                }
+                k--;
+            }
+            k++;
+            v[k] = q;
+            z[k] = (k == 0) ? -std::numeric_limits<double>::infinity() : s;
+            z[k + 1] = std::numeric_limits<double>::infinity();
+        }
+        // No finite cells, the whole line stays at infinity
+        if (k < 0)
+        {
+            return;
+        }
+        k = 0;
+        for (int64_t q = 0; q < num_cells; q++)
+        {
+            while (z[k + 1] < (double)q)
+            {
+                k++;
+            }
+            const double d = (double)(q - v[k]);
+            line[q * stride] = (d * d) + f[v[k]];
+        }
+    }
+
+    // Exact squared euclidean distance (in cells) from every cell to the nearest site, computed
+    // in place on a dense x-major grid. Sites hold 0, all other cells infinity.
+    inline void ComputeSquaredDistanceField(std::vector<double>& distance_square,
+                                            const int64_t num_x_cells,
+                                            const int64_t num_y_cells,
+                                            const int64_t num_z_cells)
+    {
+        const int64_t stride1 = num_y_cells * num_z_cells;
+        const int64_t stride2 = num_z_cells;
+        double* data = distance_square.data();
+        // Along z, lines are contiguous
+        #pragma omp parallel
+        {
+            std::vector<double> f;
+            std::vector<int64_t> v;
+            std::vector<double> z;
+            #pragma omp for
+            for (int64_t line = 0; line < num_x_cells * num_y_cells; line++)
+            {
+                SquaredDistanceTransform1d(data + (line * stride2), 1, num_z_cells, f, v, z);
+            }
+        }
+        // Along y, one line per (x, z)
+        #pragma omp parallel
+        {
+            std::vector<double> f;
+            std::vector<int64_t> v;
+            std::vector<double> z;
+            #pragma omp for
+            for (int64_t line = 0; line < num_x_cells * num_z_cells; line++)
+            {
+                const int64_t x_index = line / num_z_cells;
+                const int64_t z_index = line % num_z_cells;
+                SquaredDistanceTransform1d(data + (x_index * stride1) + z_index, stride2, num_y_cells, f, v, z);
+            }
+        }
+        // Along x, one line per (y, z)
+        #pragma omp parallel
+        {
+            std::vector<double> f;
+            std::vector<int64_t> v;
+            std::vector<double> z;
+            #pragma omp for
+            for (int64_t line = 0; line < num_y_cells * num_z_cells; line++)
+            {
+                SquaredDistanceTransform1d(data + line, stride1, num_x_cells, f, v, z);
+            }
+        }
+    }
+
+    inline std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>> ExtractSignedDistanceFieldEDT(const Eigen::Isometry3d& grid_origin_tranform,
+                                                                                                              const double grid_resolution,
+                                                                                                              const int64_t grid_num_x_cells,
+                                                                                                              const int64_t grid_num_y_cells,
+                                                                                                              const int64_t grid_num_z_cells,
+                                                                                                              const std::function<bool(const VoxelGrid::GRID_INDEX&)>& is_filled_fn,
+                                                                                                              const float oob_value,
+                                                                                                              const std::string& frame)
+    {
+        const int64_t num_cells = grid_num_x_cells * grid_num_y_cells * grid_num_z_cells;
+        const double infinity = std::numeric_limits<double>::infinity();
+        // Distance to filled voxels has filled voxels as sites, distance to free voxels has free ones
+        std::vector<double> filled_distance_square(num_cells, infinity);
+        std::vector<double> free_distance_square(num_cells, infinity);
+        int64_t data_index = 0;
+        for (int64_t x_index = 0; x_index < grid_num_x_cells; x_index++)
+        {
+            for (int64_t y_index = 0; y_index < grid_num_y_cells; y_index++)
+            {
+                for (int64_t z_index = 0; z_index < grid_num_z_cells; z_index++)
+                {
+                    if (is_filled_fn(VoxelGrid::GRID_INDEX(x_index, y_index, z_index)))
+                    {
+                        filled_distance_square[data_index] = 0.0;
+                    }
+                    else
+                    {
+                        free_distance_square[data_index] = 0.0;
+                    }
+                    data_index++;
+                }
+            }
+        }
+        ComputeSquaredDistanceField(filled_distance_square, grid_num_x_cells, grid_num_y_cells, grid_num_z_cells);
+        ComputeSquaredDistanceField(free_distance_square, grid_num_x_cells, grid_num_y_cells, grid_num_z_cells);
+        // Generate the SDF
+        sdf_tools::SignedDistanceField new_sdf(grid_origin_tranform, frame, grid_resolution, grid_num_x_cells, grid_num_y_cells, grid_num_z_cells, oob_value);
+        // Per-slab extrema, combined afterwards (MSVC OpenMP has no min/max reductions)
+        std::vector<double> slab_max_distance(grid_num_x_cells, -infinity);
+        std::vector<double> slab_min_distance(grid_num_x_cells, infinity);
+        #pragma omp parallel for
+        for (int64_t x_index = 0; x_index < grid_num_x_cells; x_index++)
+        {
+            for (int64_t y_index = 0; y_index < grid_num_y_cells; y_index++)
+            {
+                for (int64_t z_index = 0; z_index < grid_num_z_cells; z_index++)
+                {
+                    const int64_t cell_index = (((x_index * grid_num_y_cells) + y_index) * grid_num_z_cells) + z_index;
+                    const double distance1 = std::sqrt(filled_distance_square[cell_index]) * new_sdf.GetResolution();
+                    const double distance2 = std::sqrt(free_distance_square[cell_index]) * new_sdf.GetResolution();
+                    const double distance = distance1 - distance2;
+                    slab_max_distance[x_index] = std::max(slab_max_distance[x_index], distance);
+                    slab_min_distance[x_index] = std::min(slab_min_distance[x_index], distance);
+                    new_sdf.SetValue(x_index, y_index, z_index, distance);
+                }
+            }
+        }
+        const double max_distance = grid_num_x_cells > 0 ? *std::max_element(slab_max_distance.begin(), slab_max_distance.end()) : -infinity;
+        const double min_distance = grid_num_x_cells > 0 ? *std::min_element(slab_min_distance.begin(), slab_min_distance.end()) : infinity;
+        std::pair<double, double> extrema(max_distance, min_distance);
+        return std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>>(std::move(new_sdf), extrema);
+    }
+
     template<typename T>
     inline std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>> ExtractSignedDistanceField(const Eigen::Isometry3d& grid_origin_tranform,
                                                                                                            const double grid_resolution,
@@ -214,8 +394,13 @@ namespace sdf_generation
                                                                                                            const int64_t grid_num_z_cells,
                                                                                                            const std::function<bool(const VoxelGrid::GRID_INDEX&)>& is_filled_fn,
                                                                                                            const float oob_value,
-                                                                                                           const std::string& frame)
+                                                                                                           const std::string& frame,
+                                                                                                           const GENERATION_BACKEND backend=BUCKET_QUEUE)
     {
+        if (backend == PARALLEL_EDT)
+        {
+            return ExtractSignedDistanceFieldEDT(grid_origin_tranform, grid_resolution, grid_num_x_cells, grid_num_y_cells, grid_num_z_cells, is_filled_fn, oob_value, frame);
+        }
         std::vector<VoxelGrid::GRID_INDEX> filled;
         std::vector<VoxelGrid::GRID_INDEX> free;
 
@@ -271,11 +456,11 @@ namespace sdf_generation
             }
         }
         std::pair<double, double> extrema(max_distance, min_distance);
-        return std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>>(new_sdf, extrema);
+        return std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>>(std::move(new_sdf), extrema);
     }
 
     template<typename T, typename BackingStore=std::vector<T>>
-    inline std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>> ExtractSignedDistanceField(const VoxelGrid::VoxelGrid<T, BackingStore>& grid, const std::function<bool(const VoxelGrid::GRID_INDEX&)>& is_filled_fn, const float oob_value, const std::string& frame, const bool add_virtual_border)
+    inline std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>> ExtractSignedDistanceField(const VoxelGrid::VoxelGrid<T, BackingStore>& grid, const std::function<bool(const VoxelGrid::GRID_INDEX&)>& is_filled_fn, const float oob_value, const std::string& frame, const bool add_virtual_border, const GENERATION_BACKEND backend=BUCKET_QUEUE)
     {
       (void)(add_virtual_border);
       const Eigen::Vector3d cell_sizes = grid.GetCellSizes();
@@ -286,7 +471,7 @@ namespace sdf_generation
       if (add_virtual_border == false)
       {
         // This is the conventional single-pass result
-        return ExtractSignedDistanceField<T>(grid.GetOriginTransform(), cell_sizes.x(), grid.GetNumXCells(), grid.GetNumYCells(), grid.GetNumZCells(), is_filled_fn, oob_value, frame);
+        return ExtractSignedDistanceField<T>(grid.GetOriginTransform(), cell_sizes.x(), grid.GetNumXCells(), grid.GetNumYCells(), grid.GetNumZCells(), is_filled_fn, oob_value, frame, backend);
       }
       else
       {
@@ -382,8 +567,8 @@ namespace sdf_generation
           return is_filled_fn(real_grid_index);
         };
         // Make both SDFs
-        auto free_sdf_result = ExtractSignedDistanceField<T>(grid.GetOriginTransform(), cell_sizes.x(), num_x_cells, num_y_cells, num_z_cells, free_is_filled_fn, oob_value, frame);
-        auto filled_sdf_result = ExtractSignedDistanceField<T>(grid.GetOriginTransform(), cell_sizes.x(), num_x_cells, num_y_cells, num_z_cells, filled_is_filled_fn, oob_value, frame);
+        auto free_sdf_result = ExtractSignedDistanceField<T>(grid.GetOriginTransform(), cell_sizes.x(), num_x_cells, num_y_cells, num_z_cells, free_is_filled_fn, oob_value, frame, backend);
+        auto filled_sdf_result = ExtractSignedDistanceField<T>(grid.GetOriginTransform(), cell_sizes.x(), num_x_cells, num_y_cells, num_z_cells, filled_is_filled_fn, oob_value, frame, backend);
         // Combine to make a single SDF
         sdf_tools::SignedDistanceField combined_sdf(grid.GetOriginTransform(), frame, cell_sizes.x(), grid.GetNumXCells(), grid.GetNumYCells(), grid.GetNumZCells(), oob_value);
 
@@ -426,7 +611,7 @@ namespace sdf_generation
     }
 
     template<typename T, typename BackingStore=std::vector<T>>
-    inline std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>> ExtractSignedDistanceField(const VoxelGrid::VoxelGrid<T, BackingStore>& grid, const std::function<bool(const T&)>& is_filled_fn, const float oob_value, const std::string& frame)
+    inline std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>> ExtractSignedDistanceField(const VoxelGrid::VoxelGrid<T, BackingStore>& grid, const std::function<bool(const T&)>& is_filled_fn, const float oob_value, const std::string& frame, const GENERATION_BACKEND backend=BUCKET_QUEUE)
     {
         const std::function<bool(const VoxelGrid::GRID_INDEX&)> real_is_filled_fn = [&] (const VoxelGrid::GRID_INDEX& index)
         {
@@ -443,7 +628,189 @@ namespace sdf_generation
                 return false;
             }
         };
-        return ExtractSignedDistanceField(grid, real_is_filled_fn, oob_value, frame, false);
+        return ExtractSignedDistanceField(grid, real_is_filled_fn, oob_value, frame, false, backend);
+    }
+
+    // Packed occupancy of one slab, bit i set means cell i of the slab is filled
+    class OccupancyBitmask
+    {
+    public:
+
+        OccupancyBitmask() : num_bits_(0) {}
+
+        inline void Reset(const size_t num_bits)
+        {
+            num_bits_ = num_bits;
+            words_.assign((num_bits + 63) / 64, 0u);
+        }
+
+        inline size_t Size() const
+        {
+            return num_bits_;
+        }
+
+        inline void Set(const size_t bit, const bool filled)
+        {
+            const uint64_t mask = (uint64_t)1 << (bit % 64);
+            if (filled)
+            {
+                words_[bit / 64] |= mask;
+            }
+            else
+            {
+                words_[bit / 64] &= ~mask;
+            }
+        }
+
+        inline bool Get(const size_t bit) const
+        {
+            return ((words_[bit / 64] >> (bit % 64)) & 1u) != 0;
+        }
+
+        inline std::vector<uint64_t>& Words()
+        {
+            return words_;
+        }
+
+        inline const std::vector<uint64_t>& Words() const
+        {
+            return words_;
+        }
+
+    protected:
+
+        size_t num_bits_;
+        std::vector<uint64_t> words_;
+    };
+
+    // Answers occupancy for a whole slab of cells per call instead of one cell per callback, so
+    // that a backend (mesh rasterizer, cached occupancy file, physics engine) can batch its work.
+    // A slab is one x plane of the grid: cell_centers holds num_y_cells * num_z_cells locations
+    // in the frame of the grid's parent (the same frame as GridIndexToLocation), z fastest.
+    class OccupancyProvider
+    {
+    public:
+
+        virtual ~OccupancyProvider() {}
+
+        // Must Reset() filled to cell_centers.size() and set the bits of the filled cells
+        virtual void QuerySlab(const EigenHelpers::VectorVector3d& cell_centers, OccupancyBitmask& filled) const = 0;
+
+        // When true, QuerySlab is called for several slabs at once from OpenMP threads
+        virtual bool IsThreadSafe() const
+        {
+            return false;
+        }
+    };
+
+    // Adapts a per-cell predicate on locations, useful for backends without a native batch query
+    class FunctionOccupancyProvider : public OccupancyProvider
+    {
+    public:
+
+        FunctionOccupancyProvider(const std::function<bool(const Eigen::Vector3d&)>& is_filled_fn, const bool thread_safe=false)
+            : is_filled_fn_(is_filled_fn), thread_safe_(thread_safe) {}
+
+        virtual void QuerySlab(const EigenHelpers::VectorVector3d& cell_centers, OccupancyBitmask& filled) const
+        {
+            filled.Reset(cell_centers.size());
+            for (size_t idx = 0; idx < cell_centers.size(); idx++)
+            {
+                filled.Set(idx, is_filled_fn_(cell_centers[idx]));
+            }
+        }
+
+        virtual bool IsThreadSafe() const
+        {
+            return thread_safe_;
+        }
+
+    protected:
+
+        std::function<bool(const Eigen::Vector3d&)> is_filled_fn_;
+        bool thread_safe_;
+    };
+
+    // Queries the provider slab by slab and returns the occupancy of every cell, x-major
+    inline std::vector<uint8_t> ComputeOccupancy(const Eigen::Isometry3d& grid_origin_tranform,
+                                                 const double grid_resolution,
+                                                 const int64_t grid_num_x_cells,
+                                                 const int64_t grid_num_y_cells,
+                                                 const int64_t grid_num_z_cells,
+                                                 const OccupancyProvider& provider)
+    {
+        const int64_t slab_size = grid_num_y_cells * grid_num_z_cells;
+        std::vector<uint8_t> occupancy((size_t)(grid_num_x_cells * slab_size), 0u);
+        const bool parallel = provider.IsThreadSafe();
+        // Exceptions cannot leave an OpenMP region, a bad slab is flagged and reported after it
+        bool size_mismatch = false;
+        #pragma omp parallel if(parallel)
+        {
+            EigenHelpers::VectorVector3d cell_centers((size_t)slab_size);
+            OccupancyBitmask filled;
+            #pragma omp for
+            for (int64_t x_index = 0; x_index < grid_num_x_cells; x_index++)
+            {
+                size_t slab_index = 0;
+                for (int64_t y_index = 0; y_index < grid_num_y_cells; y_index++)
+                {
+                    for (int64_t z_index = 0; z_index < grid_num_z_cells; z_index++)
+                    {
+                        const Eigen::Vector3d point_in_grid_frame(grid_resolution * ((double)x_index + 0.5),
+                                                                  grid_resolution * ((double)y_index + 0.5),
+                                                                  grid_resolution * ((double)z_index + 0.5));
+                        cell_centers[slab_index] = grid_origin_tranform * point_in_grid_frame;
+                        slab_index++;
+                    }
+                }
+                provider.QuerySlab(cell_centers, filled);
+                if (filled.Size() != (size_t)slab_size)
+                {
+                    #pragma omp critical
+                    size_mismatch = true;
+                    continue;
+                }
+                uint8_t* slab_occupancy = occupancy.data() + (x_index * slab_size);
+                for (int64_t idx = 0; idx < slab_size; idx++)
+                {
+                    slab_occupancy[idx] = filled.Get((size_t)idx) ? 1u : 0u;
+                }
+            }
+        }
+        if (size_mismatch)
+        {
+            throw std::invalid_argument("OccupancyProvider returned a bitmask of the wrong size");
+        }
+        return occupancy;
+    }
+
+    inline std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>> ExtractSignedDistanceField(const Eigen::Isometry3d& grid_origin_tranform,
+                                                                                                           const double grid_resolution,
+                                                                                                           const int64_t grid_num_x_cells,
+                                                                                                           const int64_t grid_num_y_cells,
+                                                                                                           const int64_t grid_num_z_cells,
+                                                                                                           const OccupancyProvider& provider,
+                                                                                                           const float oob_value,
+                                                                                                           const std::string& frame,
+                                                                                                           const GENERATION_BACKEND backend=BUCKET_QUEUE)
+    {
+        const std::vector<uint8_t> occupancy = ComputeOccupancy(grid_origin_tranform, grid_resolution, grid_num_x_cells, grid_num_y_cells, grid_num_z_cells, provider);
+        const std::function<bool(const VoxelGrid::GRID_INDEX&)> is_filled_fn = [&] (const VoxelGrid::GRID_INDEX& index)
+        {
+            return occupancy[(size_t)((((index.x * grid_num_y_cells) + index.y) * grid_num_z_cells) + index.z)] != 0;
+        };
+        return ExtractSignedDistanceField<uint8_t>(grid_origin_tranform, grid_resolution, grid_num_x_cells, grid_num_y_cells, grid_num_z_cells, is_filled_fn, oob_value, frame, backend);
+    }
+
+    template<typename T, typename BackingStore=std::vector<T>>
+    inline std::pair<sdf_tools::SignedDistanceField, std::pair<double, double>> ExtractSignedDistanceField(const VoxelGrid::VoxelGrid<T, BackingStore>& grid, const OccupancyProvider& provider, const float oob_value, const std::string& frame, const GENERATION_BACKEND backend=BUCKET_QUEUE)
+    {
+        const Eigen::Vector3d cell_sizes = grid.GetCellSizes();
+        if ((cell_sizes.x() != cell_sizes.y()) || (cell_sizes.x() != cell_sizes.z()))
+        {
+            throw std::invalid_argument("Grid must have uniform resolution");
+        }
+        return ExtractSignedDistanceField(grid.GetOriginTransform(), cell_sizes.x(), grid.GetNumXCells(), grid.GetNumYCells(), grid.GetNumZCells(), provider, oob_value, frame, backend);
     }
 }
 
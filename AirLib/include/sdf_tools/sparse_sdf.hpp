@@ -0,0 +1,509 @@
+#ifndef SPARSE_SDF_HPP
+#define SPARSE_SDF_HPP
+
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <Eigen/Geometry>
+#include <unsupported/Eigen/AutoDiff>
+#include <sdf_utils/dynamic_spatial_hashed_voxel_grid.hpp>
+#include <sdf_tools/sdf_generation.hpp>
+
+namespace sdf_tools
+{
+/*
+ * Narrow-band signed distance field over hashed chunks.
+ *
+ * Chunks that lie within the truncation distance of a surface store every
+ * cell; all other chunks store a single value of +/- truncation distance,
+ * which keeps the inside/outside sign. Memory therefore scales with the
+ * surface area of the course rather than its volume. Distances are exact
+ * (up to interpolation) within the truncation distance of a surface and
+ * saturate to +/- truncation distance beyond it.
+ *
+ * The query API mirrors SignedDistanceField.
+ */
+class SparseSignedDistanceField
+    : public VoxelGrid::DynamicSpatialHashedVoxelGrid<float>
+{
+protected:
+
+  typedef VoxelGrid::DynamicSpatialHashedVoxelGridChunk<float> Chunk;
+
+  std::string frame_;
+  double truncation_distance_;
+  float oob_value_;
+  int64_t num_x_cells_;
+  int64_t num_y_cells_;
+  int64_t num_z_cells_;
+
+  inline const Chunk* FindChunk(const int64_t x_chunk,
+                                const int64_t y_chunk,
+                                const int64_t z_chunk) const
+  {
+    // Same base computation as GetContainingChunkRegion so the keys match
+    const VoxelGrid::CHUNK_REGION region((double)x_chunk * chunk_x_size_,
+                                         (double)y_chunk * chunk_y_size_,
+                                         (double)z_chunk * chunk_z_size_);
+    const auto found_chunk_itr = chunks_.find(region);
+    if (found_chunk_itr != chunks_.end())
+    {
+      return &(found_chunk_itr->second);
+    }
+    else
+    {
+      return nullptr;
+    }
+  }
+
+  inline double GetCellDistance(const int64_t x_index,
+                                const int64_t y_index,
+                                const int64_t z_index) const
+  {
+    const int64_t x_chunk = x_index / chunk_num_x_cells_;
+    const int64_t y_chunk = y_index / chunk_num_y_cells_;
+    const int64_t z_chunk = z_index / chunk_num_z_cells_;
+    const Chunk* chunk = FindChunk(x_chunk, y_chunk, z_chunk);
+    if (chunk == nullptr)
+    {
+      return (double)default_value_;
+    }
+    else if (chunk->IsCellInitialized())
+    {
+      return (double)chunk->GetImmutableByIndex(
+            x_index - (x_chunk * chunk_num_x_cells_),
+            y_index - (y_chunk * chunk_num_y_cells_),
+            z_index - (z_chunk * chunk_num_z_cells_)).first;
+    }
+    else
+    {
+      return (double)chunk->GetChunkImmutable();
+    }
+  }
+
+  // Stored values are distances at cell centers, like SignedDistanceField
+  inline double GetCorrectedCenterDistance(const int64_t x_index,
+                                           const int64_t y_index,
+                                           const int64_t z_index) const
+  {
+    const double nominal_sdf_distance
+        = GetCellDistance(x_index, y_index, z_index);
+    const double cell_center_distance_offset = GetResolution() * 0.5;
+    if (nominal_sdf_distance >= 0.0)
+    {
+      return nominal_sdf_distance - cell_center_distance_offset;
+    }
+    else
+    {
+      return nominal_sdf_distance + cell_center_distance_offset;
+    }
+  }
+
+  static inline std::pair<int64_t, int64_t> GetAxisInterpolationIndices(
+      const int64_t initial_index,
+      const int64_t axis_size,
+      const double axis_offset)
+  {
+    int64_t lower = initial_index;
+    int64_t upper = initial_index;
+    if (axis_offset >= 0.0)
+    {
+      upper = initial_index + 1;
+      if (upper >= axis_size)
+      {
+        upper = initial_index;
+        lower = std::max<int64_t>(initial_index - 1, 0);
+      }
+    }
+    else
+    {
+      lower = initial_index - 1;
+      if (lower < 0)
+      {
+        lower = initial_index;
+        upper = std::min<int64_t>(initial_index + 1, axis_size - 1);
+      }
+    }
+    return std::make_pair(lower, upper);
+  }
+
+  inline bool LocationToGridIndex(const Eigen::Vector3d& grid_location,
+                                  int64_t& x_index,
+                                  int64_t& y_index,
+                                  int64_t& z_index) const
+  {
+    x_index = (int64_t)std::floor(grid_location.x() / cell_x_size_);
+    y_index = (int64_t)std::floor(grid_location.y() / cell_y_size_);
+    z_index = (int64_t)std::floor(grid_location.z() / cell_z_size_);
+    return (x_index >= 0 && y_index >= 0 && z_index >= 0
+            && x_index < num_x_cells_ && y_index < num_y_cells_
+            && z_index < num_z_cells_);
+  }
+
+  // Trilinear interpolation between the 8 cell centers around the query,
+  // templated so that it can be differentiated with AutoDiffScalar
+  template<typename T>
+  inline T EstimateDistanceGridFrame(
+      const Eigen::Matrix<T, 3, 1>& grid_frame_query_location,
+      const Eigen::Vector3d& grid_location,
+      const int64_t x_idx, const int64_t y_idx, const int64_t z_idx) const
+  {
+    const double resolution = GetResolution();
+    const Eigen::Vector3d cell_center((double)x_idx + 0.5,
+                                      (double)y_idx + 0.5,
+                                      (double)z_idx + 0.5);
+    const Eigen::Vector3d query_offset
+        = grid_location - (cell_center * resolution);
+    const std::pair<int64_t, int64_t> x_axis_indices
+        = GetAxisInterpolationIndices(x_idx, num_x_cells_, query_offset(0));
+    const std::pair<int64_t, int64_t> y_axis_indices
+        = GetAxisInterpolationIndices(y_idx, num_y_cells_, query_offset(1));
+    const std::pair<int64_t, int64_t> z_axis_indices
+        = GetAxisInterpolationIndices(z_idx, num_z_cells_, query_offset(2));
+    const Eigen::Vector3d lower_corner_location
+        = Eigen::Vector3d((double)x_axis_indices.first + 0.5,
+                          (double)y_axis_indices.first + 0.5,
+                          (double)z_axis_indices.first + 0.5) * resolution;
+    const int64_t xs[2] = {x_axis_indices.first, x_axis_indices.second};
+    const int64_t ys[2] = {y_axis_indices.first, y_axis_indices.second};
+    const int64_t zs[2] = {z_axis_indices.first, z_axis_indices.second};
+    const T tx = (grid_frame_query_location(0)
+                  - T(lower_corner_location(0))) / resolution;
+    const T ty = (grid_frame_query_location(1)
+                  - T(lower_corner_location(1))) / resolution;
+    const T tz = (grid_frame_query_location(2)
+                  - T(lower_corner_location(2))) / resolution;
+    T xy_planes[2];
+    for (int z_side = 0; z_side < 2; z_side++)
+    {
+      const double mxmy = GetCorrectedCenterDistance(xs[0], ys[0], zs[z_side]);
+      const double mxpy = GetCorrectedCenterDistance(xs[0], ys[1], zs[z_side]);
+      const double pxmy = GetCorrectedCenterDistance(xs[1], ys[0], zs[z_side]);
+      const double pxpy = GetCorrectedCenterDistance(xs[1], ys[1], zs[z_side]);
+      const T my = mxmy + (tx * (pxmy - mxmy));
+      const T py = mxpy + (tx * (pxpy - mxpy));
+      xy_planes[z_side] = my + (ty * (py - my));
+    }
+    return xy_planes[0] + (tz * (xy_planes[1] - xy_planes[0]));
+  }
+
+public:
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  inline SparseSignedDistanceField(const Eigen::Isometry3d& origin_transform,
+                                   const std::string& frame,
+                                   const double resolution,
+                                   const double x_size,
+                                   const double y_size,
+                                   const double z_size,
+                                   const double truncation_distance,
+                                   const float OOB_value,
+                                   const int64_t chunk_num_cells = 16)
+    : VoxelGrid::DynamicSpatialHashedVoxelGrid<float>(
+        origin_transform, resolution,
+        chunk_num_cells, chunk_num_cells, chunk_num_cells,
+        (float)truncation_distance),
+      frame_(frame),
+      truncation_distance_(truncation_distance),
+      oob_value_(OOB_value)
+  {
+    if (truncation_distance < (2.0 * resolution))
+    {
+      throw std::invalid_argument(
+            "truncation_distance must be at least two cells");
+    }
+    num_x_cells_ = (int64_t)std::ceil(x_size / resolution);
+    num_y_cells_ = (int64_t)std::ceil(y_size / resolution);
+    num_z_cells_ = (int64_t)std::ceil(z_size / resolution);
+  }
+
+  inline SparseSignedDistanceField()
+    : VoxelGrid::DynamicSpatialHashedVoxelGrid<float>(),
+      frame_(""), truncation_distance_(0.0), oob_value_(0.0f),
+      num_x_cells_(0), num_y_cells_(0), num_z_cells_(0) {}
+
+  /*
+   * Fills the field from the occupancy provider. The region is processed in
+   * tiles of tile_num_chunks^3 chunks; each tile runs the dense parallel EDT
+   * over itself plus a halo of the truncation distance, so only one tile is
+   * ever held densely in memory.
+   */
+  inline void Build(const sdf_generation::OccupancyProvider& provider,
+                    const int64_t tile_num_chunks = 8)
+  {
+    chunks_.clear();
+    const double resolution = GetResolution();
+    const int64_t halo_cells
+        = (int64_t)std::ceil(truncation_distance_ / resolution) + 1;
+    const int64_t num_x_chunks
+        = (num_x_cells_ + chunk_num_x_cells_ - 1) / chunk_num_x_cells_;
+    const int64_t num_y_chunks
+        = (num_y_cells_ + chunk_num_y_cells_ - 1) / chunk_num_y_cells_;
+    const int64_t num_z_chunks
+        = (num_z_cells_ + chunk_num_z_cells_ - 1) / chunk_num_z_cells_;
+    const float truncation = (float)truncation_distance_;
+    for (int64_t tile_x = 0; tile_x < num_x_chunks; tile_x += tile_num_chunks)
+    {
+      for (int64_t tile_y = 0; tile_y < num_y_chunks; tile_y += tile_num_chunks)
+      {
+        for (int64_t tile_z = 0; tile_z < num_z_chunks;
+             tile_z += tile_num_chunks)
+        {
+          const int64_t tile_x_chunks
+              = std::min(tile_num_chunks, num_x_chunks - tile_x);
+          const int64_t tile_y_chunks
+              = std::min(tile_num_chunks, num_y_chunks - tile_y);
+          const int64_t tile_z_chunks
+              = std::min(tile_num_chunks, num_z_chunks - tile_z);
+          // Dense grid of the tile plus halo, in cells of this grid
+          const int64_t dense_x_min
+              = (tile_x * chunk_num_x_cells_) - halo_cells;
+          const int64_t dense_y_min
+              = (tile_y * chunk_num_y_cells_) - halo_cells;
+          const int64_t dense_z_min
+              = (tile_z * chunk_num_z_cells_) - halo_cells;
+          const int64_t dense_x_cells
+              = (tile_x_chunks * chunk_num_x_cells_) + (2 * halo_cells);
+          const int64_t dense_y_cells
+              = (tile_y_chunks * chunk_num_y_cells_) + (2 * halo_cells);
+          const int64_t dense_z_cells
+              = (tile_z_chunks * chunk_num_z_cells_) + (2 * halo_cells);
+          const Eigen::Isometry3d dense_origin
+              = origin_transform_
+                * Eigen::Translation3d((double)dense_x_min * resolution,
+                                       (double)dense_y_min * resolution,
+                                       (double)dense_z_min * resolution);
+          const SignedDistanceField dense
+              = sdf_generation::ExtractSignedDistanceField(
+                  dense_origin, resolution,
+                  dense_x_cells, dense_y_cells, dense_z_cells,
+                  provider, std::numeric_limits<float>::infinity(), frame_,
+                  sdf_generation::PARALLEL_EDT).first;
+          for (int64_t cx = tile_x; cx < tile_x + tile_x_chunks; cx++)
+          {
+            for (int64_t cy = tile_y; cy < tile_y + tile_y_chunks; cy++)
+            {
+              for (int64_t cz = tile_z; cz < tile_z + tile_z_chunks; cz++)
+              {
+                StoreChunk(dense, dense_x_min, dense_y_min, dense_z_min,
+                           cx, cy, cz, truncation);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /////////////////////////////////////////////////////////////////////
+  // Misc data access
+  /////////////////////////////////////////////////////////////////////
+
+  inline double GetResolution() const
+  {
+    return cell_x_size_;
+  }
+
+  inline std::string GetFrame() const
+  {
+    return frame_;
+  }
+
+  inline double GetTruncationDistance() const
+  {
+    return truncation_distance_;
+  }
+
+  inline float GetOOBValue() const
+  {
+    return oob_value_;
+  }
+
+  inline int64_t GetNumXCells() const
+  {
+    return num_x_cells_;
+  }
+
+  inline int64_t GetNumYCells() const
+  {
+    return num_y_cells_;
+  }
+
+  inline int64_t GetNumZCells() const
+  {
+    return num_z_cells_;
+  }
+
+  // Number of chunks that store individual cells (near a surface)
+  inline size_t GetNumCellChunks() const
+  {
+    size_t num_cell_chunks = 0;
+    for (auto chunk_itr = chunks_.begin(); chunk_itr != chunks_.end();
+         ++chunk_itr)
+    {
+      if (chunk_itr->second.IsCellInitialized())
+      {
+        num_cell_chunks++;
+      }
+    }
+    return num_cell_chunks;
+  }
+
+  // Approximate heap usage of the stored distances
+  inline uint64_t GetMemoryUsageBytes() const
+  {
+    const uint64_t cells_per_chunk = (uint64_t)(chunk_num_x_cells_
+                                                * chunk_num_y_cells_
+                                                * chunk_num_z_cells_);
+    return (GetNumCellChunks() * cells_per_chunk * sizeof(float))
+        + (chunks_.size() * (sizeof(Chunk) + sizeof(VoxelGrid::CHUNK_REGION)));
+  }
+
+  /////////////////////////////////////////////////////////////////////
+  // Estimate distance functions
+  /////////////////////////////////////////////////////////////////////
+
+  inline std::pair<double, bool> EstimateDistance(const double x,
+                                                  const double y,
+                                                  const double z) const
+  {
+    return EstimateDistance3d(Eigen::Vector3d(x, y, z));
+  }
+
+  inline std::pair<double, bool> EstimateDistance3d(
+      const Eigen::Vector3d& location) const
+  {
+    const Eigen::Vector3d grid_location = inverse_origin_transform_ * location;
+    int64_t x_idx = 0, y_idx = 0, z_idx = 0;
+    if (LocationToGridIndex(grid_location, x_idx, y_idx, z_idx))
+    {
+      return std::make_pair(
+            EstimateDistanceGridFrame<double>(grid_location, grid_location,
+                                              x_idx, y_idx, z_idx),
+            true);
+    }
+    else
+    {
+      return std::make_pair((double)oob_value_, false);
+    }
+  }
+
+  inline std::pair<double, bool> EstimateDistance4d(
+      const Eigen::Vector4d& location) const
+  {
+    return EstimateDistance3d(location.head<3>());
+  }
+
+  inline std::vector<double> GetAutoDiffGradient(
+      const double x, const double y, const double z) const
+  {
+    return GetAutoDiffGradient3d(Eigen::Vector3d(x, y, z));
+  }
+
+  inline std::vector<double> GetAutoDiffGradient3d(
+      const Eigen::Vector3d& location) const
+  {
+    const Eigen::Vector3d grid_location = inverse_origin_transform_ * location;
+    int64_t x_idx = 0, y_idx = 0, z_idx = 0;
+    if (LocationToGridIndex(grid_location, x_idx, y_idx, z_idx))
+    {
+      // Differentiate with respect to the query location in the parent frame
+      typedef Eigen::AutoDiffScalar<Eigen::Vector3d> AScalar;
+      Eigen::Matrix<AScalar, 3, 1> Alocation;
+      for (int axis = 0; axis < 3; axis++)
+      {
+        Alocation(axis) = location(axis);
+        Alocation(axis).derivatives() = Eigen::Vector3d::Unit(axis);
+      }
+      const Eigen::Matrix<AScalar, 3, 1> Agrid_location
+          = inverse_origin_transform_.linear().cast<AScalar>() * Alocation
+            + inverse_origin_transform_.translation().cast<AScalar>();
+      const AScalar Adist = EstimateDistanceGridFrame<AScalar>(
+                              Agrid_location, grid_location,
+                              x_idx, y_idx, z_idx);
+      return std::vector<double>{Adist.derivatives()(0),
+                                 Adist.derivatives()(1),
+                                 Adist.derivatives()(2)};
+    }
+    else
+    {
+      return std::vector<double>();
+    }
+  }
+
+  inline std::vector<double> GetAutoDiffGradient4d(
+      const Eigen::Vector4d& location) const
+  {
+    return GetAutoDiffGradient3d(location.head<3>());
+  }
+
+protected:
+
+  inline void StoreChunk(const SignedDistanceField& dense,
+                         const int64_t dense_x_min,
+                         const int64_t dense_y_min,
+                         const int64_t dense_z_min,
+                         const int64_t x_chunk,
+                         const int64_t y_chunk,
+                         const int64_t z_chunk,
+                         const float truncation)
+  {
+    const int64_t x_offset = (x_chunk * chunk_num_x_cells_) - dense_x_min;
+    const int64_t y_offset = (y_chunk * chunk_num_y_cells_) - dense_y_min;
+    const int64_t z_offset = (z_chunk * chunk_num_z_cells_) - dense_z_min;
+    float min_abs_distance = std::numeric_limits<float>::infinity();
+    float sign = 1.0f;
+    for (int64_t x = 0; x < chunk_num_x_cells_; x++)
+    {
+      for (int64_t y = 0; y < chunk_num_y_cells_; y++)
+      {
+        for (int64_t z = 0; z < chunk_num_z_cells_; z++)
+        {
+          const float distance = dense.GetImmutable(x + x_offset,
+                                                    y + y_offset,
+                                                    z + z_offset).first;
+          if (std::fabs(distance) < min_abs_distance)
+          {
+            min_abs_distance = std::fabs(distance);
+            sign = (distance < 0.0f) ? -1.0f : 1.0f;
+          }
+        }
+      }
+    }
+    const VoxelGrid::CHUNK_REGION region(
+          (double)x_chunk * chunk_x_size_,
+          (double)y_chunk * chunk_y_size_,
+          (double)z_chunk * chunk_z_size_);
+    if (min_abs_distance >= truncation)
+    {
+      // Far from any surface, one value keeps the sign
+      chunks_[region] = Chunk(region, chunk_x_size_, chunk_y_size_,
+                              chunk_z_size_, sign * truncation);
+      return;
+    }
+    Chunk chunk(region, cell_x_size_, cell_y_size_, cell_z_size_,
+                chunk_num_x_cells_, chunk_num_y_cells_, chunk_num_z_cells_,
+                truncation);
+    for (int64_t x = 0; x < chunk_num_x_cells_; x++)
+    {
+      for (int64_t y = 0; y < chunk_num_y_cells_; y++)
+      {
+        for (int64_t z = 0; z < chunk_num_z_cells_; z++)
+        {
+          const float distance = dense.GetImmutable(x + x_offset,
+                                                    y + y_offset,
+                                                    z + z_offset).first;
+          chunk.GetMutableByIndex(x, y, z).first
+              = std::max(-truncation, std::min(truncation, distance));
+        }
+      }
+    }
+    chunks_[region] = std::move(chunk);
+  }
+};
+}
+
+#endif // SPARSE_SDF_HPP
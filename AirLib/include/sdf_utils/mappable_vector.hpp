@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <stdexcept>
+
+#ifndef MAPPABLE_VECTOR_HPP
+#define MAPPABLE_VECTOR_HPP
+
+namespace sdf_utils
+{
+    // A whole file mapped copy-on-write into memory. Writes through Data() go to private pages
+    // and never reach the file. The mapping is released on destruction.
+    class MappedFile
+    {
+    public:
+
+        explicit MappedFile(const std::string& filepath);
+
+        ~MappedFile();
+
+        inline const uint8_t* Data() const
+        {
+            return data_;
+        }
+
+        inline uint8_t* MutableData()
+        {
+            return data_;
+        }
+
+        inline uint64_t Size() const
+        {
+            return size_;
+        }
+
+    private:
+
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+
+        uint8_t* data_;
+        uint64_t size_;
+        void* mapping_handle_;
+    };
+
+    // Vector-like storage for VoxelGrid that either owns its elements or refers to elements in
+    // a MappedFile. Copies of a mapped vector share the mapping and the first mutable element
+    // access of a shared copy detaches it into owned memory, so mapped data is never copied
+    // unless it is modified. Detach() explicitly before writing from several threads at once.
+    template<typename T>
+    class MappableVector
+    {
+    public:
+
+        typedef T value_type;
+        typedef size_t size_type;
+
+        MappableVector() : data_(nullptr), size_(0) {}
+
+        MappableVector(const size_t count, const T& value) : owned_(count, value)
+        {
+            PointAtOwned();
+        }
+
+        MappableVector(std::vector<T>&& values) : owned_(std::move(values))
+        {
+            PointAtOwned();
+        }
+
+        MappableVector(const std::shared_ptr<MappedFile>& mapping, const uint64_t byte_offset, const size_t count)
+            : mapping_(mapping), data_(nullptr), size_(count)
+        {
+            if ((byte_offset % alignof(T)) != 0 || (byte_offset + (count * sizeof(T))) > mapping->Size())
+            {
+                throw std::invalid_argument("Mapped region is misaligned or out of range");
+            }
+            data_ = reinterpret_cast<T*>(mapping->MutableData() + byte_offset);
+        }
+
+        MappableVector(const MappableVector& other) : owned_(other.owned_), mapping_(other.mapping_), data_(other.data_), size_(other.size_)
+        {
+            if (!mapping_)
+            {
+                PointAtOwned();
+            }
+        }
+
+        MappableVector& operator=(const MappableVector& other)
+        {
+            if (this != &other)
+            {
+                owned_ = other.owned_;
+                mapping_ = other.mapping_;
+                data_ = other.data_;
+                size_ = other.size_;
+                if (!mapping_)
+                {
+                    PointAtOwned();
+                }
+            }
+            return *this;
+        }
+
+        // Moves take the owned elements or the mapping, the moved-from vector is left empty
+        MappableVector(MappableVector&& other) noexcept
+            : owned_(std::move(other.owned_)), mapping_(std::move(other.mapping_)), data_(other.data_), size_(other.size_)
+        {
+            if (!mapping_)
+            {
+                PointAtOwned();
+            }
+            other.clear();
+        }
+
+        MappableVector& operator=(MappableVector&& other) noexcept
+        {
+            if (this != &other)
+            {
+                owned_ = std::move(other.owned_);
+                mapping_ = std::move(other.mapping_);
+                data_ = other.data_;
+                size_ = other.size_;
+                if (!mapping_)
+                {
+                    PointAtOwned();
+                }
+                other.clear();
+            }
+            return *this;
+        }
+
+        inline bool IsMapped() const
+        {
+            return (bool)mapping_;
+        }
+
+        // Copies mapped elements into owned memory and releases the mapping
+        inline void Detach()
+        {
+            if (mapping_)
+            {
+                owned_.assign(data_, data_ + size_);
+                mapping_.reset();
+                PointAtOwned();
+            }
+        }
+
+        inline size_t size() const
+        {
+            return size_;
+        }
+
+        inline bool empty() const
+        {
+            return size_ == 0;
+        }
+
+        inline const T& operator[](const size_t index) const
+        {
+            return data_[index];
+        }
+
+        inline T& operator[](const size_t index)
+        {
+            if (mapping_ && mapping_.use_count() > 1)
+            {
+                Detach();
+            }
+            return data_[index];
+        }
+
+        inline const T* data() const
+        {
+            return data_;
+        }
+
+        inline void clear()
+        {
+            mapping_.reset();
+            owned_.clear();
+            PointAtOwned();
+        }
+
+        inline void resize(const size_t count, const T& value=T())
+        {
+            Detach();
+            owned_.resize(count, value);
+            PointAtOwned();
+        }
+
+        inline void reserve(const size_t count)
+        {
+            Detach();
+            owned_.reserve(count);
+            PointAtOwned();
+        }
+
+        inline void push_back(const T& value)
+        {
+            Detach();
+            owned_.push_back(value);
+            PointAtOwned();
+        }
+
+        inline void shrink_to_fit()
+        {
+            owned_.shrink_to_fit();
+            if (!mapping_)
+            {
+                PointAtOwned();
+            }
+        }
+
+    protected:
+
+        inline void PointAtOwned()
+        {
+            data_ = owned_.data();
+            size_ = owned_.size();
+        }
+
+        std::vector<T> owned_;
+        std::shared_ptr<MappedFile> mapping_;
+        T* data_;
+        size_t size_;
+    };
+}
+
+#endif // MAPPABLE_VECTOR_HPP
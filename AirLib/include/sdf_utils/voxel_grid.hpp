@@ -517,6 +517,13 @@ public:
 
   virtual ~VoxelGrid() {}
 
+  // The destructor would otherwise suppress the implicit moves, which take
+  // the backing store instead of copying every cell.
+  VoxelGrid(const VoxelGrid&) = default;
+  VoxelGrid(VoxelGrid&&) = default;
+  VoxelGrid& operator=(const VoxelGrid&) = default;
+  VoxelGrid& operator=(VoxelGrid&&) = default;
+
   virtual VoxelGrid<T, BackingStore>* Clone() const
   {
     return new VoxelGrid<T, BackingStore>(
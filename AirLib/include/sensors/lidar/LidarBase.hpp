@@ -5,6 +5,7 @@
 #define msr_airlib_LidarBase_hpp
 
 #include "sensors/SensorBase.hpp"
+#include "LidarPointRing.hpp"
 
 namespace msr
 {
@@ -25,23 +26,55 @@ namespace airlib
             //call base
             UpdatableObject::reportState(reporter);
 
-            reporter.writeValue("Lidar-Timestamp", output_.time_stamp);
-            reporter.writeValue("Lidar-NumPoints", static_cast<int>(output_.point_cloud.size() / 3));
+            const auto frame = point_ring_.latest();
+            reporter.writeValue("Lidar-Timestamp", frame ? frame->time_stamp : 0);
+            reporter.writeValue("Lidar-NumPoints", frame ? static_cast<int>(frame->points.size()) : 0);
         }
 
-        const LidarData& getOutput() const
+        //latest scan in the LidarData layout, converted on the first request for each scan only, so scans nobody
+        //asks for cost nothing and asking again for the same scan returns the cached copy
+        LidarData getOutput() const
         {
+            const auto frame = point_ring_.latest();
+            std::lock_guard<std::mutex> lock(output_mutex_);
+            if (frame == nullptr || frame->sequence == output_sequence_)
+                return output_;
+
+            output_sequence_ = frame->sequence;
+            output_.time_stamp = frame->time_stamp;
+            output_.pose = frame->pose;
+            output_.point_cloud.clear();
+            output_.segmentation.clear();
+            output_.point_cloud.reserve(frame->points.size() * 3);
+            output_.segmentation.reserve(frame->points.size());
+            for (const LidarPoint& point : frame->points) {
+                output_.point_cloud.push_back(point.x);
+                output_.point_cloud.push_back(point.y);
+                output_.point_cloud.push_back(point.z);
+                output_.segmentation.push_back(point.segmentation);
+            }
             return output_;
         }
 
+        //latest scan as one flat buffer, safe to hold on to from other threads
+        std::shared_ptr<const LidarPointFrame> getPointFrame() const
+        {
+            return point_ring_.latest();
+        }
+
     protected:
-        void setOutput(const LidarData& output)
+        LidarPointRing& getPointRing()
         {
-            output_ = output;
+            return point_ring_;
         }
 
     private:
-        LidarData output_;
+        LidarPointRing point_ring_;
+
+        //getOutput of the scan with output_sequence_, 0 before any
+        mutable std::mutex output_mutex_;
+        mutable uint64_t output_sequence_ = 0;
+        mutable LidarData output_;
     };
 }
 } //namespace
@@ -0,0 +1,135 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef msr_airlib_LidarPointRing_hpp
+#define msr_airlib_LidarPointRing_hpp
+
+#include "common/Common.hpp"
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace msr
+{
+namespace airlib
+{
+
+    //one lidar return, in lidar local NED coordinates, meters
+    struct LidarPoint
+    {
+        float x, y, z;
+        int32_t segmentation;
+    };
+    static_assert(sizeof(LidarPoint) == 16, "LidarPoint is sent as raw bytes and must not have padding");
+
+    struct LidarPointFrame
+    {
+        TTimePoint time_stamp = 0;
+        Pose pose;
+        vector<LidarPoint> points;
+        uint64_t sequence = 0; //set by commit, tells scans written to the same buffer apart
+    };
+
+    /*
+Latest scans of a lidar kept as flat point buffers. The sensor writes the next scan straight into
+a buffer of the ring and publishes it, readers get a shared reference to the latest published
+scan and can serialize it without copying while the sensor goes on writing the next buffers.
+Buffers keep their capacity, so after the first few scans no allocations are made unless a
+reader holds on to every buffer of the ring, in which case the writer moves on to a new one.
+*/
+    class LidarPointRing
+    {
+    public:
+        LidarPointRing(size_t depth = 3)
+            : slots_(depth)
+        {
+            for (auto& slot : slots_)
+                slot = std::make_shared<LidarPointFrame>();
+        }
+
+        //returns an empty frame no reader refers to, only one writer may use this
+        LidarPointFrame& beginWrite()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < slots_.size(); ++i) {
+                write_index_ = (write_index_ + 1) % slots_.size();
+                //latest_ and readers hold references, slots_ alone means the frame is free
+                if (slots_[write_index_].use_count() == 1)
+                    break;
+                if (i + 1 == slots_.size())
+                    slots_[write_index_] = std::make_shared<LidarPointFrame>();
+            }
+            LidarPointFrame& frame = *slots_[write_index_];
+            frame.points.clear();
+            return frame;
+        }
+
+        //makes the frame returned by last beginWrite the latest one
+        void commit()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slots_[write_index_]->sequence = ++sequence_;
+            latest_ = slots_[write_index_];
+        }
+
+        //null until the first commit
+        std::shared_ptr<const LidarPointFrame> latest() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return latest_;
+        }
+
+    private:
+        vector<std::shared_ptr<LidarPointFrame>> slots_;
+        size_t write_index_ = 0;
+        uint64_t sequence_ = 0;
+        std::shared_ptr<const LidarPointFrame> latest_;
+        mutable std::mutex mutex_;
+    };
+
+    /*
+Read only view of a scan received over RPC. Points stay in the buffer they were received in,
+which the view keeps alive, and are decoded one at a time on access. The buffer is not
+guaranteed to be aligned, use at() or copy from data() rather than casting it.
+*/
+    class LidarPointCloud
+    {
+    public:
+        TTimePoint time_stamp = 0;
+        Pose pose;
+
+        LidarPointCloud()
+        {
+        }
+
+        LidarPointCloud(std::shared_ptr<const void> owner, const char* data, size_t point_count)
+            : owner_(std::move(owner)), data_(data), point_count_(point_count)
+        {
+        }
+
+        size_t size() const
+        {
+            return point_count_;
+        }
+
+        LidarPoint at(size_t index) const
+        {
+            LidarPoint point;
+            std::memcpy(&point, data_ + index * sizeof(LidarPoint), sizeof(LidarPoint));
+            return point;
+        }
+
+        //size() * sizeof(LidarPoint) bytes of x, y, z, segmentation per point
+        const char* data() const
+        {
+            return data_;
+        }
+
+    private:
+        std::shared_ptr<const void> owner_;
+        const char* data_ = nullptr;
+        size_t point_count_ = 0;
+    };
+}
+} //namespace
+#endif
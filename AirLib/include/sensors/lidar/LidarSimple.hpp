@@ -77,7 +77,9 @@ namespace airlib
         {
             TTimeDelta delta_time = clock()->updateSince(last_time_);
 
+            //scratch buffers keep their capacity from scan to scan
             point_cloud_.clear();
+            segmentation_cloud_.clear();
 
             const GroundTruth& ground_truth = getGroundTruth();
 
@@ -96,15 +98,28 @@ namespace airlib
                           point_cloud_,
                           segmentation_cloud_);
 
-            LidarData output;
-            output.point_cloud = point_cloud_;
-            output.time_stamp = clock()->nowNanos();
-            output.pose = lidar_pose;
-            output.segmentation = segmentation_cloud_;
+            last_time_ = clock()->nowNanos();
+            publishPointFrame(last_time_, lidar_pose);
+        }
 
-            last_time_ = output.time_stamp;
+        //the one copy of a scan, interleaving it into a ring buffer that RPC replies refer to
+        void publishPointFrame(TTimePoint time_stamp, const Pose& lidar_pose)
+        {
+            LidarPointFrame& frame = getPointRing().beginWrite();
+            frame.time_stamp = time_stamp;
+            frame.pose = lidar_pose;
+
+            const size_t point_count = point_cloud_.size() / 3;
+            frame.points.resize(point_count);
+            for (size_t i = 0; i < point_count; ++i) {
+                LidarPoint& point = frame.points[i];
+                point.x = point_cloud_[3 * i];
+                point.y = point_cloud_[3 * i + 1];
+                point.z = point_cloud_[3 * i + 2];
+                point.segmentation = i < segmentation_cloud_.size() ? segmentation_cloud_[i] : -1;
+            }
 
-            setOutput(output);
+            getPointRing().commit();
         }
 
     private:
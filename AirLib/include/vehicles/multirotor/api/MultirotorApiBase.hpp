@@ -10,8 +10,12 @@
 #include "physics/Kinematics.hpp"
 #include "physics/Environment.hpp"
 #include "api/VehicleApiBase.hpp"
+#include "SplinePlannerThread.hpp"
+#include "common/common_utils/ParallelFor.hpp"
 
 #include <atomic>
+#include <condition_variable>
+#include <limits>
 #include <thread>
 #include <memory>
 
@@ -20,6 +24,7 @@
 #include <mav_trajectory_generation/polynomial_optimization_nonlinear.h>
 #include <mav_msgs/eigen_mav_msgs.h>
 #include <mav_trajectory_generation/trajectory_sampling.h>
+#include <mav_trajectory_generation/trajectory_evaluator.h>
 
 /************************ sdf deps********************************************/
 #include <sdf_tools/sdf.hpp>
@@ -114,6 +119,63 @@ public:
     double prev_yaw_error;
 };
 
+// everything needed to fit a moveOnSpline trajectory, so that it can be planned away from the tracker
+struct SplinePlanRequest
+{
+    vector<Vector3r> waypoints; // first one is where the trajectory starts
+    vector<Vector3r> velocities; // empty, or one per waypoint to pass it with, the first one is start_velocity instead
+    bool constrain_start_velocity = false;
+    Vector3r start_velocity = Vector3r::Zero();
+    bool constrain_start_acceleration = false;
+    Vector3r start_acceleration = Vector3r::Zero();
+    float vel_max = 0;
+    float acc_max = 0;
+    double viz_sampling_dt = 1.0 / 5.0;
+
+    // warm start: segments between waypoints the previous plan also went through start from its segment times.
+    // only the time allocation carries over, the whole trajectory from waypoints.front() is optimized again
+    vector<Vector3r> previous_waypoints;
+    std::vector<double> previous_segment_times;
+    double previous_start_time = 0; // time into the previous plan at which waypoints.front() is reached
+
+    // collision cost: trajectories closer than min_clearance to an obstacle in sdf are penalized, none without sdf
+    std::shared_ptr<const sdf_tools::SignedDistanceField> sdf;
+    float min_clearance = 0;
+    float collision_weight = 1000;
+    double collision_sampling_dt = 0.1; // samples of the collision cost during the optimization
+    double collision_check_dt = 0.02; // samples of the check of the final trajectory against sdf
+};
+
+struct SplinePlan
+{
+    mav_trajectory_generation::Trajectory trajectory;
+    mav_msgs::EigenTrajectoryPoint::Vector viz_points;
+    vector<Vector3r> waypoints;
+    std::vector<double> segment_times;
+    double min_obstacle_distance = std::numeric_limits<double>::infinity(); // along the trajectory, only with an sdf
+};
+
+// what became of a replan, the call that requested it waits until it is no longer pending
+enum class SplineReplanOutcome
+{
+    Pending, // being planned, or planned and waiting for the tracker to get to swap_time
+    SwappedIn,
+    Failed, // no trajectory could be fitted through the path
+    Dropped // superseded by a newer replan, or tracking ended before swap_time
+};
+
+// a plan made while tracking, with the moveOnSpline settings that come into effect when it is swapped in
+struct SplineReplan
+{
+    SplinePlan plan;
+    double swap_time = 0; // time on the trajectory being tracked at which the plan starts
+    bool is_moveOnSplineVelConstraints = false;
+    bool viz_traj = false;
+    vector<float> viz_traj_color_rgba;
+    float replan_lookahead_sec = 0;
+    std::shared_ptr<SplineReplanOutcome> outcome; // shared with the waiting call, guarded by traj_mutex_
+};
+
 template <typename T>
 inline T rad2deg(const T radians)
 {
@@ -276,6 +338,21 @@ inline T angular_dist(T from, T to)
                                                 bool replan_from_lookahead, float replan_lookahead_sec);
         virtual void clearTrajectory();
 
+        // plans a trajectory through each candidate path concurrently, with a cost for passing closer than min_clearance
+        // to the obstacles of the sdf given to loadSplineCollisionSdf, and tracks the fastest one that stays min_clearance
+        // away from all of them. Returns false without moving if no candidate does or no sdf was loaded.
+        virtual bool moveOnSplineCandidates(const vector<vector<Vector3r>>& candidate_paths,
+                                            bool add_position_constraint, bool add_velocity_constraint, bool add_acceleration_constraint,
+                                            float vel_max, float acc_max, float min_clearance,
+                                            bool viz_traj, const vector<float>& viz_traj_color_rgba);
+        // loads the signed distance field used by moveOnSplineCandidates, e.g. one stored with simSaveSDF
+        virtual bool loadSplineCollisionSdf(const std::string& filepath);
+
+        // plans every request on pool and moves the fastest plan that keeps its request's min_clearance to best_plan.
+        // Returns its index, or -1 if there is none. plans, if given, receives all of them. Uses no state of the api.
+        static int planSplineCandidates(const vector<SplinePlanRequest>& requests, common_utils::ParallelFor& pool,
+                                        SplinePlan& best_plan, vector<SplinePlan>* plans = nullptr);
+
         /************************* high level status APIs *********************************/
         RotorStates getRotorStates() const
         {
@@ -507,8 +584,16 @@ inline T angular_dist(T from, T to)
         /************************* moveOnSpline *********************************/
         void clearTrajTrackingControllerErrorState();
         bool track_trajectory(bool is_moveOnSplineVelConstraints);
-        void fit_trajectory(const vector<Vector3r>& path, bool add_position_constraint, bool add_velocity_constraint, bool add_acceleration_constraint, float vel_max, float acc_max, bool replan_from_lookahead);
-        void fit_trajectory_vel_constraints(const vector<Vector3r>& path, const vector<Vector3r>& velocities, bool add_position_constraint, bool add_velocity_constraint, bool add_acceleration_constraint, float vel_max, float acc_max, bool replan_from_lookahead);
+        static bool plan_spline(const SplinePlanRequest& request, SplinePlan& plan);
+        void set_curr_plan(SplinePlan& plan);
+        bool replan_while_tracking(const vector<Vector3r>& path, const vector<Vector3r>& velocities, bool is_moveOnSplineVelConstraints,
+                                   bool add_velocity_constraint, bool add_acceleration_constraint, float vel_max, float acc_max,
+                                   bool viz_traj, const vector<float>& viz_traj_color_rgba, float replan_lookahead_sec, bool& swapped_in);
+        void replan_on_planner_thread(const SplinePlanRequest& request, SplineReplan replan, uint64_t replan_seq, uint64_t tracking_generation);
+        void swap_in_replanned_trajectory(double& ref_time, bool& is_moveOnSplineVelConstraints);
+        void drop_pending_replan();
+        bool fit_trajectory(const vector<Vector3r>& path, bool add_position_constraint, bool add_velocity_constraint, bool add_acceleration_constraint, float vel_max, float acc_max, bool replan_from_lookahead);
+        bool fit_trajectory_vel_constraints(const vector<Vector3r>& path, const vector<Vector3r>& velocities, bool add_position_constraint, bool add_velocity_constraint, bool add_acceleration_constraint, float vel_max, float acc_max, bool replan_from_lookahead);
         void moveOnSpline_compute_feedback_vel(const XYZYaw& curr_position, const XYZYaw& curr_velocity, 
                                                 const XYZYaw& ref_position, const XYZYaw& ref_velocity, 
                                                 bool use_only_reference_position);
@@ -532,11 +617,24 @@ inline T angular_dist(T from, T to)
         int curr_traj_track_idx_;
         bool has_traj_ = false;
         bool traj_cleared_ = false;
-        int replan_lookahead_idx_;
+        double replan_lookahead_time_ = 0;
         float replan_lookahead_sec_;
-        float traj_control_sampling_dt_;
         float traj_viz_sampling_dt_;
-        mav_msgs::EigenTrajectoryPoint::Vector curr_traj_;
+        mav_trajectory_generation::TrajectoryEvaluator curr_traj_;
+        vector<Vector3r> curr_traj_waypoints_;
+        std::vector<double> curr_traj_segment_times_;
+
+        // replanning while tracking: the tracker and the planner thread share the state below under traj_mutex_.
+        // A replan starts from curr_traj_ at replan_lookahead_time_ and is swapped in once the tracker gets there.
+        std::mutex traj_mutex_;
+        std::condition_variable tracking_done_cv_; //also notified when a replan outcome changes
+        bool tracking_active_ = false;
+        uint64_t tracking_generation_ = 0; //bumped for every track_trajectory run, replans for an earlier run are dropped
+        uint64_t replan_seq_ = 0; //latest replan request, only its result is used
+        bool replan_in_flight_ = false;
+        bool next_traj_ready_ = false;
+        SplineReplan next_traj_;
+        std::shared_ptr<SplineReplanOutcome> pending_replan_outcome_; //of the latest replan until it is no longer pending
 
         // moveOnSpline trajectory tracking control
         CrossTrackPIDParams traj_tracker_gains_;
@@ -556,6 +654,14 @@ inline T angular_dist(T from, T to)
         bool tf_to_plot_;
         float viz_poses_duration_;
 
+    private:
+        // moveOnSplineCandidates
+        std::shared_ptr<const sdf_tools::SignedDistanceField> spline_collision_sdf_; //guarded by traj_mutex_, loads replace it
+        std::unique_ptr<common_utils::ParallelFor> spline_candidate_pool_; //created with the first call
+
+        // last so that its thread is joined before the state its jobs use is destroyed
+        SplinePlannerThread spline_planner_;
+
     };
 }
 } //namespace
@@ -82,6 +82,13 @@ namespace airlib
             float vel_max, float acc_max, 
             bool viz_traj, const vector<float>& viz_traj_color_rgba, 
             bool replan_from_lookahead, float replan_lookahead_sec, const std::string& vehicle_name = "");
+        // plans every candidate path in parallel and flies the fastest one that keeps min_clearance to the
+        // obstacles of the sdf given to loadSplineCollisionSdf, which is a file saved with simSaveSDF
+        MultirotorRpcLibClient* moveOnSplineCandidatesAsync(const vector<vector<Vector3r>>& candidate_paths, 
+            bool add_position_constraint, bool add_velocity_constraint, bool add_acceleration_constraint, 
+            float vel_max, float acc_max, float min_clearance, 
+            bool viz_traj, const vector<float>& viz_traj_color_rgba, const std::string& vehicle_name = "");
+        bool loadSplineCollisionSdf(const std::string& filepath, const std::string& vehicle_name = "");
         void clearTrajectory(const std::string& vehicle_name = "");
         void setTrajectoryTrackerGains(const vector<float>& gains, const std::string& vehicle_name = "");
 
@@ -0,0 +1,74 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef air_SplinePlannerThread_hpp
+#define air_SplinePlannerThread_hpp
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace msr
+{
+namespace airlib
+{
+
+    /*
+Runs moveOnSpline replanning jobs on a thread of its own so that the tracker keeps flying the current
+trajectory while the next one is optimized. Only the latest job matters: a job submitted while another one
+is still waiting to start replaces it. The thread is started with the first job and joined on destruction.
+*/
+    class SplinePlannerThread
+    {
+    public:
+        ~SplinePlannerThread()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+                pending_ = nullptr;
+            }
+            cv_.notify_all();
+            if (thread_.joinable())
+                thread_.join();
+        }
+
+        void submit(std::function<void()> job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pending_ = std::move(job);
+                if (!thread_.joinable())
+                    thread_ = std::thread(&SplinePlannerThread::run, this);
+            }
+            cv_.notify_all();
+        }
+
+    private:
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (true) {
+                cv_.wait(lock, [this] { return stop_ || pending_ != nullptr; });
+                if (stop_)
+                    return;
+
+                std::function<void()> job = std::move(pending_);
+                pending_ = nullptr;
+                lock.unlock();
+                job();
+                lock.lock();
+            }
+        }
+
+    private:
+        std::thread thread_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::function<void()> pending_;
+        bool stop_ = false;
+    };
+}
+} //namespace
+#endif
@@ -161,7 +161,8 @@ namespace airlib
                 }
                 advanceTime();
 
-                //send sensor updates
+                //send sensor updates, the messages of this tick go out together when the batch ends
+                mavlinkcom::MavLinkConnection::SendBatch send_batch(*connection_);
                 const auto& imu_output = getImuData("");
                 const auto& mag_output = getMagnetometerData("");
                 const auto& baro_output = getBarometerData("");
@@ -212,6 +213,7 @@ namespace airlib
                         sendHILGps(gps_output.gnss.geo_point, gps_velocity, gps_velocity_xy.norm(), gps_cog, gps_output.gnss.eph, gps_output.gnss.epv, gps_output.gnss.fix_type, 10);
                     }
                 }
+                send_batch.end();
 
                 auto end = clock()->nowNanos() / 1000;
                 {
@@ -645,6 +647,7 @@ namespace airlib
                 data.messages_handled += gcs.messages_handled;
                 data.messages_received += gcs.messages_received;
                 data.messages_sent += gcs.messages_sent;
+                data.messages_dropped += gcs.messages_dropped;
 
                 if (gcs.messages_received == 0) {
                     if (!gcs_message_timer_.started()) {
@@ -1314,7 +1317,7 @@ namespace airlib
             }
 
             // start listening to the SITL connection.
-            connection_->subscribe([=](std::shared_ptr<mavlinkcom::MavLinkConnection> connection, const mavlinkcom::MavLinkMessage& msg) {
+            connection_->subscribe(getMavMessageIds(), [=](std::shared_ptr<mavlinkcom::MavLinkConnection> connection, const mavlinkcom::MavLinkMessage& msg) {
                 unused(connection);
                 processMavMessages(msg);
             });
@@ -1439,6 +1442,14 @@ namespace airlib
 
             connected_ = true;
 
+            // keep the parameter list next to settings.json so reconnecting to the same vehicle skips the download
+            try {
+                mav_vehicle_->setParamCacheFolder(common_utils::FileSystem::ensureFolder(common_utils::FileSystem::getAppDataFolder(), "ParamCache"));
+            }
+            catch (std::exception& e) {
+                addStatusMessage(std::string("Parameter cache is off: ") + e.what());
+            }
+
             // Also request home position messages
             mav_vehicle_->setMessageInterval(mavlinkcom::MavLinkHomePosition::kMessageId, 1);
 
@@ -1497,7 +1508,7 @@ namespace airlib
                     addStatusMessage(Utils::stringf("Connected to PX4 over serial port: %s", port_name_auto.c_str()));
 
                     // start listening to the HITL connection.
-                    connection_->subscribe([=](std::shared_ptr<mavlinkcom::MavLinkConnection> connection, const mavlinkcom::MavLinkMessage& msg) {
+                    connection_->subscribe(getMavMessageIds(), [=](std::shared_ptr<mavlinkcom::MavLinkConnection> connection, const mavlinkcom::MavLinkMessage& msg) {
                         unused(connection);
                         processMavMessages(msg);
                     });
@@ -1629,6 +1640,24 @@ namespace airlib
             }
         }
 
+        //the messages processMavMessages handles, the connection doesn't call it for any others
+        static std::vector<uint32_t> getMavMessageIds()
+        {
+            return {
+                mavlinkcom::MavLinkHeartbeat::kMessageId,
+                mavlinkcom::MavLinkStatustext::kMessageId,
+                mavlinkcom::MavLinkCommandLong::kMessageId,
+                mavlinkcom::MavLinkHilControls::kMessageId,
+                mavlinkcom::MavLinkHilActuatorControls::kMessageId,
+                mavlinkcom::MavLinkGpsRawInt::kMessageId,
+                mavlinkcom::MavLinkLocalPositionNed::kMessageId,
+                mavlinkcom::MavLinkExtendedSysState::kMessageId,
+                mavlinkcom::MavLinkHomePosition::kMessageId,
+                mavlinkcom::MavLinkSysStatus::kMessageId,
+                mavlinkcom::MavLinkAutopilotVersion::kMessageId
+            };
+        }
+
         void processMavMessages(const mavlinkcom::MavLinkMessage& msg)
         {
             if (msg.msgid == HeartbeatMessage.msgid) {
@@ -35,6 +35,8 @@ STRICT_MODE_OFF
 #include "common/common_utils/WindowsApisCommonPost.hpp"
 
 #include "api/RpcLibAdaptorsBase.hpp"
+#include "api/RpcLibBatch.hpp"
+#include "api/RpcLibCompactAdaptors.hpp"
 
 STRICT_MODE_ON
 #ifdef _MSC_VER
@@ -56,9 +58,12 @@ __pragma(warning(disable : 4239))
             }
 
             rpc::client client;
+            //set by enableCompactProtocol, hot calls then use the *Compact RPCs
+            bool compact = false;
         };
 
         typedef msr::airlib_rpclib::RpcLibAdaptorsBase RpcLibAdaptorsBase;
+        typedef msr::airlib_rpclib::RpcLibCompactAdaptors RpcLibCompactAdaptors;
 
         RpcLibClientBase::RpcLibClientBase(const string& ip_address, uint16_t port, float timeout_sec)
         {
@@ -73,6 +78,10 @@ __pragma(warning(disable : 4239))
         {
             return pimpl_->client.call("ping").as<bool>();
         }
+        void RpcLibClientBase::callBatch(RpcLibBatch& batch)
+        {
+            batch.setResults(pimpl_->client.call("batchCall", batch.getCalls()).as<vector<RpcLibAdaptorsBase::BatchResult>>());
+        }
         RpcLibClientBase::ConnectionState RpcLibClientBase::getConnectionState()
         {
             switch (pimpl_->client.get_connection_state()) {
@@ -112,6 +121,21 @@ __pragma(warning(disable : 4239))
         {
             return pimpl_->client.call("getServerVersion").as<int>();
         }
+        bool RpcLibClientBase::enableCompactProtocol()
+        {
+            pimpl_->compact = getServerVersion() >= RpcLibCompactAdaptors::kServerVersion;
+            return pimpl_->compact;
+        }
+        bool RpcLibClientBase::isCompactProtocolEnabled() const
+        {
+            return pimpl_->compact;
+        }
+        vector<RpcMethodMetrics> RpcLibClientBase::getRpcMethodMetrics(bool reset)
+        {
+            vector<RpcMethodMetrics> metrics;
+            RpcLibAdaptorsBase::to(pimpl_->client.call("getRpcMethodMetrics", reset).as<vector<RpcLibAdaptorsBase::RpcMethodMetrics>>(), metrics);
+            return metrics;
+        }
 
         void RpcLibClientBase::reset()
         {
@@ -176,11 +200,22 @@ __pragma(warning(disable : 4239))
 
         msr::airlib::LidarData RpcLibClientBase::getLidarData(const std::string& lidar_name, const std::string& vehicle_name) const
         {
+            if (pimpl_->compact)
+                return pimpl_->client.call("getLidarDataCompact", lidar_name, vehicle_name).as<RpcLibCompactAdaptors::LidarData>().to();
             return pimpl_->client.call("getLidarData", lidar_name, vehicle_name).as<RpcLibAdaptorsBase::LidarData>().to();
         }
 
+        msr::airlib::LidarPointCloud RpcLibClientBase::getLidarPointCloud(const std::string& lidar_name, const std::string& vehicle_name) const
+        {
+            //the cloud points into the received buffer, so it shares ownership of the reply
+            auto reply = std::make_shared<RPCLIB_MSGPACK::object_handle>(pimpl_->client.call("getLidarPointCloud", lidar_name, vehicle_name));
+            return reply->get().as<RpcLibAdaptorsBase::LidarPointCloud>().to(reply);
+        }
+
         msr::airlib::ImuBase::Output RpcLibClientBase::getImuData(const std::string& imu_name, const std::string& vehicle_name) const
         {
+            if (pimpl_->compact)
+                return pimpl_->client.call("getImuDataCompact", imu_name, vehicle_name).as<RpcLibCompactAdaptors::ImuData>().to();
             return pimpl_->client.call("getImuData", imu_name, vehicle_name).as<RpcLibAdaptorsBase::ImuData>().to();
         }
 
@@ -204,6 +239,22 @@ __pragma(warning(disable : 4239))
             return pimpl_->client.call("getDistanceSensorData", distance_sensor_name, vehicle_name).as<RpcLibAdaptorsBase::DistanceSensorData>().to();
         }
 
+        int RpcLibClientBase::subscribeTelemetry(const vector<std::string>& vehicle_names, uint32_t channels, float rate_hz)
+        {
+            return pimpl_->client.call("subscribeTelemetry", vehicle_names, channels, rate_hz).as<int>();
+        }
+
+        uint64_t RpcLibClientBase::readTelemetry(int subscription_id, msr::airlib::TelemetryStream::Handler& handler, float max_wait_sec)
+        {
+            const vector<uint8_t> batch = pimpl_->client.call("readTelemetry", subscription_id, max_wait_sec).as<vector<uint8_t>>();
+            return msr::airlib::TelemetryStream::decode(batch, handler);
+        }
+
+        void RpcLibClientBase::unsubscribeTelemetry(int subscription_id)
+        {
+            pimpl_->client.call("unsubscribeTelemetry", subscription_id);
+        }
+
         bool RpcLibClientBase::simSetSegmentationObjectID(const std::string& mesh_name, int object_id, bool is_name_regex)
         {
             return pimpl_->client.call("simSetSegmentationObjectID", mesh_name, object_id, is_name_regex).as<bool>();
@@ -239,6 +290,8 @@ __pragma(warning(disable : 4239))
         //sim only
         Pose RpcLibClientBase::simGetVehiclePose(const std::string& vehicle_name) const
         {
+            if (pimpl_->compact)
+                return pimpl_->client.call("simGetVehiclePoseCompact", vehicle_name).as<RpcLibCompactAdaptors::Pose>().to();
             return pimpl_->client.call("simGetVehiclePose", vehicle_name).as<RpcLibAdaptorsBase::Pose>().to();
         }
         void RpcLibClientBase::simSetVehiclePose(const Pose& pose, bool ignore_collision, const std::string& vehicle_name)
@@ -316,6 +369,10 @@ __pragma(warning(disable : 4239))
 
         void RpcLibClientBase::simPlotPoints(const vector<Vector3r>& points, const vector<float>& color_rgba, float size, float duration, bool is_persistent)
         {
+            if (pimpl_->compact) {
+                pimpl_->client.call("simPlotPointsCompact", RpcLibCompactAdaptors::packPoints(points), color_rgba, size, duration, is_persistent);
+                return;
+            }
             vector<RpcLibAdaptorsBase::Vector3r> conv_points;
             RpcLibAdaptorsBase::from(points, conv_points);
             pimpl_->client.call("simPlotPoints", conv_points, color_rgba, size, duration, is_persistent);
@@ -432,6 +489,8 @@ __pragma(warning(disable : 4239))
 
         msr::airlib::Pose RpcLibClientBase::simGetObjectPose(const std::string& object_name, bool add_noise) const
         {
+            if (pimpl_->compact)
+                return pimpl_->client.call("simGetObjectPoseCompact", object_name, add_noise).as<RpcLibCompactAdaptors::Pose>().to();
             return pimpl_->client.call("simGetObjectPose", object_name, add_noise).as<RpcLibAdaptorsBase::Pose>().to();
         }
 
@@ -479,6 +538,8 @@ __pragma(warning(disable : 4239))
 
         msr::airlib::Kinematics::State RpcLibClientBase::simGetGroundTruthKinematics(const std::string& vehicle_name) const
         {
+            if (pimpl_->compact)
+                return pimpl_->client.call("simGetGroundTruthKinematicsCompact", vehicle_name).as<RpcLibCompactAdaptors::KinematicsState>().to();
             return pimpl_->client.call("simGetGroundTruthKinematics", vehicle_name).as<RpcLibAdaptorsBase::KinematicsState>().to();
         }
         msr::airlib::Environment::State RpcLibClientBase::simGetGroundTruthEnvironment(const std::string& vehicle_name) const
@@ -496,6 +557,10 @@ __pragma(warning(disable : 4239))
         {
             return pimpl_->client.call("simBuildSDF", RpcLibAdaptorsBase::Vector3r(position), x, y, z, res).as<bool>();
         }
+        bool RpcLibClientBase::simBuildSparseSDF(const msr::airlib::Vector3r& position, const double& x, const double& y, const double& z, const float& res, const double& truncation_distance)
+        {
+            return pimpl_->client.call("simBuildSparseSDF", RpcLibAdaptorsBase::Vector3r(position), x, y, z, res, truncation_distance).as<bool>();
+        }
         msr::airlib::Vector3r RpcLibClientBase::simProjectToFreeSpace(const msr::airlib::Vector3r& position, const double& mindist)
         {
             return pimpl_->client.call("simProjectToFreeSpace", RpcLibAdaptorsBase::Vector3r(position), mindist).as<RpcLibAdaptorsBase::Vector3r>().to();
@@ -510,6 +575,10 @@ __pragma(warning(disable : 4239))
         }
         std::vector<double> RpcLibClientBase::simGetSignedDistances(const std::vector<Vector3r>& positions)
         {
+            if (pimpl_->compact) {
+                const vector<char> distances = pimpl_->client.call("simGetSignedDistancesCompact", RpcLibCompactAdaptors::packPoints(positions)).as<vector<char>>();
+                return RpcLibCompactAdaptors::unpackValues<double>(distances);
+            }
             vector<RpcLibAdaptorsBase::Vector3r> conv_positions;
             RpcLibAdaptorsBase::from(positions, conv_positions);
             return pimpl_->client.call("simGetSignedDistances", vector<RpcLibAdaptorsBase::Vector3r>(conv_positions)).as<std::vector<double>>();
@@ -518,6 +587,18 @@ __pragma(warning(disable : 4239))
         {
             return pimpl_->client.call("simGetSDFGradient", RpcLibAdaptorsBase::Vector3r(position)).as<RpcLibAdaptorsBase::Vector3r>().to();
         }
+        std::vector<Vector3r> RpcLibClientBase::simGetSDFGradients(const std::vector<Vector3r>& positions)
+        {
+            if (pimpl_->compact) {
+                const vector<char> gradients = pimpl_->client.call("simGetSDFGradientsCompact", RpcLibCompactAdaptors::packPoints(positions)).as<vector<char>>();
+                return RpcLibCompactAdaptors::unpackPoints(gradients);
+            }
+            vector<RpcLibAdaptorsBase::Vector3r> conv_positions;
+            RpcLibAdaptorsBase::from(positions, conv_positions);
+            vector<Vector3r> gradients;
+            RpcLibAdaptorsBase::to(pimpl_->client.call("simGetSDFGradients", conv_positions).as<vector<RpcLibAdaptorsBase::Vector3r>>(), gradients);
+            return gradients;
+        }
         bool RpcLibClientBase::simCheckInVolume(const Vector3r& position, std::string& volume_object_name)
         {
             return pimpl_->client.call("simCheckInVolume", RpcLibAdaptorsBase::Vector3r(position), volume_object_name).as<bool>();
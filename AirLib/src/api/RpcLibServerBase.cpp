@@ -29,6 +29,9 @@ STRICT_MODE_OFF
 #include "common/common_utils/WindowsApisCommonPost.hpp"
 
 #include "api/RpcLibAdaptorsBase.hpp"
+#include "api/RpcLibBatch.hpp"
+#include "api/RpcLibCompactAdaptors.hpp"
+#include "api/RpcLibDispatchPools.hpp"
 #include <functional>
 #include <thread>
 
@@ -42,12 +45,12 @@ namespace airlib
     struct RpcLibServerBase::impl
     {
         impl(string server_address, uint16_t port)
-            : server(server_address, port)
+            : server(server_address, port), binder(server, pools)
         {
         }
 
         impl(uint16_t port)
-            : server(port)
+            : server(port), binder(server, pools)
         {
         }
 
@@ -66,20 +69,26 @@ namespace airlib
 
         void run(bool block, std::size_t thread_count)
         {
+            pools.start(thread_count);
             if (block) {
                 server.run();
             }
             else {
                 is_async_ = true;
-                server.async_run(thread_count); //4 threads
+                server.async_run(thread_count);
             }
         }
 
+        //declared before server so that calls still waiting on a pool finish before it goes away
+        RpcLibDispatchPools pools;
         rpc::server server;
+        RpcLibMethodBinder<rpc::server> binder;
+        RpcLibBatchDispatcher batch;
         bool is_async_ = false;
     };
 
     typedef msr::airlib_rpclib::RpcLibAdaptorsBase RpcLibAdaptorsBase;
+    typedef msr::airlib_rpclib::RpcLibCompactAdaptors RpcLibCompactAdaptors;
 
     RpcLibServerBase::RpcLibServerBase(ApiProvider* api_provider, const std::string& server_address, uint16_t port)
         : api_provider_(api_provider)
@@ -90,83 +99,93 @@ namespace airlib
         else
             pimpl_.reset(new impl(server_address, port));
 
-        pimpl_->server.bind("ping", [&]() -> bool { return true; });
+        pimpl_->binder.bind("ping", [&]() -> bool { return true; });
 
-        pimpl_->server.bind("getServerVersion", []() -> int {
-            return 1;
+        pimpl_->binder.bind("getServerVersion", []() -> int {
+            return RpcLibCompactAdaptors::kServerVersion;
         });
 
-        pimpl_->server.bind("getMinRequiredClientVersion", []() -> int {
+        pimpl_->binder.bind("getMinRequiredClientVersion", []() -> int {
             return 1;
         });
 
-        pimpl_->server.bind("simPause", [&](bool is_paused) -> void {
+        pimpl_->binder.bind("getRpcMethodMetrics", [&](bool reset) -> std::vector<RpcLibAdaptorsBase::RpcMethodMetrics> {
+            std::vector<RpcLibAdaptorsBase::RpcMethodMetrics> metrics;
+            RpcLibAdaptorsBase::from(pimpl_->pools.getMetrics(reset), metrics);
+            return metrics;
+        });
+
+        pimpl_->binder.bind("batchCall", [&](const std::vector<RpcLibAdaptorsBase::BatchCall>& calls) -> std::vector<RpcLibAdaptorsBase::BatchResult> {
+            return pimpl_->batch.dispatch(calls, pimpl_->pools);
+        });
+
+        pimpl_->binder.bind("simPause", [&](bool is_paused) -> void {
             getWorldSimApi()->pause(is_paused);
         });
 
-        pimpl_->server.bind("simIsPaused", [&]() -> bool {
+        pimpl_->batch.bind(pimpl_->binder, "simIsPaused", [&]() -> bool {
             return getWorldSimApi()->isPaused();
         });
 
-        pimpl_->server.bind("simContinueForTime", [&](double seconds) -> void {
+        pimpl_->binder.bind("simContinueForTime", [&](double seconds) -> void {
             getWorldSimApi()->continueForTime(seconds);
         });
 
-        pimpl_->server.bind("simContinueForFrames", [&](uint32_t frames) -> void {
+        pimpl_->binder.bind("simContinueForFrames", [&](uint32_t frames) -> void {
             getWorldSimApi()->continueForFrames(frames);
         });
 
-        pimpl_->server.bind("simSetTimeOfDay", [&](bool is_enabled, const string& start_datetime, bool is_start_datetime_dst, float celestial_clock_speed, float update_interval_secs, bool move_sun) -> void {
+        pimpl_->binder.bind("simSetTimeOfDay", [&](bool is_enabled, const string& start_datetime, bool is_start_datetime_dst, float celestial_clock_speed, float update_interval_secs, bool move_sun) -> void {
             getWorldSimApi()->setTimeOfDay(is_enabled, start_datetime, is_start_datetime_dst, celestial_clock_speed, update_interval_secs, move_sun);
         });
 
-        pimpl_->server.bind("simEnableWeather", [&](bool enable) -> void {
+        pimpl_->binder.bind("simEnableWeather", [&](bool enable) -> void {
             getWorldSimApi()->enableWeather(enable);
         });
 
-        pimpl_->server.bind("simSetWeatherParameter", [&](WorldSimApiBase::WeatherParameter param, float val) -> void {
+        pimpl_->binder.bind("simSetWeatherParameter", [&](WorldSimApiBase::WeatherParameter param, float val) -> void {
             getWorldSimApi()->setWeatherParameter(param, val);
         });
 
-        pimpl_->server.bind("enableApiControl", [&](bool is_enabled, const std::string& vehicle_name) -> void {
+        pimpl_->binder.bind("enableApiControl", [&](bool is_enabled, const std::string& vehicle_name) -> void {
             getVehicleApi(vehicle_name)->enableApiControl(is_enabled);
         });
 
-        pimpl_->server.bind("isApiControlEnabled", [&](const std::string& vehicle_name) -> bool {
+        pimpl_->batch.bind(pimpl_->binder, "isApiControlEnabled", [&](const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->isApiControlEnabled();
         });
 
-        pimpl_->server.bind("armDisarm", [&](bool arm, const std::string& vehicle_name) -> bool {
+        pimpl_->binder.bind("armDisarm", [&](bool arm, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->armDisarm(arm);
         });
 
-        pimpl_->server.bind("simRunConsoleCommand", [&](const std::string& command) -> bool {
+        pimpl_->binder.bind("simRunConsoleCommand", [&](const std::string& command) -> bool {
             return getWorldSimApi()->runConsoleCommand(command);
         });
 
-        pimpl_->server.bind("simGetImages", [&](const std::vector<RpcLibAdaptorsBase::ImageRequest>& request_adapter, const std::string& vehicle_name) -> vector<RpcLibAdaptorsBase::ImageResponse> {
+        pimpl_->binder.bind("simGetImages", [&](const std::vector<RpcLibAdaptorsBase::ImageRequest>& request_adapter, const std::string& vehicle_name) -> vector<RpcLibAdaptorsBase::ImageResponse> {
             const auto& response = getVehicleSimApi(vehicle_name)->getImages(RpcLibAdaptorsBase::ImageRequest::to(request_adapter));
             return RpcLibAdaptorsBase::ImageResponse::from(response);
         });
 
-        pimpl_->server.bind("simGetImage", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const std::string& vehicle_name) -> vector<uint8_t> {
+        pimpl_->binder.bind("simGetImage", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const std::string& vehicle_name) -> vector<uint8_t> {
             return getVehicleSimApi(vehicle_name)->getImage(camera_name, type);
         });
 
-        pimpl_->server.bind("simTestLineOfSightToPoint", [&](double lat, double lon, float alt, const std::string& vehicle_name) -> bool {
+        pimpl_->binder.bind("simTestLineOfSightToPoint", [&](double lat, double lon, float alt, const std::string& vehicle_name) -> bool {
             GeoPoint point(lat, lon, alt);
 
             return getVehicleSimApi(vehicle_name)->testLineOfSightToPoint(point);
         });
 
-        pimpl_->server.bind("simTestLineOfSightBetweenPoints", [&](double lat1, double lon1, float alt1, double lat2, double lon2, float alt2) -> bool {
+        pimpl_->binder.bind("simTestLineOfSightBetweenPoints", [&](double lat1, double lon1, float alt1, double lat2, double lon2, float alt2) -> bool {
             GeoPoint point1(lat1, lon1, alt1);
             GeoPoint point2(lat2, lon2, alt2);
 
             return getVehicleSimApi("")->testLineOfSightBetweenPoints(point1, point2);
         });
 
-        pimpl_->server.bind("simGetWorldExtents", [&]() -> vector<RpcLibAdaptorsBase::GeoPoint> {
+        pimpl_->binder.bind("simGetWorldExtents", [&]() -> vector<RpcLibAdaptorsBase::GeoPoint> {
             msr::airlib::GeoPoint min;
             msr::airlib::GeoPoint max;
             getVehicleSimApi("")->getWorldExtents(min, max);
@@ -177,50 +196,54 @@ namespace airlib
             return result;
         });
 
-        pimpl_->server.bind("simGetMeshPositionVertexBuffers", [&]() -> vector<RpcLibAdaptorsBase::MeshPositionVertexBuffersResponse> {
+        pimpl_->binder.bind("simGetMeshPositionVertexBuffers", [&]() -> vector<RpcLibAdaptorsBase::MeshPositionVertexBuffersResponse> {
             const auto& response = getWorldSimApi()->getMeshPositionVertexBuffers();
             return RpcLibAdaptorsBase::MeshPositionVertexBuffersResponse::from(response);
         });
 
-        pimpl_->server.bind("simAddVehicle", [&](const std::string& vehicle_name, const std::string& vehicle_type, const RpcLibAdaptorsBase::Pose& pose, const std::string& pawn_path) -> bool {
+        pimpl_->binder.bind("simAddVehicle", [&](const std::string& vehicle_name, const std::string& vehicle_type, const RpcLibAdaptorsBase::Pose& pose, const std::string& pawn_path) -> bool {
             return getWorldSimApi()->addVehicle(vehicle_name, vehicle_type, pose.to(), pawn_path);
         });
 
-        pimpl_->server.bind("simSetVehiclePose", [&](const RpcLibAdaptorsBase::Pose& pose, bool ignore_collision, const std::string& vehicle_name) -> void {
+        pimpl_->binder.bind("simSetVehiclePose", [&](const RpcLibAdaptorsBase::Pose& pose, bool ignore_collision, const std::string& vehicle_name) -> void {
             getVehicleSimApi(vehicle_name)->setPose(pose.to(), ignore_collision);
         });
 
-        pimpl_->server.bind("simGetVehiclePose", [&](const std::string& vehicle_name) -> RpcLibAdaptorsBase::Pose {
+        pimpl_->batch.bind(pimpl_->binder, "simGetVehiclePose", [&](const std::string& vehicle_name) -> RpcLibAdaptorsBase::Pose {
             const auto& pose = getVehicleSimApi(vehicle_name)->getPose();
             return RpcLibAdaptorsBase::Pose(pose);
         });
 
-        pimpl_->server.bind("simSetTraceLine", [&](const std::vector<float>& color_rgba, float thickness, const std::string& vehicle_name) -> void {
+        pimpl_->batch.bind(pimpl_->binder, "simGetVehiclePoseCompact", [&](const std::string& vehicle_name) -> RpcLibCompactAdaptors::Pose {
+            return RpcLibCompactAdaptors::Pose(getVehicleSimApi(vehicle_name)->getPose());
+        });
+
+        pimpl_->binder.bind("simSetTraceLine", [&](const std::vector<float>& color_rgba, float thickness, const std::string& vehicle_name) -> void {
             getVehicleSimApi(vehicle_name)->setTraceLine(color_rgba, thickness);
         });
 
-        pimpl_->server.bind("simSetSegmentationObjectID", [&](const std::string& mesh_name, int object_id, bool is_name_regex) -> bool {
+        pimpl_->binder.bind("simSetSegmentationObjectID", [&](const std::string& mesh_name, int object_id, bool is_name_regex) -> bool {
             return getWorldSimApi()->setSegmentationObjectID(mesh_name, object_id, is_name_regex);
         });
-        pimpl_->server.bind("simGetSegmentationObjectID", [&](const std::string& mesh_name) -> int {
+        pimpl_->binder.bind("simGetSegmentationObjectID", [&](const std::string& mesh_name) -> int {
             return getWorldSimApi()->getSegmentationObjectID(mesh_name);
         });
 
-        pimpl_->server.bind("simAddDetectionFilterMeshName", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const std::string& mesh_name, const std::string& vehicle_name) -> void {
+        pimpl_->binder.bind("simAddDetectionFilterMeshName", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const std::string& mesh_name, const std::string& vehicle_name) -> void {
             getVehicleSimApi(vehicle_name)->addDetectionFilterMeshName(camera_name, type, mesh_name);
         });
-        pimpl_->server.bind("simSetDetectionFilterRadius", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const float radius_cm, const std::string& vehicle_name) -> void {
+        pimpl_->binder.bind("simSetDetectionFilterRadius", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const float radius_cm, const std::string& vehicle_name) -> void {
             getVehicleSimApi(vehicle_name)->setDetectionFilterRadius(camera_name, type, radius_cm);
         });
-        pimpl_->server.bind("simClearDetectionMeshNames", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const std::string& vehicle_name) -> void {
+        pimpl_->binder.bind("simClearDetectionMeshNames", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const std::string& vehicle_name) -> void {
             getVehicleSimApi(vehicle_name)->clearDetectionMeshNames(camera_name, type);
         });
-        pimpl_->server.bind("simGetDetections", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const std::string& vehicle_name) -> vector<RpcLibAdaptorsBase::DetectionInfo> {
+        pimpl_->binder.bind("simGetDetections", [&](const std::string& camera_name, ImageCaptureBase::ImageType type, const std::string& vehicle_name) -> vector<RpcLibAdaptorsBase::DetectionInfo> {
             const auto& response = getVehicleSimApi(vehicle_name)->getDetections(camera_name, type);
             return RpcLibAdaptorsBase::DetectionInfo::from(response);
         });
 
-        pimpl_->server.bind("reset", [&]() -> void {
+        pimpl_->binder.bind("reset", [&]() -> void {
             //Exit if already resetting.
             static bool resetInProgress;
             if (resetInProgress)
@@ -237,128 +260,170 @@ namespace airlib
             resetInProgress = false;
         });
 
-        pimpl_->server.bind("simPrintLogMessage", [&](const std::string& message, const std::string& message_param, unsigned char severity) -> void {
+        pimpl_->binder.bind("simPrintLogMessage", [&](const std::string& message, const std::string& message_param, unsigned char severity) -> void {
             getWorldSimApi()->printLogMessage(message, message_param, severity);
         });
 
-        pimpl_->server.bind("getHomeGeoPoint", [&](const std::string& vehicle_name) -> RpcLibAdaptorsBase::GeoPoint {
+        pimpl_->batch.bind(pimpl_->binder, "getHomeGeoPoint", [&](const std::string& vehicle_name) -> RpcLibAdaptorsBase::GeoPoint {
             const auto& geo_point = getVehicleApi(vehicle_name)->getHomeGeoPoint();
             return RpcLibAdaptorsBase::GeoPoint(geo_point);
         });
 
-        pimpl_->server.bind("getLidarData", [&](const std::string& lidar_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::LidarData {
+        pimpl_->batch.bind(pimpl_->binder, "getLidarData", [&](const std::string& lidar_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::LidarData {
             const auto& lidar_data = getVehicleApi(vehicle_name)->getLidarData(lidar_name);
             return RpcLibAdaptorsBase::LidarData(lidar_data);
         });
 
-        pimpl_->server.bind("getImuData", [&](const std::string& imu_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::ImuData {
+        //not available in batches, the reply refers to the sensor's buffer until it is sent
+        pimpl_->binder.bind("getLidarPointCloud", [&](const std::string& lidar_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::LidarPointCloud {
+            return RpcLibAdaptorsBase::LidarPointCloud(getVehicleApi(vehicle_name)->getLidarPointFrame(lidar_name));
+        });
+
+        pimpl_->batch.bind(pimpl_->binder, "getLidarDataCompact", [&](const std::string& lidar_name, const std::string& vehicle_name) -> RpcLibCompactAdaptors::LidarData {
+            return RpcLibCompactAdaptors::LidarData(getVehicleApi(vehicle_name)->getLidarData(lidar_name));
+        });
+
+        pimpl_->batch.bind(pimpl_->binder, "getImuData", [&](const std::string& imu_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::ImuData {
             const auto& imu_data = getVehicleApi(vehicle_name)->getImuData(imu_name);
             return RpcLibAdaptorsBase::ImuData(imu_data);
         });
 
-        pimpl_->server.bind("getBarometerData", [&](const std::string& barometer_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::BarometerData {
+        pimpl_->batch.bind(pimpl_->binder, "getImuDataCompact", [&](const std::string& imu_name, const std::string& vehicle_name) -> RpcLibCompactAdaptors::ImuData {
+            return RpcLibCompactAdaptors::ImuData(getVehicleApi(vehicle_name)->getImuData(imu_name));
+        });
+
+        pimpl_->batch.bind(pimpl_->binder, "getBarometerData", [&](const std::string& barometer_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::BarometerData {
             const auto& barometer_data = getVehicleApi(vehicle_name)->getBarometerData(barometer_name);
             return RpcLibAdaptorsBase::BarometerData(barometer_data);
         });
 
-        pimpl_->server.bind("getMagnetometerData", [&](const std::string& magnetometer_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::MagnetometerData {
+        pimpl_->batch.bind(pimpl_->binder, "getMagnetometerData", [&](const std::string& magnetometer_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::MagnetometerData {
             const auto& magnetometer_data = getVehicleApi(vehicle_name)->getMagnetometerData(magnetometer_name);
             return RpcLibAdaptorsBase::MagnetometerData(magnetometer_data);
         });
 
-        pimpl_->server.bind("getGpsData", [&](const std::string& gps_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::GpsData {
+        pimpl_->batch.bind(pimpl_->binder, "getGpsData", [&](const std::string& gps_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::GpsData {
             const auto& gps_data = getVehicleApi(vehicle_name)->getGpsData(gps_name);
             return RpcLibAdaptorsBase::GpsData(gps_data);
         });
 
-        pimpl_->server.bind("getDistanceSensorData", [&](const std::string& distance_sensor_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::DistanceSensorData {
+        pimpl_->batch.bind(pimpl_->binder, "getDistanceSensorData", [&](const std::string& distance_sensor_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::DistanceSensorData {
             const auto& distance_sensor_data = getVehicleApi(vehicle_name)->getDistanceSensorData(distance_sensor_name);
             return RpcLibAdaptorsBase::DistanceSensorData(distance_sensor_data);
         });
 
-        pimpl_->server.bind("simGetCameraInfo", [&](const std::string& camera_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::CameraInfo {
+        pimpl_->binder.bind("subscribeTelemetry", [&](const std::vector<std::string>& vehicle_names, uint32_t channels, float rate_hz) -> int {
+            std::vector<TelemetryPublisher::Source> sources;
+            for (const auto& vehicle_name : vehicle_names) {
+                TelemetryPublisher::Source source;
+                source.api = api_provider_->getVehicleApi(vehicle_name);
+                source.sim_api = getVehicleSimApi(vehicle_name);
+                sources.push_back(source);
+            }
+            return api_provider_->getTelemetryPublisher()->subscribe(sources, channels, rate_hz);
+        });
+
+        pimpl_->binder.bind("readTelemetry", [&](int subscription_id, float max_wait_sec) -> vector<uint8_t> {
+            vector<uint8_t> batch;
+            api_provider_->getTelemetryPublisher()->read(subscription_id, max_wait_sec, batch);
+            return batch;
+        });
+
+        pimpl_->binder.bind("unsubscribeTelemetry", [&](int subscription_id) -> void {
+            api_provider_->getTelemetryPublisher()->unsubscribe(subscription_id);
+        });
+
+        pimpl_->batch.bind(pimpl_->binder, "simGetCameraInfo", [&](const std::string& camera_name, const std::string& vehicle_name) -> RpcLibAdaptorsBase::CameraInfo {
             const auto& camera_info = getVehicleSimApi(vehicle_name)->getCameraInfo(camera_name);
             return RpcLibAdaptorsBase::CameraInfo(camera_info);
         });
 
-        pimpl_->server.bind("simSetDistortionParam", [&](const std::string& camera_name, const std::string& param_name, float value, const std::string& vehicle_name) -> void {
+        pimpl_->binder.bind("simSetDistortionParam", [&](const std::string& camera_name, const std::string& param_name, float value, const std::string& vehicle_name) -> void {
             getVehicleSimApi(vehicle_name)->setDistortionParam(camera_name, param_name, value);
         });
 
-        pimpl_->server.bind("simGetDistortionParams", [&](const std::string& camera_name, const std::string& vehicle_name) -> std::vector<float> {
+        pimpl_->binder.bind("simGetDistortionParams", [&](const std::string& camera_name, const std::string& vehicle_name) -> std::vector<float> {
             return getVehicleSimApi(vehicle_name)->getDistortionParams(camera_name);
         });
 
-        pimpl_->server.bind("simSetCameraPose", [&](const std::string& camera_name, const RpcLibAdaptorsBase::Pose& pose, const std::string& vehicle_name) -> void {
+        pimpl_->binder.bind("simSetCameraPose", [&](const std::string& camera_name, const RpcLibAdaptorsBase::Pose& pose, const std::string& vehicle_name) -> void {
             getVehicleSimApi(vehicle_name)->setCameraPose(camera_name, pose.to());
         });
 
-        pimpl_->server.bind("simSetCameraFov", [&](const std::string& camera_name, float fov_degrees, const std::string& vehicle_name) -> void {
+        pimpl_->binder.bind("simSetCameraFov", [&](const std::string& camera_name, float fov_degrees, const std::string& vehicle_name) -> void {
             getVehicleSimApi(vehicle_name)->setCameraFoV(camera_name, fov_degrees);
         });
 
-        pimpl_->server.bind("simGetCollisionInfo", [&](const std::string& vehicle_name) -> RpcLibAdaptorsBase::CollisionInfo {
+        pimpl_->batch.bind(pimpl_->binder, "simGetCollisionInfo", [&](const std::string& vehicle_name) -> RpcLibAdaptorsBase::CollisionInfo {
             const auto& collision_info = getVehicleSimApi(vehicle_name)->getCollisionInfo();
             return RpcLibAdaptorsBase::CollisionInfo(collision_info);
         });
 
-        pimpl_->server.bind("simListSceneObjects", [&](const std::string& name_regex) -> std::vector<string> {
+        pimpl_->binder.bind("simListSceneObjects", [&](const std::string& name_regex) -> std::vector<string> {
             return getWorldSimApi()->listSceneObjects(name_regex);
         });
 
-        pimpl_->server.bind("simLoadLevel", [&](const std::string& level_name) -> bool {
+        pimpl_->binder.bind("simLoadLevel", [&](const std::string& level_name) -> bool {
             return getWorldSimApi()->loadLevel(level_name);
         });
 
-        pimpl_->server.bind("simSpawnObject", [&](string& object_name, const string& load_component, const RpcLibAdaptorsBase::Pose& pose, const RpcLibAdaptorsBase::Vector3r& scale, bool physics_enabled) -> string {
+        pimpl_->binder.bind("simSpawnObject", [&](string& object_name, const string& load_component, const RpcLibAdaptorsBase::Pose& pose, const RpcLibAdaptorsBase::Vector3r& scale, bool physics_enabled) -> string {
             return getWorldSimApi()->spawnObject(object_name, load_component, pose.to(), scale.to(), physics_enabled);
         });
 
-        pimpl_->server.bind("simDestroyObject", [&](const string& object_name) -> bool {
+        pimpl_->binder.bind("simDestroyObject", [&](const string& object_name) -> bool {
             return getWorldSimApi()->destroyObject(object_name);
         });
 
-        pimpl_->server.bind("simGetObjectPose", [&](const std::string& object_name, bool add_noise) -> RpcLibAdaptorsBase::Pose {
+        pimpl_->batch.bind(pimpl_->binder, "simGetObjectPose", [&](const std::string& object_name, bool add_noise) -> RpcLibAdaptorsBase::Pose {
             const auto& pose = getWorldSimApi()->getObjectPose(object_name, add_noise);
             return RpcLibAdaptorsBase::Pose(pose);
         });
 
-        pimpl_->server.bind("simGetObjectScale", [&](const std::string& object_name) -> RpcLibAdaptorsBase::Vector3r {
+        pimpl_->batch.bind(pimpl_->binder, "simGetObjectPoseCompact", [&](const std::string& object_name, bool add_noise) -> RpcLibCompactAdaptors::Pose {
+            return RpcLibCompactAdaptors::Pose(getWorldSimApi()->getObjectPose(object_name, add_noise));
+        });
+
+        pimpl_->batch.bind(pimpl_->binder, "simGetObjectScale", [&](const std::string& object_name) -> RpcLibAdaptorsBase::Vector3r {
             const auto& scale = getWorldSimApi()->getObjectScale(object_name);
             return RpcLibAdaptorsBase::Vector3r(scale);
         });
 
-        pimpl_->server.bind("simSetObjectPose", [&](const std::string& object_name, const RpcLibAdaptorsBase::Pose& pose, bool teleport) -> bool {
+        pimpl_->binder.bind("simSetObjectPose", [&](const std::string& object_name, const RpcLibAdaptorsBase::Pose& pose, bool teleport) -> bool {
             return getWorldSimApi()->setObjectPose(object_name, pose.to(), teleport);
         });
 
-        pimpl_->server.bind("simSetObjectScale", [&](const std::string& object_name, const RpcLibAdaptorsBase::Vector3r& scale) -> bool {
+        pimpl_->binder.bind("simSetObjectScale", [&](const std::string& object_name, const RpcLibAdaptorsBase::Vector3r& scale) -> bool {
             return getWorldSimApi()->setObjectScale(object_name, scale.to());
         });
 
-        pimpl_->server.bind("simFlushPersistentMarkers", [&]() -> void {
+        pimpl_->binder.bind("simFlushPersistentMarkers", [&]() -> void {
             getWorldSimApi()->simFlushPersistentMarkers();
         });
 
-        pimpl_->server.bind("simPlotPoints", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& points, const vector<float>& color_rgba, float size, float duration, bool is_persistent) -> void {
+        pimpl_->binder.bind("simPlotPoints", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& points, const vector<float>& color_rgba, float size, float duration, bool is_persistent) -> void {
             vector<Vector3r> conv_points;
             RpcLibAdaptorsBase::to(points, conv_points);
             getWorldSimApi()->simPlotPoints(conv_points, color_rgba, size, duration, is_persistent);
         });
 
-        pimpl_->server.bind("simPlotLineStrip", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& points, const vector<float>& color_rgba, float thickness, float duration, bool is_persistent) -> void {
+        pimpl_->binder.bind("simPlotPointsCompact", [&](const std::vector<char>& points, const vector<float>& color_rgba, float size, float duration, bool is_persistent) -> void {
+            getWorldSimApi()->simPlotPoints(RpcLibCompactAdaptors::unpackPoints(points), color_rgba, size, duration, is_persistent);
+        });
+
+        pimpl_->binder.bind("simPlotLineStrip", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& points, const vector<float>& color_rgba, float thickness, float duration, bool is_persistent) -> void {
             vector<Vector3r> conv_points;
             RpcLibAdaptorsBase::to(points, conv_points);
             getWorldSimApi()->simPlotLineStrip(conv_points, color_rgba, thickness, duration, is_persistent);
         });
 
-        pimpl_->server.bind("simPlotLineList", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& points, const vector<float>& color_rgba, float thickness, float duration, bool is_persistent) -> void {
+        pimpl_->binder.bind("simPlotLineList", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& points, const vector<float>& color_rgba, float thickness, float duration, bool is_persistent) -> void {
             vector<Vector3r> conv_points;
             RpcLibAdaptorsBase::to(points, conv_points);
             getWorldSimApi()->simPlotLineList(conv_points, color_rgba, thickness, duration, is_persistent);
         });
 
-        pimpl_->server.bind("simPlotArrows", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& points_start, const std::vector<RpcLibAdaptorsBase::Vector3r>& points_end, const vector<float>& color_rgba, float thickness, float arrow_size, float duration, bool is_persistent) -> void {
+        pimpl_->binder.bind("simPlotArrows", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& points_start, const std::vector<RpcLibAdaptorsBase::Vector3r>& points_end, const vector<float>& color_rgba, float thickness, float arrow_size, float duration, bool is_persistent) -> void {
             vector<Vector3r> conv_points_start;
             RpcLibAdaptorsBase::to(points_start, conv_points_start);
             vector<Vector3r> conv_points_end;
@@ -366,142 +431,166 @@ namespace airlib
             getWorldSimApi()->simPlotArrows(conv_points_start, conv_points_end, color_rgba, thickness, arrow_size, duration, is_persistent);
         });
 
-        pimpl_->server.bind("simPlotStrings", [&](const std::vector<std::string> strings, const std::vector<RpcLibAdaptorsBase::Vector3r>& positions, float scale, const vector<float>& color_rgba, float duration) -> void {
+        pimpl_->binder.bind("simPlotStrings", [&](const std::vector<std::string> strings, const std::vector<RpcLibAdaptorsBase::Vector3r>& positions, float scale, const vector<float>& color_rgba, float duration) -> void {
             vector<Vector3r> conv_positions;
             RpcLibAdaptorsBase::to(positions, conv_positions);
             getWorldSimApi()->simPlotStrings(strings, conv_positions, scale, color_rgba, duration);
         });
 
-        pimpl_->server.bind("simPlotTransforms", [&](const std::vector<RpcLibAdaptorsBase::Pose>& poses, float scale, float thickness, float duration, bool is_persistent) -> void {
+        pimpl_->binder.bind("simPlotTransforms", [&](const std::vector<RpcLibAdaptorsBase::Pose>& poses, float scale, float thickness, float duration, bool is_persistent) -> void {
             vector<Pose> conv_poses;
             RpcLibAdaptorsBase::to(poses, conv_poses);
             getWorldSimApi()->simPlotTransforms(conv_poses, scale, thickness, duration, is_persistent);
         });
 
-        pimpl_->server.bind("simPlotTransformsWithNames", [&](const std::vector<RpcLibAdaptorsBase::Pose>& poses, const std::vector<std::string> names, float tf_scale, float tf_thickness, float text_scale, const vector<float>& text_color_rgba, float duration) -> void {
+        pimpl_->binder.bind("simPlotTransformsWithNames", [&](const std::vector<RpcLibAdaptorsBase::Pose>& poses, const std::vector<std::string> names, float tf_scale, float tf_thickness, float text_scale, const vector<float>& text_color_rgba, float duration) -> void {
             vector<Pose> conv_poses;
             RpcLibAdaptorsBase::to(poses, conv_poses);
             getWorldSimApi()->simPlotTransformsWithNames(conv_poses, names, tf_scale, tf_thickness, text_scale, text_color_rgba, duration);
         });
 
-        pimpl_->server.bind("simGetGroundTruthKinematics", [&](const std::string& vehicle_name) -> RpcLibAdaptorsBase::KinematicsState {
+        pimpl_->batch.bind(pimpl_->binder, "simGetGroundTruthKinematics", [&](const std::string& vehicle_name) -> RpcLibAdaptorsBase::KinematicsState {
             const Kinematics::State& result = *getVehicleSimApi(vehicle_name)->getGroundTruthKinematics();
             return RpcLibAdaptorsBase::KinematicsState(result);
         });
 
-        pimpl_->server.bind("simGetGroundTruthEnvironment", [&](const std::string& vehicle_name) -> RpcLibAdaptorsBase::EnvironmentState {
+        pimpl_->batch.bind(pimpl_->binder, "simGetGroundTruthKinematicsCompact", [&](const std::string& vehicle_name) -> RpcLibCompactAdaptors::KinematicsState {
+            return RpcLibCompactAdaptors::KinematicsState(*getVehicleSimApi(vehicle_name)->getGroundTruthKinematics());
+        });
+
+        pimpl_->batch.bind(pimpl_->binder, "simGetGroundTruthEnvironment", [&](const std::string& vehicle_name) -> RpcLibAdaptorsBase::EnvironmentState {
             const Environment::State& result = (*getVehicleSimApi(vehicle_name)->getGroundTruthEnvironment()).getState();
             return RpcLibAdaptorsBase::EnvironmentState(result);
         });
-        pimpl_->server.bind("simCreateVoxelGrid", [&](const RpcLibAdaptorsBase::Vector3r& position, const int& x, const int& y, const int& z, const float& res, const std::string& output_file) -> bool {
+        pimpl_->binder.bind("simCreateVoxelGrid", [&](const RpcLibAdaptorsBase::Vector3r& position, const int& x, const int& y, const int& z, const float& res, const std::string& output_file) -> bool {
             return getWorldSimApi()->createVoxelGrid(position.to(), x, y, z, res, output_file);
         });
 
-        pimpl_->server.bind("simBuildSDF", [&](const RpcLibAdaptorsBase::Vector3r& position, const double& x, const double& y, const double& z, const float& res) -> bool {
+        pimpl_->binder.bind("simBuildSDF", [&](const RpcLibAdaptorsBase::Vector3r& position, const double& x, const double& y, const double& z, const float& res) -> bool {
             return getWorldSimApi()->buildSDF(position.to(), x, y, z, res);
         });
 
-        pimpl_->server.bind("simProjectToFreeSpace", [&](const RpcLibAdaptorsBase::Vector3r& position, const double& mindist) -> RpcLibAdaptorsBase::Vector3r {
+        pimpl_->binder.bind("simBuildSparseSDF", [&](const RpcLibAdaptorsBase::Vector3r& position, const double& x, const double& y, const double& z, const float& res, const double& truncation_distance) -> bool {
+            return getWorldSimApi()->buildSparseSDF(position.to(), x, y, z, res, truncation_distance);
+        });
+
+        pimpl_->binder.bind("simProjectToFreeSpace", [&](const RpcLibAdaptorsBase::Vector3r& position, const double& mindist) -> RpcLibAdaptorsBase::Vector3r {
             const auto& free_pt = getWorldSimApi()->projectToCollisionFree(position.to(), mindist);
             return RpcLibAdaptorsBase::Vector3r(free_pt);
         });
 
-        pimpl_->server.bind("simCheckOccupancy", [&](const RpcLibAdaptorsBase::Vector3r& position) -> bool {
+        pimpl_->batch.bind(pimpl_->binder, "simCheckOccupancy", [&](const RpcLibAdaptorsBase::Vector3r& position) -> bool {
             return getWorldSimApi()->isOccupied(position.to());
         });
 
-        pimpl_->server.bind("simGetSignedDistance", [&](const RpcLibAdaptorsBase::Vector3r& position) -> double {
+        pimpl_->batch.bind(pimpl_->binder, "simGetSignedDistance", [&](const RpcLibAdaptorsBase::Vector3r& position) -> double {
             return getWorldSimApi()->getSignedDistance(position.to());
         });
 
-        pimpl_->server.bind("simGetSignedDistances", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& positions) -> std::vector<double> {
+        pimpl_->batch.bind(pimpl_->binder, "simGetSignedDistances", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& positions) -> std::vector<double> {
             vector<Vector3r> conv_positions;
             RpcLibAdaptorsBase::to(positions, conv_positions);
             return getWorldSimApi()->getSignedDistances(conv_positions);
         });
 
-        pimpl_->server.bind("simGetSDFGradient", [&](const RpcLibAdaptorsBase::Vector3r& position) -> RpcLibAdaptorsBase::Vector3r {
+        pimpl_->batch.bind(pimpl_->binder, "simGetSignedDistancesCompact", [&](const std::vector<char>& positions) -> std::vector<char> {
+            return RpcLibCompactAdaptors::packValues(getWorldSimApi()->getSignedDistances(RpcLibCompactAdaptors::unpackPoints(positions)));
+        });
+
+        pimpl_->batch.bind(pimpl_->binder, "simGetSDFGradient", [&](const RpcLibAdaptorsBase::Vector3r& position) -> RpcLibAdaptorsBase::Vector3r {
             return getWorldSimApi()->getSDFGradient(position.to());
         });
 
-        pimpl_->server.bind("simCheckInVolume", [&](const RpcLibAdaptorsBase::Vector3r& position, const std::string& volume_actor_name) -> bool {
+        pimpl_->batch.bind(pimpl_->binder, "simGetSDFGradients", [&](const std::vector<RpcLibAdaptorsBase::Vector3r>& positions) -> std::vector<RpcLibAdaptorsBase::Vector3r> {
+            vector<Vector3r> conv_positions;
+            RpcLibAdaptorsBase::to(positions, conv_positions);
+            vector<RpcLibAdaptorsBase::Vector3r> conv_gradients;
+            RpcLibAdaptorsBase::from(getWorldSimApi()->getSDFGradients(conv_positions), conv_gradients);
+            return conv_gradients;
+        });
+
+        pimpl_->batch.bind(pimpl_->binder, "simGetSDFGradientsCompact", [&](const std::vector<char>& positions) -> std::vector<char> {
+            return RpcLibCompactAdaptors::packPoints(getWorldSimApi()->getSDFGradients(RpcLibCompactAdaptors::unpackPoints(positions)));
+        });
+
+        pimpl_->binder.bind("simCheckInVolume", [&](const RpcLibAdaptorsBase::Vector3r& position, const std::string& volume_actor_name) -> bool {
             return getWorldSimApi()->checkInVolume(position.to(), volume_actor_name);
         });
 
-        pimpl_->server.bind("simLoadSDF", [&](const std::string& filepath) -> bool {
+        pimpl_->binder.bind("simLoadSDF", [&](const std::string& filepath) -> bool {
             return getWorldSimApi()->loadSDF(filepath);
         });
 
-        pimpl_->server.bind("simSaveSDF", [&](const std::string& filepath) -> bool {
+        pimpl_->binder.bind("simSaveSDF", [&](const std::string& filepath) -> bool {
             return getWorldSimApi()->saveSDF(filepath);
         });
 
-        pimpl_->server.bind("cancelLastTask", [&](const std::string& vehicle_name) -> void {
+        pimpl_->binder.bind("cancelLastTask", [&](const std::string& vehicle_name) -> void {
             getVehicleApi(vehicle_name)->cancelLastTask();
         });
 
-        pimpl_->server.bind("simSwapTextures", [&](const std::string tag, int tex_id, int component_id, int material_id) -> std::vector<string> {
+        pimpl_->binder.bind("simSwapTextures", [&](const std::string tag, int tex_id, int component_id, int material_id) -> std::vector<string> {
             return *getWorldSimApi()->swapTextures(tag, tex_id, component_id, material_id);
         });
 
-        pimpl_->server.bind("simSetObjectMaterial", [&](const std::string& object_name, const std::string& material_name) -> bool {
+        pimpl_->binder.bind("simSetObjectMaterial", [&](const std::string& object_name, const std::string& material_name) -> bool {
             return getWorldSimApi()->setObjectMaterial(object_name, material_name);
         });
 
-        pimpl_->server.bind("simSetObjectMaterialFromTexture", [&](const std::string& object_name, const std::string& texture_path) -> bool {
+        pimpl_->binder.bind("simSetObjectMaterialFromTexture", [&](const std::string& object_name, const std::string& texture_path) -> bool {
             return getWorldSimApi()->setObjectMaterialFromTexture(object_name, texture_path);
         });
 
-        pimpl_->server.bind("startRecording", [&]() -> void {
+        pimpl_->binder.bind("startRecording", [&]() -> void {
             getWorldSimApi()->startRecording();
         });
 
-        pimpl_->server.bind("stopRecording", [&]() -> void {
+        pimpl_->binder.bind("stopRecording", [&]() -> void {
             getWorldSimApi()->stopRecording();
         });
 
-        pimpl_->server.bind("isRecording", [&]() -> bool {
+        pimpl_->binder.bind("isRecording", [&]() -> bool {
             return getWorldSimApi()->isRecording();
         });
 
-        pimpl_->server.bind("simSetWind", [&](const RpcLibAdaptorsBase::Vector3r& wind) -> void {
+        pimpl_->binder.bind("simSetWind", [&](const RpcLibAdaptorsBase::Vector3r& wind) -> void {
             getWorldSimApi()->setWind(wind.to());
         });
 
-        pimpl_->server.bind("listVehicles", [&]() -> vector<string> {
+        pimpl_->binder.bind("listVehicles", [&]() -> vector<string> {
             return getWorldSimApi()->listVehicles();
         });
 
-        pimpl_->server.bind("getSettingsString", [&]() -> std::string {
+        pimpl_->binder.bind("getSettingsString", [&]() -> std::string {
             return getWorldSimApi()->getSettingsString();
         });
 
         //// ADRL Race API
 
-        pimpl_->server.bind("simGetObjectScaleInternal", [&](const std::string& object_name) -> RpcLibAdaptorsBase::Vector3r {
+        pimpl_->binder.bind("simGetObjectScaleInternal", [&](const std::string& object_name) -> RpcLibAdaptorsBase::Vector3r {
             const auto& scale = getWorldSimApi()->getObjectScaleInternal(object_name);
             return RpcLibAdaptorsBase::Vector3r(scale);
         });
-        pimpl_->server.bind("simLogMultirotorState", [&](bool is_enabled, const std::string& vehicle_name) -> void {
+        pimpl_->binder.bind("simLogMultirotorState", [&](bool is_enabled, const std::string& vehicle_name) -> void {
             getVehicleSimApi(vehicle_name)->setStateLogStatus(is_enabled);
         });
 
-        pimpl_->server.bind("simStartRace", [&](int tier) -> void {
+        pimpl_->binder.bind("simStartRace", [&](int tier) -> void {
             getWorldSimApi()->startRace(tier);
         });
-        pimpl_->server.bind("simStartBenchmarkRace", [&](int tier) -> void {
+        pimpl_->binder.bind("simStartBenchmarkRace", [&](int tier) -> void {
             getWorldSimApi()->startBenchmarkRace(tier);
         });
-        pimpl_->server.bind("simResetRace", [&]() -> void {
+        pimpl_->binder.bind("simResetRace", [&]() -> void {
             getWorldSimApi()->resetRace();
         });
-        pimpl_->server.bind("simDisableRaceLog", [&]() -> void {
+        pimpl_->binder.bind("simDisableRaceLog", [&]() -> void {
             getWorldSimApi()->disableRaceLogging();
         });
-        pimpl_->server.bind("simGetDisqualified", [&](const std::string& racer_name) -> bool {
+        pimpl_->batch.bind(pimpl_->binder, "simGetDisqualified", [&](const std::string& racer_name) -> bool {
             return getWorldSimApi()->getDisqualified(racer_name);
         });
-        pimpl_->server.bind("simGetLastGatePassed", [&](const std::string& racer_name) -> int {
+        pimpl_->batch.bind(pimpl_->binder, "simGetLastGatePassed", [&](const std::string& racer_name) -> int {
             return getWorldSimApi()->getLastGatePassed(racer_name);
         });
 
@@ -525,10 +614,32 @@ namespace airlib
         pimpl_->stop();
     }
 
+    void RpcLibServerBase::setDispatchThreadCounts(std::size_t query_threads, std::size_t heavy_threads, std::size_t command_threads)
+    {
+        pimpl_->pools.setThreadCount(RpcDispatchClass::Query, query_threads);
+        pimpl_->pools.setThreadCount(RpcDispatchClass::Heavy, heavy_threads);
+        pimpl_->pools.setThreadCount(RpcDispatchClass::Command, command_threads);
+    }
+
+    void RpcLibServerBase::setMaxPendingCalls(std::size_t max_pending_calls)
+    {
+        pimpl_->pools.setMaxPendingCalls(max_pending_calls);
+    }
+
     void* RpcLibServerBase::getServer() const
     {
         return &pimpl_->server;
     }
+
+    void* RpcLibServerBase::getMethodBinder() const
+    {
+        return &pimpl_->binder;
+    }
+
+    RpcLibBatchDispatcher* RpcLibServerBase::getBatchDispatcher() const
+    {
+        return &pimpl_->batch;
+    }
 }
 } //namespace
 #endif
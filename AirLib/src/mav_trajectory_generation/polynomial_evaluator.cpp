@@ -0,0 +1,70 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "mav_trajectory_generation/polynomial_evaluator.h"
+
+namespace mav_trajectory_generation {
+
+namespace {
+
+template <int N, int D>
+void evaluateFixed(const Segment& segment, int derivative, const double* times,
+                   size_t count, double* result) {
+  const FixedSegmentEvaluator<N, D> evaluator(segment, derivative);
+  evaluator.evaluate(times, count, result);
+}
+
+template <int N>
+bool evaluateFixedN(const Segment& segment, int derivative,
+                    const double* times, size_t count, double* result) {
+  switch (segment.D()) {
+    case 1:
+      evaluateFixed<N, 1>(segment, derivative, times, count, result);
+      return true;
+    case 3:
+      evaluateFixed<N, 3>(segment, derivative, times, count, result);
+      return true;
+    case 4:
+      evaluateFixed<N, 4>(segment, derivative, times, count, result);
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+void evaluateSegment(const Segment& segment, int derivative,
+                     const double* times, size_t count, double* result) {
+  bool evaluated = false;
+  switch (segment.N()) {
+    case 6:
+      evaluated = evaluateFixedN<6>(segment, derivative, times, count, result);
+      break;
+    case 8:
+      evaluated = evaluateFixedN<8>(segment, derivative, times, count, result);
+      break;
+    case 10:
+      evaluated =
+          evaluateFixedN<10>(segment, derivative, times, count, result);
+      break;
+    case 12:
+      evaluated =
+          evaluateFixedN<12>(segment, derivative, times, count, result);
+      break;
+    default:
+      break;
+  }
+  if (evaluated) {
+    return;
+  }
+
+  const int D = segment.D();
+  for (size_t i = 0; i < count; ++i) {
+    for (int d = 0; d < D; ++d) {
+      result[i * D + d] = segment[d].evaluate(times[i], derivative);
+    }
+  }
+}
+
+}  // namespace mav_trajectory_generation
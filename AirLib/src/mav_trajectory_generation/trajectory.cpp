@@ -19,6 +19,7 @@
  */
 
 #include "mav_trajectory_generation/trajectory.h"
+#include "mav_trajectory_generation/polynomial_evaluator.h"
 #include <limits>
 
 // fixes error due to std::iota (has been introduced in c++ standard lately
@@ -82,10 +83,23 @@ void Trajectory::evaluateRange(double t_start, double t_end, double dt,
                                int derivative_order,
                                std::vector<Eigen::VectorXd>* result,
                                std::vector<double>* sampling_times) const {
-  const size_t expected_number_of_samples = (t_end - t_start) / dt + 1;
+  Eigen::MatrixXd samples;
+  evaluateRange(t_start, t_end, dt, derivative_order, &samples,
+                sampling_times);
 
   result->clear();
-  result->reserve(expected_number_of_samples);
+  result->reserve(samples.cols());
+  for (int i = 0; i < samples.cols(); ++i) {
+    result->push_back(samples.col(i));
+  }
+}
+
+void Trajectory::evaluateRange(double t_start, double t_end, double dt,
+                               int derivative_order, Eigen::MatrixXd* result,
+                               std::vector<double>* sampling_times) const {
+  const size_t expected_number_of_samples = (t_end - t_start) / dt + 1;
+
+  result->resize(D_, expected_number_of_samples);
 
   if (sampling_times != nullptr) {
     sampling_times->clear();
@@ -110,6 +124,7 @@ void Trajectory::evaluateRange(double t_start, double t_end, double dt,
   }
   if (t_start > accumulated_time) {
     LOG(ERROR) << "Start time out of range of the trajectory!";
+    result->resize(D_, 0);
     return;
   }
 
@@ -117,9 +132,28 @@ void Trajectory::evaluateRange(double t_start, double t_end, double dt,
   accumulated_time -= segments_[i].getTime();
   double time_in_segment = t_start - accumulated_time;
 
+  // Times of the samples in segment i that are not evaluated yet.
+  std::vector<double> segment_times;
+  segment_times.reserve(expected_number_of_samples);
+  Eigen::Index n_samples = 0;
+  auto evaluate_segment_times = [&]() {
+    const Eigen::Index n_new = static_cast<Eigen::Index>(segment_times.size());
+    if (n_new == 0) {
+      return;
+    }
+    if (n_samples + n_new > result->cols()) {
+      result->conservativeResize(Eigen::NoChange, n_samples + n_new);
+    }
+    evaluateSegment(segments_[i], derivative_order, segment_times.data(),
+                    segment_times.size(), result->col(n_samples).data());
+    n_samples += n_new;
+    segment_times.clear();
+  };
+
   // Get all the samples, incrementing the segments as we go.
   while (accumulated_time < t_end) {
     if (time_in_segment > segments_[i].getTime()) {
+      evaluate_segment_times();
       time_in_segment = time_in_segment - segments_[i].getTime();
       i++;
       // Make sure we don't access segments that don't exist!
@@ -129,7 +163,7 @@ void Trajectory::evaluateRange(double t_start, double t_end, double dt,
       continue;
     }
 
-    result->push_back(segments_[i].evaluate(time_in_segment, derivative_order));
+    segment_times.push_back(time_in_segment);
 
     if (sampling_times != nullptr) {
       sampling_times->push_back(accumulated_time);
@@ -138,6 +172,10 @@ void Trajectory::evaluateRange(double t_start, double t_end, double dt,
     time_in_segment += dt;
     accumulated_time += dt;
   }
+  if (i < segments_.size()) {
+    evaluate_segment_times();
+  }
+  result->conservativeResize(Eigen::NoChange, n_samples);
 }
 
 Trajectory Trajectory::getTrajectoryWithSingleDimension(int dimension) const {
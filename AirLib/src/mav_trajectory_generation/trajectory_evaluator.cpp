@@ -0,0 +1,78 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "mav_trajectory_generation/trajectory_evaluator.h"
+
+#include <algorithm>
+
+namespace mav_trajectory_generation {
+
+void TrajectoryEvaluator::setTrajectory(const Trajectory& trajectory) {
+  trajectory_ = trajectory;
+  segment_start_times_.clear();
+  segment_start_times_.reserve(trajectory_.K());
+  double start_time = 0.0;
+  for (const Segment& segment : trajectory_.segments()) {
+    segment_start_times_.push_back(start_time);
+    start_time += segment.getTime();
+  }
+  last_segment_ = 0;
+}
+
+void TrajectoryEvaluator::clear() {
+  trajectory_.clear();
+  segment_start_times_.clear();
+  last_segment_ = 0;
+}
+
+size_t TrajectoryEvaluator::getSegmentIndex(double t) const {
+  const size_t n_segments = segment_start_times_.size();
+  if (n_segments == 0) {
+    return 0;
+  }
+
+  // Most queries are in the segment of the last one or in the next one.
+  size_t i = last_segment_;
+  if (t >= segment_start_times_[i]) {
+    if (i + 1 == n_segments || t < segment_start_times_[i + 1]) {
+      return i;
+    }
+    if (i + 2 == n_segments || t < segment_start_times_[i + 2]) {
+      return last_segment_ = i + 1;
+    }
+  }
+
+  // First segment that starts after t, the one before it contains t.
+  auto next = std::upper_bound(segment_start_times_.begin(),
+                               segment_start_times_.end(), t);
+  i = next == segment_start_times_.begin()
+          ? 0
+          : static_cast<size_t>(next - segment_start_times_.begin()) - 1;
+  return last_segment_ = i;
+}
+
+Eigen::VectorXd TrajectoryEvaluator::evaluate(double t,
+                                              int derivative_order) const {
+  if (trajectory_.empty()) {
+    return Eigen::VectorXd::Zero(trajectory_.D());
+  }
+  t = std::min(std::max(t, 0.0), trajectory_.getMaxTime());
+  const size_t i = getSegmentIndex(t);
+  const Segment& segment = trajectory_.segments()[i];
+  return segment.evaluate(
+      std::min(t - segment_start_times_[i], segment.getTime()),
+      derivative_order);
+}
+
+void TrajectoryEvaluator::sample(double t,
+                                 mav_msgs::EigenTrajectoryPoint* state) const {
+  CHECK_NOTNULL(state);
+  state->position_W = evaluate(t, derivative_order::POSITION).head<3>();
+  state->velocity_W = evaluate(t, derivative_order::VELOCITY).head<3>();
+  state->acceleration_W =
+      evaluate(t, derivative_order::ACCELERATION).head<3>();
+  state->time_from_start_ns =
+      static_cast<int64_t>(std::max(t, 0.0) * kNumNSecPerSec);
+}
+
+}  // namespace mav_trajectory_generation
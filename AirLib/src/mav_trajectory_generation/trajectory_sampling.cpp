@@ -59,8 +59,7 @@ bool sampleTrajectoryInRange(const Trajectory& trajectory, double min_time,
     return false;
   }
 
-  std::vector<Eigen::VectorXd> position, velocity, acceleration, jerk, snap,
-      yaw, yaw_rate;
+  Eigen::MatrixXd position, velocity, acceleration, jerk, snap;
 
   trajectory.evaluateRange(min_time, max_time, sampling_interval,
                            derivative_order::POSITION, &position);
@@ -73,23 +72,23 @@ bool sampleTrajectoryInRange(const Trajectory& trajectory, double min_time,
   trajectory.evaluateRange(min_time, max_time, sampling_interval,
                            derivative_order::SNAP, &snap);
 
-  size_t n_samples = position.size();
+  size_t n_samples = position.cols();
 
   states->resize(n_samples);
   for (size_t i = 0; i < n_samples; ++i) {
     mav_msgs::EigenTrajectoryPoint& state = (*states)[i];
 
-    state.position_W = position[i].head<3>();
-    state.velocity_W = velocity[i].head<3>();
-    state.acceleration_W = acceleration[i].head<3>();
-    state.jerk_W = jerk[i].head<3>();
-    state.snap_W = snap[i].head<3>();
+    state.position_W = position.col(i).head<3>();
+    state.velocity_W = velocity.col(i).head<3>();
+    state.acceleration_W = acceleration.col(i).head<3>();
+    state.jerk_W = jerk.col(i).head<3>();
+    state.snap_W = snap.col(i).head<3>();
     state.time_from_start_ns = static_cast<int64_t>(
         (min_time + sampling_interval * i) * kNumNanosecondsPerSecond);
     if (trajectory.D() > 3) {
-      state.setFromYaw(position[i](3));
-      state.setFromYawRate(velocity[i](3));
-      state.setFromYawAcc(acceleration[i](3));
+      state.setFromYaw(position(3, i));
+      state.setFromYawRate(velocity(3, i));
+      state.setFromYawAcc(acceleration(3, i));
     }
   }
   return true;
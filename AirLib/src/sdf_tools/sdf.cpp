@@ -7,6 +7,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <unordered_map>
+#include <cstring>
 #include <sdf_utils/eigen_helpers_conversions.hpp>
 #include <sdf_utils/serialization_eigen.hpp>
 #include <sdf_tools/sdf.hpp>
@@ -221,7 +222,7 @@ uint64_t SignedDistanceField::SerializeSelf(
   sdf_utils::SerializeEigen<Eigen::Isometry3d>(inverse_origin_transform_,
                                              buffer);
   // Serialize the data
-  sdf_utils::SerializeVector<float>(
+  sdf_utils::SerializeVectorLike<float, sdf_utils::MappableVector<float>>(
         data_, buffer, sdf_utils::SerializeFixedSizePOD<float>);
   // Serialize the cell sizes
   sdf_utils::SerializeFixedSizePOD<double>(cell_x_size_, buffer);
@@ -280,11 +281,12 @@ uint64_t SignedDistanceField::DeserializeSelf(
   inverse_origin_transform_ = inverse_origin_transform_deserialized.first;
   current_position += inverse_origin_transform_deserialized.second;
   // Deserialize the data
-  const std::pair<std::vector<float>, uint64_t> data_deserialized
+  std::pair<std::vector<float>, uint64_t> data_deserialized
       = sdf_utils::DeserializeVector<float>(
         buffer, current_position,
         sdf_utils::DeserializeFixedSizePOD<float>);
-  data_ = data_deserialized.first;
+  data_ = sdf_utils::MappableVector<float>(
+        std::move(data_deserialized.first));
   current_position += data_deserialized.second;
   // Deserialize the cell sizes
   const std::pair<double, uint64_t> cell_x_size_deserialized
@@ -386,24 +388,335 @@ uint64_t SignedDistanceField::DeserializeSelf(
   return bytes_read;
 }
 
+/*
+ * Versioned file layout:
+ *
+ *   "SDFM" | version | flags | reserved | payload offset | payload size
+ *   | metadata (SerializeMetadata) | zero padding to payload offset
+ *   | payload
+ *
+ * The payload offset is a multiple of the page size. Uncompressed, the
+ * payload is the raw float cells in grid order, ready to be mapped.
+ * Compressed, it is a block count, the encoded size of every block, then
+ * the blocks. Each block holds up to kCompressionBlockCells cells; its
+ * first byte says whether it is stored raw or byte-plane packed.
+ */
+namespace
+{
+const char kFileMagic[4] = {'S', 'D', 'F', 'M'};
+const char kLegacyFileMagic[4] = {'S', 'D', 'F', 'R'};
+const uint32_t kFileVersion = 1;
+const uint32_t kFileFlagCompressed = 0x01;
+const uint64_t kFilePreambleSize = 32;
+const uint64_t kFilePageSize = 4096;
+const uint64_t kCompressionBlockCells = 65536;
+const uint8_t kBlockStored = 0x00;
+const uint8_t kBlockPacked = 0x01;
+
+// PackBits run-length encoding: control bytes 0..127 copy the next n+1
+// bytes, 129..255 repeat the next byte 257-n times.
+void PackBitsEncode(const uint8_t* input, const size_t size,
+                    std::vector<uint8_t>& output)
+{
+  size_t idx = 0;
+  while (idx < size)
+  {
+    size_t run = 1;
+    while ((idx + run) < size && run < 128 && input[idx + run] == input[idx])
+    {
+      run++;
+    }
+    if (run >= 2)
+    {
+      output.push_back((uint8_t)(257 - run));
+      output.push_back(input[idx]);
+      idx += run;
+      continue;
+    }
+    // Literal span up to the next repeat of at least 2
+    size_t literal = 1;
+    while ((idx + literal) < size && literal < 128
+           && !((idx + literal + 1) < size
+                && input[idx + literal] == input[idx + literal + 1]))
+    {
+      literal++;
+    }
+    output.push_back((uint8_t)(literal - 1));
+    output.insert(output.end(), input + idx, input + idx + literal);
+    idx += literal;
+  }
+}
+
+bool PackBitsDecode(const uint8_t* input, const size_t size,
+                    uint8_t* output, const size_t output_size)
+{
+  size_t in_idx = 0;
+  size_t out_idx = 0;
+  while (in_idx < size)
+  {
+    const uint8_t control = input[in_idx++];
+    if (control < 128)
+    {
+      const size_t literal = (size_t)control + 1;
+      if ((in_idx + literal) > size || (out_idx + literal) > output_size)
+      {
+        return false;
+      }
+      memcpy(output + out_idx, input + in_idx, literal);
+      in_idx += literal;
+      out_idx += literal;
+    }
+    else if (control > 128)
+    {
+      const size_t run = 257 - (size_t)control;
+      if (in_idx >= size || (out_idx + run) > output_size)
+      {
+        return false;
+      }
+      memset(output + out_idx, input[in_idx++], run);
+      out_idx += run;
+    }
+  }
+  return out_idx == output_size;
+}
+
+// Neighbouring SDF values are close, so XOR with the previous value zeroes
+// the sign, exponent and high mantissa bits that the byte planes then group
+// into long runs.
+std::vector<uint8_t> EncodeBlock(const float* cells, const size_t count)
+{
+  std::vector<uint8_t> planes(count * sizeof(float));
+  uint32_t previous = 0;
+  for (size_t idx = 0; idx < count; idx++)
+  {
+    uint32_t bits = 0;
+    memcpy(&bits, cells + idx, sizeof(bits));
+    const uint32_t delta = bits ^ previous;
+    previous = bits;
+    for (size_t plane = 0; plane < sizeof(float); plane++)
+    {
+      planes[(plane * count) + idx] = (uint8_t)(delta >> (8 * (3 - plane)));
+    }
+  }
+  std::vector<uint8_t> encoded;
+  encoded.reserve(planes.size() / 2);
+  encoded.push_back(kBlockPacked);
+  PackBitsEncode(planes.data(), planes.size(), encoded);
+  if (encoded.size() >= (planes.size() + 1))
+  {
+    encoded.assign(1, kBlockStored);
+    const uint8_t* raw = reinterpret_cast<const uint8_t*>(cells);
+    encoded.insert(encoded.end(), raw, raw + (count * sizeof(float)));
+  }
+  return encoded;
+}
+
+bool DecodeBlock(const uint8_t* encoded, const size_t size,
+                 float* cells, const size_t count)
+{
+  if (size < 1)
+  {
+    return false;
+  }
+  if (encoded[0] == kBlockStored)
+  {
+    if ((size - 1) != (count * sizeof(float)))
+    {
+      return false;
+    }
+    memcpy(cells, encoded + 1, count * sizeof(float));
+    return true;
+  }
+  if (encoded[0] != kBlockPacked)
+  {
+    return false;
+  }
+  std::vector<uint8_t> planes(count * sizeof(float));
+  if (!PackBitsDecode(encoded + 1, size - 1, planes.data(), planes.size()))
+  {
+    return false;
+  }
+  uint32_t previous = 0;
+  for (size_t idx = 0; idx < count; idx++)
+  {
+    uint32_t delta = 0;
+    for (size_t plane = 0; plane < sizeof(float); plane++)
+    {
+      delta = (delta << 8) | planes[(plane * count) + idx];
+    }
+    previous ^= delta;
+    memcpy(cells + idx, &previous, sizeof(previous));
+  }
+  return true;
+}
+
+template<typename T>
+T ReadPOD(const uint8_t* bytes)
+{
+  T value;
+  memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+template<typename T>
+void DeserializeField(const std::vector<uint8_t>& buffer,
+                      uint64_t& current_position, T& field)
+{
+  const std::pair<T, uint64_t> deserialized
+      = sdf_utils::DeserializeFixedSizePOD<T>(buffer, current_position);
+  field = deserialized.first;
+  current_position += deserialized.second;
+}
+}
+
+uint64_t SignedDistanceField::SerializeMetadata(
+    std::vector<uint8_t>& buffer) const
+{
+  const uint64_t start_buffer_size = buffer.size();
+  sdf_utils::SerializeFixedSizePOD<uint8_t>((uint8_t)initialized_, buffer);
+  sdf_utils::SerializeEigen<Eigen::Isometry3d>(origin_transform_, buffer);
+  sdf_utils::SerializeEigen<Eigen::Isometry3d>(inverse_origin_transform_,
+                                             buffer);
+  sdf_utils::SerializeFixedSizePOD<double>(cell_x_size_, buffer);
+  sdf_utils::SerializeFixedSizePOD<double>(cell_y_size_, buffer);
+  sdf_utils::SerializeFixedSizePOD<double>(cell_z_size_, buffer);
+  sdf_utils::SerializeFixedSizePOD<double>(inv_cell_x_size_, buffer);
+  sdf_utils::SerializeFixedSizePOD<double>(inv_cell_y_size_, buffer);
+  sdf_utils::SerializeFixedSizePOD<double>(inv_cell_z_size_, buffer);
+  sdf_utils::SerializeFixedSizePOD<double>(x_size_, buffer);
+  sdf_utils::SerializeFixedSizePOD<double>(y_size_, buffer);
+  sdf_utils::SerializeFixedSizePOD<double>(z_size_, buffer);
+  sdf_utils::SerializeFixedSizePOD<int64_t>(stride1_, buffer);
+  sdf_utils::SerializeFixedSizePOD<int64_t>(stride2_, buffer);
+  sdf_utils::SerializeFixedSizePOD<int64_t>(num_x_cells_, buffer);
+  sdf_utils::SerializeFixedSizePOD<int64_t>(num_y_cells_, buffer);
+  sdf_utils::SerializeFixedSizePOD<int64_t>(num_z_cells_, buffer);
+  sdf_utils::SerializeFixedSizePOD<float>(default_value_, buffer);
+  sdf_utils::SerializeFixedSizePOD<float>(oob_value_, buffer);
+  sdf_utils::SerializeString(frame_, buffer);
+  sdf_utils::SerializeFixedSizePOD<uint8_t>((uint8_t)locked_, buffer);
+  return buffer.size() - start_buffer_size;
+}
+
+uint64_t SignedDistanceField::DeserializeMetadata(
+    const std::vector<uint8_t>& buffer, const uint64_t current)
+{
+  uint64_t current_position = current;
+  uint8_t initialized = 0;
+  DeserializeField(buffer, current_position, initialized);
+  initialized_ = (bool)initialized;
+  const std::pair<Eigen::Isometry3d, uint64_t> origin_transform_deserialized
+      = sdf_utils::DeserializeEigen<Eigen::Isometry3d>(buffer,
+                                                           current_position);
+  origin_transform_ = origin_transform_deserialized.first;
+  current_position += origin_transform_deserialized.second;
+  const std::pair<Eigen::Isometry3d, uint64_t>
+      inverse_origin_transform_deserialized
+      = sdf_utils::DeserializeEigen<Eigen::Isometry3d>(buffer,
+                                                           current_position);
+  inverse_origin_transform_ = inverse_origin_transform_deserialized.first;
+  current_position += inverse_origin_transform_deserialized.second;
+  DeserializeField(buffer, current_position, cell_x_size_);
+  DeserializeField(buffer, current_position, cell_y_size_);
+  DeserializeField(buffer, current_position, cell_z_size_);
+  DeserializeField(buffer, current_position, inv_cell_x_size_);
+  DeserializeField(buffer, current_position, inv_cell_y_size_);
+  DeserializeField(buffer, current_position, inv_cell_z_size_);
+  DeserializeField(buffer, current_position, x_size_);
+  DeserializeField(buffer, current_position, y_size_);
+  DeserializeField(buffer, current_position, z_size_);
+  DeserializeField(buffer, current_position, stride1_);
+  DeserializeField(buffer, current_position, stride2_);
+  DeserializeField(buffer, current_position, num_x_cells_);
+  DeserializeField(buffer, current_position, num_y_cells_);
+  DeserializeField(buffer, current_position, num_z_cells_);
+  DeserializeField(buffer, current_position, default_value_);
+  DeserializeField(buffer, current_position, oob_value_);
+  const std::pair<std::string, uint64_t> frame_deserialized
+      = sdf_utils::DeserializeString<char>(buffer, current_position);
+  frame_ = frame_deserialized.first;
+  current_position += frame_deserialized.second;
+  uint8_t locked = 0;
+  DeserializeField(buffer, current_position, locked);
+  locked_ = (bool)locked;
+  return current_position - current;
+}
+
 void SignedDistanceField::SaveToFile(
     const SignedDistanceField& sdf,
     const std::string& filepath,
     const bool compress)
 {
-  std::vector<uint8_t> buffer;
-  sdf.SerializeSelf(buffer);
-  std::ofstream output_file(filepath, std::ios::out|std::ios::binary);
-  output_file.write("SDFR", 4);
-  const size_t serialized_size = buffer.size();
-  output_file.write(reinterpret_cast<const char*>(
-                      buffer.data()), (std::streamsize)serialized_size);
+  std::vector<uint8_t> header(kFilePreambleSize, 0x00);
+  sdf.SerializeMetadata(header);
+  const uint64_t payload_offset
+      = ((header.size() + kFilePageSize - 1) / kFilePageSize) * kFilePageSize;
+  header.resize(payload_offset, 0x00);
 
+  const uint64_t num_cells = sdf.data_.size();
+  std::vector<std::vector<uint8_t>> blocks;
+  uint64_t payload_size = num_cells * sizeof(float);
+  if (compress)
+  {
+    const int64_t num_blocks = (int64_t)((num_cells + kCompressionBlockCells - 1)
+                                         / kCompressionBlockCells);
+    blocks.resize((size_t)num_blocks);
+    #pragma omp parallel for
+    for (int64_t block = 0; block < num_blocks; block++)
+    {
+      const uint64_t first = (uint64_t)block * kCompressionBlockCells;
+      const uint64_t count = std::min(kCompressionBlockCells, num_cells - first);
+      blocks[(size_t)block] = EncodeBlock(sdf.data_.data() + first, (size_t)count);
+    }
+    payload_size = sizeof(uint64_t) * (1 + blocks.size());
+    for (size_t block = 0; block < blocks.size(); block++)
+    {
+      payload_size += blocks[block].size();
+    }
+  }
+
+  const uint32_t flags = compress ? kFileFlagCompressed : 0u;
+  memcpy(header.data(), kFileMagic, 4);
+  memcpy(header.data() + 4, &kFileVersion, sizeof(uint32_t));
+  memcpy(header.data() + 8, &flags, sizeof(uint32_t));
+  memcpy(header.data() + 16, &payload_offset, sizeof(uint64_t));
+  memcpy(header.data() + 24, &payload_size, sizeof(uint64_t));
+
+  std::ofstream output_file(filepath, std::ios::out|std::ios::binary);
+  if (output_file.good() == false)
+  {
+    throw std::invalid_argument("Could not open file [" + filepath + "]");
+  }
+  output_file.write(reinterpret_cast<const char*>(header.data()),
+                    (std::streamsize)header.size());
+  if (compress)
+  {
+    const uint64_t num_blocks = blocks.size();
+    output_file.write(reinterpret_cast<const char*>(&num_blocks),
+                      sizeof(num_blocks));
+    for (size_t block = 0; block < blocks.size(); block++)
+    {
+      const uint64_t block_size = blocks[block].size();
+      output_file.write(reinterpret_cast<const char*>(&block_size),
+                        sizeof(block_size));
+    }
+    for (size_t block = 0; block < blocks.size(); block++)
+    {
+      output_file.write(reinterpret_cast<const char*>(blocks[block].data()),
+                        (std::streamsize)blocks[block].size());
+    }
+  }
+  else
+  {
+    output_file.write(reinterpret_cast<const char*>(sdf.data_.data()),
+                      (std::streamsize)payload_size);
+  }
   output_file.close();
 }
 
 SignedDistanceField SignedDistanceField::LoadFromFile(
-    const std::string& filepath)
+    const std::string& filepath,
+    const bool map_file)
 {
   std::ifstream input_file(filepath, std::ios::in|std::ios::binary);
   if (input_file.good() == false)
@@ -416,34 +729,131 @@ SignedDistanceField SignedDistanceField::LoadFromFile(
   std::streampos begin = input_file.tellg();
   const std::streamsize serialized_size = end - begin;
   const std::streamsize header_size = 4;
-  if (serialized_size >= header_size)
-  {
-    // Load the header
-    std::vector<uint8_t> file_header(header_size + 1, 0x00);
-    input_file.read(reinterpret_cast<char*>(file_header.data()),
-                    header_size);
-    const std::string header_string(
-          reinterpret_cast<const char*>(file_header.data()));
+  if (serialized_size < header_size)
+  {
+    throw std::invalid_argument("File is too small");
+  }
+  // Load the header
+  std::vector<uint8_t> file_header(header_size + 1, 0x00);
+  input_file.read(reinterpret_cast<char*>(file_header.data()),
+                  header_size);
+  const std::string header_string(
+        reinterpret_cast<const char*>(file_header.data()));
+  if (header_string == std::string(kLegacyFileMagic, 4))
+  {
     // Load the rest of the file
     std::vector<uint8_t> file_buffer(
           (size_t)serialized_size - header_size, 0x00);
     input_file.read(reinterpret_cast<char*>(file_buffer.data()),
                     serialized_size - header_size);
-    // Deserialize
-    if (header_string == "SDFR")
+    SignedDistanceField sdf;
+    sdf.DeserializeSelf(file_buffer, 0);
+    return sdf;
+  }
+  if (header_string != std::string(kFileMagic, 4))
+  {
+    throw std::invalid_argument(
+          "File has invalid header [" + header_string + "]");
+  }
+  if ((uint64_t)serialized_size < kFilePreambleSize)
+  {
+    throw std::invalid_argument("File is too small");
+  }
+  std::vector<uint8_t> preamble(kFilePreambleSize, 0x00);
+  input_file.seekg(0, std::ios::beg);
+  input_file.read(reinterpret_cast<char*>(preamble.data()),
+                  (std::streamsize)kFilePreambleSize);
+  const uint32_t version = ReadPOD<uint32_t>(preamble.data() + 4);
+  const uint32_t flags = ReadPOD<uint32_t>(preamble.data() + 8);
+  const uint64_t payload_offset = ReadPOD<uint64_t>(preamble.data() + 16);
+  const uint64_t payload_size = ReadPOD<uint64_t>(preamble.data() + 24);
+  if (version > kFileVersion)
+  {
+    throw std::invalid_argument("File version "
+                                + std::to_string(version)
+                                + " is newer than supported version "
+                                + std::to_string(kFileVersion));
+  }
+  if (payload_offset < kFilePreambleSize
+      || (payload_offset + payload_size) > (uint64_t)serialized_size)
+  {
+    throw std::invalid_argument("File is truncated");
+  }
+  // Load the metadata
+  std::vector<uint8_t> metadata(
+        (size_t)(payload_offset - kFilePreambleSize), 0x00);
+  input_file.read(reinterpret_cast<char*>(metadata.data()),
+                  (std::streamsize)metadata.size());
+  SignedDistanceField sdf;
+  sdf.DeserializeMetadata(metadata, 0);
+  const uint64_t num_cells = (uint64_t)(sdf.num_x_cells_ * sdf.num_y_cells_
+                                        * sdf.num_z_cells_);
+  // Load the cells
+  if ((flags & kFileFlagCompressed) == 0)
+  {
+    if (payload_size != (num_cells * sizeof(float)))
     {
-      SignedDistanceField sdf;
-      sdf.DeserializeSelf(file_buffer, 0);
-      return sdf;
+      throw std::invalid_argument("File payload does not match grid size");
+    }
+    if (map_file)
+    {
+      input_file.close();
+      std::shared_ptr<sdf_utils::MappedFile> mapping
+          = std::make_shared<sdf_utils::MappedFile>(filepath);
+      sdf.data_ = sdf_utils::MappableVector<float>(mapping, payload_offset,
+                                                   (size_t)num_cells);
     }
     else
     {
-      throw std::invalid_argument(
-            "File has invalid header [" + header_string + "]");
+      std::vector<float> cells((size_t)num_cells);
+      input_file.read(reinterpret_cast<char*>(cells.data()),
+                      (std::streamsize)payload_size);
+      sdf.data_ = sdf_utils::MappableVector<float>(std::move(cells));
     }
+    return sdf;
   }
-  else
+  std::vector<uint8_t> payload((size_t)payload_size);
+  input_file.read(reinterpret_cast<char*>(payload.data()),
+                  (std::streamsize)payload_size);
+  const uint64_t num_blocks = (payload_size >= sizeof(uint64_t))
+                                ? ReadPOD<uint64_t>(payload.data()) : 0;
+  if (num_blocks != ((num_cells + kCompressionBlockCells - 1)
+                     / kCompressionBlockCells)
+      || payload_size < (sizeof(uint64_t) * (1 + num_blocks)))
   {
-    throw std::invalid_argument("File is too small");
+    throw std::invalid_argument("File has an invalid block table");
+  }
+  std::vector<uint64_t> block_offsets((size_t)num_blocks + 1);
+  block_offsets[0] = sizeof(uint64_t) * (1 + num_blocks);
+  for (uint64_t block = 0; block < num_blocks; block++)
+  {
+    block_offsets[block + 1] = block_offsets[block]
+        + ReadPOD<uint64_t>(payload.data() + sizeof(uint64_t) * (1 + block));
+  }
+  if (block_offsets[num_blocks] != payload_size)
+  {
+    throw std::invalid_argument("File has an invalid block table");
+  }
+  std::vector<float> cells((size_t)num_cells);
+  // Exceptions cannot leave an OpenMP region, bad blocks are counted instead
+  int64_t bad_blocks = 0;
+  #pragma omp parallel for reduction(+:bad_blocks)
+  for (int64_t block = 0; block < (int64_t)num_blocks; block++)
+  {
+    const uint64_t first = (uint64_t)block * kCompressionBlockCells;
+    const uint64_t count = std::min(kCompressionBlockCells, num_cells - first);
+    if (!DecodeBlock(payload.data() + block_offsets[(size_t)block],
+                     (size_t)(block_offsets[(size_t)block + 1]
+                              - block_offsets[(size_t)block]),
+                     cells.data() + first, (size_t)count))
+    {
+      bad_blocks++;
+    }
+  }
+  if (bad_blocks > 0)
+  {
+    throw std::invalid_argument("File has corrupt compressed blocks");
   }
+  sdf.data_ = sdf_utils::MappableVector<float>(std::move(cells));
+  return sdf;
 }
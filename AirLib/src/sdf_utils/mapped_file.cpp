@@ -0,0 +1,95 @@
+#include <sdf_utils/mappable_vector.hpp>
+
+#if defined _WIN32 || defined _WIN64
+
+#include "common/common_utils/WindowsApisCommonPre.hpp"
+#include "common/common_utils/MinWinDefines.hpp"
+#undef NOKERNEL // All KERNEL #undefs and routines
+#include <Windows.h>
+#include "common/common_utils/WindowsApisCommonPost.hpp"
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace sdf_utils;
+
+#if defined _WIN32 || defined _WIN64
+
+MappedFile::MappedFile(const std::string& filepath)
+  : data_(nullptr), size_(0), mapping_handle_(nullptr)
+{
+  HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    throw std::invalid_argument("File does not exist");
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    throw std::invalid_argument("File is too small");
+  }
+  // PAGE_WRITECOPY + FILE_MAP_COPY gives private copy-on-write pages
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL)
+  {
+    throw std::runtime_error("Failed to map file [" + filepath + "]");
+  }
+  void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  if (view == NULL)
+  {
+    CloseHandle(mapping);
+    throw std::runtime_error("Failed to map file [" + filepath + "]");
+  }
+  data_ = reinterpret_cast<uint8_t*>(view);
+  size_ = (uint64_t)file_size.QuadPart;
+  mapping_handle_ = mapping;
+}
+
+MappedFile::~MappedFile()
+{
+  UnmapViewOfFile(data_);
+  CloseHandle((HANDLE)mapping_handle_);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filepath)
+  : data_(nullptr), size_(0), mapping_handle_(nullptr)
+{
+  const int fd = open(filepath.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    throw std::invalid_argument("File does not exist");
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+  {
+    close(fd);
+    throw std::invalid_argument("File is too small");
+  }
+  // MAP_PRIVATE gives copy-on-write pages, the file itself is never modified
+  void* view = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file
+  close(fd);
+  if (view == MAP_FAILED)
+  {
+    throw std::runtime_error("Failed to map file [" + filepath + "]");
+  }
+  data_ = reinterpret_cast<uint8_t*>(view);
+  size_ = (uint64_t)file_stat.st_size;
+}
+
+MappedFile::~MappedFile()
+{
+  munmap(data_, (size_t)size_);
+}
+
+#endif
@@ -29,6 +29,8 @@ STRICT_MODE_OFF
 #include "common/common_utils/WindowsApisCommonPost.hpp"
 
 #include "vehicles/car/api/CarRpcLibAdaptors.hpp"
+#include "api/RpcLibBatch.hpp"
+#include "api/RpcLibDispatchPools.hpp"
 
 STRICT_MODE_ON
 
@@ -38,18 +40,19 @@ namespace airlib
 {
 
     typedef msr::airlib_rpclib::CarRpcLibAdaptors CarRpcLibAdaptors;
+    typedef RpcLibMethodBinder<rpc::server> MethodBinder;
 
     CarRpcLibServer::CarRpcLibServer(ApiProvider* api_provider, string server_address, uint16_t port)
         : RpcLibServerBase(api_provider, server_address, port)
     {
-        (static_cast<rpc::server*>(getServer()))->bind("getCarState", [&](const std::string& vehicle_name) -> CarRpcLibAdaptors::CarState {
+        getBatchDispatcher()->bind(*static_cast<MethodBinder*>(getMethodBinder()), "getCarState", [&](const std::string& vehicle_name) -> CarRpcLibAdaptors::CarState {
             return CarRpcLibAdaptors::CarState(getVehicleApi(vehicle_name)->getCarState());
         });
 
-        (static_cast<rpc::server*>(getServer()))->bind("setCarControls", [&](const CarRpcLibAdaptors::CarControls& controls, const std::string& vehicle_name) -> void {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("setCarControls", [&](const CarRpcLibAdaptors::CarControls& controls, const std::string& vehicle_name) -> void {
             getVehicleApi(vehicle_name)->setCarControls(controls.to());
         });
-        (static_cast<rpc::server*>(getServer()))->bind("getCarControls", [&](const std::string& vehicle_name) -> CarRpcLibAdaptors::CarControls {
+        getBatchDispatcher()->bind(*static_cast<MethodBinder*>(getMethodBinder()), "getCarControls", [&](const std::string& vehicle_name) -> CarRpcLibAdaptors::CarControls {
             return CarRpcLibAdaptors::CarControls(getVehicleApi(vehicle_name)->getCarControls());
         });
     }
@@ -954,375 +954,274 @@ namespace airlib
         moveByVelocityInternal(0.0, 0.0, 0.0, adj_yaw_mode);
         traj_cleared_ = true;
         cancelLastTask();
-        curr_traj_.clear();
+        {
+            std::lock_guard<std::mutex> traj_lock(traj_mutex_);
+            curr_traj_.clear();
+            next_traj_ready_ = false;
+        }
         has_traj_ = false;
         viz_traj_ = false;
     }
 
-    void MultirotorApiBase::fit_trajectory(const vector<Vector3r>& path,
+    bool MultirotorApiBase::fit_trajectory(const vector<Vector3r>& path,
                                             bool add_position_constraint,
                                             bool add_velocity_constraint,
                                             bool add_acceleration_constraint,
                                             float vel_max,
                                             float acc_max,
                                             bool replan_from_lookahead)
+    {
+        return fit_trajectory_vel_constraints(path, vector<Vector3r>(), add_position_constraint, add_velocity_constraint, add_acceleration_constraint, vel_max, acc_max, replan_from_lookahead);
+    }
+
+    // an empty velocities vector fits through the path positions only, returns false and keeps the current
+    // trajectory when no trajectory could be fitted
+    bool MultirotorApiBase::fit_trajectory_vel_constraints(const vector<Vector3r>& path, 
+                                                            const vector<Vector3r>& velocities, 
+                                                            bool add_position_constraint, 
+                                                            bool add_velocity_constraint, 
+                                                            bool add_acceleration_constraint, 
+                                                            float vel_max, 
+                                                            float acc_max,
+                                                            bool replan_from_lookahead)
     {
         SingleTaskCall lock(this);
 
-        // todo error checking
-        // if (path.size() < 1) // 1, as we'll add odometry to the beginning
-        // {
-            // return false;
-        // }
+        traj_viz_sampling_dt_ = 1.0 / 5.0;
 
-        constexpr int N = 10;
-        constexpr int D = 3;
-        // todo expose this as function param. 
-        int derivative_to_optimize = mav_trajectory_generation::derivative_order::JERK;
-        mav_trajectory_generation::Trajectory trajectory;
-        curr_traj_viz_tf_.clear();
+        SplinePlanRequest request;
+        request.vel_max = vel_max;
+        request.acc_max = acc_max;
+        request.viz_sampling_dt = traj_viz_sampling_dt_;
+        request.constrain_start_velocity = add_velocity_constraint;
+        request.constrain_start_acceleration = add_acceleration_constraint;
 
         if (has_traj_ && replan_from_lookahead)
         {
-            mav_trajectory_generation::Vertex::Vector vertices(path.size() + 1, mav_trajectory_generation::Vertex(D));
-            auto lookahead_point = curr_traj_[replan_lookahead_idx_];
-
-            Eigen::Vector3d lookahead_position_eigen(lookahead_point.position_W[0], lookahead_point.position_W[1], lookahead_point.position_W[2]);
-            vertices.front().makeStartOrEnd(lookahead_position_eigen, derivative_to_optimize);
-            curr_traj_viz_tf_.push_back(Vector3r(lookahead_position_eigen[0], lookahead_position_eigen[1], lookahead_position_eigen[2]));
-
-            if (add_velocity_constraint)
-            {
-                Eigen::Vector3d lookahead_velocity_eigen(lookahead_point.velocity_W[0], lookahead_point.velocity_W[1], lookahead_point.velocity_W[2]);
-                vertices.front().addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, lookahead_velocity_eigen);
-            }
-
-            if (add_acceleration_constraint)
-            {
-                Eigen::Vector3d lookahead_acceleration_eigen(lookahead_point.acceleration_W[0], lookahead_point.acceleration_W[1], lookahead_point.acceleration_W[2]);
-                vertices.front().addConstraint(mav_trajectory_generation::derivative_order::ACCELERATION, lookahead_acceleration_eigen);
-            }
-
-            // Add last.
-            Eigen::Vector3d last_eigen(path.back().x(), path.back().y(), path.back().z());
-
-            vertices.back().makeStartOrEnd(last_eigen, derivative_to_optimize);
+            std::lock_guard<std::mutex> traj_lock(traj_mutex_);
+            mav_msgs::EigenTrajectoryPoint lookahead_point;
+            curr_traj_.sample(replan_lookahead_time_, &lookahead_point);
 
-            // Now do the middle bits.
-            /// note that i is starting from 0 (unlike the "else" clause, coz the 1st vertex is the lookahead point)
-            size_t j = 1;
-            for (size_t i = 0; i < path.size() - 1; i += 1)
+            request.waypoints.push_back(lookahead_point.position_W.cast<float>());
+            request.waypoints.insert(request.waypoints.end(), path.begin(), path.end());
+            if (!velocities.empty())
             {
-                Eigen::Vector3d curr_xyz(path[i].x(), path[i].y(), path[i].z());
-                curr_traj_viz_tf_.push_back(path[i]);
-                vertices[j].addConstraint(mav_trajectory_generation::derivative_order::POSITION, curr_xyz);
-                j++;
+                request.velocities.push_back(lookahead_point.velocity_W.cast<float>());
+                request.velocities.insert(request.velocities.end(), velocities.begin(), velocities.end());
             }
-            curr_traj_viz_tf_.push_back(path.back());
+            request.start_velocity = lookahead_point.velocity_W.cast<float>();
+            request.start_acceleration = lookahead_point.acceleration_W.cast<float>();
 
-            std::vector<double> segment_times = mav_trajectory_generation::estimateSegmentTimes(vertices, vel_max, acc_max);
-
-            bool optimize_time = true;
-            if (optimize_time)
-            {
-                mav_trajectory_generation::NonlinearOptimizationParameters nlopt_parameters;
-                nlopt_parameters.algorithm = nlopt::LD_LBFGS;
-                nlopt_parameters.time_alloc_method = mav_trajectory_generation::NonlinearOptimizationParameters::kMellingerOuterLoop;
-                nlopt_parameters.print_debug_info_time_allocation = false;
-                mav_trajectory_generation::PolynomialOptimizationNonLinear<N> nlopt(D, nlopt_parameters);
-                nlopt.setupFromVertices(vertices, segment_times, derivative_to_optimize);
-                nlopt.addMaximumMagnitudeConstraint(mav_trajectory_generation::derivative_order::VELOCITY, vel_max);
-                nlopt.addMaximumMagnitudeConstraint(mav_trajectory_generation::derivative_order::ACCELERATION, acc_max);
-                nlopt.optimize();
-                nlopt.getTrajectory(trajectory);
-            }
-            else
-            {
-                mav_trajectory_generation::PolynomialOptimization<N> opt(D);
-                opt.setupFromVertices(vertices, segment_times, derivative_to_optimize);
-                opt.solveLinear();
-                opt.getTrajectory(trajectory);
-            }
+            request.previous_waypoints = curr_traj_waypoints_;
+            request.previous_segment_times = curr_traj_segment_times_;
+            request.previous_start_time = replan_lookahead_time_;
         }
         else
         {
-            vector<Vector3r> path_internal = path; // todo if I am copying and modding with if-else, passing by const ref is stupid. but want to copy and be safe. 
+            auto kinematics = getKinematicsEstimated();
+            request.waypoints = path;
+            request.velocities = velocities;
             if (add_position_constraint)
             {
-                auto curr_odom_position = getKinematicsEstimated().pose.position;
-                path_internal.insert(path_internal.begin(), curr_odom_position);
+                request.waypoints.insert(request.waypoints.begin(), kinematics.pose.position);
+                if (!velocities.empty())
+                    request.velocities.insert(request.velocities.begin(), kinematics.twist.linear);
             }
+            request.start_velocity = request.velocities.empty() ? kinematics.twist.linear : request.velocities.front();
+            request.start_acceleration = kinematics.accelerations.linear;
+        }
 
-            Eigen::Vector3d first_eigen(path_internal.front().x(), path_internal.front().y(), path_internal.front().z());
-            Eigen::Vector3d last_eigen(path_internal.back().x(), path_internal.back().y(), path_internal.back().z());
-            curr_traj_viz_tf_.push_back(path_internal.front());
-
-            int num_vertices = path_internal.size();
-
-            mav_trajectory_generation::Vertex::Vector vertices(num_vertices, mav_trajectory_generation::Vertex(D));
+        SplinePlan plan;
+        if (!plan_spline(request, plan)) {
+            Utils::log("moveOnSpline could not fit a trajectory through the path", Utils::kLogLevelWarn);
+            return false;
+        }
 
-            // Add first.
-            vertices.front().makeStartOrEnd(first_eigen, derivative_to_optimize);
+        std::lock_guard<std::mutex> traj_lock(traj_mutex_);
+        set_curr_plan(plan);
+        return true;
+    }
 
-            if (add_velocity_constraint)
-            {
-                auto curr_odom_velocity = getKinematicsEstimated().twist.linear;
-                Eigen::Vector3d curr_odom_velocity_eigen(curr_odom_velocity.x(), curr_odom_velocity.y(), curr_odom_velocity.z());
-                vertices.front().addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, curr_odom_velocity_eigen);
-            }
-            if (add_acceleration_constraint)
-            {
-                auto curr_odom_accel = getKinematicsEstimated().accelerations.linear;
-                Eigen::Vector3d curr_odom_accel_eigen(curr_odom_accel.x(), curr_odom_accel.y(), curr_odom_accel.z());
-                vertices.front().addConstraint(mav_trajectory_generation::derivative_order::ACCELERATION, curr_odom_accel_eigen);
-            }
+    //distance function of the moveOnSpline collision cost, the sdf is shared with the request so that it outlives the optimization
+    static mav_trajectory_generation::DistanceFunction sdfDistanceFunction(const std::shared_ptr<const sdf_tools::SignedDistanceField>& sdf)
+    {
+        return [sdf](const Eigen::Matrix3Xd& positions, Eigen::VectorXd* distances, Eigen::Matrix3Xd* gradients) {
+            distances->resize(positions.cols());
+            if (gradients != nullptr)
+                gradients->resize(3, positions.cols());
+            sdf->EstimateDistancesBatch3d(positions.data(), static_cast<size_t>(positions.cols()), distances->data(),
+                                          gradients != nullptr ? gradients->data() : nullptr);
+        };
+    }
 
-            // Add last.
-            vertices.back().makeStartOrEnd(last_eigen, derivative_to_optimize);
+    //smallest signed distance to an obstacle along the trajectory, sampled every dt
+    static double minObstacleDistance(const sdf_tools::SignedDistanceField& sdf, const mav_trajectory_generation::Trajectory& trajectory, double dt)
+    {
+        Eigen::MatrixXd positions;
+        trajectory.evaluateRange(0, trajectory.getMaxTime(), dt, mav_trajectory_generation::derivative_order::POSITION, &positions);
+        if (positions.cols() == 0)
+            return std::numeric_limits<double>::infinity();
+
+        Eigen::Matrix3Xd points = positions.topRows<3>();
+        std::vector<double> distances(points.cols());
+        sdf.EstimateDistancesBatch3d(points.data(), distances.size(), distances.data());
+        return *std::min_element(distances.begin(), distances.end());
+    }
 
-            // Now do the middle bits.
-            size_t j = 1;
-            for (size_t i = 1; i < path_internal.size() - 1; i += 1)
-            {
-                curr_traj_viz_tf_.push_back(path_internal[i]);
-                Eigen::Vector3d curr_xyz(path_internal[i].x(), path_internal[i].y(), path_internal[i].z());
-                vertices[j].addConstraint(mav_trajectory_generation::derivative_order::POSITION, curr_xyz);
-                j++;
+    //segments of the new plan between waypoints the previous plan also went through start from the time the
+    //previous time allocation gave them, so a replan of a mostly unchanged course starts close to its optimum
+    static void warmStartSegmentTimes(const SplinePlanRequest& request, std::vector<double>& segment_times)
+    {
+        const vector<Vector3r>& previous = request.previous_waypoints;
+        const std::vector<double>& previous_times = request.previous_segment_times;
+        if (previous.size() < 2 || previous.size() != previous_times.size() + 1)
+            return;
+
+        std::vector<double> previous_end_times(previous_times.size());
+        double end_time = 0;
+        for (size_t i = 0; i < previous_times.size(); ++i)
+            previous_end_times[i] = end_time += previous_times[i];
+
+        constexpr float kSameWaypointDistance = 1E-3f;
+        size_t next_previous = 1;
+        for (size_t k = 0; k < segment_times.size(); ++k) {
+            size_t p = next_previous;
+            while (p < previous.size() && (previous[p] - request.waypoints[k + 1]).norm() > kSameWaypointDistance)
+                ++p;
+            if (p == previous.size())
+                continue; //changed or new waypoint, keep the estimate
+
+            double time = -1;
+            if (k == 0) {
+                //the plan starts part way into previous segment p - 1
+                double start_time = previous_end_times[p - 1] - previous_times[p - 1];
+                if (request.previous_start_time >= start_time)
+                    time = previous_end_times[p - 1] - request.previous_start_time;
             }
-            curr_traj_viz_tf_.push_back(path_internal.back());
+            else if ((previous[p - 1] - request.waypoints[k]).norm() <= kSameWaypointDistance)
+                time = previous_times[p - 1];
 
-            std::vector<double> segment_times = mav_trajectory_generation::estimateSegmentTimes(vertices, vel_max, acc_max);
-
-            bool optimize_time = true;
-            if (optimize_time)
-            {
-                mav_trajectory_generation::NonlinearOptimizationParameters nlopt_parameters;
-                nlopt_parameters.algorithm = nlopt::LD_LBFGS;
-                nlopt_parameters.time_alloc_method = mav_trajectory_generation::NonlinearOptimizationParameters::kMellingerOuterLoop;
-                nlopt_parameters.print_debug_info_time_allocation = false;
-                mav_trajectory_generation::PolynomialOptimizationNonLinear<N> nlopt(D, nlopt_parameters);
-                nlopt.setupFromVertices(vertices, segment_times, derivative_to_optimize);
-                nlopt.addMaximumMagnitudeConstraint(mav_trajectory_generation::derivative_order::VELOCITY, vel_max);
-                nlopt.addMaximumMagnitudeConstraint(mav_trajectory_generation::derivative_order::ACCELERATION, acc_max);
-                nlopt.optimize();
-                nlopt.getTrajectory(trajectory);
-            }
-            else
-            {
-                mav_trajectory_generation::PolynomialOptimization<N> opt(D);
-                opt.setupFromVertices(vertices, segment_times, derivative_to_optimize);
-                opt.solveLinear();
-                opt.getTrajectory(trajectory);
-            }
+            if (time > 0)
+                segment_times[k] = std::max(time, mav_trajectory_generation::kOptimizationTimeLowerBound);
+            next_previous = p + 1;
         }
-        
-
-
-        // double v_max, a_max;
-        // trajectory.computeMaxVelocityAndAcceleration(&v_max, &a_max);
-        // printf("[SMOOTHING] V max/limit: %f/%f, A max/limit: %f/%f \n\n\n", v_max, vel_max, a_max, acc_max);
-
-        traj_control_sampling_dt_ = 1.0 / 50.0;
-        traj_viz_sampling_dt_ = 1.0 / 5.0;
-
-        mav_msgs::EigenTrajectoryPoint::Vector eigen_traj_pt_vec;
-        mav_trajectory_generation::sampleWholeTrajectory(trajectory, traj_control_sampling_dt_, &eigen_traj_pt_vec);
-
-        mav_msgs::EigenTrajectoryPoint::Vector eigen_traj_pt_viz_vec;
-        mav_trajectory_generation::sampleWholeTrajectory(trajectory, traj_viz_sampling_dt_, &eigen_traj_pt_viz_vec);
-        curr_traj_viz_idx_++;
-        set_curr_traj_for_plotting(eigen_traj_pt_viz_vec);
-
-        curr_traj_ = eigen_traj_pt_vec;
     }
 
-    // todo remote duplicate code wrt fit_trajcetory
-    void MultirotorApiBase::fit_trajectory_vel_constraints(const vector<Vector3r>& path, 
-                                                            const vector<Vector3r>& velocities, 
-                                                            bool add_position_constraint, 
-                                                            bool add_velocity_constraint, 
-                                                            bool add_acceleration_constraint, 
-                                                            float vel_max, 
-                                                            float acc_max,
-                                                            bool replan_from_lookahead)
+    // does not touch any state of the api so that replans can run on the planner thread
+    bool MultirotorApiBase::plan_spline(const SplinePlanRequest& request, SplinePlan& plan)
     {
-        SingleTaskCall lock(this);
-
-        // todo error checking
-        // if (path.size() < 1) // 1, as we'll add odometry to the beginning
-        // {
-            // return false;
-        // }
-
         constexpr int N = 10;
         constexpr int D = 3;
+        // todo expose this as function param. 
         int derivative_to_optimize = mav_trajectory_generation::derivative_order::JERK;
-        mav_trajectory_generation::Trajectory trajectory;
-        curr_traj_viz_tf_.clear();
-
-        if (has_traj_ && replan_from_lookahead)
-        {
-            mav_trajectory_generation::Vertex::Vector vertices(path.size() + 1, mav_trajectory_generation::Vertex(D));
-            auto lookahead_point = curr_traj_[replan_lookahead_idx_];
-
-            Eigen::Vector3d lookahead_position_eigen(lookahead_point.position_W[0], lookahead_point.position_W[1], lookahead_point.position_W[2]);
-            vertices.front().makeStartOrEnd(lookahead_position_eigen, derivative_to_optimize);
-            curr_traj_viz_tf_.push_back(Vector3r(lookahead_position_eigen[0], lookahead_position_eigen[1], lookahead_position_eigen[2]));
-
-            if (add_velocity_constraint)
-            {
-                Eigen::Vector3d lookahead_velocity_eigen(lookahead_point.velocity_W[0], lookahead_point.velocity_W[1], lookahead_point.velocity_W[2]);
-                vertices.front().addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, lookahead_velocity_eigen);
-            }
-
-            if (add_acceleration_constraint)
-            {
-                Eigen::Vector3d lookahead_acceleration_eigen(lookahead_point.acceleration_W[0], lookahead_point.acceleration_W[1], lookahead_point.acceleration_W[2]);
-                vertices.front().addConstraint(mav_trajectory_generation::derivative_order::ACCELERATION, lookahead_acceleration_eigen);
-            }
-
-            // Add last.
-            Eigen::Vector3d last_eigen(path.back().x(), path.back().y(), path.back().z());
-            Eigen::Vector3d last_eigen_velocity(velocities.back().x(), velocities.back().y(), velocities.back().z());
-
-            vertices.back().makeStartOrEnd(last_eigen, derivative_to_optimize);
-            vertices.back().addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, last_eigen_velocity);
+        const vector<Vector3r>& waypoints = request.waypoints;
+        if (waypoints.size() < 2)
+            return false;
+        if (!request.velocities.empty() && request.velocities.size() != waypoints.size()) {
+            Utils::log(Utils::stringf("moveOnSpline got %d velocities for %d waypoints", static_cast<int>(request.velocities.size()),
+                                      static_cast<int>(waypoints.size())),
+                       Utils::kLogLevelWarn);
+            return false;
+        }
+        const bool has_velocities = !request.velocities.empty();
 
-            // Now do the middle bits.
-            /// note that i is starting from 0 (unlike the "else" clause, coz the 1st vertex is the lookahead point)
-            size_t j = 1;
-            for (size_t i = 0; i < path.size() - 1; i += 1)
-            {
-                curr_traj_viz_tf_.push_back(path[i]);
-                Eigen::Vector3d curr_xyz(path[i].x(), path[i].y(), path[i].z());
-                Eigen::Vector3d curr_xyz_velocity(velocities[i].x(), velocities[i].y(), velocities[i].z());
-                vertices[j].addConstraint(mav_trajectory_generation::derivative_order::POSITION, curr_xyz);
-                vertices[j].addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, curr_xyz_velocity);
-                j++;
-            }
+        mav_trajectory_generation::Vertex::Vector vertices(waypoints.size(), mav_trajectory_generation::Vertex(D));
 
-            curr_traj_viz_tf_.push_back(path.back());
-            std::vector<double> segment_times = mav_trajectory_generation::estimateSegmentTimes(vertices, vel_max, acc_max);
+        // Add first.
+        vertices.front().makeStartOrEnd(waypoints.front().cast<double>(), derivative_to_optimize);
+        if (request.constrain_start_velocity)
+            vertices.front().addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, request.start_velocity.cast<double>());
+        if (request.constrain_start_acceleration)
+            vertices.front().addConstraint(mav_trajectory_generation::derivative_order::ACCELERATION, request.start_acceleration.cast<double>());
 
-            bool optimize_time = true;
-            if (optimize_time)
-            {
-                mav_trajectory_generation::NonlinearOptimizationParameters nlopt_parameters;
-                nlopt_parameters.algorithm = nlopt::LD_LBFGS;
-                nlopt_parameters.time_alloc_method = mav_trajectory_generation::NonlinearOptimizationParameters::kMellingerOuterLoop;
-                nlopt_parameters.print_debug_info_time_allocation = false;
-                mav_trajectory_generation::PolynomialOptimizationNonLinear<N> nlopt(D, nlopt_parameters);
-                nlopt.setupFromVertices(vertices, segment_times, derivative_to_optimize);
-                nlopt.addMaximumMagnitudeConstraint(mav_trajectory_generation::derivative_order::VELOCITY, vel_max);
-                nlopt.addMaximumMagnitudeConstraint(mav_trajectory_generation::derivative_order::ACCELERATION, acc_max);
-                nlopt.optimize();
-                nlopt.getTrajectory(trajectory);
-            }
-            else
-            {
-                mav_trajectory_generation::PolynomialOptimization<N> opt(D);
-                opt.setupFromVertices(vertices, segment_times, derivative_to_optimize);
-                opt.solveLinear();
-                opt.getTrajectory(trajectory);
-            }
-        }
+        // Add last.
+        vertices.back().makeStartOrEnd(waypoints.back().cast<double>(), derivative_to_optimize);
+        if (has_velocities)
+            vertices.back().addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, request.velocities.back().cast<double>());
 
-        else
+        // Now do the middle bits.
+        for (size_t i = 1; i + 1 < waypoints.size(); ++i)
         {
-            // use a deque? or reverse the vector and push_back odometry in the end? 
+            vertices[i].addConstraint(mav_trajectory_generation::derivative_order::POSITION, waypoints[i].cast<double>());
+            if (has_velocities)
+                vertices[i].addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, request.velocities[i].cast<double>());
+        }
 
-            vector<Vector3r> path_internal = path; // todo if I am copying and modding with if-else, passing by const ref is stupid. but want to copy and be safe. 
-            vector<Vector3r> velocities_internal = velocities;
+        std::vector<double> segment_times = mav_trajectory_generation::estimateSegmentTimes(vertices, request.vel_max, request.acc_max);
+        warmStartSegmentTimes(request, segment_times);
+
+        mav_trajectory_generation::NonlinearOptimizationParameters nlopt_parameters;
+        nlopt_parameters.algorithm = nlopt::LD_LBFGS;
+        nlopt_parameters.time_alloc_method = mav_trajectory_generation::NonlinearOptimizationParameters::kMellingerOuterLoop;
+        nlopt_parameters.print_debug_info_time_allocation = false;
+        mav_trajectory_generation::PolynomialOptimizationNonLinear<N> nlopt(D, nlopt_parameters);
+        nlopt.setupFromVertices(vertices, segment_times, derivative_to_optimize);
+        nlopt.addMaximumMagnitudeConstraint(mav_trajectory_generation::derivative_order::VELOCITY, request.vel_max);
+        nlopt.addMaximumMagnitudeConstraint(mav_trajectory_generation::derivative_order::ACCELERATION, request.acc_max);
+        if (request.sdf)
+            nlopt.addCollisionCost(sdfDistanceFunction(request.sdf), request.min_clearance, request.collision_weight, request.collision_sampling_dt);
+        nlopt.optimize();
+        nlopt.getTrajectory(plan.trajectory);
 
-            if (add_position_constraint)
-            {
-                auto curr_odom_position = getKinematicsEstimated().pose.position;
-                auto curr_odom_velocity = getKinematicsEstimated().twist.linear;
-                path_internal.insert(path_internal.begin(), curr_odom_position);
-                velocities_internal.insert(velocities_internal.begin(), curr_odom_velocity);//only used if add_velocity_constraint is true    
-            }
+        // double v_max, a_max;
+        // plan.trajectory.computeMaxVelocityAndAcceleration(&v_max, &a_max);
+        // printf("[SMOOTHING] V max/limit: %f/%f, A max/limit: %f/%f \n\n\n", v_max, vel_max, a_max, acc_max);
 
-            int num_vertices = path_internal.size();
-            mav_trajectory_generation::Vertex::Vector vertices(num_vertices, mav_trajectory_generation::Vertex(D));
+        if (plan.trajectory.empty())
+            return false;
 
-            // Add first.
-            Eigen::Vector3d first_eigen(path_internal.front().x(), path_internal.front().y(), path_internal.front().z());
-            vertices.front().makeStartOrEnd(first_eigen, derivative_to_optimize);
-            curr_traj_viz_tf_.push_back(path_internal.front());
+        mav_trajectory_generation::sampleWholeTrajectory(plan.trajectory, request.viz_sampling_dt, &plan.viz_points);
+        plan.waypoints = waypoints;
+        plan.segment_times = plan.trajectory.getSegmentTimes();
+        if (request.sdf)
+            plan.min_obstacle_distance = minObstacleDistance(*request.sdf, plan.trajectory, request.collision_check_dt);
+        return true;
+    }
 
-            if (add_velocity_constraint) // can be true only if add_position_constraint is true   
-            {
-                Eigen::Vector3d first_eigen_velocity(velocities_internal.front().x(), velocities_internal.front().y(), velocities_internal.front().z());
-                vertices.front().addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, first_eigen_velocity);
-            }
-            if (add_acceleration_constraint)
-            {
-                auto curr_odom_accel = getKinematicsEstimated().accelerations.linear;
-                Eigen::Vector3d curr_odom_accel_eigen(curr_odom_accel.x(), curr_odom_accel.y(), curr_odom_accel.z());
-                vertices.front().addConstraint(mav_trajectory_generation::derivative_order::ACCELERATION, curr_odom_accel_eigen);
+    int MultirotorApiBase::planSplineCandidates(const vector<SplinePlanRequest>& requests, common_utils::ParallelFor& pool,
+                                                SplinePlan& best_plan, vector<SplinePlan>* plans)
+    {
+        vector<SplinePlan> candidate_plans(requests.size());
+        vector<char> planned(requests.size(), 0);
+        pool.run(requests.size(), [&](size_t i) {
+            try {
+                planned[i] = plan_spline(requests[i], candidate_plans[i]);
             }
-
-            // Add last.
-            Eigen::Vector3d last_eigen(path_internal.back().x(), path_internal.back().y(), path_internal.back().z());
-            vertices.back().makeStartOrEnd(last_eigen, derivative_to_optimize);
-            Eigen::Vector3d last_eigen_velocity(velocities_internal.back().x(), velocities_internal.back().y(), velocities_internal.back().z());
-            vertices.back().addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, last_eigen_velocity);
-
-            // Now do the middle bits.
-            size_t j = 1;
-            for (size_t i = 1; i < path_internal.size() - 1; i += 1)
-            {
-                curr_traj_viz_tf_.push_back(path_internal[i]);
-                Eigen::Vector3d curr_xyz_position(path_internal[i].x(), path_internal[i].y(), path_internal[i].z());
-                Eigen::Vector3d curr_xyz_velocity(velocities_internal[i].x(), velocities_internal[i].y(), velocities_internal[i].z());
-                vertices[j].addConstraint(mav_trajectory_generation::derivative_order::POSITION, curr_xyz_position);
-                vertices[j].addConstraint(mav_trajectory_generation::derivative_order::VELOCITY, curr_xyz_velocity);
-                j++;
+            catch (const std::exception& ex) {
+                Utils::log(Utils::stringf("moveOnSpline candidate %d failed: %s", static_cast<int>(i), ex.what()), Utils::kLogLevelWarn);
             }
+        });
+
+        int best = -1;
+        for (size_t i = 0; i < requests.size(); ++i) {
+            if (!planned[i] || candidate_plans[i].min_obstacle_distance < requests[i].min_clearance)
+                continue;
+            if (best < 0 || candidate_plans[i].trajectory.getMaxTime() < candidate_plans[best].trajectory.getMaxTime())
+                best = static_cast<int>(i);
+        }
 
-            curr_traj_viz_tf_.push_back(path_internal.back());
-            std::vector<double> segment_times = mav_trajectory_generation::estimateSegmentTimes(vertices, vel_max, acc_max);
-
-            bool optimize_time = true;
-            if (optimize_time)
-            {
-                mav_trajectory_generation::NonlinearOptimizationParameters nlopt_parameters;
-                nlopt_parameters.algorithm = nlopt::LD_LBFGS;
-                nlopt_parameters.time_alloc_method = mav_trajectory_generation::NonlinearOptimizationParameters::kMellingerOuterLoop;
-                nlopt_parameters.print_debug_info_time_allocation = false;
-                mav_trajectory_generation::PolynomialOptimizationNonLinear<N> nlopt(D, nlopt_parameters);
-                nlopt.setupFromVertices(vertices, segment_times, derivative_to_optimize);
-                nlopt.addMaximumMagnitudeConstraint(mav_trajectory_generation::derivative_order::VELOCITY, vel_max);
-                nlopt.addMaximumMagnitudeConstraint(mav_trajectory_generation::derivative_order::ACCELERATION, acc_max);
-                nlopt.optimize();
-                nlopt.getTrajectory(trajectory);
-            }
+        if (best >= 0) {
+            if (plans != nullptr)
+                best_plan = candidate_plans[best];
             else
-            {
-                mav_trajectory_generation::PolynomialOptimization<N> opt(D);
-                opt.setupFromVertices(vertices, segment_times, derivative_to_optimize);
-                opt.solveLinear();
-                opt.getTrajectory(trajectory);
-            }
-
+                best_plan = std::move(candidate_plans[best]);
         }
+        if (plans != nullptr)
+            plans->swap(candidate_plans);
+        return best;
+    }
 
-        // double v_max, a_max;
-        // trajectory.computeMaxVelocityAndAcceleration(&v_max, &a_max);
-        // printf("[SMOOTHING] V max/limit: %f/%f, A max/limit: %f/%f \n\n\n", v_max, vel_max, a_max, acc_max);
-
-        traj_control_sampling_dt_ = 1.0 / 50.0;
-        traj_viz_sampling_dt_ = 1.0 / 5.0;
-
-        mav_msgs::EigenTrajectoryPoint::Vector eigen_traj_pt_vec;
-        mav_trajectory_generation::sampleWholeTrajectory(trajectory, traj_control_sampling_dt_, &eigen_traj_pt_vec);
-
-        mav_msgs::EigenTrajectoryPoint::Vector eigen_traj_pt_viz_vec;
-        mav_trajectory_generation::sampleWholeTrajectory(trajectory, traj_viz_sampling_dt_, &eigen_traj_pt_viz_vec);
+    // makes plan the trajectory to track and leaves it empty, traj_mutex_ must be held
+    void MultirotorApiBase::set_curr_plan(SplinePlan& plan)
+    {
+        curr_traj_viz_tf_ = plan.waypoints;
         curr_traj_viz_idx_++;
-        set_curr_traj_for_plotting(eigen_traj_pt_viz_vec);
+        set_curr_traj_for_plotting(plan.viz_points);
 
-        curr_traj_ = eigen_traj_pt_vec;
+        curr_traj_.setTrajectory(plan.trajectory);
+        plan.trajectory.clear();
+        curr_traj_waypoints_.swap(plan.waypoints);
+        curr_traj_segment_times_.swap(plan.segment_times);
     }
 
     void MultirotorApiBase::set_curr_traj_for_plotting(const mav_msgs::EigenTrajectoryPoint::Vector& eigen_traj_pt_vec)
@@ -1349,12 +1248,20 @@ namespace airlib
                                         bool replan_from_lookahead,
                                         float replan_lookahead_sec)
     {
+        bool swapped_in;
+        if (replan_from_lookahead && replan_while_tracking(path, vector<Vector3r>(), false, add_velocity_constraint, add_acceleration_constraint, 
+                                                           vel_max, acc_max, viz_traj, viz_traj_color_rgba, replan_lookahead_sec, swapped_in))
+            return swapped_in;
+
         SingleTaskCall lock(this);
         traj_cleared_ = false;
         viz_traj_ = viz_traj;
         viz_traj_color_rgba_ = viz_traj_color_rgba;
 
-        fit_trajectory(path, add_position_constraint, add_velocity_constraint, add_acceleration_constraint, vel_max, acc_max, replan_from_lookahead);
+        if (!fit_trajectory(path, add_position_constraint, add_velocity_constraint, add_acceleration_constraint, vel_max, acc_max, replan_from_lookahead)) {
+            viz_traj_ = false;
+            return false;
+        }
         replan_lookahead_sec_ = replan_lookahead_sec;
         track_trajectory(false);
         viz_traj_ = false;// make false after tracker is finished
@@ -1374,12 +1281,20 @@ namespace airlib
                                                         bool replan_from_lookahead,
                                                         float replan_lookahead_sec)
     {
+        bool swapped_in;
+        if (replan_from_lookahead && replan_while_tracking(path, velocities, true, add_velocity_constraint, add_acceleration_constraint, 
+                                                           vel_max, acc_max, viz_traj, viz_traj_color_rgba, replan_lookahead_sec, swapped_in))
+            return swapped_in;
+
         SingleTaskCall lock(this);
         traj_cleared_ = false;
         viz_traj_ = viz_traj;
         viz_traj_color_rgba_ = viz_traj_color_rgba;
 
-        fit_trajectory_vel_constraints(path, velocities, add_position_constraint, add_velocity_constraint, add_acceleration_constraint, vel_max, acc_max, replan_from_lookahead);
+        if (!fit_trajectory_vel_constraints(path, velocities, add_position_constraint, add_velocity_constraint, add_acceleration_constraint, vel_max, acc_max, replan_from_lookahead)) {
+            viz_traj_ = false;
+            return false;
+        }
         replan_lookahead_sec_ = replan_lookahead_sec;
         track_trajectory(true);
         viz_traj_ = false;// make false after tracker is finished
@@ -1387,6 +1302,214 @@ namespace airlib
         return true; // todo actual future
     }
 
+    bool MultirotorApiBase::moveOnSplineCandidates(const vector<vector<Vector3r>>& candidate_paths,
+                                                   bool add_position_constraint,
+                                                   bool add_velocity_constraint,
+                                                   bool add_acceleration_constraint,
+                                                   float vel_max,
+                                                   float acc_max,
+                                                   float min_clearance,
+                                                   bool viz_traj,
+                                                   const vector<float>& viz_traj_color_rgba)
+    {
+        SingleTaskCall lock(this);
+
+        std::shared_ptr<const sdf_tools::SignedDistanceField> sdf;
+        {
+            std::lock_guard<std::mutex> traj_lock(traj_mutex_);
+            sdf = spline_collision_sdf_;
+        }
+        if (!sdf) {
+            Utils::log("moveOnSplineCandidates needs an sdf, call loadSplineCollisionSdf first", Utils::kLogLevelWarn);
+            return false;
+        }
+
+        traj_viz_sampling_dt_ = 1.0 / 5.0;
+        auto kinematics = getKinematicsEstimated();
+
+        vector<SplinePlanRequest> requests(candidate_paths.size());
+        for (size_t i = 0; i < candidate_paths.size(); ++i) {
+            SplinePlanRequest& request = requests[i];
+            request.waypoints = candidate_paths[i];
+            if (add_position_constraint)
+                request.waypoints.insert(request.waypoints.begin(), kinematics.pose.position);
+            request.constrain_start_velocity = add_velocity_constraint;
+            request.start_velocity = kinematics.twist.linear;
+            request.constrain_start_acceleration = add_acceleration_constraint;
+            request.start_acceleration = kinematics.accelerations.linear;
+            request.vel_max = vel_max;
+            request.acc_max = acc_max;
+            request.viz_sampling_dt = traj_viz_sampling_dt_;
+            request.sdf = sdf;
+            request.min_clearance = min_clearance;
+        }
+
+        if (!spline_candidate_pool_)
+            spline_candidate_pool_.reset(new common_utils::ParallelFor());
+
+        SplinePlan plan;
+        const int best = planSplineCandidates(requests, *spline_candidate_pool_, plan);
+        if (best < 0) {
+            Utils::log("moveOnSplineCandidates found no collision free candidate", Utils::kLogLevelWarn);
+            return false;
+        }
+
+        traj_cleared_ = false;
+        viz_traj_ = viz_traj;
+        viz_traj_color_rgba_ = viz_traj_color_rgba;
+        {
+            std::lock_guard<std::mutex> traj_lock(traj_mutex_);
+            set_curr_plan(plan);
+        }
+        replan_lookahead_sec_ = 0;
+        track_trajectory(false);
+        viz_traj_ = false; // make false after tracker is finished
+
+        return true;
+    }
+
+    bool MultirotorApiBase::loadSplineCollisionSdf(const std::string& filepath)
+    {
+        std::shared_ptr<const sdf_tools::SignedDistanceField> sdf;
+        try {
+            sdf = std::make_shared<const sdf_tools::SignedDistanceField>(sdf_tools::SignedDistanceField::LoadFromFile(filepath));
+        }
+        catch (const std::exception& ex) {
+            Utils::log(Utils::stringf("could not load sdf %s: %s", filepath.c_str(), ex.what()), Utils::kLogLevelWarn);
+            return false;
+        }
+
+        //candidates being planned keep the sdf they started with
+        std::lock_guard<std::mutex> traj_lock(traj_mutex_);
+        spline_collision_sdf_ = std::move(sdf);
+        return true;
+    }
+
+    // If a trajectory is being tracked, plans the new one on the planner thread from the current lookahead point
+    // and hands it to the tracker, which keeps flying the current trajectory until it gets to that point. Like a
+    // moveOnSpline call that tracks the trajectory itself this returns once the vehicle is done tracking, with
+    // swapped_in set. If the replan could not be planned, or is dropped before it is swapped in, this returns as
+    // soon as that is known with swapped_in cleared and the vehicle keeps flying what it was tracking.
+    // Returns false if nothing is being tracked, the caller then plans and tracks as usual.
+    bool MultirotorApiBase::replan_while_tracking(const vector<Vector3r>& path, const vector<Vector3r>& velocities, bool is_moveOnSplineVelConstraints,
+                                                  bool add_velocity_constraint, bool add_acceleration_constraint, float vel_max, float acc_max,
+                                                  bool viz_traj, const vector<float>& viz_traj_color_rgba, float replan_lookahead_sec, bool& swapped_in)
+    {
+        swapped_in = false;
+        SplinePlanRequest request;
+        SplineReplan replan;
+        uint64_t replan_seq, tracking_generation;
+        {
+            std::lock_guard<std::mutex> traj_lock(traj_mutex_);
+            if (!tracking_active_ || curr_traj_.empty() || path.empty())
+                return false;
+
+            replan.swap_time = std::min(replan_lookahead_time_, curr_traj_.getMaxTime());
+            replan.is_moveOnSplineVelConstraints = is_moveOnSplineVelConstraints;
+            replan.viz_traj = viz_traj;
+            replan.viz_traj_color_rgba = viz_traj_color_rgba;
+            replan.replan_lookahead_sec = replan_lookahead_sec;
+
+            mav_msgs::EigenTrajectoryPoint lookahead_point;
+            curr_traj_.sample(replan.swap_time, &lookahead_point);
+            request.vel_max = vel_max;
+            request.acc_max = acc_max;
+            request.viz_sampling_dt = traj_viz_sampling_dt_;
+            request.waypoints.push_back(lookahead_point.position_W.cast<float>());
+            request.waypoints.insert(request.waypoints.end(), path.begin(), path.end());
+            if (!velocities.empty())
+            {
+                request.velocities.push_back(lookahead_point.velocity_W.cast<float>());
+                request.velocities.insert(request.velocities.end(), velocities.begin(), velocities.end());
+            }
+            request.constrain_start_velocity = add_velocity_constraint;
+            request.start_velocity = lookahead_point.velocity_W.cast<float>();
+            request.constrain_start_acceleration = add_acceleration_constraint;
+            request.start_acceleration = lookahead_point.acceleration_W.cast<float>();
+            request.previous_waypoints = curr_traj_waypoints_;
+            request.previous_segment_times = curr_traj_segment_times_;
+            request.previous_start_time = replan.swap_time;
+
+            //a replan that is planned but not swapped in yet is superseded by this one
+            drop_pending_replan();
+            replan.outcome = pending_replan_outcome_ = std::make_shared<SplineReplanOutcome>(SplineReplanOutcome::Pending);
+            replan_seq = ++replan_seq_;
+            replan_in_flight_ = true;
+            tracking_generation = tracking_generation_;
+        }
+        tracking_done_cv_.notify_all();
+
+        const std::shared_ptr<SplineReplanOutcome> outcome = replan.outcome;
+        spline_planner_.submit([this, request, replan, replan_seq, tracking_generation]() {
+            replan_on_planner_thread(request, replan, replan_seq, tracking_generation);
+        });
+
+        std::unique_lock<std::mutex> traj_lock(traj_mutex_);
+        tracking_done_cv_.wait(traj_lock, [this, &outcome, tracking_generation]() {
+            return (*outcome != SplineReplanOutcome::Pending && *outcome != SplineReplanOutcome::SwappedIn) ||
+                   !tracking_active_ || tracking_generation_ != tracking_generation;
+        });
+        swapped_in = *outcome == SplineReplanOutcome::SwappedIn;
+        return true;
+    }
+
+    // the replan that is neither swapped in nor failed yet won't be. traj_mutex_ must be held, notify tracking_done_cv_ after.
+    void MultirotorApiBase::drop_pending_replan()
+    {
+        next_traj_ready_ = false;
+        if (pending_replan_outcome_ && *pending_replan_outcome_ == SplineReplanOutcome::Pending)
+            *pending_replan_outcome_ = SplineReplanOutcome::Dropped;
+        pending_replan_outcome_.reset();
+    }
+
+    void MultirotorApiBase::replan_on_planner_thread(const SplinePlanRequest& request, SplineReplan replan, uint64_t replan_seq, uint64_t tracking_generation)
+    {
+        bool planned = false;
+        try {
+            planned = plan_spline(request, replan.plan);
+        }
+        catch (const std::exception& ex) {
+            Utils::log(Utils::stringf("moveOnSpline replan failed: %s", ex.what()), Utils::kLogLevelWarn);
+        }
+
+        {
+            std::lock_guard<std::mutex> traj_lock(traj_mutex_);
+            if (replan_seq != replan_seq_)
+                return; //a newer replan was requested meanwhile, which dropped this one
+            replan_in_flight_ = false;
+            if (!planned) {
+                Utils::log("moveOnSpline could not fit a trajectory through the replanned path", Utils::kLogLevelWarn);
+                *replan.outcome = SplineReplanOutcome::Failed;
+                pending_replan_outcome_.reset();
+            }
+            else if (tracking_active_ && tracking_generation_ == tracking_generation) {
+                next_traj_ = std::move(replan);
+                next_traj_ready_ = true;
+            }
+            else
+                drop_pending_replan();
+        }
+        tracking_done_cv_.notify_all();
+    }
+
+    // swaps in the replanned trajectory once the tracker reaches the time it was planned from, ref_time is moved to
+    // the same point in time on the new trajectory. traj_mutex_ must be held.
+    void MultirotorApiBase::swap_in_replanned_trajectory(double& ref_time, bool& is_moveOnSplineVelConstraints)
+    {
+        if (!next_traj_ready_ || ref_time < next_traj_.swap_time)
+            return;
+        next_traj_ready_ = false;
+        *next_traj_.outcome = SplineReplanOutcome::SwappedIn;
+        pending_replan_outcome_.reset();
+
+        ref_time = std::min(ref_time - next_traj_.swap_time, next_traj_.plan.trajectory.getMaxTime());
+        is_moveOnSplineVelConstraints = next_traj_.is_moveOnSplineVelConstraints;
+        viz_traj_ = next_traj_.viz_traj;
+        viz_traj_color_rgba_ = next_traj_.viz_traj_color_rgba;
+        replan_lookahead_sec_ = next_traj_.replan_lookahead_sec;
+        set_curr_plan(next_traj_.plan);
+    }
+
     bool MultirotorApiBase::track_trajectory(bool is_moveOnSplineVelConstraints)
     {
         bool traj_cancelled_ = false;
@@ -1394,14 +1517,13 @@ namespace airlib
         double duration_vel_cmd = 1.0 / 50.0;
         double timeout_sec = 1.0 / 50.0;
 
-        Vector3dDeque position_reference_deque_;
-        Vector3dDeque velocity_reference_deque_;
-
-        for (const auto& eigen_traj_pt : curr_traj_)
         {
-            position_reference_deque_.push_back(eigen_traj_pt.position_W);
-            velocity_reference_deque_.push_back(eigen_traj_pt.velocity_W);
+            std::lock_guard<std::mutex> traj_lock(traj_mutex_);
+            tracking_active_ = true;
+            ++tracking_generation_;
+            drop_pending_replan();
         }
+        tracking_done_cv_.notify_all();
 
         XYZYaw curr_position;
         XYZYaw curr_velocity;
@@ -1412,19 +1534,38 @@ namespace airlib
 
         int print_idx = 0;
         int print_every_nth = 75;
-        int curr_tracking_ref_idx_ = 0;
+        bool has_last_reference = false;
+
+        // the reference is evaluated on the trajectory polynomials at the time since tracking started
+        double ref_time = 0;
+        TTimePoint ref_clock = ClockFactory::get()->nowNanos();
+        mav_msgs::EigenTrajectoryPoint ref_point;
 
         // track both position and velocity until the last point
-        while (velocity_reference_deque_.size() > 1)
+        while (true)
         {
-            curr_tracking_ref_idx_++;
+            bool hold_reference;
+            {
+                std::lock_guard<std::mutex> traj_lock(traj_mutex_);
+                if (!traj_cancelled_)
+                    swap_in_replanned_trajectory(ref_time, is_moveOnSplineVelConstraints);
 
-            if (!traj_cancelled_)
-                replan_lookahead_idx_ = std::min(curr_tracking_ref_idx_ + static_cast<size_t>((replan_lookahead_sec_) / traj_control_sampling_dt_), 
-                                            curr_traj_.size());
+                // at the last point, keep tracking it while a replan is on its way rather than stopping first
+                hold_reference = ref_time >= curr_traj_.getMaxTime();
+                if (curr_traj_.empty() || traj_cancelled_ || (hold_reference && !replan_in_flight_))
+                {
+                    has_last_reference = !curr_traj_.empty();
+                    tracking_active_ = false;
+                    drop_pending_replan();
+                    break;
+                }
+                ref_time = std::min(ref_time, curr_traj_.getMaxTime());
+                replan_lookahead_time_ = std::min(ref_time + replan_lookahead_sec_, curr_traj_.getMaxTime());
 
-            auto ref_velocity_eth = velocity_reference_deque_.front();
-            auto ref_position_eth = position_reference_deque_.front();
+                curr_traj_.sample(ref_time, &ref_point);
+            }
+            const Eigen::Vector3d& ref_velocity_eth = ref_point.velocity_W;
+            const Eigen::Vector3d& ref_position_eth = ref_point.position_W;
             Kinematics::State multirotor_kinematics_estimated = getKinematicsEstimated();
             auto curr_position_airsim =  multirotor_kinematics_estimated.pose.position;
             auto curr_velocity_airsim =  multirotor_kinematics_estimated.twist.linear;
@@ -1488,12 +1629,15 @@ namespace airlib
             // }
 
             print_idx++;
-            position_reference_deque_.pop_front();
-            velocity_reference_deque_.pop_front();
+            TTimePoint now = ClockFactory::get()->nowNanos();
+            if (!hold_reference)
+                ref_time += ClockFactory::get()->elapsedBetween(now, ref_clock);
+            ref_clock = now;
         }
+        tracking_done_cv_.notify_all();
 
         // now track only position. 
-        if ((velocity_reference_deque_.size() == 1) && !(is_moveOnSplineVelConstraints))
+        if (has_last_reference && !(is_moveOnSplineVelConstraints))
         {
             use_only_reference_position = true;
 
@@ -1572,7 +1716,7 @@ namespace airlib
         }
 
         // just send last waypoint's velocity and let it be. 
-        if ((velocity_reference_deque_.size() == 1) && is_moveOnSplineVelConstraints)
+        if (has_last_reference && is_moveOnSplineVelConstraints)
         {
             YawMode adj_yaw_mode;
 
@@ -1591,9 +1735,6 @@ namespace airlib
             while (waiter.sleep());
         }
 
-        position_reference_deque_.pop_front();
-        velocity_reference_deque_.pop_front();
-
         if (traj_cancelled_ && !traj_cleared_)
             has_traj_ = true;
         else
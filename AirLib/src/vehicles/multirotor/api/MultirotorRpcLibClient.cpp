@@ -298,6 +298,26 @@ __pragma(warning(disable : 4239))
             return this;
         }
 
+        MultirotorRpcLibClient* MultirotorRpcLibClient::moveOnSplineCandidatesAsync(const vector<vector<Vector3r>>& candidate_paths, 
+            bool add_position_constraint, bool add_velocity_constraint, bool add_acceleration_constraint, 
+            float vel_max, float acc_max, float min_clearance, 
+            bool viz_traj, const vector<float>& viz_traj_color_rgba, const std::string& vehicle_name)
+        {
+            vector<vector<MultirotorRpcLibAdaptors::Vector3r>> conv_paths(candidate_paths.size());
+            for (size_t i = 0; i < candidate_paths.size(); ++i)
+                MultirotorRpcLibAdaptors::from(candidate_paths[i], conv_paths[i]);
+            pimpl_->last_future = static_cast<rpc::client*>(getClient())->async_call("moveOnSplineCandidates", conv_paths, 
+                add_position_constraint, add_velocity_constraint, add_acceleration_constraint, 
+                vel_max, acc_max, min_clearance, 
+                viz_traj, viz_traj_color_rgba, vehicle_name);
+            return this;
+        }
+
+        bool MultirotorRpcLibClient::loadSplineCollisionSdf(const std::string& filepath, const std::string& vehicle_name)
+        {
+            return static_cast<rpc::client*>(getClient())->call("loadSplineCollisionSdf", filepath, vehicle_name).as<bool>();
+        }
+
         void MultirotorRpcLibClient::setTrajectoryTrackerGains(const vector<float>& gains, const std::string& vehicle_name)
         {
             static_cast<rpc::client*>(getClient())->call("setTrajectoryTrackerGains", gains, vehicle_name);
@@ -29,6 +29,8 @@ STRICT_MODE_OFF
 #include "common/common_utils/WindowsApisCommonPost.hpp"
 
 #include "vehicles/multirotor/api/MultirotorRpcLibAdaptors.hpp"
+#include "api/RpcLibBatch.hpp"
+#include "api/RpcLibDispatchPools.hpp"
 
 STRICT_MODE_ON
 
@@ -38,105 +40,106 @@ namespace airlib
 {
 
     typedef msr::airlib_rpclib::MultirotorRpcLibAdaptors MultirotorRpcLibAdaptors;
+    typedef RpcLibMethodBinder<rpc::server> MethodBinder;
 
     MultirotorRpcLibServer::MultirotorRpcLibServer(ApiProvider* api_provider, string server_address, uint16_t port)
         : RpcLibServerBase(api_provider, server_address, port)
     {
-        (static_cast<rpc::server*>(getServer()))->bind("takeoff", [&](float timeout_sec, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("takeoff", [&](float timeout_sec, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->takeoff(timeout_sec);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("land", [&](float timeout_sec, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("land", [&](float timeout_sec, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->land(timeout_sec);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("goHome", [&](float timeout_sec, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("goHome", [&](float timeout_sec, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->goHome(timeout_sec);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByVelocityBodyFrame", [&](float vx, float vy, float vz, float duration, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByVelocityBodyFrame", [&](float vx, float vy, float vz, float duration, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByVelocityBodyFrame(vx, vy, vz, duration, drivetrain, yaw_mode.to());
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByVelocityZBodyFrame", [&](float vx, float vy, float z, float duration, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByVelocityZBodyFrame", [&](float vx, float vy, float z, float duration, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByVelocityZBodyFrame(vx, vy, z, duration, drivetrain, yaw_mode.to());
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByMotorPWMs", [&](float front_right_pwm, float rear_left_pwm, float front_left_pwm, float rear_right_pwm, float duration, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByMotorPWMs", [&](float front_right_pwm, float rear_left_pwm, float front_left_pwm, float rear_right_pwm, float duration, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByMotorPWMs(front_right_pwm, rear_left_pwm, front_left_pwm, rear_right_pwm, duration);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByRollPitchYawZ", [&](float roll, float pitch, float yaw, float z, float duration, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByRollPitchYawZ", [&](float roll, float pitch, float yaw, float z, float duration, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByRollPitchYawZ(roll, pitch, yaw, z, duration);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByRollPitchYawThrottle", [&](float roll, float pitch, float yaw, float throttle, float duration, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByRollPitchYawThrottle", [&](float roll, float pitch, float yaw, float throttle, float duration, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByRollPitchYawThrottle(roll, pitch, yaw, throttle, duration);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByRollPitchYawrateThrottle", [&](float roll, float pitch, float yaw_rate, float throttle, float duration, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByRollPitchYawrateThrottle", [&](float roll, float pitch, float yaw_rate, float throttle, float duration, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByRollPitchYawrateThrottle(roll, pitch, yaw_rate, throttle, duration);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByRollPitchYawrateZ", [&](float roll, float pitch, float yaw_rate, float z, float duration, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByRollPitchYawrateZ", [&](float roll, float pitch, float yaw_rate, float z, float duration, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByRollPitchYawrateZ(roll, pitch, yaw_rate, z, duration);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByAngleRatesZ", [&](float roll_rate, float pitch_rate, float yaw_rate, float z, float duration, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByAngleRatesZ", [&](float roll_rate, float pitch_rate, float yaw_rate, float z, float duration, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByAngleRatesZ(roll_rate, pitch_rate, yaw_rate, z, duration);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByAngleRatesThrottle", [&](float roll_rate, float pitch_rate, float yaw_rate, float throttle, float duration, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByAngleRatesThrottle", [&](float roll_rate, float pitch_rate, float yaw_rate, float throttle, float duration, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByAngleRatesThrottle(roll_rate, pitch_rate, yaw_rate, throttle, duration);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByVelocity", [&](float vx, float vy, float vz, float duration, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByVelocity", [&](float vx, float vy, float vz, float duration, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByVelocity(vx, vy, vz, duration, drivetrain, yaw_mode.to());
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByVelocityZ", [&](float vx, float vy, float z, float duration, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByVelocityZ", [&](float vx, float vy, float z, float duration, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByVelocityZ(vx, vy, z, duration, drivetrain, yaw_mode.to());
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveOnPath", [&](const vector<MultirotorRpcLibAdaptors::Vector3r>& path, float velocity, float timeout_sec, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveOnPath", [&](const vector<MultirotorRpcLibAdaptors::Vector3r>& path, float velocity, float timeout_sec, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name) -> bool {
             vector<Vector3r> conv_path;
             MultirotorRpcLibAdaptors::to(path, conv_path);
             return getVehicleApi(vehicle_name)->moveOnPath(conv_path, velocity, timeout_sec, drivetrain, yaw_mode.to(), lookahead, adaptive_lookahead);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveToPosition", [&](float x, float y, float z, float velocity, float timeout_sec, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveToPosition", [&](float x, float y, float z, float velocity, float timeout_sec, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveToPosition(x, y, z, velocity, timeout_sec, drivetrain, yaw_mode.to(), lookahead, adaptive_lookahead);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveToZ", [&](float z, float velocity, float timeout_sec, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveToZ", [&](float z, float velocity, float timeout_sec, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, float lookahead, float adaptive_lookahead, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveToZ(z, velocity, timeout_sec, yaw_mode.to(), lookahead, adaptive_lookahead);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByManual", [&](float vx_max, float vy_max, float z_min, float duration, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByManual", [&](float vx_max, float vy_max, float z_min, float duration, DrivetrainType drivetrain, const MultirotorRpcLibAdaptors::YawMode& yaw_mode, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->moveByManual(vx_max, vy_max, z_min, duration, drivetrain, yaw_mode.to());
         });
-        (static_cast<rpc::server*>(getServer()))->bind("rotateToYaw", [&](float yaw, float timeout_sec, float margin, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("rotateToYaw", [&](float yaw, float timeout_sec, float margin, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->rotateToYaw(yaw, timeout_sec, margin);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("rotateByYawRate", [&](float yaw_rate, float duration, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("rotateByYawRate", [&](float yaw_rate, float duration, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->rotateByYawRate(yaw_rate, duration);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("hover", [&](const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("hover", [&](const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->hover();
         });
-        (static_cast<rpc::server*>(getServer()))->bind("setAngleLevelControllerGains", [&](const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name) -> void {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("setAngleLevelControllerGains", [&](const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name) -> void {
             getVehicleApi(vehicle_name)->setAngleLevelControllerGains(kp, ki, kd);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("setAngleRateControllerGains", [&](const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name) -> void {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("setAngleRateControllerGains", [&](const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name) -> void {
             getVehicleApi(vehicle_name)->setAngleRateControllerGains(kp, ki, kd);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("setVelocityControllerGains", [&](const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name) -> void {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("setVelocityControllerGains", [&](const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name) -> void {
             getVehicleApi(vehicle_name)->setVelocityControllerGains(kp, ki, kd);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("setPositionControllerGains", [&](const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name) -> void {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("setPositionControllerGains", [&](const vector<float>& kp, const vector<float>& ki, const vector<float>& kd, const std::string& vehicle_name) -> void {
             getVehicleApi(vehicle_name)->setPositionControllerGains(kp, ki, kd);
         });
-        (static_cast<rpc::server*>(getServer()))->bind("moveByRC", [&](const MultirotorRpcLibAdaptors::RCData& data, const std::string& vehicle_name) -> void {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("moveByRC", [&](const MultirotorRpcLibAdaptors::RCData& data, const std::string& vehicle_name) -> void {
             getVehicleApi(vehicle_name)->moveByRC(data.to());
         });
-        (static_cast<rpc::server*>(getServer()))->bind("setSafety", [&](uint enable_reasons, float obs_clearance, const SafetyEval::ObsAvoidanceStrategy& obs_startegy, float obs_avoidance_vel, const MultirotorRpcLibAdaptors::Vector3r& origin, float xy_length, float max_z, float min_z, const std::string& vehicle_name) -> bool {
+        static_cast<MethodBinder*>(getMethodBinder())->bind("setSafety", [&](uint enable_reasons, float obs_clearance, const SafetyEval::ObsAvoidanceStrategy& obs_startegy, float obs_avoidance_vel, const MultirotorRpcLibAdaptors::Vector3r& origin, float xy_length, float max_z, float min_z, const std::string& vehicle_name) -> bool {
             return getVehicleApi(vehicle_name)->setSafety(SafetyEval::SafetyViolationType(enable_reasons), obs_clearance, obs_startegy, obs_avoidance_vel, origin.to(), xy_length, max_z, min_z);
         });
 
 
         // ADRL //
-        (static_cast<rpc::server*>(getServer()))->
+        static_cast<MethodBinder*>(getMethodBinder())->
             bind("setTrajectoryTrackerGains", [&](const vector<float>& gains, const std::string& vehicle_name) -> void {
                 getVehicleApi(vehicle_name)->setTrajectoryTrackerGains(gains);
         });
-        (static_cast<rpc::server*>(getServer()))->
+        static_cast<MethodBinder*>(getMethodBinder())->
             bind("clearTrajectory", [&](const std::string& vehicle_name) -> void {
             getVehicleApi(vehicle_name)->clearTrajectory();
         });
-        (static_cast<rpc::server*>(getServer()))->
+        static_cast<MethodBinder*>(getMethodBinder())->
             bind("moveOnSpline", [&](const vector<MultirotorRpcLibAdaptors::Vector3r>& path, 
                     bool add_position_constraint, bool add_velocity_constraint, bool add_acceleration_constraint, 
                     float vel_max, float acc_max, 
@@ -147,7 +150,7 @@ namespace airlib
                 return getVehicleApi(vehicle_name)->moveOnSpline(conv_path, add_position_constraint, add_velocity_constraint, add_acceleration_constraint, 
                     vel_max, acc_max, viz_traj, viz_traj_color_rgba, replan_from_lookahead, replan_lookahead_sec);
         });
-        (static_cast<rpc::server*>(getServer()))->
+        static_cast<MethodBinder*>(getMethodBinder())->
             bind("moveOnSplineVelConstraints", [&](const vector<MultirotorRpcLibAdaptors::Vector3r>& path, const vector<MultirotorRpcLibAdaptors::Vector3r>& velocities, 
                     bool add_position_constraint, bool add_velocity_constraint, bool add_acceleration_constraint, 
                     float vel_max, float acc_max, 
@@ -160,15 +163,30 @@ namespace airlib
                 return getVehicleApi(vehicle_name)->moveOnSplineVelConstraints(conv_path, conv_velocities, add_position_constraint, add_velocity_constraint, add_acceleration_constraint, 
                     vel_max, acc_max, viz_traj, viz_traj_color_rgba, replan_from_lookahead, replan_lookahead_sec);
         });
+        static_cast<MethodBinder*>(getMethodBinder())->
+            bind("moveOnSplineCandidates", [&](const vector<vector<MultirotorRpcLibAdaptors::Vector3r>>& candidate_paths, 
+                    bool add_position_constraint, bool add_velocity_constraint, bool add_acceleration_constraint, 
+                    float vel_max, float acc_max, float min_clearance, 
+                    bool viz_traj, const vector<float>& viz_traj_color_rgba, const std::string& vehicle_name) -> bool {
+                vector<vector<Vector3r>> conv_paths(candidate_paths.size());
+                for (size_t i = 0; i < candidate_paths.size(); ++i)
+                    MultirotorRpcLibAdaptors::to(candidate_paths[i], conv_paths[i]);
+                return getVehicleApi(vehicle_name)->moveOnSplineCandidates(conv_paths, add_position_constraint, add_velocity_constraint, add_acceleration_constraint, 
+                    vel_max, acc_max, min_clearance, viz_traj, viz_traj_color_rgba);
+        });
+        static_cast<MethodBinder*>(getMethodBinder())->
+            bind("loadSplineCollisionSdf", [&](const std::string& filepath, const std::string& vehicle_name) -> bool {
+                return getVehicleApi(vehicle_name)->loadSplineCollisionSdf(filepath);
+        });
         // ADRL //
 
         //getters
         // Rotor state
-        (static_cast<rpc::server*>(getServer()))->bind("getRotorStates", [&](const std::string& vehicle_name) -> MultirotorRpcLibAdaptors::RotorStates {
+        getBatchDispatcher()->bind(*static_cast<MethodBinder*>(getMethodBinder()), "getRotorStates", [&](const std::string& vehicle_name) -> MultirotorRpcLibAdaptors::RotorStates {
             return MultirotorRpcLibAdaptors::RotorStates(getVehicleApi(vehicle_name)->getRotorStates());
         });
         // Multirotor state
-        (static_cast<rpc::server*>(getServer()))->bind("getMultirotorState", [&](const std::string& vehicle_name) -> MultirotorRpcLibAdaptors::MultirotorState {
+        getBatchDispatcher()->bind(*static_cast<MethodBinder*>(getMethodBinder()), "getMultirotorState", [&](const std::string& vehicle_name) -> MultirotorRpcLibAdaptors::MultirotorState {
             return MultirotorRpcLibAdaptors::MultirotorState(getVehicleApi(vehicle_name)->getMultirotorState());
         });
     }
@@ -0,0 +1,118 @@
+#ifndef msr_AirLibUnitTests_PhysicsBatchTest_hpp
+#define msr_AirLibUnitTests_PhysicsBatchTest_hpp
+
+#include <memory>
+#include <vector>
+#include "TestBase.hpp"
+#include "common/SteppableClock.hpp"
+#include "physics/FastPhysicsEngine.hpp"
+#include "physics/DebugPhysicsBody.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    //steps the same bodies with the per body and the batched FastPhysicsEngine update and checks that they agree
+    class PhysicsBatchTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            auto clock = std::make_shared<SteppableClock>(3E-3f);
+            ClockFactory::get(clock);
+
+            Bodies serial, batched;
+            FastPhysicsEngine serial_physics(true, Vector3r(1, 0, 0), false);
+            FastPhysicsEngine batched_physics(true, Vector3r(1, 0, 0), true);
+            serial.create(serial_physics);
+            batched.create(batched_physics);
+
+            for (int step = 0; step < 500; ++step) {
+                clock->step();
+                serial.update(serial_physics);
+                batched.update(batched_physics);
+            }
+
+            testAssert(serial.ground_hits > 0 && serial.ground_hits == batched.ground_hits, "falling body did not hit the ground the same way");
+            for (size_t i = 0; i < serial.bodies.size(); ++i) {
+                const Kinematics::State& expected = serial.bodies[i]->getKinematics();
+                const Kinematics::State& actual = batched.bodies[i]->getKinematics();
+                testAssert(isClose(expected.pose.position, actual.pose.position), "batched position differs");
+                testAssert(isClose(expected.pose.orientation.coeffs(), actual.pose.orientation.coeffs()), "batched orientation differs");
+                testAssert(isClose(expected.twist.linear, actual.twist.linear), "batched linear velocity differs");
+                testAssert(isClose(expected.twist.angular, actual.twist.angular), "batched angular velocity differs");
+                testAssert(isClose(expected.accelerations.angular, actual.accelerations.angular), "batched angular acceleration differs");
+            }
+        }
+
+    private:
+        class QuietBody : public DebugPhysicsBody
+        {
+        public:
+            virtual void updateKinematics(const Kinematics::State& kinematics) override
+            {
+                PhysicsBody::updateKinematics(kinematics);
+            }
+        };
+
+        struct Bodies
+        {
+            std::vector<std::unique_ptr<Kinematics>> kinematics;
+            std::vector<std::unique_ptr<Environment>> environments;
+            std::vector<std::unique_ptr<QuietBody>> bodies;
+            int ground_hits = 0;
+
+            void create(FastPhysicsEngine& physics)
+            {
+                //one body without rotation takes the branch that keeps the orientation, the last one
+                //starts just above the ground and falls onto it, which takes the collision response
+                for (int i = 0; i < 7; ++i) {
+                    auto initial = Kinematics::State::zero();
+                    initial.pose.position = Vector3r(i * 2.0f, 0, i == 6 ? -0.2f : -10.0f);
+                    initial.twist.linear = i == 6 ? Vector3r(0.3f, 0, 2.0f) : Vector3r(0.5f * i, -0.2f * i, 0.1f);
+                    initial.twist.angular = i == 0 || i == 6 ? Vector3r::Zero() : Vector3r(0.3f * i, -0.1f, 0.05f * i);
+                    Environment::State initial_environment(initial.pose.position, GeoPoint(47.641468, -122.140165, 122));
+
+                    kinematics.emplace_back(new Kinematics(initial));
+                    environments.emplace_back(new Environment(initial_environment));
+                    bodies.emplace_back(new QuietBody());
+                    bodies.back()->initialize(kinematics.back().get(), environments.back().get());
+                    kinematics.back()->reset();
+                    bodies.back()->reset();
+                    physics.insert(bodies.back().get());
+                }
+                physics.reset();
+            }
+
+            void update(FastPhysicsEngine& physics)
+            {
+                for (size_t i = 0; i < bodies.size(); ++i) {
+                    environments[i]->update();
+                    bodies[i]->update();
+                    hitGround(*bodies[i]);
+                }
+                physics.update();
+            }
+
+            //the ground is the plane z = 0, like the collision info the renderer reports
+            void hitGround(PhysicsBody& body)
+            {
+                const Vector3r position = body.getKinematics().pose.position;
+                if (position.z() < 0)
+                    return;
+                ++ground_hits;
+                body.setCollisionInfo(CollisionInfo(true, Vector3r(0, 0, -1), Vector3r(position.x(), position.y(), 0), position,
+                                                    position.z(), ClockFactory::get()->nowNanos(), "ground", 0));
+            }
+        };
+
+        template <typename TVector>
+        static bool isClose(const TVector& expected, const TVector& actual)
+        {
+            return (expected - actual).norm() <= 1E-4f * (1 + expected.norm());
+        }
+    };
+}
+}
+#endif
@@ -0,0 +1,382 @@
+#ifndef msr_AirLibUnitTests_RpcLibTest_hpp
+#define msr_AirLibUnitTests_RpcLibTest_hpp
+
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "TestBase.hpp"
+#include "api/VehicleApiBase.hpp"
+#include "api/RpcLibAdaptorsBase.hpp"
+#include "api/RpcLibBatch.hpp"
+#include "api/RpcLibCompactAdaptors.hpp"
+#include "api/RpcLibDispatchPools.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class RpcLibTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            batchTest();
+            dispatchPoolsTest();
+            compactTest();
+            lidarPointCloudTest();
+        }
+
+    private:
+        typedef msr::airlib_rpclib::RpcLibAdaptorsBase RpcLibAdaptorsBase;
+        typedef msr::airlib_rpclib::RpcLibCompactAdaptors RpcLibCompactAdaptors;
+
+        //stands in for the rpclib server, batch methods are registered with both
+        struct Server
+        {
+            std::vector<std::string> names;
+
+            template <typename TFunc>
+            void bind(const std::string& name, TFunc)
+            {
+                names.push_back(name);
+            }
+        };
+
+        template <typename T>
+        static size_t packedSize(const T& value)
+        {
+            RPCLIB_MSGPACK::sbuffer buffer;
+            RPCLIB_MSGPACK::pack(buffer, value);
+            return buffer.size();
+        }
+
+        template <typename T>
+        static T roundTrip(const T& value)
+        {
+            RPCLIB_MSGPACK::sbuffer buffer;
+            RPCLIB_MSGPACK::pack(buffer, value);
+            RPCLIB_MSGPACK::object_handle handle = RPCLIB_MSGPACK::unpack(buffer.data(), buffer.size());
+            return handle.get().as<T>();
+        }
+
+        //calls and results go through msgpack like they would over the wire
+        void batchTest()
+        {
+            Server server;
+            RpcLibBatchDispatcher dispatcher;
+            int void_calls = 0;
+            dispatcher.bind(server, "add", [](int a, int b) -> int { return a + b; });
+            dispatcher.bind(server, "getPose", [](const std::string& name) -> RpcLibAdaptorsBase::Pose {
+                return RpcLibAdaptorsBase::Pose(Pose(Vector3r(1, 2, static_cast<float>(name.size())), Quaternionr(0, 1, 0, 0)));
+            });
+            dispatcher.bind(server, "fail", [](int) -> int { throw std::runtime_error("failed on purpose"); });
+            dispatcher.bind(server, "ping", [&]() -> void { ++void_calls; });
+            testAssert(server.names.size() == 4, "batch methods were not bound to the server");
+
+            RpcLibBatch batch;
+            const auto sum = batch.add<int>("add", 2, 3);
+            const auto pose = batch.add<RpcLibAdaptorsBase::Pose>("getPose", std::string("gate"));
+            const auto failed = batch.add<int>("fail", 1);
+            const auto missing = batch.add<int>("missing");
+            const auto bad_args = batch.add<int>("add", std::string("two"), 3);
+            batch.add<RPCLIB_MSGPACK::type::nil_t>("ping");
+
+            bool threw = false;
+            try {
+                batch.get(sum);
+            }
+            catch (const std::logic_error&) {
+                threw = true;
+            }
+            testAssert(threw, "batch result was available before the call");
+
+            const std::vector<RpcLibAdaptorsBase::BatchCall> calls = roundTrip(batch.getCalls());
+            batch.setResults(roundTrip(dispatcher.dispatch(calls)));
+
+            testAssert(batch.get(sum) == 5, "batched add returned the wrong sum");
+            const Pose pose_result = batch.get(pose).to();
+            testAssert(pose_result.position == Vector3r(1, 2, 4), "batched pose has the wrong position");
+            testAssert(pose_result.orientation.coeffs() == Quaternionr(0, 1, 0, 0).coeffs(), "batched pose has the wrong orientation");
+            testAssert(void_calls == 1, "batched void call did not run exactly once");
+
+            //errors stay with their own call and name it
+            const std::pair<RpcLibBatch::Handle<int>, std::string> failures[] = {
+                { failed, "fail: failed on purpose" }, { missing, "missing: " }, { bad_args, "add: " }
+            };
+            for (const auto& failure : failures) {
+                std::string error;
+                try {
+                    batch.get(failure.first);
+                }
+                catch (const std::runtime_error& ex) {
+                    error = ex.what();
+                }
+                testAssert(error.compare(0, failure.second.size(), failure.second) == 0, "failed batch call did not throw its error from get()");
+            }
+
+            //the same calls can be sent again every tick
+            batch.clearResults();
+            batch.setResults(dispatcher.dispatch(batch.getCalls()));
+            testAssert(batch.get(sum) == 5 && void_calls == 2, "repeated batch returned the wrong results");
+
+            threw = false;
+            try {
+                batch.setResults(std::vector<RpcLibAdaptorsBase::BatchResult>(1));
+            }
+            catch (const std::runtime_error&) {
+                threw = true;
+            }
+            testAssert(threw, "batch accepted the wrong number of results");
+        }
+
+        void dispatchPoolsTest()
+        {
+            testAssert(RpcLibDispatchPools::classify("batchCall") == RpcDispatchClass::Batch, "batchCall is not in its own class");
+            testAssert(RpcLibDispatchPools::classify("simGetImages") == RpcDispatchClass::Heavy, "simGetImages is not heavy");
+            testAssert(RpcLibDispatchPools::classify("loadSplineCollisionSdf") == RpcDispatchClass::Heavy, "loadSplineCollisionSdf is not heavy");
+            testAssert(RpcLibDispatchPools::classify("getMultirotorState") == RpcDispatchClass::Query, "getMultirotorState is not a query");
+            testAssert(RpcLibDispatchPools::classify("moveToPositionAsync") == RpcDispatchClass::Command, "moveToPositionAsync is not a command");
+
+            RpcLibDispatchPools pools;
+            pools.setThreadCount(RpcDispatchClass::Heavy, 1);
+            pools.start(3);
+
+            //batched calls run on the pool of their own method and are measured as that method
+            Server server;
+            RpcLibBatchDispatcher dispatcher;
+            const std::thread::id caller = std::this_thread::get_id();
+            dispatcher.bind(server, "getThreadMatches", [caller]() -> bool { return std::this_thread::get_id() == caller; });
+            RpcLibBatch batch;
+            const auto same_thread = batch.add<bool>("getThreadMatches");
+            batch.setResults(dispatcher.dispatch(batch.getCalls(), pools));
+            testAssert(!batch.get(same_thread), "batched call did not run on a pool");
+            bool measured = false;
+            for (const auto& metrics : pools.getMetrics(false))
+                measured |= metrics.method == "getThreadMatches" && metrics.dispatch_class == "Query" && metrics.calls == 1;
+            testAssert(measured, "batched call was not measured in its own class");
+
+            //heavy calls beyond the single heavy worker queue on its pool without holding back queries
+            heavyQueueTest(pools, 4, "");
+
+            //with a pending limit further heavy calls fail instead of waiting
+            RpcLibDispatchPools limited_pools;
+            limited_pools.setThreadCount(RpcDispatchClass::Heavy, 1);
+            limited_pools.setMaxPendingCalls(2);
+            limited_pools.start(3);
+            heavyQueueTest(limited_pools, 2, "Too many pending Heavy calls");
+        }
+
+        //blocks pending_count heavy calls, then makes one more heavy call and a query while they wait
+        void heavyQueueTest(RpcLibDispatchPools& pools, size_t pending_count, const std::string& expected_error)
+        {
+            std::promise<void> release;
+            std::shared_future<void> released = release.get_future().share();
+            auto render = pools.wrap("simGetImages", [released]() -> int { released.wait(); return 1; });
+            std::vector<std::future<int>> pending;
+            for (size_t i = 0; i < pending_count; ++i)
+                pending.push_back(std::async(std::launch::async, render));
+            while (pools.getPendingCount(RpcDispatchClass::Heavy) < pending_count)
+                std::this_thread::yield();
+
+            //without a limit the extra call waits for the released ones, so it runs on its own thread
+            std::future<int> extra = std::async(std::launch::async, render);
+            auto query = pools.wrap("getValue", []() -> int { return 2; });
+            testAssert(query() == 2, "query did not run while heavy calls were pending");
+
+            std::string error;
+            if (!expected_error.empty()) {
+                try {
+                    extra.get();
+                }
+                catch (const std::runtime_error& ex) {
+                    error = ex.what();
+                }
+                testAssert(error.compare(0, expected_error.size(), expected_error) == 0, "heavy call beyond the pending limit was not rejected");
+            }
+            release.set_value();
+            for (auto& call : pending)
+                testAssert(call.get() == 1, "pending heavy call did not finish");
+            if (expected_error.empty())
+                testAssert(extra.get() == 1, "queued heavy call did not run");
+            testAssert(pools.getPendingCount(RpcDispatchClass::Heavy) == 0, "finished heavy calls are still pending");
+        }
+
+        //the positional encoding keeps every field and is smaller than the map encoding
+        void compactTest()
+        {
+            Kinematics::State kinematics = Kinematics::State::zero();
+            kinematics.pose = Pose(Vector3r(1, -2, 3), Quaternionr(0.5f, 0.5f, -0.5f, 0.5f));
+            kinematics.twist.linear = Vector3r(4, 5, 6);
+            kinematics.twist.angular = Vector3r(-0.1f, 0.2f, -0.3f);
+            kinematics.accelerations.linear = Vector3r(7, 8, 9);
+            kinematics.accelerations.angular = Vector3r(0.4f, -0.5f, 0.6f);
+            const Kinematics::State kinematics_result = roundTrip(RpcLibCompactAdaptors::KinematicsState(kinematics)).to();
+            testAssert(kinematics_result.pose.position == kinematics.pose.position, "compact kinematics position differs");
+            testAssert(kinematics_result.pose.orientation.coeffs() == kinematics.pose.orientation.coeffs(), "compact kinematics orientation differs");
+            testAssert(kinematics_result.twist.linear == kinematics.twist.linear && kinematics_result.twist.angular == kinematics.twist.angular,
+                       "compact kinematics twist differs");
+            testAssert(kinematics_result.accelerations.linear == kinematics.accelerations.linear &&
+                           kinematics_result.accelerations.angular == kinematics.accelerations.angular,
+                       "compact kinematics accelerations differ");
+            testAssert(packedSize(RpcLibCompactAdaptors::KinematicsState(kinematics)) < packedSize(RpcLibAdaptorsBase::KinematicsState(kinematics)),
+                       "compact kinematics is not smaller than the map encoding");
+
+            ImuBase::Output imu;
+            imu.time_stamp = 123456789012345ULL;
+            imu.orientation = kinematics.pose.orientation;
+            imu.angular_velocity = kinematics.twist.angular;
+            imu.linear_acceleration = kinematics.accelerations.linear;
+            const ImuBase::Output imu_result = roundTrip(RpcLibCompactAdaptors::ImuData(imu)).to();
+            testAssert(imu_result.time_stamp == imu.time_stamp, "compact IMU time stamp differs");
+            testAssert(imu_result.orientation.coeffs() == imu.orientation.coeffs(), "compact IMU orientation differs");
+            testAssert(imu_result.angular_velocity == imu.angular_velocity && imu_result.linear_acceleration == imu.linear_acceleration,
+                       "compact IMU rates differ");
+
+            LidarData lidar;
+            lidar.time_stamp = 42;
+            lidar.pose = kinematics.pose;
+            for (int i = 0; i < 300; ++i)
+                lidar.point_cloud.push_back(0.01f * i - 1);
+            lidar.segmentation.assign(100, 7);
+            const LidarData lidar_result = roundTrip(RpcLibCompactAdaptors::LidarData(lidar)).to();
+            testAssert(lidar_result.time_stamp == lidar.time_stamp && lidar_result.pose.position == lidar.pose.position, "compact lidar header differs");
+            testAssert(lidar_result.point_cloud == lidar.point_cloud, "compact lidar point cloud differs");
+            testAssert(lidar_result.segmentation == lidar.segmentation, "compact lidar segmentation differs");
+            testAssert(packedSize(RpcLibCompactAdaptors::LidarData(lidar)) < packedSize(RpcLibAdaptorsBase::LidarData(lidar)),
+                       "compact lidar is not smaller than the map encoding");
+
+            const std::vector<Vector3r> points = { Vector3r(1, 2, 3), Vector3r(-4, 5.5f, -6), Vector3r::Zero() };
+            testAssert(RpcLibCompactAdaptors::unpackPoints(roundTrip(RpcLibCompactAdaptors::packPoints(points))) == points, "packed points differ");
+            testAssert(RpcLibCompactAdaptors::unpackPoints(RpcLibCompactAdaptors::packPoints({})).empty(), "empty packed point list is not empty");
+
+            //partial values and points are rejected
+            bool threw = false;
+            try {
+                RpcLibCompactAdaptors::unpackValues<float>(std::vector<char>(5));
+            }
+            catch (const std::invalid_argument&) {
+                threw = true;
+            }
+            testAssert(threw, "packed values with a partial value were accepted");
+            threw = false;
+            try {
+                RpcLibCompactAdaptors::unpackPoints(RpcLibCompactAdaptors::packValues(std::vector<float>(4)));
+            }
+            catch (const std::invalid_argument&) {
+                threw = true;
+            }
+            testAssert(threw, "packed points with a partial point were accepted");
+        }
+
+        class TestLidar : public LidarBase
+        {
+        public:
+            using LidarBase::getPointRing;
+            virtual void resetImplementation() override {}
+        };
+
+        static void writeScan(LidarPointFrame& frame, TTimePoint time_stamp, size_t point_count)
+        {
+            frame.time_stamp = time_stamp;
+            frame.pose = Pose(Vector3r(1, 2, -3), Quaternionr(0.5f, -0.5f, 0.5f, 0.5f));
+            for (size_t i = 0; i < point_count; ++i)
+                frame.points.push_back(LidarPoint{ 0.5f * i, -0.25f * i, static_cast<float>(time_stamp), static_cast<int32_t>(i % 7) });
+        }
+
+        //the ring reuses the buffers nobody reads, the scans go over msgpack as one bin and LidarData is built once per scan
+        void lidarPointCloudTest()
+        {
+            TestLidar lidar;
+            LidarPointRing& ring = lidar.getPointRing();
+            testAssert(lidar.getPointFrame() == nullptr && lidar.getOutput().point_cloud.empty(), "lidar has a scan before the first commit");
+
+            //without readers the writer cycles through the buffers of the ring, which keep their capacity
+            std::vector<const LidarPointFrame*> buffers;
+            for (int i = 0; i < 6; ++i) {
+                LidarPointFrame& frame = ring.beginWrite();
+                testAssert(frame.points.empty() && (i < 3 || frame.points.capacity() >= 100), "reused buffer was not cleared or lost its capacity");
+                writeScan(frame, 100 + i, 100);
+                ring.commit();
+                buffers.push_back(&frame);
+            }
+            testAssert(buffers[3] == buffers[0] && buffers[4] == buffers[1] && buffers[5] == buffers[2] && buffers[0] != buffers[1] &&
+                           buffers[1] != buffers[2] && buffers[0] != buffers[2],
+                       "writer did not cycle through the buffers of the ring");
+
+            //a reader that holds on to every buffer makes the writer move on to a new one and keeps its scans as they were
+            std::vector<std::shared_ptr<const LidarPointFrame>> held = { ring.latest() };
+            for (int i = 0; i < 2; ++i) {
+                writeScan(ring.beginWrite(), 200 + i, 10);
+                ring.commit();
+                held.push_back(ring.latest());
+            }
+            LidarPointFrame& fresh = ring.beginWrite();
+            for (const auto& frame : held)
+                testAssert(&fresh != frame.get(), "writer reused a buffer a reader holds");
+            writeScan(fresh, 300, 5);
+            ring.commit();
+            testAssert(held[0]->time_stamp == 105 && held[0]->points.size() == 100 && held[1]->time_stamp == 200 && held[2]->time_stamp == 201,
+                       "scans held by a reader changed");
+            testAssert(ring.latest()->time_stamp == 300 && ring.latest()->sequence > held[2]->sequence, "new buffer was not published");
+
+            //LidarData of a scan is built on the first request only, changing the points in place afterwards does not show
+            const LidarData output = lidar.getOutput();
+            testAssert(output.time_stamp == 300 && output.point_cloud.size() == 15 && output.segmentation.size() == 5, "lidar output has the wrong size");
+            testAssert(output.point_cloud[3] == fresh.points[1].x && output.point_cloud[4] == fresh.points[1].y &&
+                           output.segmentation[4] == fresh.points[4].segmentation,
+                       "lidar output differs from the scan");
+            fresh.points[1].x = 1000;
+            testAssert(lidar.getOutput().point_cloud == output.point_cloud, "lidar output was built again for the same scan");
+            //the next scan goes into a buffer that held an earlier one and is built again
+            held.clear();
+            writeScan(ring.beginWrite(), 400, 3);
+            ring.commit();
+            testAssert(lidar.getOutput().time_stamp == 400 && lidar.getOutput().point_cloud.size() == 9, "lidar output was not built for the next scan");
+
+            //the points are unpacked as a view into the received buffer, which the handle keeps alive
+            const std::shared_ptr<const LidarPointFrame> frame = lidar.getPointFrame();
+            auto handle = std::make_shared<RPCLIB_MSGPACK::object_handle>();
+            {
+                RPCLIB_MSGPACK::sbuffer buffer;
+                RPCLIB_MSGPACK::pack(buffer, RpcLibAdaptorsBase::LidarPointCloud(frame));
+                *handle = RPCLIB_MSGPACK::unpack(buffer.data(), buffer.size());
+            }
+            const LidarPointCloud cloud = handle->get().as<RpcLibAdaptorsBase::LidarPointCloud>().to(handle);
+            handle.reset();
+            testAssert(cloud.time_stamp == frame->time_stamp && cloud.pose.position == frame->pose.position &&
+                           cloud.pose.orientation.coeffs() == frame->pose.orientation.coeffs(),
+                       "lidar point cloud header differs");
+            testAssert(cloud.size() == frame->points.size(), "lidar point cloud has the wrong number of points");
+            for (size_t i = 0; i < cloud.size(); ++i) {
+                const LidarPoint point = cloud.at(i);
+                testAssert(point.x == frame->points[i].x && point.y == frame->points[i].y && point.z == frame->points[i].z &&
+                               point.segmentation == frame->points[i].segmentation,
+                           "lidar point cloud point differs");
+            }
+
+            //a bin that does not match the point count is rejected
+            RPCLIB_MSGPACK::sbuffer buffer;
+            RPCLIB_MSGPACK::packer<RPCLIB_MSGPACK::sbuffer> packer(buffer);
+            packer.pack_array(4);
+            packer.pack(frame->time_stamp);
+            packer.pack(RpcLibAdaptorsBase::Pose(frame->pose));
+            packer.pack(static_cast<uint32_t>(frame->points.size() + 1));
+            packer.pack_bin(static_cast<uint32_t>(frame->points.size() * sizeof(LidarPoint)));
+            packer.pack_bin_body(reinterpret_cast<const char*>(frame->points.data()), static_cast<uint32_t>(frame->points.size() * sizeof(LidarPoint)));
+            bool threw = false;
+            try {
+                RPCLIB_MSGPACK::unpack(buffer.data(), buffer.size()).get().as<RpcLibAdaptorsBase::LidarPointCloud>();
+            }
+            catch (const RPCLIB_MSGPACK::type_error&) {
+                threw = true;
+            }
+            testAssert(threw, "lidar point cloud with a short bin was accepted");
+        }
+    };
+}
+}
+#endif
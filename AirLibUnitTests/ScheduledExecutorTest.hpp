@@ -0,0 +1,72 @@
+#ifndef msr_AirLibUnitTests_ScheduledExecutorTest_hpp
+#define msr_AirLibUnitTests_ScheduledExecutorTest_hpp
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "TestBase.hpp"
+#include "common/common_utils/ScheduledExecutor.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    //runs a short schedule with the Hybrid wait strategy and checks the timing stats it keeps
+    class ScheduledExecutorTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            using common_utils::ScheduledExecutor;
+
+            const uint64_t period_nanos = 2000000;
+            const unsigned int call_count = 200;
+            std::atomic<unsigned int> calls{ 0 };
+            ScheduledExecutor executor([&calls](uint64_t) {
+                ++calls;
+                return true;
+            },
+                                       period_nanos);
+            testAssert(executor.getWaitStrategy() == ScheduledExecutor::WaitStrategy::Spin, "executor does not spin by default");
+            executor.setWaitStrategy(ScheduledExecutor::WaitStrategy::Hybrid);
+            testAssert(executor.getWaitStrategy() == ScheduledExecutor::WaitStrategy::Hybrid, "executor did not switch to Hybrid");
+
+            executor.start();
+            const auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (calls < call_count && std::chrono::steady_clock::now() < timeout)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            executor.stop();
+            testAssert(calls >= call_count, "executor did not make the calls in time");
+
+            //every period after the first one that only starts the schedule is counted once, either as overrun or in a jitter bin
+            const ScheduledExecutor::TimingStats stats = executor.getTimingStats();
+            testAssert(stats.period_count >= calls && stats.period_count <= calls + 1, "executor counted the wrong number of periods");
+            uint64_t binned = 0;
+            for (uint64_t bin : stats.jitter_histogram)
+                binned += bin;
+            testAssert(binned + stats.overrun_count == stats.period_count, "jitter histogram does not add up to the periods");
+            testAssert(stats.overrun_count < stats.period_count / 10, "callback that returns at once overran its period");
+            testAssert(stats.sleep_time_avg > 0 && stats.sleep_time_avg <= period_nanos, "average sleep time is outside the period");
+
+            //the spin window absorbs the late wake ups of the OS sleep, a loaded machine may still
+            //delay some periods but not by several of them
+            const auto& edges = ScheduledExecutor::jitterBinEdgesNanos();
+            size_t last_bin = 0;
+            for (size_t bin = 0; bin < stats.jitter_histogram.size(); ++bin)
+                if (stats.jitter_histogram[bin] > 0)
+                    last_bin = bin;
+            testAssert(stats.max_jitter_nanos < 10 * period_nanos, "Hybrid wake up was late by several periods");
+            testAssert(last_bin == 0 || stats.max_jitter_nanos >= edges[last_bin - 1], "max jitter is below the bin of the latest wake up");
+            testAssert(last_bin == edges.size() || stats.max_jitter_nanos < edges[last_bin], "max jitter is above the bin of the latest wake up");
+
+            executor.resetTimingStats();
+            const ScheduledExecutor::TimingStats reset_stats = executor.getTimingStats();
+            testAssert(reset_stats.period_count == 0 && reset_stats.overrun_count == 0 && reset_stats.max_jitter_nanos == 0 &&
+                           reset_stats.jitter_histogram[0] == 0,
+                       "timing stats were not reset");
+        }
+    };
+}
+}
+#endif
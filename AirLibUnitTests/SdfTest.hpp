@@ -0,0 +1,338 @@
+#ifndef msr_AirLibUnitTests_SdfTest_hpp
+#define msr_AirLibUnitTests_SdfTest_hpp
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "TestBase.hpp"
+#include "sdf_tools/sdf_generation.hpp"
+#include "sdf_tools/sparse_sdf.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    class SdfTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            edtTest();
+            fileRoundTripTest();
+            packBitsTest();
+            sparseTest();
+            batchQueryTest();
+            occupancyTest();
+        }
+
+    private:
+        static constexpr int64_t kCells = 12;
+        static constexpr double kResolution = 0.25;
+
+        //random occupancy with about fill_ratio of the cells filled
+        static std::vector<uint8_t> makeOccupancy(double fill_ratio, unsigned int seed)
+        {
+            std::mt19937 rng(seed);
+            std::bernoulli_distribution is_filled(fill_ratio);
+            std::vector<uint8_t> occupancy(kCells * kCells * kCells);
+            for (auto& cell : occupancy)
+                cell = is_filled(rng) ? 1 : 0;
+            return occupancy;
+        }
+
+        static sdf_tools::SignedDistanceField generate(const std::vector<uint8_t>& occupancy, sdf_generation::GENERATION_BACKEND backend)
+        {
+            const std::function<bool(const VoxelGrid::GRID_INDEX&)> is_filled_fn = [&](const VoxelGrid::GRID_INDEX& index) {
+                return occupancy[(index.x * kCells + index.y) * kCells + index.z] != 0;
+            };
+            return sdf_generation::ExtractSignedDistanceField<uint8_t>(Eigen::Isometry3d::Identity(), kResolution, kCells, kCells, kCells,
+                                                                       is_filled_fn, std::numeric_limits<float>::infinity(), "world", backend)
+                .first;
+        }
+
+        //distance to the closest filled cell minus distance to the closest free cell, by trying all of them
+        static double bruteForceDistance(const std::vector<uint8_t>& occupancy, int64_t x, int64_t y, int64_t z)
+        {
+            double filled_square = std::numeric_limits<double>::infinity(), free_square = filled_square;
+            for (int64_t i = 0; i < kCells; ++i)
+                for (int64_t j = 0; j < kCells; ++j)
+                    for (int64_t k = 0; k < kCells; ++k) {
+                        const double square = static_cast<double>((i - x) * (i - x) + (j - y) * (j - y) + (k - z) * (k - z));
+                        double& closest = occupancy[(i * kCells + j) * kCells + k] ? filled_square : free_square;
+                        closest = std::min(closest, square);
+                    }
+            return (std::sqrt(filled_square) - std::sqrt(free_square)) * kResolution;
+        }
+
+        //the EDT backend is exact, the bucket queue may overestimate by a fraction of a cell
+        void edtTest()
+        {
+            const std::vector<uint8_t> occupancy = makeOccupancy(0.1, 6);
+            const auto edt = generate(occupancy, sdf_generation::PARALLEL_EDT);
+            const auto bucket_queue = generate(occupancy, sdf_generation::BUCKET_QUEUE);
+
+            for (int64_t x = 0; x < kCells; ++x)
+                for (int64_t y = 0; y < kCells; ++y)
+                    for (int64_t z = 0; z < kCells; ++z) {
+                        const double expected = bruteForceDistance(occupancy, x, y, z);
+                        const double edt_value = edt.GetImmutable(x, y, z).first;
+                        const double bucket_queue_value = bucket_queue.GetImmutable(x, y, z).first;
+                        testAssert(std::fabs(edt_value - expected) < 1E-5, "EDT distance is not exact");
+                        testAssert(std::fabs(bucket_queue_value) >= std::fabs(edt_value) - 1E-5, "bucket queue distance is below EDT distance");
+                        testAssert(std::fabs(bucket_queue_value - edt_value) < 0.5 * kResolution, "bucket queue distance is far from EDT distance");
+                    }
+        }
+
+        static bool sameCells(const sdf_tools::SignedDistanceField& expected, const sdf_tools::SignedDistanceField& actual)
+        {
+            if (expected.GetNumXCells() != actual.GetNumXCells() || expected.GetNumYCells() != actual.GetNumYCells() ||
+                expected.GetNumZCells() != actual.GetNumZCells() || expected.GetResolution() != actual.GetResolution() ||
+                expected.GetOOBValue() != actual.GetOOBValue() || expected.GetFrame() != actual.GetFrame())
+                return false;
+            for (int64_t x = 0; x < expected.GetNumXCells(); ++x)
+                for (int64_t y = 0; y < expected.GetNumYCells(); ++y)
+                    for (int64_t z = 0; z < expected.GetNumZCells(); ++z)
+                        if (expected.GetImmutable(x, y, z).first != actual.GetImmutable(x, y, z).first)
+                            return false;
+            return true;
+        }
+
+        //saves in the mappable and the compressed format and loads mapped and read back
+        void fileRoundTripTest()
+        {
+            const auto sdf = generate(makeOccupancy(0.1, 8), sdf_generation::PARALLEL_EDT);
+            const std::string filepath = "SdfTest.sdfm";
+
+            sdf_tools::SignedDistanceField::SaveToFile(sdf, filepath, false);
+            {
+                auto mapped = sdf_tools::SignedDistanceField::LoadFromFile(filepath, true);
+                testAssert(mapped.IsMapped(), "uncompressed file is not mapped");
+                testAssert(sameCells(sdf, mapped), "mapped SDF differs");
+
+                //moves keep the mapping and leave the source empty
+                auto moved = std::move(mapped);
+                testAssert(moved.IsMapped() && sameCells(sdf, moved), "moved mapped SDF differs");
+                testAssert(!mapped.IsMapped() && mapped.GetImmutableRawData().empty(), "moved from SDF is not empty");
+
+                //writes go to private pages and do not reach the file
+                testAssert(moved.SetValue(int64_t(0), int64_t(0), int64_t(0), 123.0f), "could not write mapped SDF");
+                testAssert(moved.GetImmutable(int64_t(0), int64_t(0), int64_t(0)).first == 123.0f, "write to mapped SDF was lost");
+
+                const auto read = sdf_tools::SignedDistanceField::LoadFromFile(filepath, false);
+                testAssert(!read.IsMapped() && sameCells(sdf, read), "write to mapped SDF reached the file");
+            }
+
+            sdf_tools::SignedDistanceField::SaveToFile(sdf, filepath, true);
+            const auto decompressed = sdf_tools::SignedDistanceField::LoadFromFile(filepath, true);
+            testAssert(!decompressed.IsMapped() && sameCells(sdf, decompressed), "compressed SDF differs");
+            std::remove(filepath.c_str());
+        }
+
+        //compressed blocks mixing runs longer than 128 bytes, noise and short alternations
+        void packBitsTest()
+        {
+            const int64_t cells = 40;
+            sdf_tools::SignedDistanceField sdf(Eigen::Isometry3d::Identity(), "world", kResolution, cells, cells, cells, 1.0f);
+            std::mt19937 rng(9);
+            std::uniform_real_distribution<float> noise(-5.0f, 5.0f);
+            for (int64_t x = 0; x < cells; ++x)
+                for (int64_t y = 0; y < cells; ++y)
+                    for (int64_t z = 0; z < cells; ++z) {
+                        float value = 2.5f;
+                        if (x < 4)
+                            value = noise(rng);
+                        else if (x < 8)
+                            value = (z % 2 == 0) ? 0.25f : -0.25f;
+                        else if (x < 12)
+                            value = static_cast<float>(z / 3) * kResolution;
+                        sdf.SetValue(x, y, z, value);
+                    }
+
+            const std::string filepath = "SdfPackBitsTest.sdfm";
+            sdf_tools::SignedDistanceField::SaveToFile(sdf, filepath, true);
+            const auto decompressed = sdf_tools::SignedDistanceField::LoadFromFile(filepath, true);
+            testAssert(sameCells(sdf, decompressed), "PackBits compressed SDF differs");
+
+            //a block of pure noise does not compress and is stored
+            for (int64_t x = 0; x < cells; ++x)
+                for (int64_t y = 0; y < cells; ++y)
+                    for (int64_t z = 0; z < cells; ++z)
+                        sdf.SetValue(x, y, z, noise(rng));
+            sdf_tools::SignedDistanceField::SaveToFile(sdf, filepath, true);
+            testAssert(sameCells(sdf, sdf_tools::SignedDistanceField::LoadFromFile(filepath, true)), "stored block SDF differs");
+            std::remove(filepath.c_str());
+        }
+
+        //within the truncation distance the sparse SDF answers like the dense one, beyond it only the sign is kept
+        void sparseTest()
+        {
+            const double size = 12, resolution = 0.25, truncation = 1.0;
+            const int64_t cells = static_cast<int64_t>(size / resolution);
+            const sdf_generation::FunctionOccupancyProvider provider([](const Eigen::Vector3d& location) {
+                const bool in_sphere = (location - Eigen::Vector3d(4, 4, 5)).norm() < 2;
+                const bool in_box = location.x() > 7 && location.x() < 10 && location.y() > 6 && location.y() < 11 && location.z() < 3;
+                return in_sphere || in_box;
+            });
+            const auto dense = sdf_generation::ExtractSignedDistanceField(Eigen::Isometry3d::Identity(), resolution, cells, cells, cells, provider,
+                                                                          std::numeric_limits<float>::infinity(), "world", sdf_generation::PARALLEL_EDT)
+                                   .first;
+
+            //small chunks and tiles so that the field is built from several tiles
+            sdf_tools::SparseSignedDistanceField sparse(Eigen::Isometry3d::Identity(), "world", resolution, size, size, size, truncation,
+                                                        std::numeric_limits<float>::infinity(), 8);
+            sparse.Build(provider, 2);
+            testAssert(sparse.GetNumCellChunks() > 0 && sparse.GetNumCellChunks() < 6 * 6 * 6, "sparse SDF does not skip far chunks");
+
+            std::mt19937 rng(10);
+            std::uniform_real_distribution<double> coordinate(0, size);
+            int near_count = 0;
+            for (int i = 0; i < 2000; ++i) {
+                const Eigen::Vector3d location(coordinate(rng), coordinate(rng), coordinate(rng));
+                const double dense_distance = dense.EstimateDistance3d(location).first;
+                const std::pair<double, bool> sparse_distance = sparse.EstimateDistance3d(location);
+                testAssert(sparse_distance.second, "sparse SDF query is out of bounds");
+                testAssert((sparse_distance.first < 0) == (dense_distance < 0), "sparse SDF sign differs");
+                if (std::fabs(dense_distance) < truncation - 2 * resolution) {
+                    ++near_count;
+                    testAssert(std::fabs(sparse_distance.first - dense_distance) < 1E-5, "sparse SDF distance differs near a surface");
+                    const std::vector<double> dense_gradient = dense.GetAutoDiffGradient3d(location);
+                    const std::vector<double> sparse_gradient = sparse.GetAutoDiffGradient3d(location);
+                    testAssert(sparse_gradient.size() == 3 && dense_gradient.size() == 3, "SDF gradient is missing");
+                    for (size_t axis = 0; axis < 3; ++axis)
+                        testAssert(std::fabs(sparse_gradient[axis] - dense_gradient[axis]) < 1E-4, "sparse SDF gradient differs near a surface");
+                }
+                else
+                    testAssert(std::fabs(sparse_distance.first) <= truncation + 1E-5, "sparse SDF distance exceeds the truncation distance");
+            }
+            testAssert(near_count > 50, "too few sparse SDF samples near a surface");
+            testAssert(!sparse.EstimateDistance3d(Eigen::Vector3d(-1, 0, 0)).second, "sparse SDF query outside the grid is in bounds");
+        }
+
+        //batched distances and gradients match the per point queries, over several blocks, in a rotated grid and out of bounds
+        void batchQueryTest()
+        {
+            const std::vector<uint8_t> occupancy = makeOccupancy(0.05, 11);
+            const std::function<bool(const VoxelGrid::GRID_INDEX&)> is_filled_fn = [&](const VoxelGrid::GRID_INDEX& index) {
+                return occupancy[(index.x * kCells + index.y) * kCells + index.z] != 0;
+            };
+            const Eigen::Isometry3d origin = Eigen::Translation3d(1, -2, 0.5) * Eigen::AngleAxisd(0.4, Eigen::Vector3d(1, 2, 3).normalized());
+            const auto sdf = sdf_generation::ExtractSignedDistanceField<uint8_t>(origin, kResolution, kCells, kCells, kCells, is_filled_fn, 100.0f,
+                                                                                 "world", sdf_generation::PARALLEL_EDT)
+                                 .first;
+
+            //some points fall outside the rotated grid
+            std::mt19937 rng(12);
+            std::uniform_real_distribution<double> coordinate(-0.5, kCells * kResolution + 0.5);
+            const size_t count = 700;
+            std::vector<double> points(3 * count);
+            for (size_t i = 0; i < count; ++i) {
+                const Eigen::Vector3d location = origin * Eigen::Vector3d(coordinate(rng), coordinate(rng), coordinate(rng));
+                for (int axis = 0; axis < 3; ++axis)
+                    points[3 * i + axis] = location(axis);
+            }
+
+            std::vector<double> distances, distances_only, gradients;
+            const size_t num_in_bounds = sdf.EstimateDistancesAndGradientsBatch3d(points, distances, gradients);
+            testAssert(sdf.EstimateDistancesBatch3d(points, distances_only) == num_in_bounds, "batch in bounds counts differ");
+            testAssert(distances.size() == count && gradients.size() == 3 * count, "batch results have the wrong size");
+
+            size_t expected_in_bounds = 0;
+            for (size_t i = 0; i < count; ++i) {
+                const Eigen::Vector3d location(points[3 * i], points[3 * i + 1], points[3 * i + 2]);
+                const std::pair<double, bool> expected = sdf.EstimateDistance3d(location);
+                testAssert(std::fabs(distances[i] - expected.first) < 1E-6, "batch distance differs");
+                testAssert(distances_only[i] == distances[i], "batch distance without gradients differs");
+                const std::vector<double> expected_gradient = sdf.GetAutoDiffGradient3d(location);
+                if (expected.second) {
+                    ++expected_in_bounds;
+                    testAssert(expected_gradient.size() == 3, "per point gradient is missing");
+                    for (size_t axis = 0; axis < 3; ++axis)
+                        testAssert(std::fabs(gradients[3 * i + axis] - expected_gradient[axis]) < 1E-6, "batch gradient differs");
+                }
+                else
+                    testAssert(gradients[3 * i] == 0 && gradients[3 * i + 1] == 0 && gradients[3 * i + 2] == 0, "out of bounds batch gradient is not zero");
+            }
+            testAssert(num_in_bounds == expected_in_bounds && num_in_bounds < count && num_in_bounds > count / 2, "batch in bounds count is wrong");
+        }
+
+        //answers every slab with one bit too few
+        class ShortSlabProvider : public sdf_generation::OccupancyProvider
+        {
+        public:
+            explicit ShortSlabProvider(bool thread_safe)
+                : thread_safe_(thread_safe)
+            {
+            }
+
+            virtual void QuerySlab(const EigenHelpers::VectorVector3d& cell_centers, sdf_generation::OccupancyBitmask& filled) const override
+            {
+                filled.Reset(cell_centers.size() - 1);
+            }
+
+            virtual bool IsThreadSafe() const override
+            {
+                return thread_safe_;
+            }
+
+        private:
+            bool thread_safe_;
+        };
+
+        //bits across word boundaries, slabs gathered into x-major occupancy serially and from OpenMP threads, and slabs of the wrong size
+        void occupancyTest()
+        {
+            sdf_generation::OccupancyBitmask bitmask;
+            bitmask.Reset(130);
+            testAssert(bitmask.Size() == 130 && bitmask.Words().size() == 3, "bitmask has the wrong size");
+            for (size_t bit : { 0, 63, 64, 129 })
+                bitmask.Set(bit, true);
+            bitmask.Set(63, false);
+            for (size_t bit = 0; bit < bitmask.Size(); ++bit)
+                testAssert(bitmask.Get(bit) == (bit == 0 || bit == 64 || bit == 129), "bitmask bit is wrong");
+            bitmask.Reset(64);
+            testAssert(bitmask.Size() == 64 && bitmask.Words().size() == 1 && bitmask.Words()[0] == 0, "reset bitmask kept bits");
+
+            //a grid that is not a cube and is rotated, so that swapped axes or a missing transform show
+            const int64_t x_cells = 5, y_cells = 7, z_cells = 9;
+            const Eigen::Isometry3d origin = Eigen::Translation3d(-1, 2, 0.5) * Eigen::AngleAxisd(0.7, Eigen::Vector3d(1, -1, 2).normalized());
+            const std::function<bool(const Eigen::Vector3d&)> is_filled_fn = [](const Eigen::Vector3d& location) {
+                return std::sin(3 * location.x()) + std::cos(2 * location.y()) * location.z() > 0.3;
+            };
+            for (bool thread_safe : { false, true }) {
+                const std::vector<uint8_t> occupancy = sdf_generation::ComputeOccupancy(origin, kResolution, x_cells, y_cells, z_cells,
+                                                                                        sdf_generation::FunctionOccupancyProvider(is_filled_fn, thread_safe));
+                testAssert(occupancy.size() == static_cast<size_t>(x_cells * y_cells * z_cells), "occupancy has the wrong size");
+                size_t filled_count = 0;
+                for (int64_t x = 0; x < x_cells; ++x)
+                    for (int64_t y = 0; y < y_cells; ++y)
+                        for (int64_t z = 0; z < z_cells; ++z) {
+                            const Eigen::Vector3d center = origin * (Eigen::Vector3d(x + 0.5, y + 0.5, z + 0.5) * kResolution);
+                            const uint8_t cell = occupancy[(x * y_cells + y) * z_cells + z];
+                            testAssert(cell == (is_filled_fn(center) ? 1 : 0), "occupancy of a cell differs from the provider");
+                            filled_count += cell;
+                        }
+                testAssert(filled_count > 0 && filled_count < occupancy.size(), "occupancy does not mix filled and free cells");
+            }
+
+            //the error of a bad slab is raised after the OpenMP region, from serial and parallel queries alike
+            for (bool thread_safe : { false, true }) {
+                bool threw = false;
+                try {
+                    sdf_generation::ExtractSignedDistanceField(origin, kResolution, x_cells, y_cells, z_cells, ShortSlabProvider(thread_safe),
+                                                               std::numeric_limits<float>::infinity(), "world");
+                }
+                catch (const std::invalid_argument&) {
+                    threw = true;
+                }
+                testAssert(threw, "slab of the wrong size was accepted");
+            }
+        }
+    };
+}
+}
+#endif
@@ -0,0 +1,334 @@
+#ifndef msr_AirLibUnitTests_TelemetryTest_hpp
+#define msr_AirLibUnitTests_TelemetryTest_hpp
+
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "TestBase.hpp"
+#include "api/TelemetryPublisher.hpp"
+#include "common/SteppableClock.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    //encodes and decodes every telemetry channel, and checks how TelemetryPublisher paces, bounds and hands over what it samples
+    class TelemetryTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            roundTripTest();
+            rateLimitTest();
+            bufferLimitTest();
+            unknownSubscriptionTest();
+        }
+
+    private:
+        class FakeImu : public ImuBase
+        {
+        public:
+            using ImuBase::setOutput;
+            virtual void resetImplementation() override {}
+        };
+
+        class FakeBarometer : public BarometerBase
+        {
+        public:
+            using BarometerBase::setOutput;
+            virtual void resetImplementation() override {}
+        };
+
+        //a vehicle with nothing but an IMU and a barometer whose outputs the test sets
+        class SensorApi : public VehicleApiBase
+        {
+        public:
+            SensorApi()
+            {
+                sensors_.insert(&imu, SensorBase::SensorType::Imu);
+                sensors_.insert(&barometer, SensorBase::SensorType::Barometer);
+            }
+
+            virtual const SensorCollection& getSensors() const override
+            {
+                return sensors_;
+            }
+
+            virtual void resetImplementation() override {}
+            virtual void enableApiControl(bool) override {}
+            virtual bool isApiControlEnabled() const override
+            {
+                return true;
+            }
+            virtual bool armDisarm(bool) override
+            {
+                return true;
+            }
+            virtual GeoPoint getHomeGeoPoint() const override
+            {
+                return GeoPoint();
+            }
+
+            FakeImu imu;
+            FakeBarometer barometer;
+
+        private:
+            SensorCollection sensors_;
+        };
+
+        class Recorder : public TelemetryStream::Handler
+        {
+        public:
+            virtual void onImu(uint vehicle_index, const ImuBase::Output& output) override
+            {
+                imu_vehicles.push_back(vehicle_index);
+                imu.push_back(output);
+            }
+            virtual void onGps(uint vehicle_index, const GpsBase::Output& output) override
+            {
+                gps_vehicles.push_back(vehicle_index);
+                gps.push_back(output);
+            }
+            virtual void onBarometer(uint vehicle_index, const BarometerBase::Output& output) override
+            {
+                barometer_vehicles.push_back(vehicle_index);
+                barometer.push_back(output);
+            }
+            virtual void onMagnetometer(uint vehicle_index, const MagnetometerBase::Output& output) override
+            {
+                magnetometer_vehicles.push_back(vehicle_index);
+                magnetometer.push_back(output);
+            }
+            virtual void onKinematics(uint vehicle_index, TTimePoint time_stamp, const Kinematics::State& state) override
+            {
+                kinematics_vehicles.push_back(vehicle_index);
+                kinematics_times.push_back(time_stamp);
+                kinematics.push_back(state);
+            }
+
+            std::vector<uint> imu_vehicles, gps_vehicles, barometer_vehicles, magnetometer_vehicles, kinematics_vehicles;
+            std::vector<ImuBase::Output> imu;
+            std::vector<GpsBase::Output> gps;
+            std::vector<BarometerBase::Output> barometer;
+            std::vector<MagnetometerBase::Output> magnetometer;
+            std::vector<TTimePoint> kinematics_times;
+            std::vector<Kinematics::State> kinematics;
+        };
+
+        template <typename T>
+        static T readHeader(const std::vector<uint8_t>& batch, size_t offset)
+        {
+            T value;
+            std::memcpy(&value, batch.data() + offset, sizeof(T));
+            return value;
+        }
+
+        //values that floats hold exactly, so that every field must come back as it went in
+        void roundTripTest()
+        {
+            ImuBase::Output imu;
+            imu.time_stamp = 1000;
+            imu.orientation = Quaternionr(0.5f, -0.5f, 0.5f, -0.5f);
+            imu.angular_velocity = Vector3r(0.25f, -1.5f, 2);
+            imu.linear_acceleration = Vector3r(0.125f, 9.75f, -3);
+
+            GpsBase::Output gps;
+            gps.time_stamp = 2000;
+            gps.gnss.geo_point = GeoPoint(47.641468, -122.140165, 122.5f);
+            gps.gnss.eph = 0.75f;
+            gps.gnss.epv = 1.25f;
+            gps.gnss.velocity = Vector3r(1, -2, 0.5f);
+            gps.gnss.time_utc = 1234567890123ULL;
+            gps.gnss.fix_type = GpsBase::GnssFixType::GNSS_FIX_3D_FIX;
+            gps.is_valid = true;
+
+            BarometerBase::Output barometer;
+            barometer.time_stamp = 3000;
+            barometer.altitude = 121.5f;
+            barometer.pressure = 101325;
+            barometer.qnh = 1013.25f;
+
+            MagnetometerBase::Output magnetometer;
+            magnetometer.time_stamp = 4000;
+            magnetometer.magnetic_field_body = Vector3r(0.25f, -0.125f, 0.5f);
+
+            Kinematics::State kinematics = Kinematics::State::zero();
+            kinematics.pose.position = Vector3r(1, 2, -3);
+            kinematics.pose.orientation = Quaternionr(0.5f, 0.5f, 0.5f, 0.5f);
+            kinematics.twist.linear = Vector3r(0.5f, 0, -1);
+            kinematics.twist.angular = Vector3r(0, 0.25f, 0);
+            kinematics.accelerations.linear = Vector3r(-0.5f, 1, 9.5f);
+            kinematics.accelerations.angular = Vector3r(0.125f, 0, -0.25f);
+
+            std::vector<uint8_t> batch;
+            TelemetryStream::beginBatch(batch);
+            TelemetryStream::encodeImu(batch, 0, imu);
+            TelemetryStream::encodeGps(batch, 1, gps);
+            TelemetryStream::encodeBarometer(batch, 2, barometer);
+            //a frame from a newer server is skipped by its size
+            const size_t unknown = batch.size();
+            batch.resize(unknown + TelemetryStream::kFrameHeaderBytes + 5, 0);
+            batch[unknown] = 99;
+            const uint16_t unknown_bytes = 5;
+            std::memcpy(batch.data() + unknown + 2, &unknown_bytes, sizeof(unknown_bytes));
+            TelemetryStream::encodeMagnetometer(batch, 3, magnetometer);
+            TelemetryStream::encodeKinematics(batch, 255, 5000, kinematics);
+            TelemetryStream::endBatch(batch, 6, 7);
+
+            testAssert(readHeader<uint16_t>(batch, 0) == TelemetryStream::kVersion, "batch header has the wrong version");
+            testAssert(readHeader<uint32_t>(batch, 4) == 6, "batch header has the wrong frame count");
+            testAssert(readHeader<uint64_t>(batch, 8) == 7, "batch header has the wrong dropped frame count");
+
+            Recorder recorder;
+            testAssert(TelemetryStream::decode(batch, recorder) == 7, "decode did not return the dropped frame count");
+
+            testAssert(recorder.imu.size() == 1 && recorder.imu_vehicles[0] == 0, "IMU frame was not decoded once");
+            testAssert(recorder.imu[0].time_stamp == imu.time_stamp && recorder.imu[0].orientation.coeffs() == imu.orientation.coeffs() &&
+                           recorder.imu[0].angular_velocity == imu.angular_velocity && recorder.imu[0].linear_acceleration == imu.linear_acceleration,
+                       "IMU frame differs after the round trip");
+
+            testAssert(recorder.gps.size() == 1 && recorder.gps_vehicles[0] == 1, "GPS frame was not decoded once");
+            const GpsBase::Output& decoded_gps = recorder.gps[0];
+            testAssert(decoded_gps.time_stamp == gps.time_stamp && decoded_gps.gnss.geo_point.latitude == gps.gnss.geo_point.latitude &&
+                           decoded_gps.gnss.geo_point.longitude == gps.gnss.geo_point.longitude &&
+                           decoded_gps.gnss.geo_point.altitude == gps.gnss.geo_point.altitude && decoded_gps.gnss.eph == gps.gnss.eph &&
+                           decoded_gps.gnss.epv == gps.gnss.epv && decoded_gps.gnss.velocity == gps.gnss.velocity &&
+                           decoded_gps.gnss.time_utc == gps.gnss.time_utc && decoded_gps.gnss.fix_type == gps.gnss.fix_type && decoded_gps.is_valid,
+                       "GPS frame differs after the round trip");
+
+            testAssert(recorder.barometer.size() == 1 && recorder.barometer_vehicles[0] == 2, "barometer frame was not decoded once");
+            testAssert(recorder.barometer[0].time_stamp == barometer.time_stamp && recorder.barometer[0].altitude == barometer.altitude &&
+                           recorder.barometer[0].pressure == barometer.pressure && recorder.barometer[0].qnh == barometer.qnh,
+                       "barometer frame differs after the round trip");
+
+            testAssert(recorder.magnetometer.size() == 1 && recorder.magnetometer_vehicles[0] == 3, "magnetometer frame was not decoded once");
+            testAssert(recorder.magnetometer[0].time_stamp == magnetometer.time_stamp &&
+                           recorder.magnetometer[0].magnetic_field_body == magnetometer.magnetic_field_body,
+                       "magnetometer frame differs after the round trip");
+
+            testAssert(recorder.kinematics.size() == 1 && recorder.kinematics_vehicles[0] == 255 && recorder.kinematics_times[0] == 5000,
+                       "kinematics frame was not decoded once");
+            const Kinematics::State& decoded_kinematics = recorder.kinematics[0];
+            testAssert(decoded_kinematics.pose.position == kinematics.pose.position &&
+                           decoded_kinematics.pose.orientation.coeffs() == kinematics.pose.orientation.coeffs() &&
+                           decoded_kinematics.twist.linear == kinematics.twist.linear && decoded_kinematics.twist.angular == kinematics.twist.angular &&
+                           decoded_kinematics.accelerations.linear == kinematics.accelerations.linear &&
+                           decoded_kinematics.accelerations.angular == kinematics.accelerations.angular,
+                       "kinematics frame differs after the round trip");
+
+            batch.pop_back();
+            bool truncated_threw = false;
+            try {
+                TelemetryStream::decode(batch, recorder);
+            }
+            catch (const std::invalid_argument&) {
+                truncated_threw = true;
+            }
+            testAssert(truncated_threw, "truncated batch was decoded");
+        }
+
+        //a publisher stepped on its own clock, with the IMU time stamped like the tick that samples it
+        struct SteppedPublisher
+        {
+            std::shared_ptr<SteppableClock> clock = std::make_shared<SteppableClock>(1E-3f, 1000000000);
+            TelemetryPublisher publisher;
+            SensorApi api;
+
+            SteppedPublisher()
+            {
+                publisher.setClock(clock);
+                publisher.reset();
+            }
+
+            int subscribe(float rate_hz, size_t max_buffered_bytes = 4 * 1024 * 1024)
+            {
+                TelemetryPublisher::Source source;
+                source.api = &api;
+                return publisher.subscribe({ source }, static_cast<uint32_t>(TelemetryStream::Channel::Imu), rate_hz, max_buffered_bytes);
+            }
+
+            void tick()
+            {
+                ImuBase::Output imu = ImuBase::Output();
+                imu.orientation = Quaternionr::Identity();
+                imu.time_stamp = clock->nowNanos();
+                api.imu.setOutput(imu);
+                publisher.update();
+                clock->step();
+            }
+
+            uint64_t read(int id, Recorder& recorder, uint32_t& frame_count)
+            {
+                std::vector<uint8_t> batch;
+                publisher.read(id, 0, batch);
+                frame_count = readHeader<uint32_t>(batch, 4);
+                return TelemetryStream::decode(batch, recorder);
+            }
+        };
+
+        void rateLimitTest()
+        {
+            SteppedPublisher stepped;
+            const int id = stepped.subscribe(100);
+            for (int i = 0; i < 100; ++i)
+                stepped.tick();
+
+            Recorder recorder;
+            uint32_t frame_count;
+            testAssert(stepped.read(id, recorder, frame_count) == 0, "frames were dropped below the buffer limit");
+            testAssert(frame_count == 10 && recorder.imu.size() == 10, "100 Hz subscription did not take 10 samples in 100 ms");
+            for (size_t i = 1; i < recorder.imu.size(); ++i)
+                testAssert(recorder.imu[i].time_stamp - recorder.imu[i - 1].time_stamp == 10000000, "100 Hz subscription was not sampled every 10 ms");
+
+            //after a stall sampling resumes at the requested rate instead of catching up
+            for (int i = 0; i < 50; ++i)
+                stepped.clock->step();
+            stepped.tick();
+            stepped.tick();
+            Recorder after_stall;
+            stepped.read(id, after_stall, frame_count);
+            testAssert(frame_count == 1 && after_stall.imu.size() == 1, "subscription caught up on the samples it missed during a stall");
+        }
+
+        void bufferLimitTest()
+        {
+            SteppedPublisher stepped;
+            //room for two IMU frames after the batch header
+            const size_t imu_frame_bytes = TelemetryStream::kFrameHeaderBytes + 10 * sizeof(float);
+            const int id = stepped.subscribe(1000, TelemetryStream::kBatchHeaderBytes + 2 * imu_frame_bytes);
+            for (int i = 0; i < 5; ++i)
+                stepped.tick();
+
+            Recorder recorder;
+            uint32_t frame_count;
+            testAssert(stepped.read(id, recorder, frame_count) == 3, "frames over the buffer limit were not counted as dropped");
+            testAssert(frame_count == 2 && recorder.imu.size() == 2, "buffer did not keep the frames up to its limit");
+
+            //the counts start over with the next batch
+            stepped.tick();
+            Recorder next;
+            testAssert(stepped.read(id, next, frame_count) == 0 && frame_count == 1 && next.imu.size() == 1, "batch after a drain did not start over");
+        }
+
+        void unknownSubscriptionTest()
+        {
+            SteppedPublisher stepped;
+            const int id = stepped.subscribe(100);
+            stepped.publisher.unsubscribe(id);
+            for (int unknown_id : { id, id + 100 }) {
+                bool threw = false;
+                try {
+                    std::vector<uint8_t> batch;
+                    stepped.publisher.read(unknown_id, 0, batch);
+                }
+                catch (const std::invalid_argument&) {
+                    threw = true;
+                }
+                testAssert(threw, "read of an unknown subscription did not throw");
+            }
+        }
+    };
+}
+}
+#endif
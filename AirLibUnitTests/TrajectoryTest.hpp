@@ -0,0 +1,414 @@
+#ifndef msr_AirLibUnitTests_TrajectoryTest_hpp
+#define msr_AirLibUnitTests_TrajectoryTest_hpp
+
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+#include "TestBase.hpp"
+#include "common/SteppableClock.hpp"
+#include "mav_trajectory_generation/polynomial_evaluator.h"
+#include "mav_trajectory_generation/polynomial_optimization_linear.h"
+#include "mav_trajectory_generation/test_utils.h"
+#include "mav_trajectory_generation/trajectory_evaluator.h"
+#include "sdf_tools/sdf_generation.hpp"
+#include "vehicles/multirotor/api/MultirotorApiBase.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    //checks the faster trajectory evaluation paths against the plain per segment ones
+    class TrajectoryTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            std::srand(42);
+            evaluatorTest();
+            segmentEvaluatorTest();
+            linearSolverTest();
+            splineCandidatesTest();
+            replanTest();
+        }
+
+    private:
+        typedef mav_trajectory_generation::Trajectory Trajectory;
+
+        static Trajectory makeRandomTrajectory(int segment_count, int n, int d)
+        {
+            mav_trajectory_generation::Segment::Vector segments;
+            for (int k = 0; k < segment_count; ++k) {
+                mav_trajectory_generation::Segment segment(n, d);
+                for (int i = 0; i < d; ++i)
+                    segment[i].setCoefficients(Eigen::VectorXd::Random(n));
+                segment.setTime(mav_trajectory_generation::createRandomDouble(0.3, 2.0));
+                segments.push_back(segment);
+            }
+            Trajectory trajectory;
+            trajectory.setSegments(segments);
+            return trajectory;
+        }
+
+        static bool isClose(const Eigen::VectorXd& expected, const Eigen::VectorXd& actual)
+        {
+            return expected.size() == actual.size() && (expected - actual).norm() <= 1E-9 * (1 + expected.norm());
+        }
+
+        //TrajectoryEvaluator against Trajectory::evaluate, stepping forward like the tracker, on vertices and jumping around
+        void evaluatorTest()
+        {
+            const Trajectory trajectory = makeRandomTrajectory(12, 10, 3);
+            const mav_trajectory_generation::TrajectoryEvaluator evaluator(trajectory);
+            const double max_time = trajectory.getMaxTime();
+
+            std::vector<double> vertex_times(1, 0.0);
+            for (const auto& segment : trajectory.segments())
+                vertex_times.push_back(vertex_times.back() + segment.getTime());
+
+            std::vector<double> times;
+            for (double t = 0; t <= max_time; t += 0.02)
+                times.push_back(t);
+            //every vertex, then every other one so that a step skips a whole segment
+            times.insert(times.end(), vertex_times.begin(), vertex_times.end());
+            for (size_t i = 0; i < vertex_times.size(); i += 2)
+                times.push_back(vertex_times[i]);
+            for (int i = 0; i < 200; ++i)
+                times.push_back(mav_trajectory_generation::createRandomDouble(0, max_time));
+
+            for (double t : times) {
+                for (int derivative = 0; derivative <= mav_trajectory_generation::derivative_order::SNAP; ++derivative)
+                    testAssert(isClose(trajectory.evaluate(t, derivative), evaluator.evaluate(t, derivative)), "evaluator differs from the trajectory");
+
+                mav_msgs::EigenTrajectoryPoint point;
+                evaluator.sample(t, &point);
+                testAssert(isClose(trajectory.evaluate(t, 0).head<3>(), point.position_W), "sampled position differs from the trajectory");
+                testAssert(isClose(trajectory.evaluate(t, 1).head<3>(), point.velocity_W), "sampled velocity differs from the trajectory");
+                testAssert(isClose(trajectory.evaluate(t, 2).head<3>(), point.acceleration_W), "sampled acceleration differs from the trajectory");
+            }
+
+            //a time on a vertex picks the segment after it
+            testAssert(evaluator.getSegmentIndex(vertex_times[1]) == 1, "time on a vertex is not in the next segment");
+
+            //times outside the trajectory are clamped
+            testAssert(isClose(trajectory.evaluate(0, 1), evaluator.evaluate(-1, 1)), "time before the start is not clamped");
+            testAssert(isClose(trajectory.evaluate(max_time, 1), evaluator.evaluate(max_time + 1, 1)), "time after the end is not clamped");
+
+            mav_trajectory_generation::TrajectoryEvaluator empty;
+            testAssert(empty.empty() && empty.evaluate(1).size() == 0, "empty evaluator returned a value");
+        }
+
+        //evaluateSegment, which goes through FixedSegmentEvaluator for the shapes it dispatches, against Polynomial::evaluate
+        void segmentEvaluatorTest()
+        {
+            //the last shapes are not dispatched and take the per polynomial fallback
+            const int shapes[][2] = { { 6, 1 }, { 6, 3 }, { 8, 4 }, { 10, 1 }, { 10, 3 }, { 10, 4 }, { 12, 3 }, { 7, 3 }, { 10, 2 } };
+            //11 times leave a remainder after the batches of FixedSegmentEvaluator
+            std::vector<double> times;
+            for (int i = 0; i < 11; ++i)
+                times.push_back(mav_trajectory_generation::createRandomDouble(0, 1.5));
+
+            for (const auto& shape : shapes) {
+                const int n = shape[0], d = shape[1];
+                const Trajectory trajectory = makeRandomTrajectory(1, n, d);
+                const mav_trajectory_generation::Segment& segment = trajectory.segments()[0];
+                //derivatives up to n leave no terms at all
+                for (int derivative = 0; derivative <= n; ++derivative) {
+                    std::vector<double> result(times.size() * d);
+                    mav_trajectory_generation::evaluateSegment(segment, derivative, times.data(), times.size(), result.data());
+                    for (size_t i = 0; i < times.size(); ++i)
+                        for (int k = 0; k < d; ++k) {
+                            const double expected = segment[k].evaluate(times[i], derivative);
+                            testAssert(std::abs(expected - result[i * d + k]) <= 1E-12 * (1 + std::abs(expected)), "batched segment evaluation differs from the polynomial");
+                        }
+                }
+            }
+
+            //evaluateRange evaluates the samples of each segment in one batch
+            const Trajectory trajectory = makeRandomTrajectory(5, 10, 3);
+            for (int derivative = 0; derivative <= mav_trajectory_generation::derivative_order::SNAP; ++derivative) {
+                Eigen::MatrixXd samples;
+                std::vector<double> sampling_times;
+                trajectory.evaluateRange(0, trajectory.getMaxTime(), 0.05, derivative, &samples, &sampling_times);
+                testAssert(samples.cols() == static_cast<Eigen::Index>(sampling_times.size()) && !sampling_times.empty(), "evaluateRange returned the wrong number of samples");
+                for (size_t i = 0; i < sampling_times.size(); ++i)
+                    testAssert(isClose(trajectory.evaluate(sampling_times[i], derivative), samples.col(i)), "evaluateRange differs from the trajectory");
+            }
+        }
+
+        //the cached Cholesky solver against the sparse QR solver while the segment times change like in the nonlinear optimization
+        void linearSolverTest()
+        {
+            typedef mav_trajectory_generation::PolynomialOptimization<10> Optimization;
+            const int derivative = mav_trajectory_generation::derivative_order::JERK;
+            const mav_trajectory_generation::Vertex::Vector vertices = mav_trajectory_generation::createRandomVertices(
+                derivative, 10, Eigen::Vector3d(-10, -10, -5), Eigen::Vector3d(10, 10, 5), 7);
+            std::vector<double> segment_times = mav_trajectory_generation::estimateSegmentTimes(vertices, 5, 3);
+
+            Optimization qr(3), cholesky(3);
+            cholesky.setLinearSolverType(Optimization::kCachedCholesky);
+            qr.setupFromVertices(vertices, segment_times, derivative);
+            cholesky.setupFromVertices(vertices, segment_times, derivative);
+
+            const int iterations = 5;
+            for (int iteration = 0; iteration < iterations; ++iteration) {
+                if (iteration > 0) {
+                    for (double& time : segment_times)
+                        time *= mav_trajectory_generation::createRandomDouble(0.8, 1.25);
+                    qr.updateSegmentTimes(segment_times);
+                    cholesky.updateSegmentTimes(segment_times);
+                }
+                testAssert(qr.solveLinear() && cholesky.solveLinear(), "linear solve failed");
+
+                std::vector<Eigen::VectorXd> qr_solution, cholesky_solution;
+                qr.getFreeConstraints(&qr_solution);
+                cholesky.getFreeConstraints(&cholesky_solution);
+                testAssert(qr_solution.size() == cholesky_solution.size(), "solvers returned a different number of dimensions");
+                for (size_t i = 0; i < qr_solution.size(); ++i)
+                    testAssert(qr_solution[i].size() == cholesky_solution[i].size() &&
+                                   (qr_solution[i] - cholesky_solution[i]).norm() <= 1E-6 * (1 + qr_solution[i].norm()),
+                               "cached Cholesky solution differs from the sparse QR one");
+                testAssert(std::abs(qr.computeCost() - cholesky.computeCost()) <= 1E-6 * (1 + qr.computeCost()), "solvers reached a different cost");
+            }
+
+            //the pattern of Rpp does not change with the segment times, so it is analyzed once and refactorized after that
+            const mav_trajectory_generation::LinearSolveStats& stats = cholesky.getLinearSolveStats();
+            testAssert(stats.n_solves == iterations, "cached Cholesky solves were not counted");
+            testAssert(stats.n_pattern_analyses == 1, "pattern of Rpp was analyzed more than once");
+            testAssert(stats.n_fallbacks == 0, "well conditioned solve fell back to sparse QR");
+        }
+
+        //planSplineCandidates on a field with a pillar in the middle picks the fastest candidate that keeps clear of it
+        void splineCandidatesTest()
+        {
+            const double resolution = 0.25;
+            const std::function<bool(const VoxelGrid::GRID_INDEX&)> is_filled_fn = [&](const VoxelGrid::GRID_INDEX& index) {
+                const double x = (index.x + 0.5) * resolution, y = (index.y + 0.5) * resolution;
+                return (x - 10) * (x - 10) + (y - 5) * (y - 5) < 1.5 * 1.5;
+            };
+            auto sdf = std::make_shared<const sdf_tools::SignedDistanceField>(
+                sdf_generation::ExtractSignedDistanceField<uint8_t>(Eigen::Isometry3d::Identity(), resolution, 80, 40, 20, is_filled_fn,
+                                                                    std::numeric_limits<float>::infinity(), "world")
+                    .first);
+
+            //the first candidate goes through the pillar, the others pass it at different distances
+            const float offsets[] = { 0, 2.5f, 4, -3 };
+            vector<SplinePlanRequest> requests;
+            for (float offset : offsets) {
+                SplinePlanRequest request;
+                request.waypoints = { Vector3r(0, 5, 2.5f), Vector3r(10, 5 + offset, 2.5f), Vector3r(20, 5, 2.5f) };
+                request.vel_max = 5;
+                request.acc_max = 3;
+                request.sdf = sdf;
+                request.min_clearance = 0.5f;
+                requests.push_back(request);
+            }
+
+            common_utils::ParallelFor pool(2);
+            SplinePlan best_plan;
+            vector<SplinePlan> plans;
+            const int best = MultirotorApiBase::planSplineCandidates(requests, pool, best_plan, &plans);
+            testAssert(plans.size() == requests.size(), "not every candidate was planned");
+            testAssert(plans[0].min_obstacle_distance < 0, "candidate through the pillar did not hit it");
+
+            int expected = -1;
+            for (size_t i = 0; i < plans.size(); ++i)
+                if (!plans[i].trajectory.empty() && plans[i].min_obstacle_distance >= requests[i].min_clearance &&
+                    (expected < 0 || plans[i].trajectory.getMaxTime() < plans[expected].trajectory.getMaxTime()))
+                    expected = static_cast<int>(i);
+            testAssert(expected > 0 && best == expected, "planSplineCandidates did not pick the fastest clear candidate");
+            testAssert(best_plan.trajectory.getMaxTime() == plans[best].trajectory.getMaxTime() &&
+                           best_plan.min_obstacle_distance == plans[best].min_obstacle_distance,
+                       "best plan is not the picked candidate");
+
+            //without a clear candidate there is nothing to fly
+            requests.resize(1);
+            testAssert(MultirotorApiBase::planSplineCandidates(requests, pool, best_plan) == -1, "candidate through the pillar was picked");
+        }
+
+        //a vehicle that flies exactly the velocity it is commanded, and records where it was whenever the tracker starts a trajectory
+        class VelocityFollowerApi : public MultirotorApiBase
+        {
+        public:
+            struct TrajectoryStart
+            {
+                Vector3r position, trajectory_start;
+                TTimePoint time;
+            };
+
+            VelocityFollowerApi(const Vector3r& position)
+            {
+                kinematics_ = Kinematics::State::zero();
+                kinematics_.pose.position = position;
+                last_command_ = ClockFactory::get()->nowNanos();
+                //position feedback only, on top of the reference velocity
+                setTrajectoryTrackerGains({ 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0 });
+                traj_viz_idx_ = curr_traj_viz_idx_;
+            }
+
+            Vector3r getPosition() const
+            {
+                return kinematics_.pose.position;
+            }
+
+            vector<TrajectoryStart> trajectory_starts;
+
+        protected:
+            virtual void commandVelocity(float vx, float vy, float vz, const YawMode& yaw_mode) override
+            {
+                unused(yaw_mode);
+                const TTimePoint now = ClockFactory::get()->nowNanos();
+                kinematics_.pose.position += kinematics_.twist.linear * static_cast<float>(ClockFactory::get()->elapsedBetween(now, last_command_));
+                kinematics_.twist.linear = Vector3r(vx, vy, vz);
+                last_command_ = now;
+
+                if (curr_traj_viz_idx_ != traj_viz_idx_ && !curr_traj_viz_.empty()) {
+                    traj_viz_idx_ = curr_traj_viz_idx_;
+                    trajectory_starts.push_back(TrajectoryStart{ kinematics_.pose.position, curr_traj_viz_.front(), now });
+                }
+            }
+
+            virtual void commandMotorPWMs(float, float, float, float) override {}
+            virtual void commandRollPitchYawrateThrottle(float, float, float, float) override {}
+            virtual void commandRollPitchYawZ(float, float, float, float) override {}
+            virtual void commandRollPitchYawThrottle(float, float, float, float) override {}
+            virtual void commandRollPitchYawrateZ(float, float, float, float) override {}
+            virtual void commandAngleRatesZ(float, float, float, float) override {}
+            virtual void commandAngleRatesThrottle(float, float, float, float) override {}
+            virtual void commandVelocityZ(float, float, float, const YawMode&) override {}
+            virtual void commandPosition(float, float, float, const YawMode&) override {}
+            virtual void setControllerGains(uint8_t, const vector<float>&, const vector<float>&, const vector<float>&) override {}
+
+            virtual Kinematics::State getKinematicsEstimated() const override
+            {
+                return kinematics_;
+            }
+            virtual LandedState getLandedState() const override
+            {
+                return LandedState::Flying;
+            }
+            virtual GeoPoint getGpsLocation() const override
+            {
+                return GeoPoint();
+            }
+            virtual const MultirotorApiParams& getMultirotorApiParams() const override
+            {
+                return params_;
+            }
+            virtual float getCommandPeriod() const override
+            {
+                return 1.0f / 50;
+            }
+            virtual float getTakeoffZ() const override
+            {
+                return -3;
+            }
+            virtual float getDistanceAccuracy() const override
+            {
+                return 0.1f;
+            }
+
+        public:
+            virtual void enableApiControl(bool) override {}
+            virtual bool isApiControlEnabled() const override
+            {
+                return true;
+            }
+            virtual bool armDisarm(bool) override
+            {
+                return true;
+            }
+            virtual GeoPoint getHomeGeoPoint() const override
+            {
+                return GeoPoint();
+            }
+
+        private:
+            Kinematics::State kinematics_;
+            TTimePoint last_command_;
+            int traj_viz_idx_;
+            MultirotorApiParams params_;
+        };
+
+        //replans handed to the planner thread while the tracker flies: a failed or superseded replan returns false right
+        //away, the latest one is swapped in once the tracker gets to the lookahead point and returns true when tracking is done.
+        //The calls run on their own threads and the test steps their clock, so that nothing moves while it checks what returned.
+        void replanTest()
+        {
+            auto clock = std::make_shared<SteppableClock>(10E-3f, Utils::getTimeSinceEpochNanos());
+            ClockFactory::ScopedThreadClock clock_scope(clock.get());
+            VelocityFollowerApi api(Vector3r(0, 0, -5));
+
+            typedef std::function<bool()> Call;
+            auto start = [&clock](const Call& call) {
+                return std::async(std::launch::async, [&clock, call]() {
+                    ClockFactory::ScopedThreadClock call_clock_scope(clock.get());
+                    return call();
+                });
+            };
+            auto isDone = [](const std::future<bool>& result, int wait_ms = 0) {
+                return result.wait_for(std::chrono::milliseconds(wait_ms)) == std::future_status::ready;
+            };
+            auto advance = [&clock](double seconds, const std::function<bool()>& until = nullptr) {
+                for (double t = 0; t < seconds && !(until && until()); t += clock->getStepSize()) {
+                    clock->step();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            };
+            auto moveOnSpline = [&api](const vector<Vector3r>& path, bool replan) {
+                return api.moveOnSpline(path, true, true, true, 3, 2, false, vector<float>(), replan, 2);
+            };
+
+            std::future<bool> tracking = start([&]() { return moveOnSpline({ Vector3r(60, 0, -5) }, false); });
+            advance(3);
+            testAssert(!isDone(tracking) && api.trajectory_starts.size() == 1, "vehicle is not tracking");
+
+            //one velocity for three waypoints once the lookahead point is added
+            std::future<bool> mismatched = start([&]() {
+                return api.moveOnSplineVelConstraints({ Vector3r(30, 5, -5), Vector3r(40, 5, -5) }, { Vector3r(3, 0, 0) },
+                                                      true, true, true, 3, 2, false, vector<float>(), true, 2);
+            });
+            testAssert(isDone(mismatched, 10000) && !mismatched.get(), "replan with velocities that do not match the path was not failed");
+            testAssert(!isDone(tracking), "failed replan stopped tracking");
+
+            //of two replans requested at the same time only the later one is used, the other returns right away
+            const TTimePoint request_time = clock->nowNanos();
+            std::future<bool> replans[] = { start([&]() { return moveOnSpline({ Vector3r(20, -10, -5) }, true); }),
+                                            start([&]() { return moveOnSpline({ Vector3r(20, 10, -5) }, true); }) };
+            const Vector3r replan_ends[] = { Vector3r(20, -10, -5), Vector3r(20, 10, -5) };
+            for (int wait_ms = 0; wait_ms < 10000 && !isDone(replans[0]) && !isDone(replans[1]); wait_ms += 10)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            testAssert(isDone(replans[0]) != isDone(replans[1]), "not exactly one of two replans was superseded");
+            const int used = isDone(replans[0]) ? 1 : 0;
+            testAssert(!replans[1 - used].get(), "superseded replan was reported as flown");
+            //give the planner thread time to plan the used replan before the tracker gets to the lookahead point
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+            advance(60, [&]() { return isDone(tracking) && isDone(replans[used]); });
+            testAssert(isDone(tracking) && tracking.get() && isDone(replans[used]) && replans[used].get(), "replan was not flown");
+            testAssert((api.getPosition() - replan_ends[used]).norm() < 0.5f, "vehicle did not end at the end of the replanned path");
+
+            //the replan starts from where the first trajectory was one lookahead after the request, and is swapped in there
+            testAssert(api.trajectory_starts.size() == 2, "replan was not swapped in exactly once");
+            const VelocityFollowerApi::TrajectoryStart& swap = api.trajectory_starts.back();
+            const double swap_delay = clock->elapsedBetween(swap.time, request_time);
+            testAssert(swap_delay > 2 - 0.05 && swap_delay < 2 + 0.1, "replan was not swapped in at the lookahead point");
+            testAssert((swap.position - swap.trajectory_start).norm() < 0.3f, "vehicle was not at the start of the replan when it was swapped in");
+
+            //a replan that is still pending when its tracking run is cancelled by a new call is dropped
+            tracking = start([&]() { return moveOnSpline({ Vector3r(0, 0, -5) }, false); });
+            advance(1);
+            std::future<bool> pending = start([&]() { return moveOnSpline({ Vector3r(10, 0, -10) }, true); });
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            testAssert(!isDone(pending), "replan returned before it was swapped in");
+            std::future<bool> next = start([&]() { return moveOnSpline({ Vector3r(5, 5, -5) }, false); });
+            testAssert(isDone(pending, 10000) && !pending.get(), "replan of a cancelled tracking run was not dropped");
+            advance(60, [&]() { return isDone(tracking) && isDone(next); });
+            testAssert(isDone(next) && next.get() && (api.getPosition() - Vector3r(5, 5, -5)).norm() < 0.5f, "call after the cancelled one was not flown");
+        }
+    };
+}
+}
+#endif
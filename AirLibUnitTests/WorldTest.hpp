@@ -0,0 +1,208 @@
+#ifndef msr_AirLibUnitTests_WorldTest_hpp
+#define msr_AirLibUnitTests_WorldTest_hpp
+
+#include <memory>
+#include <thread>
+#include <vector>
+#include "TestBase.hpp"
+#include "common/SteppableClock.hpp"
+#include "physics/World.hpp"
+#include "physics/FastPhysicsEngine.hpp"
+#include "vehicles/multirotor/MultiRotorPhysicsBody.hpp"
+#include "vehicles/multirotor/firmwares/simple_flight/SimpleFlightQuadXParams.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    //steps the same vehicles in Worlds updated serially, in parallel and concurrently with their own clocks and checks that they end up bit identical
+    class WorldTest : public TestBase
+    {
+    public:
+        virtual void run() override
+        {
+            //default settings give the SimpleFlight vehicle
+            AirSimSettings::initializeSettings("{}");
+            AirSimSettings::singleton().load([]() { return std::string(AirSimSettings::kSimModeTypeMultirotor); });
+            Utils::getSetMinLogLevel(true, 100);
+
+            parallelUpdateTest();
+            concurrentWorldsTest();
+
+            Utils::getSetMinLogLevel(true);
+        }
+
+    private:
+        //records the rotor thrust of the vehicles inserted before it, which their update computes, so a member
+        //without physics body that runs between the vehicles must see them updated like in the serial order.
+        //Also records the time members read from ClockFactory, which must be the one of their world.
+        class ThrustRecorder : public UpdatableObject
+        {
+        public:
+            ThrustRecorder(const std::vector<std::unique_ptr<MultiRotorPhysicsBody>>& vehicles, size_t count)
+                : vehicles_(vehicles), count_(count)
+            {
+            }
+
+            virtual void resetImplementation() override
+            {
+                thrusts.clear();
+                times.clear();
+                saw_world_clock = true;
+            }
+
+            virtual void update() override
+            {
+                UpdatableObject::update();
+                saw_world_clock = saw_world_clock && ClockFactory::get() == clock();
+                times.push_back(ClockFactory::get()->nowNanos());
+                for (size_t i = 0; i < count_; ++i)
+                    for (uint rotor = 0; rotor < vehicles_[i]->wrenchVertexCount(); ++rotor)
+                        thrusts.push_back(vehicles_[i]->getWrenchVertex(rotor).getWrench().force);
+            }
+
+            std::vector<Vector3r> thrusts;
+            std::vector<TTimePoint> times;
+            bool saw_world_clock = true;
+
+        private:
+            const std::vector<std::unique_ptr<MultiRotorPhysicsBody>>& vehicles_;
+            size_t count_;
+        };
+
+        //gives the firmware a goal without the blocking api calls that would wait on the clock we step
+        class HoldingApi : public SimpleFlightApi
+        {
+        public:
+            using SimpleFlightApi::SimpleFlightApi;
+
+            void holdLevel(float z)
+            {
+                commandRollPitchYawZ(0, 0, 0, z);
+            }
+        };
+
+        struct Vehicles
+        {
+            std::vector<std::unique_ptr<MultiRotorParams>> params;
+            std::vector<std::unique_ptr<HoldingApi>> apis;
+            std::vector<std::unique_ptr<Kinematics>> kinematics;
+            std::vector<std::unique_ptr<Environment>> environments;
+            std::vector<std::unique_ptr<MultiRotorPhysicsBody>> bodies;
+            std::unique_ptr<ThrustRecorder> recorder;
+            std::unique_ptr<World> world;
+            bool armed = true;
+
+            void create(std::shared_ptr<ClockBase> clock, uint thread_count)
+            {
+                //vehicles record their start times as they reset so they must see our clock
+                ClockFactory::ScopedThreadClock clock_scope(clock.get());
+
+                const int vehicle_count = 4;
+                for (int i = 0; i < vehicle_count; ++i) {
+                    //every vehicle starts in the air with its own velocity and spin so that they diverge
+                    auto initial = Kinematics::State::zero();
+                    initial.pose.position = Vector3r(i * 5.0f, 0, -20.0f);
+                    initial.twist.linear = Vector3r(0.5f * i, -0.3f * i, 0.2f);
+                    initial.twist.angular = Vector3r(0.2f * i, -0.1f, 0.05f * i);
+
+                    params.emplace_back(new SimpleFlightQuadXParams(AirSimSettings::singleton().getVehicleSetting("SimpleFlight"),
+                                                                    std::make_shared<SensorFactory>()));
+                    params.back()->initialize(AirSimSettings::singleton().getVehicleSetting("SimpleFlight"));
+                    apis.emplace_back(new HoldingApi(params.back().get(), AirSimSettings::singleton().getVehicleSetting("SimpleFlight")));
+                    kinematics.emplace_back(new Kinematics(initial));
+                    environments.emplace_back(new Environment(Environment::State(initial.pose.position, GeoPoint(47.641468, -122.140165, 122))));
+                    bodies.emplace_back(new MultiRotorPhysicsBody(params.back().get(), apis.back().get(), kinematics.back().get(), environments.back().get()));
+                    //like the pawn sim api, give firmware its ground truth and reset what the world does not
+                    apis.back()->setSimulatedGroundTruth(&kinematics.back()->getState(), environments.back().get());
+                    kinematics.back()->reset();
+                    apis.back()->reset();
+                }
+                recorder.reset(new ThrustRecorder(bodies, 2));
+
+                world.reset(new World(std::unique_ptr<PhysicsEngineBase>(new FastPhysicsEngine()), clock));
+                world->setParallelUpdate(thread_count);
+                world->insert(bodies[0].get());
+                world->insert(bodies[1].get());
+                world->insert(recorder.get());
+                world->insert(bodies[2].get());
+                world->insert(bodies[3].get());
+                world->reset();
+
+                //firmware holds the vehicles level at their altitude against the spin and velocity they start with
+                for (auto& api : apis) {
+                    api->enableApiControl(true);
+                    armed = api->armDisarm(true) && armed;
+                    api->holdLevel(-20.0f);
+                }
+            }
+        };
+
+        void parallelUpdateTest()
+        {
+            //both clocks start at the same time so that nothing but the update mode differs
+            const TTimePoint start = Utils::getTimeSinceEpochNanos();
+            Vehicles serial, parallel;
+            serial.create(std::make_shared<SteppableClock>(3E-3f, start), 1);
+            parallel.create(std::make_shared<SteppableClock>(3E-3f, start), 3);
+            testAssert(serial.armed && parallel.armed, "vehicles did not arm");
+            testAssert(parallel.world->getParallelUpdateThreadCount() == 3, "world did not switch to parallel update");
+
+            for (int step = 0; step < 400; ++step) {
+                serial.world->update();
+                parallel.world->update();
+            }
+
+            testAssert(serial.bodies[3]->getKinematics().pose.position != serial.kinematics[3]->getInitialState().pose.position, "vehicles did not move");
+            testAssert(serial.recorder->thrusts.back() != Vector3r::Zero(), "rotors did not spin");
+            assertSame(serial, parallel, "parallel");
+        }
+
+        //two worlds with their own clocks stepped at the same time on their own threads
+        void concurrentWorldsTest()
+        {
+            const TTimePoint start = Utils::getTimeSinceEpochNanos();
+            Vehicles first, second;
+            first.create(std::make_shared<SteppableClock>(3E-3f, start), 1);
+            second.create(std::make_shared<SteppableClock>(3E-3f, start), 2);
+
+            const int steps = 400;
+            std::thread first_thread([&first, steps]() {
+                for (int step = 0; step < steps; ++step)
+                    first.world->update();
+            });
+            std::thread second_thread([&second, steps]() {
+                for (int step = 0; step < steps; ++step)
+                    second.world->update();
+            });
+            first_thread.join();
+            second_thread.join();
+
+            for (const Vehicles* vehicles : { &first, &second }) {
+                testAssert(vehicles->recorder->saw_world_clock, "member of a world did not see the clock of its world");
+                testAssert(vehicles->recorder->times.size() == static_cast<size_t>(steps) && vehicles->recorder->times.back() == vehicles->world->clock()->nowNanos(),
+                           "member of a world did not see the time of its world");
+                testAssert(vehicles->world->clock()->getStepCount() == static_cast<uint64_t>(steps), "world clock was stepped by the other world");
+            }
+            assertSame(first, second, "concurrent");
+        }
+
+        void assertSame(const Vehicles& expected_vehicles, const Vehicles& actual_vehicles, const std::string& mode)
+        {
+            for (size_t i = 0; i < expected_vehicles.bodies.size(); ++i) {
+                const Kinematics::State& expected = expected_vehicles.bodies[i]->getKinematics();
+                const Kinematics::State& actual = actual_vehicles.bodies[i]->getKinematics();
+                testAssert(expected.pose.position == actual.pose.position, mode + " position differs");
+                testAssert(expected.pose.orientation.coeffs() == actual.pose.orientation.coeffs(), mode + " orientation differs");
+                testAssert(expected.twist.linear == actual.twist.linear, mode + " linear velocity differs");
+                testAssert(expected.twist.angular == actual.twist.angular, mode + " angular velocity differs");
+                testAssert(expected.accelerations.linear == actual.accelerations.linear, mode + " linear acceleration differs");
+                testAssert(expected.accelerations.angular == actual.accelerations.angular, mode + " angular acceleration differs");
+            }
+            testAssert(expected_vehicles.recorder->thrusts == actual_vehicles.recorder->thrusts, mode + ": member between the vehicles saw them in a different state");
+        }
+    };
+}
+}
+#endif
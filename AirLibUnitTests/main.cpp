@@ -5,6 +5,13 @@
 #include "WorkerThreadTest.hpp"
 #include "QuaternionTest.hpp"
 #include "CelestialTests.hpp"
+#include "PhysicsBatchTest.hpp"
+#include "SdfTest.hpp"
+#include "RpcLibTest.hpp"
+#include "TrajectoryTest.hpp"
+#include "WorldTest.hpp"
+#include "TelemetryTest.hpp"
+#include "ScheduledExecutorTest.hpp"
 
 int main()
 {
@@ -14,6 +21,13 @@ int main()
         std::unique_ptr<TestBase>(new QuaternionTest()),
         std::unique_ptr<TestBase>(new CelestialTest()),
         std::unique_ptr<TestBase>(new SettingsTest()),
+        std::unique_ptr<TestBase>(new PhysicsBatchTest()),
+        std::unique_ptr<TestBase>(new SdfTest()),
+        std::unique_ptr<TestBase>(new RpcLibTest()),
+        std::unique_ptr<TestBase>(new TrajectoryTest()),
+        std::unique_ptr<TestBase>(new WorldTest()),
+        std::unique_ptr<TestBase>(new TelemetryTest()),
+        std::unique_ptr<TestBase>(new ScheduledExecutorTest()),
         std::unique_ptr<TestBase>(new SimpleFlightTest())
         //,
         //std::unique_ptr<TestBase>(new PixhawkTest()),
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "mav_trajectory_generation/polynomial_evaluator.h"
+#include "mav_trajectory_generation/trajectory.h"
+
+namespace msr
+{
+namespace airlib
+{
+
+    // Times the per sample polynomial evaluation of a random trajectory against the batched
+    // fixed size evaluator for each derivative and reports the largest difference between them.
+    class PolynomialEvaluationBenchmark
+    {
+    public:
+        void run(int segment_count = 20, double sampling_dt = 0.001, int repeats = 20)
+        {
+            using namespace mav_trajectory_generation;
+
+            const Trajectory trajectory = makeTrajectory(segment_count);
+            for (int derivative = derivative_order::POSITION; derivative <= derivative_order::SNAP; ++derivative) {
+                Eigen::MatrixXd legacy, batched;
+                double legacy_sec = 0, batched_sec = 0;
+                for (int repeat = 0; repeat < repeats; ++repeat) {
+                    legacy_sec += evaluateLegacy(trajectory, derivative, sampling_dt, legacy);
+                    batched_sec += evaluateBatched(trajectory, derivative, sampling_dt, batched);
+                }
+
+                const double max_diff = legacy.cols() == batched.cols() ? (legacy - batched).cwiseAbs().maxCoeff() : -1;
+                std::cout << "derivative " << derivative << ", " << legacy.cols() << " samples: per sample "
+                          << legacy_sec / repeats * 1e3 << " ms, batched " << batched_sec / repeats * 1e3 << " ms, speedup "
+                          << legacy_sec / batched_sec << "x, max diff " << max_diff << std::endl;
+            }
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        static mav_trajectory_generation::Trajectory makeTrajectory(int segment_count)
+        {
+            using namespace mav_trajectory_generation;
+
+            std::mt19937 rng(42);
+            std::uniform_real_distribution<double> coefficient(-1.0, 1.0);
+            std::uniform_real_distribution<double> segment_time(0.5, 2.0);
+
+            Segment::Vector segments;
+            for (int i = 0; i < segment_count; ++i) {
+                Segment segment(10, 3);
+                for (int d = 0; d < 3; ++d) {
+                    Eigen::VectorXd coefficients(10);
+                    for (int j = 0; j < 10; ++j)
+                        coefficients[j] = coefficient(rng);
+                    segment[d] = Polynomial(coefficients);
+                }
+                segment.setTime(segment_time(rng));
+                segments.push_back(segment);
+            }
+
+            Trajectory trajectory;
+            trajectory.setSegments(segments);
+            return trajectory;
+        }
+
+        static double evaluateLegacy(const mav_trajectory_generation::Trajectory& trajectory, int derivative, double dt, Eigen::MatrixXd& result)
+        {
+            const auto start = Clock::now();
+            const size_t n_samples = static_cast<size_t>(std::floor(trajectory.getMaxTime() / dt)) + 1;
+            result.resize(trajectory.D(), n_samples);
+            size_t i = 0;
+            double segment_start = 0;
+            for (const auto& segment : trajectory.segments()) {
+                for (; i < n_samples && i * dt <= segment_start + segment.getTime(); ++i) {
+                    const double t = i * dt - segment_start;
+                    for (int d = 0; d < segment.D(); ++d)
+                        result(d, i) = segment[d].evaluate(t, derivative);
+                }
+                segment_start += segment.getTime();
+            }
+            result.conservativeResize(Eigen::NoChange, i);
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        static double evaluateBatched(const mav_trajectory_generation::Trajectory& trajectory, int derivative, double dt, Eigen::MatrixXd& result)
+        {
+            const auto start = Clock::now();
+            const size_t n_samples = static_cast<size_t>(std::floor(trajectory.getMaxTime() / dt)) + 1;
+            result.resize(trajectory.D(), n_samples);
+            std::vector<double> times;
+            size_t i = 0;
+            double segment_start = 0;
+            for (const auto& segment : trajectory.segments()) {
+                const size_t first = i;
+                times.clear();
+                for (; i < n_samples && i * dt <= segment_start + segment.getTime(); ++i)
+                    times.push_back(i * dt - segment_start);
+                mav_trajectory_generation::evaluateSegment(segment, derivative, times.data(), times.size(), result.col(first).data());
+                segment_start += segment.getTime();
+            }
+            result.conservativeResize(Eigen::NoChange, i);
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        }
+    };
+}
+} //namespace
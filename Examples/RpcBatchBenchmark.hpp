@@ -0,0 +1,131 @@
+#pragma once
+
+#include "common/Common.hpp"
+#include "vehicles/multirotor/api/MultirotorRpcLibClient.hpp"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+STRICT_MODE_OFF
+#include "vehicles/multirotor/api/MultirotorRpcLibAdaptors.hpp"
+#include "api/RpcLibBatch.hpp"
+STRICT_MODE_ON
+
+namespace msr
+{
+namespace airlib
+{
+
+    // Measures the latency of one controller tick against a running simulator when the tick's
+    // state queries are sent as separate calls and when they are sent as one batchCall.
+    class RpcBatchBenchmark
+    {
+    public:
+        void run(const std::string& vehicle_name = "", int ticks = 500)
+        {
+            MultirotorRpcLibClient client;
+            client.confirmConnection();
+
+            for (int query_count : { 1, 4, 16 }) {
+                const Stats sequential = measure(ticks, [&]() { tickSequential(client, vehicle_name, query_count); });
+                const Stats batched = measure(ticks, [&]() { tickBatched(client, vehicle_name, query_count); });
+                std::cout << query_count << " queries/tick: sequential mean " << sequential.mean_ms << " ms p99 " << sequential.p99_ms
+                          << " ms, batched mean " << batched.mean_ms << " ms p99 " << batched.p99_ms << " ms, speedup "
+                          << sequential.mean_ms / batched.mean_ms << "x" << std::endl;
+            }
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+        typedef msr::airlib_rpclib::RpcLibAdaptorsBase RpcLibAdaptorsBase;
+        typedef msr::airlib_rpclib::MultirotorRpcLibAdaptors MultirotorRpcLibAdaptors;
+
+        struct Stats
+        {
+            double mean_ms;
+            double p99_ms;
+        };
+
+        static Stats measure(int ticks, const std::function<void()>& tick)
+        {
+            //warm up connection and server side caches
+            for (int i = 0; i < 10; ++i)
+                tick();
+
+            std::vector<double> samples;
+            samples.reserve(ticks);
+            for (int i = 0; i < ticks; ++i) {
+                const auto start = Clock::now();
+                tick();
+                samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            }
+
+            std::sort(samples.begin(), samples.end());
+            double sum = 0;
+            for (double sample : samples)
+                sum += sample;
+            return Stats{ sum / samples.size(), samples[static_cast<size_t>(samples.size() * 0.99)] };
+        }
+
+        //the mix a racing controller typically asks for every tick, repeated to reach query_count
+        static void tickSequential(MultirotorRpcLibClient& client, const std::string& vehicle_name, int query_count)
+        {
+            for (int i = 0; i < query_count; ++i) {
+                switch (i % 4) {
+                case 0:
+                    client.getMultirotorState(vehicle_name);
+                    break;
+                case 1:
+                    client.simGetGroundTruthKinematics(vehicle_name);
+                    break;
+                case 2:
+                    client.getImuData("", vehicle_name);
+                    break;
+                default:
+                    client.simGetCollisionInfo(vehicle_name);
+                    break;
+                }
+            }
+        }
+
+        static void tickBatched(MultirotorRpcLibClient& client, const std::string& vehicle_name, int query_count)
+        {
+            RpcLibBatch batch;
+            std::vector<RpcLibBatch::Handle<MultirotorRpcLibAdaptors::MultirotorState>> states;
+            std::vector<RpcLibBatch::Handle<RpcLibAdaptorsBase::KinematicsState>> kinematics;
+            std::vector<RpcLibBatch::Handle<RpcLibAdaptorsBase::ImuData>> imus;
+            std::vector<RpcLibBatch::Handle<RpcLibAdaptorsBase::CollisionInfo>> collisions;
+            for (int i = 0; i < query_count; ++i) {
+                switch (i % 4) {
+                case 0:
+                    states.push_back(batch.add<MultirotorRpcLibAdaptors::MultirotorState>("getMultirotorState", vehicle_name));
+                    break;
+                case 1:
+                    kinematics.push_back(batch.add<RpcLibAdaptorsBase::KinematicsState>("simGetGroundTruthKinematics", vehicle_name));
+                    break;
+                case 2:
+                    imus.push_back(batch.add<RpcLibAdaptorsBase::ImuData>("getImuData", std::string(), vehicle_name));
+                    break;
+                default:
+                    collisions.push_back(batch.add<RpcLibAdaptorsBase::CollisionInfo>("simGetCollisionInfo", vehicle_name));
+                    break;
+                }
+            }
+
+            client.callBatch(batch);
+
+            //decode everything so both variants do the same work
+            for (const auto& handle : states)
+                batch.get(handle).to();
+            for (const auto& handle : kinematics)
+                batch.get(handle).to();
+            for (const auto& handle : imus)
+                batch.get(handle).to();
+            for (const auto& handle : collisions)
+                batch.get(handle).to();
+        }
+    };
+}
+} //namespace
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "sdf_tools/sdf_generation.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    // Times the SDF generation backends on random occupancy grids of increasing size and
+    // reports the largest difference between them.
+    class SdfGenerationBenchmark
+    {
+    public:
+        void run(double fill_ratio = 0.05, int64_t max_cells_per_side = 256)
+        {
+            for (int64_t cells_per_side = 32; cells_per_side <= max_cells_per_side; cells_per_side *= 2)
+                runGrid(cells_per_side, fill_ratio);
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        void runGrid(int64_t n, double fill_ratio)
+        {
+            std::mt19937 rng(static_cast<unsigned int>(n));
+            std::bernoulli_distribution is_filled(fill_ratio);
+            std::vector<uint8_t> occupancy(static_cast<size_t>(n * n * n));
+            for (auto& cell : occupancy)
+                cell = is_filled(rng) ? 1 : 0;
+
+            const std::function<bool(const VoxelGrid::GRID_INDEX&)> is_filled_fn = [&](const VoxelGrid::GRID_INDEX& index) {
+                return occupancy[static_cast<size_t>((index.x * n + index.y) * n + index.z)] != 0;
+            };
+
+            double bucket_queue_sec, edt_sec;
+            const auto bucket_queue = generate(n, is_filled_fn, sdf_generation::BUCKET_QUEUE, bucket_queue_sec);
+            const auto edt = generate(n, is_filled_fn, sdf_generation::PARALLEL_EDT, edt_sec);
+
+            double max_diff = 0;
+            for (int64_t x = 0; x < n; ++x)
+                for (int64_t y = 0; y < n; ++y)
+                    for (int64_t z = 0; z < n; ++z)
+                        max_diff = std::max(max_diff, (double)std::fabs(bucket_queue.GetImmutable(x, y, z).first - edt.GetImmutable(x, y, z).first));
+
+            std::cout << n << "^3 cells: bucket queue " << bucket_queue_sec << " s, parallel EDT " << edt_sec
+                      << " s, speedup " << bucket_queue_sec / edt_sec << "x, max diff " << max_diff << std::endl;
+        }
+
+        static sdf_tools::SignedDistanceField generate(int64_t n, const std::function<bool(const VoxelGrid::GRID_INDEX&)>& is_filled_fn,
+                                                       sdf_generation::GENERATION_BACKEND backend, double& elapsed_sec)
+        {
+            const auto start = Clock::now();
+            auto result = sdf_generation::ExtractSignedDistanceField<uint8_t>(Eigen::Isometry3d::Identity(), 0.1, n, n, n,
+                                                                              is_filled_fn, std::numeric_limits<float>::infinity(), "world", backend);
+            elapsed_sec = std::chrono::duration<double>(Clock::now() - start).count();
+            return result.first;
+        }
+    };
+}
+} //namespace
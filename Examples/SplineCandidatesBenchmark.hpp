@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "common/common_utils/ParallelFor.hpp"
+#include "sdf_tools/sdf_generation.hpp"
+#include "vehicles/multirotor/api/MultirotorApiBase.hpp"
+
+namespace msr
+{
+namespace airlib
+{
+
+    // Plans the moveOnSplineCandidates trajectories through a set of candidate paths around an obstacle
+    // on one thread and on all hardware threads and reports the chosen candidate of each.
+    // Without sdf_file the obstacle is a pillar in the middle of a generated 20 x 10 x 5 m field.
+    class SplineCandidatesBenchmark
+    {
+    public:
+        void run(const std::string& sdf_file = "", int candidate_count = 8, int repeats = 5)
+        {
+            const std::shared_ptr<const sdf_tools::SignedDistanceField> sdf = sdf_file.empty()
+                ? makePillarSdf()
+                : std::make_shared<const sdf_tools::SignedDistanceField>(sdf_tools::SignedDistanceField::LoadFromFile(sdf_file));
+
+            vector<SplinePlanRequest> requests(candidate_count);
+            for (int i = 0; i < candidate_count; ++i) {
+                const float offset = candidate_count > 1 ? -4.0f + 8.0f * i / (candidate_count - 1) : 0.0f;
+                SplinePlanRequest& request = requests[i];
+                request.waypoints = { Vector3r(0, 5, 2.5f), Vector3r(7, 5 + offset, 2.5f), Vector3r(13, 5 + offset, 2.5f), Vector3r(20, 5, 2.5f) };
+                request.vel_max = 5;
+                request.acc_max = 3;
+                request.sdf = sdf;
+                request.min_clearance = 0.5f;
+            }
+
+            common_utils::ParallelFor single_thread(1);
+            common_utils::ParallelFor all_threads;
+            const double single_sec = plan(requests, single_thread, repeats, "1 thread");
+            const double all_sec = plan(requests, all_threads, repeats, std::to_string(all_threads.getThreadCount()) + " threads");
+            std::cout << "speedup " << single_sec / all_sec << "x" << std::endl;
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        static double plan(const vector<SplinePlanRequest>& requests, common_utils::ParallelFor& pool, int repeats, const std::string& name)
+        {
+            SplinePlan best_plan;
+            vector<SplinePlan> plans;
+            int best = -1;
+            const auto start = Clock::now();
+            for (int repeat = 0; repeat < repeats; ++repeat)
+                best = MultirotorApiBase::planSplineCandidates(requests, pool, best_plan, &plans);
+            const double elapsed_sec = std::chrono::duration<double>(Clock::now() - start).count() / repeats;
+
+            std::cout << name << ": " << requests.size() << " candidates in " << elapsed_sec * 1e3 << " ms, clearances";
+            for (const auto& candidate : plans)
+                std::cout << " " << candidate.min_obstacle_distance;
+            std::cout << std::endl;
+            if (best >= 0)
+                std::cout << "  chose candidate " << best << ", " << best_plan.trajectory.getMaxTime() << " s, clearance "
+                          << best_plan.min_obstacle_distance << std::endl;
+            else
+                std::cout << "  no collision free candidate" << std::endl;
+            return elapsed_sec;
+        }
+
+        static std::shared_ptr<const sdf_tools::SignedDistanceField> makePillarSdf()
+        {
+            const double resolution = 0.1;
+            const std::function<bool(const VoxelGrid::GRID_INDEX&)> is_filled_fn = [&](const VoxelGrid::GRID_INDEX& index) {
+                const double x = (index.x + 0.5) * resolution, y = (index.y + 0.5) * resolution;
+                return (x - 10) * (x - 10) + (y - 5) * (y - 5) < 1.5 * 1.5;
+            };
+            auto result = sdf_generation::ExtractSignedDistanceField<uint8_t>(Eigen::Isometry3d::Identity(), resolution, 200, 100, 50,
+                                                                              is_filled_fn, std::numeric_limits<float>::infinity(), "world",
+                                                                              sdf_generation::PARALLEL_EDT);
+            return std::make_shared<const sdf_tools::SignedDistanceField>(std::move(result.first));
+        }
+    };
+}
+} //namespace
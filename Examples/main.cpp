@@ -3,6 +3,10 @@
 #include "DataCollection/StereoImageGenerator.hpp"
 #include "DataCollection/DataCollectorSGM.h"
 #include "GaussianMarkovTest.hpp"
+#include "SdfGenerationBenchmark.hpp"
+#include "RpcBatchBenchmark.hpp"
+#include "PolynomialEvaluationBenchmark.hpp"
+#include "SplineCandidatesBenchmark.hpp"
 #include "DepthNav/DepthNavCost.hpp"
 #include "DepthNav/DepthNavThreshold.hpp"
 #include "DepthNav/DepthNavOptAStar.hpp"
@@ -91,6 +95,39 @@ void runGaussianMarkovTest()
     test.run();
 }
 
+void runSdfGenerationBenchmark()
+{
+    using namespace msr::airlib;
+
+    SdfGenerationBenchmark benchmark;
+    benchmark.run();
+}
+
+void runRpcBatchBenchmark()
+{
+    using namespace msr::airlib;
+
+    RpcBatchBenchmark benchmark;
+    benchmark.run();
+}
+
+void runPolynomialEvaluationBenchmark()
+{
+    using namespace msr::airlib;
+
+    PolynomialEvaluationBenchmark benchmark;
+    benchmark.run();
+}
+
+//args: [sdf file saved with simSaveSDF, the generated pillar without one] [candidate count]
+void runSplineCandidatesBenchmark(int argc, const char* argv[])
+{
+    using namespace msr::airlib;
+
+    SplineCandidatesBenchmark benchmark;
+    benchmark.run(argc < 2 ? std::string() : std::string(argv[1]), argc < 3 ? 8 : std::stoi(argv[2]));
+}
+
 void runDepthNavGT()
 {
     typedef ImageCaptureBase::ImageRequest ImageRequest;
@@ -170,6 +207,10 @@ int main(int argc, const char* argv[])
 {
     //runDepthNavGT();
     //runDepthNavSGM();
+    //runSdfGenerationBenchmark();
+    //runRpcBatchBenchmark();
+    //runPolynomialEvaluationBenchmark();
+    //runSplineCandidatesBenchmark(argc, argv);
     runDataCollectorSGM(argc, argv);
 
     return 0;
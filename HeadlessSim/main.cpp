@@ -0,0 +1,171 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include "vehicles/multirotor/MultiRotorParamsFactory.hpp"
+#include "vehicles/multirotor/MultiRotorPhysicsBody.hpp"
+#include "physics/FastPhysicsEngine.hpp"
+#include "physics/LockstepSimDriver.hpp"
+#include "common/common_utils/Timer.hpp"
+#include "common/common_utils/ParallelFor.hpp"
+
+using namespace msr::airlib;
+
+/*
+    Runs SimpleFlight vehicles without Unreal, stepping physics in lock step with a steppable
+    clock as fast as the CPU allows. Each episode flies to a random target and reports the
+    final position error, which makes this a template for Monte-Carlo controller evaluation.
+    Every episode has its own world and clock so episodes run concurrently on worker threads.
+*/
+
+struct EpisodeResult
+{
+    Vector3r target;
+    bool completed;
+    double position_error;
+    double sim_seconds;
+    double real_time_factor;
+};
+
+//vehicle_setting is only read, so episodes on different threads can share it
+static EpisodeResult runEpisode(const AirSimSettings::VehicleSetting* vehicle_setting, const Vector3r& target, double max_sim_seconds)
+{
+    std::unique_ptr<MultiRotorParams> params = MultiRotorParamsFactory::createConfig(
+        vehicle_setting, std::make_shared<SensorFactory>());
+    auto api = params->createMultirotorApi();
+
+    Kinematics kinematics(Kinematics::State::zero());
+    Environment::State initial_environment;
+    initial_environment.position = Vector3r::Zero();
+    initial_environment.geo_point = GeoPoint();
+    Environment environment(initial_environment);
+
+    MultiRotorPhysicsBody vehicle(params.get(), api.get(), &kinematics, &environment);
+    api->setSimulatedGroundTruth(&kinematics.getState(), &environment);
+
+    std::vector<UpdatableObject*> vehicles = { &vehicle };
+    LockstepSimDriver driver(std::unique_ptr<PhysicsEngineBase>(new FastPhysicsEngine()), vehicles);
+
+    //world resets the vehicle but, like the pawn sim api in the simulator, we own its kinematics and firmware
+    {
+        ClockFactory::ScopedThreadClock clock_scope(&driver.getClock());
+        kinematics.reset();
+        api->reset();
+    }
+
+    //there is no renderer to report hits, so the plane z = 0 is the ground and each step reports
+    //touching it for the next one, like the simulator does between ticks
+    driver.setStepCallback([&](uint64_t) {
+        const Vector3r position = vehicle.getKinematics().pose.position;
+        if (position.z() >= 0)
+            vehicle.setCollisionInfo(CollisionInfo(true, Vector3r(0, 0, -1), Vector3r(position.x(), position.y(), 0), position,
+                                                   position.z(), driver.getClock().nowNanos(), "ground", 0));
+        return true;
+    });
+
+    //let sensors and estimator settle before arming
+    driver.runFor(0.1);
+
+    //blocking API calls wait on simulated time so they run on their own thread while we step
+    std::atomic<bool> controller_done(false);
+    std::atomic<bool> completed(false);
+    std::thread controller([&]() {
+        ClockFactory::ScopedThreadClock clock_scope(&driver.getClock());
+        api->enableApiControl(true);
+        api->armDisarm(true);
+        //the episode is judged by reaching the target, takeoff only gets the vehicle off the ground
+        api->takeoff(10);
+        bool ok = api->moveToPosition(target.x(), target.y(), target.z(), 5, static_cast<float>(max_sim_seconds),
+                                      DrivetrainType::MaxDegreeOfFreedom, YawMode(true, 0), -1, 0);
+        completed = ok;
+        controller_done = true;
+    });
+
+    //firmware drops to hover when api commands stop for 60 ms of simulated time, so step one tick
+    //at a time and let the controller thread run in between rather than racing ahead of it
+    while (!controller_done) {
+        driver.step();
+        std::this_thread::yield();
+
+        if (driver.getSimTime() > max_sim_seconds)
+            api->cancelLastTask();
+    }
+    controller.join();
+
+    EpisodeResult result;
+    result.target = target;
+    result.completed = completed;
+    result.position_error = (vehicle.getKinematics().pose.position - target).norm();
+    result.sim_seconds = driver.getSimTime();
+    result.real_time_factor = driver.getRealTimeFactor();
+    return result;
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc > 4) {
+        std::cout << "Usage: " << argv[0] << " [episodes] [max_sim_seconds_per_episode] [threads]" << std::endl;
+        std::cout << "\t where threads = 0 uses all hardware threads" << std::endl;
+        return 1;
+    }
+
+    int episodes = argc > 1 ? std::atoi(argv[1]) : 10;
+    double max_sim_seconds = argc > 2 ? std::atof(argv[2]) : 60;
+    unsigned int threads = argc > 3 ? static_cast<unsigned int>(std::atoi(argv[3])) : 1;
+
+    //keep firmware chatter out of the output
+    Utils::getSetMinLogLevel(true, 100);
+
+    //default settings give the SimpleFlight vehicle the episodes fly, they are loaded here
+    //once before the workers start because loading settings is not thread safe
+    AirSimSettings::initializeSettings("{}");
+    AirSimSettings::singleton().load([]() { return std::string(AirSimSettings::kSimModeTypeMultirotor); });
+    const AirSimSettings::VehicleSetting* vehicle_setting = AirSimSettings::singleton().getVehicleSetting("SimpleFlight");
+
+    std::mt19937 random_engine(42);
+    std::uniform_real_distribution<float> horizontal(-20, 20);
+    std::uniform_real_distribution<float> altitude(-15, -5);
+
+    //draw targets up front so results don't depend on thread count
+    std::vector<Vector3r> targets;
+    for (int episode = 0; episode < episodes; ++episode)
+        targets.push_back(Vector3r(horizontal(random_engine), horizontal(random_engine), altitude(random_engine)));
+
+    std::vector<EpisodeResult> results(targets.size());
+    common_utils::Timer timer;
+    timer.start();
+
+    common_utils::ParallelFor parallel_for(threads);
+    parallel_for.run(targets.size(), [&](size_t episode) {
+        results[episode] = runEpisode(vehicle_setting, targets[episode], max_sim_seconds);
+    });
+
+    double total_sim_seconds = 0, total_error = 0;
+    int completed = 0;
+    for (int episode = 0; episode < episodes; ++episode) {
+        const EpisodeResult& result = results[episode];
+
+        std::cout << "episode " << episode << ": target " << VectorMath::toString(result.target)
+                  << " completed " << result.completed
+                  << " error " << result.position_error << " m"
+                  << " sim " << result.sim_seconds << " s"
+                  << " rtf " << result.real_time_factor << std::endl;
+
+        total_sim_seconds += result.sim_seconds;
+        total_error += result.position_error;
+        completed += result.completed ? 1 : 0;
+    }
+
+    double wall_seconds = timer.seconds();
+    std::cout << parallel_for.getThreadCount() << " threads, ";
+    std::cout << "completed " << completed << "/" << episodes
+              << ", mean error " << (episodes > 0 ? total_error / episodes : 0) << " m"
+              << ", " << total_sim_seconds << " sim s in " << wall_seconds << " wall s"
+              << " (" << total_sim_seconds / wall_seconds << "x real time)" << std::endl;
+
+    return 0;
+}
@@ -13,12 +13,20 @@
 #include "MavLinkTcpServer.hpp"
 #include "MavLinkFtpClient.hpp"
 #include "Semaphore.hpp"
+#include "SpscRing.hpp"
 
 STRICT_MODE_OFF
 #include "json.hpp"
 STRICT_MODE_ON
 
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <deque>
+#include <condition_variable>
+#include <mutex>
+#include <atomic>
+#include <cstring>
 
 using namespace mavlink_utils;
 using namespace mavlinkcom;
@@ -38,6 +46,12 @@ void UnitTests::RunAll(std::string comPort, int boardRate)
     RunTest("SendImageTest", [=] { SendImageTest(); });
     RunTest("SerialPx4Test", [=] { SerialPx4Test(); });
     RunTest("FtpTest", [=] { FtpTest(); });
+    RunTest("FtpThroughputTest", [=] { FtpThroughputTest(); });
+    RunTest("ParamCacheTest", [=] { ParamCacheTest(); });
+    RunTest("UdpSendBatchTest", [=] { UdpSendBatchTest(); });
+    RunTest("SpscRingTest", [=] { SpscRingTest(); });
+    RunTest("MessagesDroppedTest", [=] { MessagesDroppedTest(); });
+    RunTest("FilteredSubscribeTest", [=] { FilteredSubscribeTest(); });
     RunTest("JSonLogTest", [=] { JSonLogTest(); });
 }
 
@@ -398,6 +412,686 @@ void UnitTests::FtpTest()
     connection = nullptr;
 }
 
+// Stand-in for the PX4 ftp server, good enough for reading one file.  Responses are held back by the given
+// latency to look like a radio link, and a fraction of the read responses is dropped to exercise the retries.
+class FtpLoopbackServer
+{
+public:
+    FtpLoopbackServer(std::shared_ptr<MavLinkConnection> connection, const std::vector<uint8_t>& file, int latencyMs, int dropPercent)
+        : file_(file), latency_(latencyMs), drop_percent_(dropPercent)
+    {
+        node_ = std::make_shared<MavLinkNode>(1, 1);
+        node_->connect(connection);
+        subscription_ = connection->subscribe({ MavLinkFileTransferProtocol::kMessageId }, [=](std::shared_ptr<MavLinkConnection> con, const MavLinkMessage& msg) {
+            handleRequest(msg);
+        });
+        connection_ = connection;
+        sender_ = std::thread(&FtpLoopbackServer::sendResponses, this);
+    }
+
+    ~FtpLoopbackServer()
+    {
+        connection_->unsubscribe(subscription_);
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            stopped_ = true;
+        }
+        ready_.notify_one();
+        sender_.join();
+    }
+
+private:
+    // copy of the FtpPayload layout in MavLinkFtpClientImpl.cpp
+    struct Payload
+    {
+        uint16_t seq_number;
+        uint8_t session;
+        uint8_t opcode;
+        uint8_t size;
+        uint8_t req_opcode;
+        uint8_t burst_complete;
+        uint8_t padding;
+        uint32_t offset;
+        uint8_t data;
+    };
+    static const uint8_t kCmdResetSessions = 2;
+    static const uint8_t kCmdOpenFileRO = 4;
+    static const uint8_t kCmdReadFile = 5;
+    static const uint8_t kRspAck = 128;
+    static const uint8_t kRspNak = 129;
+    static const uint8_t kErrEOF = 6;
+    static const uint32_t kMaxDataLength = 251 - 12;
+
+    void handleRequest(const MavLinkMessage& msg)
+    {
+        MavLinkFileTransferProtocol response;
+        response.decode(msg);
+        Payload* payload = reinterpret_cast<Payload*>(&response.payload[0]);
+        uint8_t opcode = payload->opcode;
+        payload->req_opcode = opcode;
+        payload->seq_number++;
+        payload->opcode = kRspAck;
+        if (opcode == kCmdOpenFileRO) {
+            uint32_t size = static_cast<uint32_t>(file_.size());
+            payload->session = 0;
+            payload->size = sizeof(uint32_t);
+            ::memcpy(&payload->data, &size, sizeof(uint32_t));
+        }
+        else if (opcode == kCmdReadFile) {
+            if (payload->offset >= file_.size()) {
+                payload->opcode = kRspNak;
+                payload->size = 1;
+                payload->data = kErrEOF;
+            }
+            else {
+                if (std::rand() % 100 < drop_percent_) {
+                    return;
+                }
+                uint32_t size = std::min(kMaxDataLength, static_cast<uint32_t>(file_.size()) - payload->offset);
+                payload->size = static_cast<uint8_t>(size);
+                ::memcpy(&payload->data, file_.data() + payload->offset, size);
+            }
+        }
+        else if (opcode != kCmdResetSessions) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(mutex_);
+        pending_.push_back(std::make_pair(std::chrono::steady_clock::now() + std::chrono::milliseconds(latency_), response));
+        ready_.notify_one();
+    }
+
+    void sendResponses()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopped_) {
+            if (pending_.empty()) {
+                ready_.wait(lock);
+                continue;
+            }
+            auto due = pending_.front().first;
+            if (std::chrono::steady_clock::now() < due) {
+                ready_.wait_until(lock, due);
+                continue;
+            }
+            MavLinkFileTransferProtocol response = pending_.front().second;
+            pending_.pop_front();
+            lock.unlock();
+            node_->sendMessage(response);
+            lock.lock();
+        }
+    }
+
+    std::vector<uint8_t> file_;
+    int latency_;
+    int drop_percent_;
+    std::shared_ptr<MavLinkNode> node_;
+    std::shared_ptr<MavLinkConnection> connection_;
+    int subscription_ = 0;
+    std::deque<std::pair<std::chrono::steady_clock::time_point, MavLinkFileTransferProtocol>> pending_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stopped_ = false;
+    std::thread sender_;
+};
+
+void UnitTests::FtpThroughputTest()
+{
+    const int testPort = 14590;
+    const int latencyMs = 5; // one way
+    std::vector<uint8_t> file(128 * 1024);
+    for (size_t i = 0; i < file.size(); i++) {
+        file[i] = static_cast<uint8_t>(std::rand());
+    }
+    auto localFile = FileSystem::combine(FileSystem::getTempFolder(), "ftp_throughput.bin");
+
+    struct Run
+    {
+        int window;
+        int dropPercent;
+    };
+    for (Run run : { Run{ 1, 0 }, Run{ 4, 0 }, Run{ 16, 0 }, Run{ 16, 5 } }) {
+        auto serverConnection = MavLinkConnection::connectLocalUdp("ftpserver", "127.0.0.1", testPort);
+        auto clientConnection = MavLinkConnection::connectRemoteUdp("ftpclient", "127.0.0.1", "127.0.0.1", testPort);
+        {
+            FtpLoopbackServer server(serverConnection, file, latencyMs, run.dropPercent);
+            MavLinkFtpClient ftp{ 166, 1 };
+            ftp.connect(clientConnection);
+            ftp.setReadWindow(run.window);
+
+            MavLinkFtpProgress progress;
+            auto start = std::chrono::steady_clock::now();
+            ftp.get(progress, "/fs/microsd/log.ulg", localFile);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            ftp.close();
+            if (progress.error != 0) {
+                throw std::runtime_error(Utils::stringf("ftp get failed with error %d: '%s'", progress.error, progress.message.c_str()));
+            }
+
+            std::ifstream stream(localFile, std::ios::binary);
+            std::vector<uint8_t> received((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+            if (received != file) {
+                throw std::runtime_error(Utils::stringf("downloaded file does not match, got %d of %d bytes", static_cast<int>(received.size()), static_cast<int>(file.size())));
+            }
+            printf("    window %2d, %d%% dropped: %.1f KB/s\n", run.window, run.dropPercent, file.size() / 1024.0 / seconds);
+        }
+        clientConnection->close();
+        serverConnection->close();
+    }
+}
+
+// Stand-in for the PX4 parameter server.  Every dropEvery'th parameter is left out of the streamed list so that
+// the client has to repair the list with individual reads, and _HASH_CHECK answers with the hash set by the test.
+class ParamLoopbackServer
+{
+public:
+    ParamLoopbackServer(std::shared_ptr<MavLinkConnection> connection, int count, int dropEvery, MAV_AUTOPILOT autopilot)
+        : count_(count), drop_every_(dropEvery), autopilot_(autopilot)
+    {
+        node_ = std::make_shared<MavLinkNode>(1, 1);
+        node_->connect(connection);
+        subscription_ = connection->subscribe({ MavLinkHeartbeat::kMessageId, MavLinkParamRequestList::kMessageId, MavLinkParamRequestRead::kMessageId }, [=](std::shared_ptr<MavLinkConnection> con, const MavLinkMessage& msg) {
+            handleRequest(msg);
+        });
+        connection_ = connection;
+    }
+
+    ~ParamLoopbackServer()
+    {
+        connection_->unsubscribe(subscription_);
+    }
+
+    static float valueOf(int index)
+    {
+        return index * 0.5f;
+    }
+
+    void setHash(uint32_t hash)
+    {
+        hash_ = hash;
+    }
+
+    int listRequests()
+    {
+        return list_requests_;
+    }
+
+    int readRequests()
+    {
+        return read_requests_;
+    }
+
+    int hashRequests()
+    {
+        return hash_requests_;
+    }
+
+    // the client learns which autopilot we are from the heartbeat we answer its heartbeat with
+    static void exchangeHeartbeats(MavLinkNode& client, std::shared_ptr<MavLinkConnection> clientConnection)
+    {
+        Semaphore received;
+        int subscription = clientConnection->subscribe({ MavLinkHeartbeat::kMessageId }, [&](std::shared_ptr<MavLinkConnection> con, const MavLinkMessage& msg) {
+            received.post();
+        });
+        client.sendOneHeartbeat();
+        bool found = received.timed_wait(2000);
+        clientConnection->unsubscribe(subscription);
+        if (!found) {
+            throw std::runtime_error("parameter server did not answer the heartbeat");
+        }
+    }
+
+private:
+    void handleRequest(const MavLinkMessage& msg)
+    {
+        if (msg.msgid == MavLinkHeartbeat::kMessageId) {
+            MavLinkHeartbeat hb;
+            hb.autopilot = static_cast<uint8_t>(autopilot_);
+            hb.type = static_cast<uint8_t>(MAV_TYPE::MAV_TYPE_QUADROTOR);
+            hb.mavlink_version = 3;
+            node_->sendMessage(hb);
+            return;
+        }
+        if (msg.msgid == MavLinkParamRequestList::kMessageId) {
+            list_requests_++;
+            for (int i = 0; i < count_; i++) {
+                if (i % drop_every_ != drop_every_ - 1) {
+                    sendParam(i);
+                }
+            }
+            return;
+        }
+
+        MavLinkParamRequestRead read;
+        read.decode(msg);
+        if (read.param_index >= 0) {
+            read_requests_++;
+            sendParam(read.param_index);
+        }
+        else if (std::strncmp(read.param_id, "_HASH_CHECK", sizeof(read.param_id)) == 0) {
+            hash_requests_++;
+            if (autopilot_ != MAV_AUTOPILOT::MAV_AUTOPILOT_PX4) {
+                // only PX4 knows this one
+                return;
+            }
+            MavLinkParamValue value;
+            std::strncpy(value.param_id, "_HASH_CHECK", sizeof(value.param_id));
+            uint32_t hash = hash_;
+            std::memcpy(&value.param_value, &hash, sizeof(uint32_t));
+            value.param_type = static_cast<uint8_t>(MAV_PARAM_TYPE::MAV_PARAM_TYPE_INT32);
+            value.param_count = static_cast<uint16_t>(count_);
+            value.param_index = 65535;
+            node_->sendMessage(value);
+        }
+    }
+
+    void sendParam(int index)
+    {
+        MavLinkParamValue value;
+        std::string name = Utils::stringf("TEST_PARAM_%03d", index);
+        std::strncpy(value.param_id, name.c_str(), sizeof(value.param_id));
+        value.param_value = valueOf(index);
+        value.param_type = static_cast<uint8_t>(MAV_PARAM_TYPE::MAV_PARAM_TYPE_REAL32);
+        value.param_count = static_cast<uint16_t>(count_);
+        value.param_index = static_cast<uint16_t>(index);
+        node_->sendMessage(value);
+    }
+
+    int count_;
+    int drop_every_;
+    MAV_AUTOPILOT autopilot_;
+    std::atomic<uint32_t> hash_{ 0x1234 };
+    std::atomic<int> list_requests_{ 0 };
+    std::atomic<int> read_requests_{ 0 };
+    std::atomic<int> hash_requests_{ 0 };
+    std::shared_ptr<MavLinkNode> node_;
+    std::shared_ptr<MavLinkConnection> connection_;
+    int subscription_ = 0;
+};
+
+void UnitTests::ParamCacheTest()
+{
+    const int testPort = 14591;
+    const int count = 100;
+    const int dropEvery = 7;
+    // a new folder each run, so the first download never finds a cache from an earlier run
+    auto folder = FileSystem::ensureFolder(FileSystem::combine(FileSystem::getTempFolder(),
+                                                               Utils::stringf("param_cache_%lld", static_cast<long long>(std::chrono::system_clock::now().time_since_epoch().count()))));
+
+    auto verify = [&](const std::vector<MavLinkParameter>& params, const char* what) {
+        if (params.size() != count) {
+            throw std::runtime_error(Utils::stringf("%s returned %d of %d parameters", what, static_cast<int>(params.size()), count));
+        }
+        for (int i = 0; i < count; i++) {
+            const MavLinkParameter& p = params[i];
+            if (p.index != i || p.name != Utils::stringf("TEST_PARAM_%03d", i) || p.value != ParamLoopbackServer::valueOf(i)) {
+                throw std::runtime_error(Utils::stringf("%s returned the wrong parameter %d: '%s' = %f", what, i, p.name.c_str(), p.value));
+            }
+        }
+    };
+
+    auto serverConnection = MavLinkConnection::connectLocalUdp("paramserver", "127.0.0.1", testPort);
+    auto clientConnection = MavLinkConnection::connectRemoteUdp("paramclient", "127.0.0.1", "127.0.0.1", testPort);
+    {
+        ParamLoopbackServer server(serverConnection, count, dropEvery, MAV_AUTOPILOT::MAV_AUTOPILOT_PX4);
+        MavLinkNode client{ 166, 1 };
+        client.connect(clientConnection);
+        client.setParamCacheFolder(folder);
+        ParamLoopbackServer::exchangeHeartbeats(client, clientConnection);
+
+        // the streamed list has gaps, only the missing parameters are read one by one
+        verify(client.getParamList(), "download");
+        if (server.listRequests() != 1 || server.readRequests() != count / dropEvery) {
+            throw std::runtime_error(Utils::stringf("download sent %d list and %d read requests, expected 1 and %d", server.listRequests(), server.readRequests(), count / dropEvery));
+        }
+
+        // same hash, the list comes from the cache
+        verify(client.getParamList(), "cached list");
+        if (server.listRequests() != 1) {
+            throw std::runtime_error("parameter list was downloaded again although the hash did not change");
+        }
+
+        // a changed hash makes the cache stale
+        server.setHash(0x5678);
+        verify(client.getParamList(), "download after hash change");
+        if (server.listRequests() != 2) {
+            throw std::runtime_error("stale parameter cache was used after the hash changed");
+        }
+        client.close();
+    }
+    clientConnection->close();
+    serverConnection->close();
+
+    // ArduPilot has no parameter hash, every list is downloaded without asking for one
+    serverConnection = MavLinkConnection::connectLocalUdp("paramserver", "127.0.0.1", testPort + 1);
+    clientConnection = MavLinkConnection::connectRemoteUdp("paramclient", "127.0.0.1", "127.0.0.1", testPort + 1);
+    {
+        ParamLoopbackServer server(serverConnection, count, dropEvery, MAV_AUTOPILOT::MAV_AUTOPILOT_ARDUPILOTMEGA);
+        MavLinkNode client{ 166, 1 };
+        client.connect(clientConnection);
+        client.setParamCacheFolder(folder);
+        ParamLoopbackServer::exchangeHeartbeats(client, clientConnection);
+
+        verify(client.getParamList(), "ArduPilot download");
+        verify(client.getParamList(), "second ArduPilot download");
+        if (server.listRequests() != 2 || server.hashRequests() != 0) {
+            throw std::runtime_error(Utils::stringf("ArduPilot was sent %d list and %d hash requests, expected 2 and 0", server.listRequests(), server.hashRequests()));
+        }
+        client.close();
+    }
+    clientConnection->close();
+    serverConnection->close();
+}
+
+void UnitTests::UdpSendBatchTest()
+{
+    const int testPort = 14592;
+    // more datagrams than one recvmmsg call of the linux UdpClientPort reads
+    const int count = 40;
+
+    auto serverConnection = MavLinkConnection::connectLocalUdp("batchserver", "127.0.0.1", testPort);
+    auto clientConnection = MavLinkConnection::connectRemoteUdp("batchclient", "127.0.0.1", "127.0.0.1", testPort);
+
+    std::mutex mutex;
+    std::vector<uint32_t> received;
+    Semaphore receivedAll;
+    size_t expected = count;
+    serverConnection->subscribe({ MavLinkHeartbeat::kMessageId }, [&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+        MavLinkHeartbeat hb;
+        hb.decode(msg);
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(hb.custom_mode);
+        if (received.size() == expected) {
+            receivedAll.post();
+        }
+    });
+    auto receivedCount = [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received.size();
+    };
+    auto send = [&](uint32_t i) {
+        MavLinkHeartbeat hb;
+        hb.custom_mode = i;
+        hb.mavlink_version = 3;
+        clientConnection->sendMessage(hb);
+    };
+
+    {
+        MavLinkConnection::SendBatch outer(*clientConnection);
+        {
+            // a nested batch leaves the sending to the outer one
+            MavLinkConnection::SendBatch inner(*clientConnection);
+            for (int i = 0; i < count; i++) {
+                send(i);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        if (receivedCount() != 0) {
+            throw std::runtime_error(Utils::stringf("%d messages were sent before the outer batch ended", static_cast<int>(receivedCount())));
+        }
+        outer.end();
+        if (!receivedAll.timed_wait(2000)) {
+            throw std::runtime_error(Utils::stringf("%d of %d batched messages received after 2 seconds", static_cast<int>(receivedCount()), count));
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (received[i] != static_cast<uint32_t>(i)) {
+            throw std::runtime_error(Utils::stringf("batched message %d arrived in position %d", received[i], i));
+        }
+    }
+
+    // leaving the scope ends a batch that was not ended explicitly
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        expected = count + 1;
+    }
+    {
+        MavLinkConnection::SendBatch batch(*clientConnection);
+        send(count);
+    }
+    if (!receivedAll.timed_wait(2000)) {
+        throw std::runtime_error("message of a batch that went out of scope was not sent");
+    }
+
+    // the reader thread of the server is waiting for datagrams while it is closed
+    serverConnection->close();
+    clientConnection->close();
+}
+
+void UnitTests::SpscRingTest()
+{
+    // capacity is rounded up to a power of two, a full ring refuses pushes and an empty one has no front
+    SpscRing<int> ring(5);
+    if (ring.capacity() != 8 || !ring.empty() || ring.front() != nullptr) {
+        throw std::runtime_error(Utils::stringf("new ring of capacity %d is not empty", static_cast<int>(ring.capacity())));
+    }
+    for (int i = 0; i < 8; i++) {
+        int* slot = ring.beginPush();
+        if (slot == nullptr) {
+            throw std::runtime_error(Utils::stringf("ring is full after %d pushes", i));
+        }
+        *slot = i;
+        ring.commitPush();
+    }
+    if (ring.beginPush() != nullptr) {
+        throw std::runtime_error("full ring accepted a push");
+    }
+    if (*ring.front() != 0) {
+        throw std::runtime_error("front of the ring is not the first push");
+    }
+    ring.pop();
+    int* slot = ring.beginPush();
+    if (slot == nullptr) {
+        throw std::runtime_error("ring is still full after a pop");
+    }
+    *slot = 8;
+    ring.commitPush();
+    for (int i = 1; i <= 8; i++) {
+        if (ring.front() == nullptr || *ring.front() != i) {
+            throw std::runtime_error(Utils::stringf("ring did not return item %d in order", i));
+        }
+        ring.pop();
+    }
+    if (!ring.empty() || ring.front() != nullptr) {
+        throw std::runtime_error("ring is not empty after popping every item");
+    }
+
+    // a small ring between two threads fills up and runs empty many times and must keep every item in order
+    const int count = 200000;
+    SpscRing<int> shared(4);
+    std::atomic<int> fullCount{ 0 };
+    std::thread producer([&]() {
+        for (int i = 0; i < count; i++) {
+            int* next;
+            while ((next = shared.beginPush()) == nullptr) {
+                fullCount++;
+                std::this_thread::yield();
+            }
+            *next = i;
+            shared.commitPush();
+        }
+    });
+    int emptyCount = 0;
+    for (int i = 0; i < count; i++) {
+        int* item;
+        while ((item = shared.front()) == nullptr) {
+            emptyCount++;
+            std::this_thread::yield();
+        }
+        if (*item != i) {
+            producer.join();
+            throw std::runtime_error(Utils::stringf("ring returned item %d in position %d", *item, i));
+        }
+        shared.pop();
+    }
+    producer.join();
+    if (!shared.empty()) {
+        throw std::runtime_error("shared ring is not empty after the consumer popped every item");
+    }
+    printf("    ring was full %d times and empty %d times\n", fullCount.load(), emptyCount);
+}
+
+void UnitTests::MessagesDroppedTest()
+{
+    const int testPort = 14593;
+    // more messages than the receive queue of a connection holds
+    const int count = 1500;
+
+    auto serverConnection = MavLinkConnection::connectLocalUdp("dropserver", "127.0.0.1", testPort);
+    auto clientConnection = MavLinkConnection::connectRemoteUdp("dropclient", "127.0.0.1", "127.0.0.1", testPort);
+
+    // the first message blocks the handler, so the queue fills up behind it and the rest is dropped
+    Semaphore blocked;
+    Semaphore release;
+    std::atomic<int> handled{ 0 };
+    serverConnection->subscribe([&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+        if (handled++ == 0) {
+            blocked.post();
+            release.wait();
+        }
+    });
+    auto send = [&](int messages) {
+        for (int i = 0; i < messages; i++) {
+            MavLinkHeartbeat hb;
+            hb.custom_mode = i;
+            hb.mavlink_version = 3;
+            clientConnection->sendMessage(hb);
+            // don't outrun the socket receive buffer, only the queue is meant to overflow
+            if (i % 100 == 99) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        }
+    };
+
+    send(1);
+    if (!blocked.timed_wait(2000)) {
+        throw std::runtime_error("first message was not handled");
+    }
+    send(count - 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    release.post();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    MavLinkTelemetry telemetry;
+    serverConnection->getTelemetry(telemetry);
+    if (telemetry.messages_received != static_cast<uint32_t>(count)) {
+        throw std::runtime_error(Utils::stringf("%d of %d messages received", telemetry.messages_received, count));
+    }
+    if (telemetry.messages_dropped == 0 || telemetry.messages_handled != static_cast<uint32_t>(handled) ||
+        telemetry.messages_dropped + telemetry.messages_handled != telemetry.messages_received) {
+        throw std::runtime_error(Utils::stringf("%d messages dropped and %d handled of %d received", telemetry.messages_dropped, telemetry.messages_handled, telemetry.messages_received));
+    }
+
+    // the counter is reset by reading it and handlers that keep up drop nothing
+    const int handledBefore = handled;
+    send(50);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    serverConnection->getTelemetry(telemetry);
+    if (telemetry.messages_dropped != 0 || handled - handledBefore != 50) {
+        throw std::runtime_error(Utils::stringf("%d messages dropped and %d handled while the handler kept up", telemetry.messages_dropped, handled - handledBefore));
+    }
+
+    serverConnection->close();
+    clientConnection->close();
+}
+
+void UnitTests::FilteredSubscribeTest()
+{
+    const int testPort = 14594;
+
+    auto serverConnection = MavLinkConnection::connectLocalUdp("filterserver", "127.0.0.1", testPort);
+    auto clientConnection = MavLinkConnection::connectRemoteUdp("filterclient", "127.0.0.1", "127.0.0.1", testPort);
+
+    // message ids seen by each subscriber, the semaphore is posted once they all saw what they expect
+    std::mutex mutex;
+    std::vector<uint32_t> heartbeats, attitudesAndHeartbeats, everything;
+    size_t expectedHeartbeats = 0, expectedAttitudesAndHeartbeats = 0, expectedEverything = 0;
+    Semaphore receivedAll;
+    auto record = [&](std::vector<uint32_t>& received, uint32_t msgid) {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(msgid);
+        if (heartbeats.size() == expectedHeartbeats && attitudesAndHeartbeats.size() == expectedAttitudesAndHeartbeats && everything.size() == expectedEverything) {
+            receivedAll.post();
+        }
+    };
+    auto expect = [&](size_t heartbeatCount, size_t attitudeAndHeartbeatCount, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        expectedHeartbeats = heartbeatCount;
+        expectedAttitudesAndHeartbeats = attitudeAndHeartbeatCount;
+        expectedEverything = count;
+    };
+
+    int heartbeatId = serverConnection->subscribe({ MavLinkHeartbeat::kMessageId }, [&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+        record(heartbeats, msg.msgid);
+    });
+    // an id listed twice still calls the handler once per message
+    serverConnection->subscribe({ MavLinkAttitude::kMessageId, MavLinkHeartbeat::kMessageId, MavLinkAttitude::kMessageId }, [&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+        record(attitudesAndHeartbeats, msg.msgid);
+    });
+    serverConnection->subscribe([&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+        record(everything, msg.msgid);
+    });
+
+    // heartbeats, system status and attitude messages in turn
+    auto send = [&](int count) {
+        for (int i = 0; i < count; i++) {
+            if (i % 3 == 0) {
+                MavLinkHeartbeat hb;
+                hb.mavlink_version = 3;
+                clientConnection->sendMessage(hb);
+            }
+            else if (i % 3 == 1) {
+                MavLinkSysStatus status;
+                clientConnection->sendMessage(status);
+            }
+            else {
+                MavLinkAttitude attitude;
+                clientConnection->sendMessage(attitude);
+            }
+        }
+    };
+    auto check = [&](const std::vector<uint32_t>& received, const std::vector<uint32_t>& ids, const char* name) {
+        for (uint32_t msgid : received) {
+            if (std::find(ids.begin(), ids.end(), msgid) == ids.end()) {
+                throw std::runtime_error(Utils::stringf("%s subscriber received message %d", name, msgid));
+            }
+        }
+    };
+
+    const int count = 30;
+    expect(count / 3, 2 * count / 3, count);
+    send(count);
+    if (!receivedAll.timed_wait(2000)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        throw std::runtime_error(Utils::stringf("%d heartbeats, %d attitudes and heartbeats and %d messages received after 2 seconds",
+                                                static_cast<int>(heartbeats.size()), static_cast<int>(attitudesAndHeartbeats.size()), static_cast<int>(everything.size())));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        check(heartbeats, { MavLinkHeartbeat::kMessageId }, "heartbeat");
+        check(attitudesAndHeartbeats, { MavLinkAttitude::kMessageId, MavLinkHeartbeat::kMessageId }, "attitude and heartbeat");
+        for (int i = 0; i < count; i++) {
+            const uint32_t expectedId = i % 3 == 0 ? MavLinkHeartbeat::kMessageId : (i % 3 == 1 ? MavLinkSysStatus::kMessageId : MavLinkAttitude::kMessageId);
+            if (everything[i] != expectedId) {
+                throw std::runtime_error(Utils::stringf("subscriber to every message received message %d in position %d", everything[i], i));
+            }
+        }
+    }
+
+    // after unsubscribing the heartbeat subscriber gets nothing more while the others still do
+    serverConnection->unsubscribe(heartbeatId);
+    expect(count / 3, 2 * count / 3 + 2, count + 3);
+    send(3);
+    if (!receivedAll.timed_wait(2000)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        throw std::runtime_error(Utils::stringf("%d heartbeats, %d attitudes and heartbeats and %d messages received after unsubscribing",
+                                                static_cast<int>(heartbeats.size()), static_cast<int>(attitudesAndHeartbeats.size()), static_cast<int>(everything.size())));
+    }
+
+    serverConnection->close();
+    clientConnection->close();
+}
+
 void UnitTests::JSonLogTest()
 {
     auto connection = MavLinkConnection::connectSerial("px4", com_port_, baud_rate_);
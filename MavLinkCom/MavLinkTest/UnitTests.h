@@ -18,6 +18,12 @@ public:
     void TcpPingTest();
     void SendImageTest();
     void FtpTest();
+    void FtpThroughputTest();
+    void ParamCacheTest();
+    void UdpSendBatchTest();
+    void SpscRingTest();
+    void MessagesDroppedTest();
+    void FilteredSubscribeTest();
     void JSonLogTest();
 
 private:
@@ -147,6 +147,7 @@ std::vector<PortAddress> proxyEndPoints;
 // from kicking in when you try and fly.
 bool noRadio = false;
 bool unitTest = false;
+bool ftpBenchmark = false;
 bool verbose = false;
 bool nsh = false;
 bool noparams = false;
@@ -773,6 +774,7 @@ void PrintUsage()
     printf("    -nsh                                   - enter NuttX shell immediately on connecting with PX4\n");
     printf("    -telemetry                             - generate telemetry mavlink messages for logviewer\n");
     printf("    -wifi:iface                            - add wifi rssi to the telemetry using given wifi interface name (e.g. wplsp0)\n");
+    printf("    -ftpbench                              - measure mavlink ftp download throughput against a local loopback server\n");
     printf("If no arguments it will find a COM port matching the name 'PX4'\n");
     printf("You can specify -proxy multiple times with different port numbers to proxy drone messages out to multiple listeners\n");
 }
@@ -951,6 +953,9 @@ bool ParseCommandLine(int argc, const char* argv[])
             else if (lower == "test") {
                 unitTest = true;
             }
+            else if (lower == "ftpbench") {
+                ftpBenchmark = true;
+            }
             else if (lower == "verbose") {
                 verbose = true;
             }
@@ -1534,6 +1539,12 @@ int main(int argc, const char* argv[])
             return 0;
         }
 
+        if (ftpBenchmark) {
+            UnitTests test;
+            test.FtpThroughputTest();
+            return 0;
+        }
+
         if (!connect()) {
             return 1;
         }
@@ -0,0 +1,87 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef MavLinkCom_SpscRing_hpp
+#define MavLinkCom_SpscRing_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace mavlink_utils
+{
+
+// Bounded lock free queue for exactly one producer thread and one consumer thread.
+// All slots are allocated up front and items are written and read in place, so nothing
+// is allocated or copied through a temporary while messages flow.
+//
+// Producer: T* slot = ring.beginPush(); if (slot) { fill *slot; ring.commitPush(); }
+// Consumer: T* item = ring.front(); if (item) { use *item; ring.pop(); }
+template <typename T>
+class SpscRing
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    size_t capacity() const
+    {
+        return slots_.size();
+    }
+
+    // producer only, returns null when the ring is full
+    T* beginPush()
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slots_.size())
+            return nullptr;
+        return &slots_[tail & mask_];
+    }
+
+    // producer only, publishes the slot returned by beginPush
+    void commitPush()
+    {
+        tail_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    // consumer only, returns null when the ring is empty
+    T* front()
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_seq_cst))
+            return nullptr;
+        return &slots_[head & mask_];
+    }
+
+    // consumer only, releases the slot returned by front
+    void pop()
+    {
+        head_.fetch_add(1, std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_seq_cst);
+    }
+
+private:
+    static const size_t kCacheLine = 64;
+
+    // producer and consumer indices on separate cache lines so they don't bounce between cores
+    std::atomic<size_t> head_{ 0 };
+    char head_padding_[kCacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_{ 0 };
+    char tail_padding_[kCacheLine - sizeof(std::atomic<size_t>)];
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+};
+}
+
+#endif
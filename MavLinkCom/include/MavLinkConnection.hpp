@@ -104,6 +104,9 @@ public:
 
     // provide a callback function that will be called for every message "received" from the remote mavlink node.
     int subscribe(MessageHandler handler);
+    // same, but only for messages with one of the given ids.  Prefer this to filtering on msgid inside the handler,
+    // messages nobody asked for are then not handed to the handler at all.
+    int subscribe(const std::vector<uint32_t>& messageIds, MessageHandler handler);
     void unsubscribe(int id);
 
     // log every message that is "sent" using sendMessage.
@@ -127,6 +130,28 @@ public:
     // Send the given already encoded message, assuming the compid and sysid have been set by the caller.
     void sendMessage(const MavLinkMessage& msg);
 
+    // Hold back messages sent on this connection until the matching endSendBatch, which sends them as one
+    // burst (a single system call on linux udp connections).  Batches can be nested, the outermost one sends.
+    void beginSendBatch();
+    void endSendBatch();
+
+    // Begins a send batch on the connection and ends it on every way out of the scope that holds it.
+    class SendBatch
+    {
+    public:
+        explicit SendBatch(MavLinkConnection& connection);
+        // ends the batch if end() was not called, a send error is then ignored as this is typically during unwinding.
+        ~SendBatch();
+        // sends the messages held back so far, and throws if that fails.
+        void end();
+
+    private:
+        SendBatch(const SendBatch&) = delete;
+        SendBatch& operator=(const SendBatch&) = delete;
+        MavLinkConnection& connection_;
+        bool ended_ = false;
+    };
+
     // get the next telemetry snapshot, then clear the internal counters and start over.  This way each snapshot
     // gives you a picture of what happened in whatever timeslice you decide to call this method.  This is packaged
     // in a mavlink message so you can easily send it to the LogViewer.
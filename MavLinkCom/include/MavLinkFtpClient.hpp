@@ -55,6 +55,10 @@ public:
     void rmdir(MavLinkFtpProgress& progress, const std::string& remotePath);
 
     void cancel(); // cancel any pending operation.
+
+    // number of read requests get keeps outstanding, default 16.  1 waits for each block before asking for the next,
+    // which is what servers that can't handle concurrent reads of one session need.
+    void setReadWindow(int requests);
 };
 }
 
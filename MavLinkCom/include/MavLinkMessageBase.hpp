@@ -140,7 +140,7 @@ class MavLinkTelemetry : public MavLinkMessageBase
 {
 public:
     const static uint8_t kMessageId = 204; // in the user range 180-229.
-    const static int MessageLength = 12 * 4;
+    const static int MessageLength = 13 * 4;
     MavLinkTelemetry() { msgid = kMessageId; }
     uint32_t messages_sent = 0; // number of messages sent since the last telemetry message
     uint32_t messages_received = 0; // number of messages received since the last telemetry message
@@ -154,6 +154,7 @@ public:
     uint32_t sensor_rate = 0; // rate we are sending HIL_SENSOR messages
     uint32_t lock_step_resets = 0; // total number of lock_step resets
     uint32_t update_time = 0; // time inside MavLinkMultiRotorApi::update() method
+    uint32_t messages_dropped = 0; // number of received messages dropped because the handlers fell behind since the last telemetry message
 
     // not serialized
     const char* wifiInterfaceName = nullptr; // the name of the wifi interface we are measuring RSSI on.
@@ -167,6 +168,7 @@ public:
         result << "\"messages_received\":" << this->messages_received << ",";
         result << "\"messages_handled\":" << this->messages_handled << ",";
         result << "\"crc_errors\":" << this->crc_errors << ",";
+        result << "\"messages_dropped\":" << this->messages_dropped << ",";
         result << "\"handler_microseconds\":" << this->handler_microseconds << ",";
         result << "\"render_time\":" << this->render_time;
         result << "\"wifi_rssi\":" << this->wifi_rssi;
@@ -56,6 +56,12 @@ public:
     // get the parameter from last getParamList download.
     MavLinkParameter getCachedParameter(const std::string& name);
 
+    // keep a copy of the parameters downloaded by getParamList in the given folder, so that the next getParamList
+    // can skip the download when the vehicle reports the same parameter hash (PX4 _HASH_CHECK).  Empty (the default)
+    // turns the cache off.  The cache is only used once a heartbeat says the vehicle runs PX4, other autopilots
+    // don't answer the hash request and always download.
+    void setParamCacheFolder(const std::string& folder);
+
     // get a single parameter by name.
     AsyncResult<MavLinkParameter> getParameter(const std::string& name);
 
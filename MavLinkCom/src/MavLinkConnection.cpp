@@ -109,11 +109,51 @@ void MavLinkConnection::sendMessage(const MavLinkMessage& msg)
     pImpl->sendMessage(msg);
 }
 
+void MavLinkConnection::beginSendBatch()
+{
+    pImpl->beginSendBatch();
+}
+
+void MavLinkConnection::endSendBatch()
+{
+    pImpl->endSendBatch();
+}
+
+MavLinkConnection::SendBatch::SendBatch(MavLinkConnection& connection)
+    : connection_(connection)
+{
+    connection_.beginSendBatch();
+}
+
+MavLinkConnection::SendBatch::~SendBatch()
+{
+    if (!ended_) {
+        try {
+            connection_.endSendBatch();
+        }
+        catch (const std::exception&) {
+        }
+    }
+}
+
+void MavLinkConnection::SendBatch::end()
+{
+    if (!ended_) {
+        ended_ = true;
+        connection_.endSendBatch();
+    }
+}
+
 int MavLinkConnection::subscribe(MessageHandler handler)
 {
     return pImpl->subscribe(handler);
 }
 
+int MavLinkConnection::subscribe(const std::vector<uint32_t>& messageIds, MessageHandler handler)
+{
+    return pImpl->subscribe(messageIds, handler);
+}
+
 void MavLinkConnection::unsubscribe(int id)
 {
     pImpl->unsubscribe(id);
@@ -28,6 +28,12 @@ void MavLinkFtpClient::cancel()
     ptr->cancel();
 }
 
+void MavLinkFtpClient::setReadWindow(int requests)
+{
+    auto ptr = dynamic_cast<MavLinkFtpClientImpl*>(pImpl.get());
+    ptr->setReadWindow(requests);
+}
+
 void MavLinkFtpClient::list(MavLinkFtpProgress& progress, const std::string& remotePath, std::vector<MavLinkFileInfo>& files)
 {
     auto ptr = dynamic_cast<MavLinkFtpClientImpl*>(pImpl.get());
@@ -310,6 +310,7 @@ int MavLinkTelemetry::pack(char* buffer) const
     pack_int32_t(buffer, reinterpret_cast<const int32_t*>(&this->sensor_rate), 36);
     pack_int32_t(buffer, reinterpret_cast<const int32_t*>(&this->lock_step_resets), 40);
     pack_int32_t(buffer, reinterpret_cast<const int32_t*>(&this->update_time), 44);
+    pack_int32_t(buffer, reinterpret_cast<const int32_t*>(&this->messages_dropped), 48);
     return MavLinkTelemetry::MessageLength;
 }
 
@@ -327,6 +328,7 @@ int MavLinkTelemetry::unpack(const char* buffer)
     unpack_int32_t(buffer, reinterpret_cast<int32_t*>(&this->sensor_rate), 36);
     unpack_int32_t(buffer, reinterpret_cast<int32_t*>(&this->lock_step_resets), 40);
     unpack_int32_t(buffer, reinterpret_cast<int32_t*>(&this->update_time), 44);
+    unpack_int32_t(buffer, reinterpret_cast<int32_t*>(&this->messages_dropped), 48);
     return MavLinkTelemetry::MessageLength;
 }
 
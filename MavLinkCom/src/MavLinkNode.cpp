@@ -51,6 +51,11 @@ MavLinkParameter MavLinkNode::getCachedParameter(const std::string& name)
     return pImpl->getCachedParameter(name);
 }
 
+void MavLinkNode::setParamCacheFolder(const std::string& folder)
+{
+    pImpl->setParamCacheFolder(folder);
+}
+
 AsyncResult<MavLinkParameter> MavLinkNode::getParameter(const std::string& name)
 {
     return pImpl->getParameter(name);
@@ -14,13 +14,8 @@ using namespace mavlink_utils;
 using namespace mavlinkcom_impl;
 
 MavLinkConnectionImpl::MavLinkConnectionImpl()
+    : msg_queue_(kMessageQueueCapacity)
 {
-    // add our custom telemetry message length.
-    telemetry_.crc_errors = 0;
-    telemetry_.handler_microseconds = 0;
-    telemetry_.messages_handled = 0;
-    telemetry_.messages_received = 0;
-    telemetry_.messages_sent = 0;
     closed = true;
     ::memset(&mavlink_intermediate_status_, 0, sizeof(mavlink_status_t));
     ::memset(&mavlink_status_, 0, sizeof(mavlink_status_t));
@@ -236,17 +231,58 @@ void MavLinkConnectionImpl::sendMessage(const MavLinkMessage& m)
         std::lock_guard<std::mutex> guard(buffer_mutex);
         unsigned len = mavlink_msg_to_send_buffer(message_buf, &message);
 
-        try {
-            port->write(message_buf, len);
+        if (send_batch_depth_ > 0) {
+            send_batch_data_.insert(send_batch_data_.end(), message_buf, message_buf + len);
+            send_batch_lengths_.push_back(static_cast<int>(len));
+            if (send_batch_lengths_.size() >= kMaxSendBatch) {
+                flushSendBatch();
+            }
         }
-        catch (std::exception& e) {
-            throw std::runtime_error(Utils::stringf("MavLinkConnectionImpl: Error sending message on connection '%s', details: %s", name.c_str(), e.what()));
+        else {
+            try {
+                port->write(message_buf, len);
+            }
+            catch (std::exception& e) {
+                throw std::runtime_error(Utils::stringf("MavLinkConnectionImpl: Error sending message on connection '%s', details: %s", name.c_str(), e.what()));
+            }
         }
     }
-    {
-        std::lock_guard<std::mutex> guard(telemetry_mutex_);
-        telemetry_.messages_sent++;
+    messages_sent_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MavLinkConnectionImpl::beginSendBatch()
+{
+    std::lock_guard<std::mutex> guard(buffer_mutex);
+    send_batch_depth_++;
+}
+
+void MavLinkConnectionImpl::endSendBatch()
+{
+    std::lock_guard<std::mutex> guard(buffer_mutex);
+    if (send_batch_depth_ > 0 && --send_batch_depth_ == 0) {
+        flushSendBatch();
+    }
+}
+
+// caller holds buffer_mutex
+void MavLinkConnectionImpl::flushSendBatch()
+{
+    if (send_batch_lengths_.empty()) {
+        return;
+    }
+    try {
+        if (!closed) {
+            port->writePackets(send_batch_data_.data(), send_batch_lengths_.data(), static_cast<int>(send_batch_lengths_.size()));
+        }
+    }
+    catch (std::exception& e) {
+        send_batch_data_.clear();
+        send_batch_lengths_.clear();
+        throw std::runtime_error(Utils::stringf("MavLinkConnectionImpl: Error sending message on connection '%s', details: %s", name.c_str(), e.what()));
     }
+    // clear keeps the capacity, so the next burst doesn't allocate
+    send_batch_data_.clear();
+    send_batch_lengths_.clear();
 }
 
 int MavLinkConnectionImpl::prepareForSending(MavLinkMessage& msg)
@@ -355,8 +391,13 @@ void MavLinkConnectionImpl::sendMessage(const MavLinkMessageBase& msg)
 
 int MavLinkConnectionImpl::subscribe(MessageHandler handler)
 {
-    MessageHandlerEntry entry = { static_cast<int>(listeners.size() + 1), handler = handler };
+    return subscribe(std::vector<uint32_t>(), handler);
+}
+
+int MavLinkConnectionImpl::subscribe(const std::vector<uint32_t>& messageIds, MessageHandler handler)
+{
     std::lock_guard<std::mutex> guard(listener_mutex);
+    MessageHandlerEntry entry = { next_listener_id_++, handler, messageIds };
     listeners.push_back(entry);
     snapshot_stale = true;
     return entry.id;
@@ -434,8 +475,7 @@ void MavLinkConnectionImpl::readPackets()
                 continue;
             }
             else if (frame_state == MAVLINK_FRAMING_BAD_CRC) {
-                std::lock_guard<std::mutex> guard(telemetry_mutex_);
-                telemetry_.crc_errors++;
+                crc_errors_.fetch_add(1, std::memory_order_relaxed);
             }
             else if (frame_state == MAVLINK_FRAMING_OK) {
                 // pick up the sysid/compid of the remote node we are connected to.
@@ -453,36 +493,36 @@ void MavLinkConnectionImpl::readPackets()
                 }
 
                 if (con_ != nullptr && !closed) {
-                    {
-                        std::lock_guard<std::mutex> guard(telemetry_mutex_);
-                        telemetry_.messages_received++;
-                    }
-                    // queue event for publishing.
-                    {
-                        std::lock_guard<std::mutex> guard(msg_queue_mutex_);
-                        MavLinkMessage message;
-                        message.compid = msg.compid;
-                        message.sysid = msg.sysid;
-                        message.len = msg.len;
-                        message.checksum = msg.checksum;
-                        message.magic = msg.magic;
-                        message.incompat_flags = msg.incompat_flags;
-                        message.compat_flags = msg.compat_flags;
-                        message.seq = msg.seq;
-                        message.msgid = msg.msgid;
-                        message.protocol_version = supports_mavlink2_ ? 2 : 1;
-                        ::memcpy(message.signature, msg.signature, 13);
-                        ::memcpy(message.payload64, msg.payload64, PayloadSize * sizeof(uint64_t));
-                        msg_queue_.push(message);
+                    messages_received_.fetch_add(1, std::memory_order_relaxed);
+
+                    // queue event for publishing, straight into the ring slot. When the handlers
+                    // have fallen a whole ring behind, the newest message is dropped and counted.
+                    MavLinkMessage* message = msg_queue_.beginPush();
+                    if (message == nullptr) {
+                        messages_dropped_.fetch_add(1, std::memory_order_relaxed);
+                        continue;
                     }
+                    message->compid = msg.compid;
+                    message->sysid = msg.sysid;
+                    message->len = msg.len;
+                    message->checksum = msg.checksum;
+                    message->magic = msg.magic;
+                    message->incompat_flags = msg.incompat_flags;
+                    message->compat_flags = msg.compat_flags;
+                    message->seq = msg.seq;
+                    message->msgid = msg.msgid;
+                    message->protocol_version = supports_mavlink2_ ? 2 : 1;
+                    ::memcpy(message->signature, msg.signature, 13);
+                    ::memcpy(message->payload64, msg.payload64, PayloadSize * sizeof(uint64_t));
+                    msg_queue_.commitPush();
+
                     if (waiting_for_msg_) {
                         msg_available_.post();
                     }
                 }
             }
             else {
-                std::lock_guard<std::mutex> guard(telemetry_mutex_);
-                telemetry_.crc_errors++;
+                crc_errors_.fetch_add(1, std::memory_order_relaxed);
             }
         }
 
@@ -494,21 +534,9 @@ void MavLinkConnectionImpl::readPackets()
 
 void MavLinkConnectionImpl::drainQueue()
 {
-    MavLinkMessage message;
-    bool hasMsg = true;
-    while (hasMsg) {
-        hasMsg = false;
-        {
-            std::lock_guard<std::mutex> guard(msg_queue_mutex_);
-            if (!msg_queue_.empty()) {
-                message = msg_queue_.front();
-                msg_queue_.pop();
-                hasMsg = true;
-            }
-        }
-        if (!hasMsg) {
-            return;
-        }
+    // handlers see the message in its ring slot, which readPackets won't reuse until it is popped
+    for (MavLinkMessage* next = msg_queue_.front(); next != nullptr; next = msg_queue_.front()) {
+        const MavLinkMessage& message = *next;
 
         if (receiveLog_ != nullptr) {
             receiveLog_->write(message);
@@ -517,16 +545,11 @@ void MavLinkConnectionImpl::drainQueue()
         // publish the message from this thread, this is safer than publishing from the readPackets thread
         // as it ensures we don't lose messages if the listener is slow.
         if (snapshot_stale) {
-            // this is tricky, the clear has to be done outside the lock because it is destructing the handlers
-            // and the handler might try and call unsubscribe, which needs to be able to grab the lock, otherwise
-            // we would get a deadlock.
-            snapshot.clear();
-
-            std::lock_guard<std::mutex> guard(listener_mutex);
-            snapshot = listeners;
-            snapshot_stale = false;
+            updateSnapshot();
         }
-        auto end = snapshot.end();
+        auto found = snapshot_by_id_.find(message.msgid);
+        const std::vector<MessageHandlerEntry>& handlers = found != snapshot_by_id_.end() ? found->second : snapshot;
+        auto end = handlers.end();
 
         if (message.msgid == static_cast<uint8_t>(MavLinkMessageIds::MAVLINK_MSG_ID_AUTOPILOT_VERSION)) {
             MavLinkAutopilotVersion cap;
@@ -538,7 +561,7 @@ void MavLinkConnectionImpl::drainQueue()
 
         auto startTime = std::chrono::system_clock::now();
         std::shared_ptr<MavLinkConnection> sharedPtr = std::shared_ptr<MavLinkConnection>(this->con_);
-        for (auto ptr = snapshot.begin(); ptr != end; ptr++) {
+        for (auto ptr = handlers.begin(); ptr != end; ptr++) {
             try {
                 (*ptr).handler(sharedPtr, message);
             }
@@ -555,11 +578,46 @@ void MavLinkConnectionImpl::drainQueue()
             auto endTime = std::chrono::system_clock::now();
             auto diff = endTime - startTime;
             long microseconds = static_cast<long>(std::chrono::duration_cast<std::chrono::microseconds>(diff).count());
-            std::lock_guard<std::mutex> guard(telemetry_mutex_);
-            telemetry_.messages_handled++;
-            telemetry_.handler_microseconds += microseconds;
+            messages_handled_.fetch_add(1, std::memory_order_relaxed);
+            handler_microseconds_.fetch_add(static_cast<uint32_t>(microseconds), std::memory_order_relaxed);
+        }
+
+        msg_queue_.pop();
+    }
+}
+
+void MavLinkConnectionImpl::updateSnapshot()
+{
+    // this is tricky, the clear has to be done outside the lock because it is destructing the handlers
+    // and the handler might try and call unsubscribe, which needs to be able to grab the lock, otherwise
+    // we would get a deadlock.
+    snapshot.clear();
+    snapshot_by_id_.clear();
+
+    std::lock_guard<std::mutex> guard(listener_mutex);
+    for (const MessageHandlerEntry& entry : listeners) {
+        for (uint32_t id : entry.message_ids) {
+            snapshot_by_id_[id];
+        }
+    }
+    for (const MessageHandlerEntry& entry : listeners) {
+        if (entry.message_ids.empty()) {
+            snapshot.push_back(entry);
+            for (auto& pair : snapshot_by_id_) {
+                pair.second.push_back(entry);
+            }
+        }
+        else {
+            for (uint32_t id : entry.message_ids) {
+                std::vector<MessageHandlerEntry>& handlers = snapshot_by_id_[id];
+                // the same id may be listed twice, still call the handler once
+                if (handlers.empty() || handlers.back().id != entry.id) {
+                    handlers.push_back(entry);
+                }
+            }
         }
     }
+    snapshot_stale = false;
 }
 
 void MavLinkConnectionImpl::publishPackets()
@@ -572,7 +630,11 @@ void MavLinkConnectionImpl::publishPackets()
         drainQueue();
 
         waiting_for_msg_ = true;
-        msg_available_.wait();
+        // readPackets may have queued a message after drainQueue returned but before it could see
+        // waiting_for_msg_, so check again before sleeping
+        if (msg_queue_.empty()) {
+            msg_available_.wait();
+        }
         waiting_for_msg_ = false;
     }
 }
@@ -586,12 +648,13 @@ void MavLinkConnectionImpl::getTelemetry(MavLinkTelemetry& result)
 {
     std::lock_guard<std::mutex> guard(telemetry_mutex_);
     result = telemetry_;
-    // reset counters
-    telemetry_.crc_errors = 0;
-    telemetry_.handler_microseconds = 0;
-    telemetry_.messages_handled = 0;
-    telemetry_.messages_received = 0;
-    telemetry_.messages_sent = 0;
+    // collect and reset counters
+    result.crc_errors = crc_errors_.exchange(0);
+    result.handler_microseconds = handler_microseconds_.exchange(0);
+    result.messages_handled = messages_handled_.exchange(0);
+    result.messages_received = messages_received_.exchange(0);
+    result.messages_sent = messages_sent_.exchange(0);
+    result.messages_dropped = messages_dropped_.exchange(0);
     if (telemetry_.wifiInterfaceName != nullptr) {
         telemetry_.wifi_rssi = port->getRssi(telemetry_.wifiInterfaceName);
     }
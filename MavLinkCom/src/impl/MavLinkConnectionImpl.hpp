@@ -4,15 +4,17 @@
 #ifndef MavLinkCom_MavLinkConnectionImpl_hpp
 #define MavLinkCom_MavLinkConnectionImpl_hpp
 
+#include <atomic>
 #include <memory>
 #include <vector>
-#include <queue>
 #include <thread>
 #include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 #include "MavLinkConnection.hpp"
 #include "MavLinkMessageBase.hpp"
 #include "Semaphore.hpp"
+#include "SpscRing.hpp"
 #include "../serial_com/TcpClientPort.hpp"
 #include "StrictMode.hpp"
 #define MAVLINK_PACKED
@@ -52,7 +54,10 @@ public:
     bool isOpen();
     void sendMessage(const MavLinkMessageBase& msg);
     void sendMessage(const MavLinkMessage& msg);
+    void beginSendBatch();
+    void endSendBatch();
     int subscribe(MessageHandler handler);
+    int subscribe(const std::vector<uint32_t>& messageIds, MessageHandler handler);
     void unsubscribe(int id);
     uint8_t getNextSequence();
     void join(std::shared_ptr<MavLinkConnection> remote, bool subscribeToLeft = true, bool subscribeToRight = true);
@@ -68,6 +73,8 @@ private:
     void publishPackets();
     void readPackets();
     void drainQueue();
+    void updateSnapshot();
+    void flushSendBatch();
     std::string name;
     std::shared_ptr<Port> port;
     std::shared_ptr<MavLinkConnection> con_;
@@ -85,23 +92,41 @@ private:
     public:
         int id;
         MessageHandler handler;
+        std::vector<uint32_t> message_ids; // empty means every message
     };
     std::vector<MessageHandlerEntry> listeners;
+    int next_listener_id_ = 1;
+    // copies of listeners used by the publish thread: the handlers for messages nobody subscribed to by id, and
+    // for each id that somebody did subscribe to, all handlers for that id, both in subscription order.
     std::vector<MessageHandlerEntry> snapshot;
+    std::unordered_map<uint32_t, std::vector<MessageHandlerEntry>> snapshot_by_id_;
     bool snapshot_stale;
     std::mutex listener_mutex;
     uint8_t message_buf[300]; // must be bigger than sizeof(mavlink_message_t), which is currently 292.
     std::mutex buffer_mutex;
+    // encoded messages held back by beginSendBatch, guarded by buffer_mutex
+    static const size_t kMaxSendBatch = 64;
+    int send_batch_depth_ = 0;
+    std::vector<uint8_t> send_batch_data_;
+    std::vector<int> send_batch_lengths_;
     bool closed;
     std::thread publish_thread_;
-    std::queue<MavLinkMessage> msg_queue_;
-    std::mutex msg_queue_mutex_;
+    // received messages waiting for the publish thread, written only by readPackets and read only by drainQueue
+    static const size_t kMessageQueueCapacity = 1024;
+    mavlink_utils::SpscRing<MavLinkMessage> msg_queue_;
     mavlink_utils::Semaphore msg_available_;
-    bool waiting_for_msg_ = false;
+    std::atomic<bool> waiting_for_msg_{ false };
     bool supports_mavlink2_ = false;
     std::thread::id publish_thread_id_;
     mavlink_status_t mavlink_intermediate_status_;
     mavlink_status_t mavlink_status_;
+    // counters are updated on the hot paths without locking and collected by getTelemetry
+    std::atomic<uint32_t> messages_sent_{ 0 };
+    std::atomic<uint32_t> messages_received_{ 0 };
+    std::atomic<uint32_t> messages_handled_{ 0 };
+    std::atomic<uint32_t> messages_dropped_{ 0 };
+    std::atomic<uint32_t> crc_errors_{ 0 };
+    std::atomic<uint32_t> handler_microseconds_{ 0 };
     std::mutex telemetry_mutex_;
     MavLinkTelemetry telemetry_;
     std::unordered_set<uint8_t> ignored_messageids;
@@ -14,6 +14,8 @@ using milliseconds = std::chrono::milliseconds;
 
 #define MAXIMUM_ROUND_TRIP_TIME 200 // 200 milliseconds should be plenty of time for single round trip to remote node.
 #define TIMEOUT_INTERVAL 10 // 10 * MAXIMUM_ROUND_TRIP_TIME means we have a problem.
+#define MINIMUM_READ_TIMEOUT 20 // shortest time we wait for a windowed read response before asking again.
+#define MAXIMUM_READ_ATTEMPTS 10 // give up on a windowed read after this many requests for the same offset.
 
 // These definitions are copied from PX4 implementation
 
@@ -86,6 +88,8 @@ static const char kDirentFile = 'F'; ///< Identifies File returned from List com
 static const char kDirentDir = 'D'; ///< Identifies Directory returned from List command
 static const char kDirentSkip = 'S'; ///< Identifies Skipped entry from List command
 
+static const uint32_t kMaxDataLength = 251 - 12; ///< bytes of data that fit in one message after the payload header
+
 MavLinkFtpClientImpl::MavLinkFtpClientImpl(int localSystemId, int localComponentId)
     : MavLinkNodeImpl(localSystemId, localComponentId)
 {
@@ -106,10 +110,15 @@ bool MavLinkFtpClientImpl::isSupported()
     return (ver.capabilities & static_cast<int>(MAV_PROTOCOL_CAPABILITY::MAV_PROTOCOL_CAPABILITY_FTP)) != 0;
 }
 
+void MavLinkFtpClientImpl::setReadWindow(int requests)
+{
+    read_window_ = requests < 1 ? 1 : requests;
+}
+
 void MavLinkFtpClientImpl::subscribe()
 {
     if (subscription_ == 0) {
-        subscription_ = getConnection()->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
+        subscription_ = getConnection()->subscribe({ static_cast<uint32_t>(MavLinkMessageIds::MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL) }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg) {
             unused(connection);
             handleResponse(msg);
         });
@@ -151,8 +160,10 @@ void MavLinkFtpClientImpl::get(MavLinkFtpProgress& progress, const std::string&
     bytes_read_ = 0;
     file_size_ = 0;
     remote_file_open_ = false;
+    clearReadWindow();
 
     runStateMachine();
+    clearReadWindow();
     progress_ = nullptr;
     progress.complete = true;
 }
@@ -246,6 +257,13 @@ void MavLinkFtpClientImpl::runStateMachine()
     double totalSleep = 0;
 
     while (waiting_) {
+        if (windowed_read_) {
+            // windowed reads time out each request on its own, based on the measured round trip time.
+            std::this_thread::sleep_for(std::chrono::milliseconds(MINIMUM_READ_TIMEOUT / 2));
+            checkReadTimeouts();
+            totalSleep = 0;
+            continue;
+        }
         std::this_thread::sleep_for(std::chrono::milliseconds(monitorInterval));
         totalSleep += monitorInterval;
 
@@ -611,7 +629,17 @@ void MavLinkFtpClientImpl::handleReadResponse()
         if (progress_ != nullptr) {
             progress_->goal = file_size_;
         }
-        nextStep();
+        if (read_window_ > 1 && file_size_ > 0) {
+            session_ = payload->session;
+            startWindowedRead();
+        }
+        else {
+            // unknown size, read one block at a time until EOF.
+            nextStep();
+        }
+    }
+    else if (windowed_read_) {
+        handleWindowedRead(payload->offset, &payload->data, payload->size);
     }
     else if (payload->req_opcode == kCmdReadFile) {
         int seq = static_cast<int>(payload->seq_number);
@@ -630,6 +658,187 @@ void MavLinkFtpClientImpl::handleReadResponse()
     }
 }
 
+void MavLinkFtpClientImpl::startWindowedRead()
+{
+    // createLocalFile clears file_size_, but here it is the size of the remote file.
+    uint64_t size = file_size_;
+    if (!createLocalFile()) {
+        // could not create the local file, so stop.
+        reset();
+        waiting_ = false;
+        return;
+    }
+    file_size_ = size;
+    std::lock_guard<std::mutex> guard(window_mutex_);
+    windowed_read_ = true;
+    fillReadWindow();
+}
+
+// caller holds window_mutex_
+void MavLinkFtpClientImpl::fillReadWindow()
+{
+    while (pending_reads_.size() < static_cast<size_t>(read_window_) && next_offset_ < file_size_) {
+        sendReadRequest(next_offset_, 1);
+        next_offset_ += kMaxDataLength;
+    }
+}
+
+// caller holds window_mutex_
+void MavLinkFtpClientImpl::sendReadRequest(uint32_t offset, int attempts)
+{
+    MavLinkFileTransferProtocol ftp;
+    FtpPayload* payload = reinterpret_cast<FtpPayload*>(&ftp.payload[0]);
+    ftp.target_component = getTargetComponentId();
+    ftp.target_system = getTargetSystemId();
+    payload->seq_number = static_cast<uint16_t>(++sequence_);
+    payload->session = session_;
+    payload->opcode = kCmdReadFile;
+    payload->size = static_cast<uint8_t>(kMaxDataLength);
+    payload->offset = offset;
+    pending_reads_[offset] = PendingRead{ std::chrono::steady_clock::now(), attempts };
+    sendMessage(ftp);
+    recordMessageSent();
+}
+
+void MavLinkFtpClientImpl::handleWindowedRead(uint32_t offset, const uint8_t* data, uint32_t size)
+{
+    std::lock_guard<std::mutex> guard(window_mutex_);
+    auto ptr = pending_reads_.find(offset);
+    if (ptr == pending_reads_.end() || file_ptr_ == nullptr) {
+        // a late answer to a request we already got a response for.
+        return;
+    }
+    if (ptr->second.attempts == 1) {
+        // only responses to requests that were sent once tell us the round trip time.
+        updateRoundTripTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - ptr->second.sent).count());
+    }
+    pending_reads_.erase(ptr);
+    retries_ = 0;
+
+    if (size == 0) {
+        // the file is shorter than it was when we opened it.
+        handleWindowedReadEof(offset);
+        return;
+    }
+
+    // responses arrive in any order, so each block goes straight to its place in the file.
+    fseek(file_ptr_, static_cast<long>(offset), SEEK_SET);
+    fwrite(data, size, 1, file_ptr_);
+    bytes_read_ += size;
+    if (progress_ != nullptr) {
+        progress_->current = bytes_read_;
+    }
+
+    uint64_t end = std::min<uint64_t>((offset / kMaxDataLength + 1) * static_cast<uint64_t>(kMaxDataLength), file_size_);
+    if (offset + size < end) {
+        // short read, ask for the rest of this block.
+        sendReadRequest(offset + size, 1);
+    }
+    fillReadWindow();
+    if (pending_reads_.empty()) {
+        finishWindowedRead();
+    }
+}
+
+// caller holds window_mutex_
+void MavLinkFtpClientImpl::handleWindowedReadEof(uint32_t offset)
+{
+    pending_reads_.erase(offset);
+    if (offset < file_size_) {
+        file_size_ = offset;
+        for (auto ptr = pending_reads_.begin(); ptr != pending_reads_.end();) {
+            if (ptr->first >= file_size_) {
+                ptr = pending_reads_.erase(ptr);
+            }
+            else {
+                ptr++;
+            }
+        }
+    }
+    if (pending_reads_.empty()) {
+        finishWindowedRead();
+    }
+}
+
+void MavLinkFtpClientImpl::checkReadTimeouts()
+{
+    std::lock_guard<std::mutex> guard(window_mutex_);
+    if (!windowed_read_) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    bool timedOut = false;
+    for (auto& pair : pending_reads_) {
+        PendingRead& pending = pair.second;
+        if (std::chrono::duration<double, std::milli>(now - pending.sent).count() < rto_ms_) {
+            continue;
+        }
+        if (pending.attempts >= MAXIMUM_READ_ATTEMPTS) {
+            // give up then.
+            errorCode_ = kErrRetriesExhausted;
+            success_ = false;
+            if (progress_ != nullptr) {
+                progress_->error = kErrRetriesExhausted;
+                progress_->message = Utils::stringf("ftp read at offset %d was not answered", pair.first);
+            }
+            if (file_ptr_ != nullptr) {
+                fclose(file_ptr_);
+                file_ptr_ = nullptr;
+            }
+            pending_reads_.clear();
+            windowed_read_ = false;
+            reset();
+            waiting_ = false;
+            return;
+        }
+        sendReadRequest(pair.first, pending.attempts + 1);
+        timedOut = true;
+    }
+    if (timedOut) {
+        // back off like TCP does, the link is slower or lossier than we thought.
+        rto_ms_ = std::min(rto_ms_ * 2, static_cast<double>(MAXIMUM_ROUND_TRIP_TIME * TIMEOUT_INTERVAL));
+    }
+}
+
+// caller holds window_mutex_
+void MavLinkFtpClientImpl::updateRoundTripTime(double sampleMilliseconds)
+{
+    if (srtt_ms_ == 0) {
+        srtt_ms_ = sampleMilliseconds;
+        rttvar_ms_ = sampleMilliseconds / 2;
+    }
+    else {
+        rttvar_ms_ = 0.75 * rttvar_ms_ + 0.25 * std::abs(srtt_ms_ - sampleMilliseconds);
+        srtt_ms_ = 0.875 * srtt_ms_ + 0.125 * sampleMilliseconds;
+    }
+    rto_ms_ = std::max(static_cast<double>(MINIMUM_READ_TIMEOUT), std::min(srtt_ms_ + 4 * rttvar_ms_, static_cast<double>(MAXIMUM_ROUND_TRIP_TIME * TIMEOUT_INTERVAL)));
+}
+
+// caller holds window_mutex_
+void MavLinkFtpClientImpl::finishWindowedRead()
+{
+    if (file_ptr_ != nullptr) {
+        fclose(file_ptr_);
+        file_ptr_ = nullptr;
+    }
+    windowed_read_ = false;
+    success_ = true;
+    errorCode_ = 0;
+    reset();
+    waiting_ = false;
+}
+
+void MavLinkFtpClientImpl::clearReadWindow()
+{
+    std::lock_guard<std::mutex> guard(window_mutex_);
+    windowed_read_ = false;
+    pending_reads_.clear();
+    next_offset_ = 0;
+    srtt_ms_ = 0;
+    rttvar_ms_ = 0;
+    rto_ms_ = MAXIMUM_ROUND_TRIP_TIME;
+}
+
 void MavLinkFtpClientImpl::handleWriteResponse()
 {
     FtpPayload* payload = reinterpret_cast<FtpPayload*>(&last_message_.payload[0]);
@@ -683,12 +892,23 @@ void MavLinkFtpClientImpl::handleResponse(const MavLinkMessage& msg)
         recordMessageReceived();
 
         FtpPayload* payload = reinterpret_cast<FtpPayload*>(&last_message_.payload[0]);
-        if (payload->opcode == kRspNak) {
+        if (payload->opcode == kRspNak && windowed_read_ && payload->req_opcode == kCmdReadFile && payload->data == kErrEOF) {
+            // with several reads outstanding, EOF only means this one asked past the end of the file.
+            std::lock_guard<std::mutex> guard(window_mutex_);
+            if (pending_reads_.find(payload->offset) != pending_reads_.end()) {
+                handleWindowedReadEof(payload->offset);
+            }
+        }
+        else if (payload->opcode == kRspNak) {
 
             // reached the end of the list or the file.
-            if (file_ptr_ != nullptr) {
-                fclose(file_ptr_);
-                file_ptr_ = nullptr;
+            {
+                std::lock_guard<std::mutex> guard(window_mutex_);
+                windowed_read_ = false;
+                if (file_ptr_ != nullptr) {
+                    fclose(file_ptr_);
+                    file_ptr_ = nullptr;
+                }
             }
 
             int error = static_cast<int>(payload->data);
@@ -9,6 +9,8 @@
 #include <vector>
 #include <mutex>
 #include <chrono>
+#include <atomic>
+#include <map>
 #include "MavLinkNode.hpp"
 #include "MavLinkNodeImpl.hpp"
 #include "MavLinkFtpClient.hpp"
@@ -32,6 +34,7 @@ public:
     void mkdir(MavLinkFtpProgress& progress, const std::string& remotePath);
     void rmdir(MavLinkFtpProgress& progress, const std::string& remotePath);
     void cancel();
+    void setReadWindow(int requests);
 
 private:
     void nextStep();
@@ -43,6 +46,15 @@ private:
     void rmdir();
     void handleListResponse();
     void handleReadResponse();
+    void startWindowedRead();
+    void fillReadWindow();
+    void sendReadRequest(uint32_t offset, int attempts);
+    void handleWindowedRead(uint32_t offset, const uint8_t* data, uint32_t size);
+    void handleWindowedReadEof(uint32_t offset);
+    void checkReadTimeouts();
+    void updateRoundTripTime(double sampleMilliseconds);
+    void finishWindowedRead();
+    void clearReadWindow();
     void handleWriteResponse();
     void handleRemoveResponse();
     void handleRmdirResponse();
@@ -96,6 +108,24 @@ private:
     std::mutex mutex_;
     std::vector<mavlinkcom::MavLinkFileInfo>* files_ = nullptr;
     MavLinkFtpProgress* progress_ = nullptr;
+
+    // windowed reads: get keeps up to read_window_ kCmdReadFile requests for different offsets outstanding,
+    // writes each response at its offset as it arrives and re-sends requests whose response is overdue.
+    struct PendingRead
+    {
+        std::chrono::steady_clock::time_point sent;
+        int attempts;
+    };
+    int read_window_ = 16;
+    std::atomic<bool> windowed_read_{ false };
+    uint8_t session_ = 0;
+    uint32_t next_offset_ = 0;
+    std::map<uint32_t, PendingRead> pending_reads_;
+    // smoothed round trip time and its variation, giving the retry timeout as in TCP (RFC 6298)
+    double srtt_ms_ = 0;
+    double rttvar_ms_ = 0;
+    double rto_ms_ = 0;
+    std::mutex window_mutex_;
 };
 }
 
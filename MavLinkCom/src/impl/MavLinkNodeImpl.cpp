@@ -6,6 +6,11 @@
 #include "MavLinkMessages.hpp"
 #include "Semaphore.hpp"
 #include "ThreadUtils.hpp"
+#include "FileSystem.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
 
 using namespace mavlink_utils;
 
@@ -28,6 +33,7 @@ MavLinkNodeImpl::~MavLinkNodeImpl()
 void MavLinkNodeImpl::connect(std::shared_ptr<MavLinkConnection> connection)
 {
     has_cap_ = false;
+    autopilot_ = -1;
     connection_ = connection;
     subscription_ = connection_->subscribe([=](std::shared_ptr<MavLinkConnection> con, const MavLinkMessage& msg) {
         handleMessage(con, msg);
@@ -57,10 +63,13 @@ void MavLinkNodeImpl::sendHeartbeat()
 // this is called for all messages received on the connection.
 void MavLinkNodeImpl::handleMessage(std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& msg)
 {
-    unused(connection);
-
     switch (msg.msgid) {
     case static_cast<uint8_t>(MavLinkMessageIds::MAVLINK_MSG_ID_HEARTBEAT):
+        if (msg.sysid == connection->getTargetSystemId()) {
+            MavLinkHeartbeat heartbeat;
+            heartbeat.decode(msg);
+            autopilot_ = heartbeat.autopilot;
+        }
         // we received a heartbeat, so let's get the capabilities.
         if (!req_cap_) {
             req_cap_ = true;
@@ -142,7 +151,7 @@ AsyncResult<MavLinkHeartbeat> MavLinkNodeImpl::waitForHeartbeat()
         con->unsubscribe(state);
     });
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& m) {
+    int subscription = con->subscribe({ static_cast<uint8_t>(MavLinkMessageIds::MAVLINK_MSG_ID_HEARTBEAT) }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& m) {
         unused(connection);
         if (m.msgid == static_cast<uint8_t>(MavLinkMessageIds::MAVLINK_MSG_ID_HEARTBEAT)) {
             MavLinkHeartbeat heartbeat;
@@ -293,39 +302,115 @@ void MavLinkNodeImpl::assertNotPublishingThread()
     }
 }
 
+// state of one parameter download, shared with the subscription so that a late callback after
+// unsubscribe never touches a finished download.
+struct ParamDownload
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<MavLinkParameter> params; // by index
+    std::vector<bool> received; // bitmap of the indices we have
+    size_t received_count = 0;
+
+    bool complete()
+    {
+        return !received.empty() && received_count == received.size();
+    }
+
+    std::vector<int> missing()
+    {
+        std::vector<int> result;
+        for (size_t i = 0; i < received.size(); i++) {
+            if (!received[i]) {
+                result.push_back(static_cast<int>(i));
+            }
+        }
+        return result;
+    }
+
+    // wait until done() or until no new parameter arrived for the given time, returns done().
+    // the deadline only moves when a parameter arrives, so spurious wakeups do not count as a stall.
+    template <typename TDone>
+    bool waitFor(int stallMilliseconds, TDone done)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        size_t seen = received_count;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(stallMilliseconds);
+        while (!done()) {
+            if (received_count != seen) {
+                seen = received_count;
+                deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(stallMilliseconds);
+            }
+            else if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            changed.wait_until(lock, deadline);
+        }
+        return true;
+    }
+};
+
+const int paramFirstResponseMilliseconds = 3000; // time the vehicle has to start sending the parameter list
+const int paramStallMilliseconds = 500; // gap in the parameter stream after which we ask for the missing ones
+const size_t paramRequestWindow = 16; // individual parameter requests kept outstanding while filling gaps
+const int paramRepairRounds = 5;
+
 std::vector<MavLinkParameter> MavLinkNodeImpl::getParamList()
 {
+    // only PX4 answers the hash request, don't wait for an answer from other autopilots.
+    uint32_t hash = 0;
+    bool hasHash = !param_cache_folder_.empty() && autopilot_ == static_cast<int>(MAV_AUTOPILOT::MAV_AUTOPILOT_PX4) && getParamHash(hash);
+
     std::vector<MavLinkParameter> result;
-    bool done = false;
-    Semaphore paramReceived;
-    bool waiting = false;
-    size_t paramCount = 0;
+    if (hasHash && loadParamCache(hash, result)) {
+        setCachedParameters(result);
+        return result;
+    }
+
+    result = downloadParamList();
+    setCachedParameters(result);
 
+    if (hasHash) {
+        // only keep the download if nothing changed while we were downloading it.
+        uint32_t after = 0;
+        if (getParamHash(after) && after == hash) {
+            saveParamCache(hash, result);
+        }
+    }
+    return result;
+}
+
+std::vector<MavLinkParameter> MavLinkNodeImpl::downloadParamList()
+{
     auto con = ensureConnection();
     assertNotPublishingThread();
 
-    int subscription = con->subscribe([&](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+    auto download = std::make_shared<ParamDownload>();
+    int subscription = con->subscribe({ MavLinkParamValue::kMessageId }, [download](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
         unused(connection);
-        if (message.msgid == MavLinkParamValue::kMessageId) {
-            MavLinkParamValue param;
-            param.decode(message);
-            MavLinkParameter p;
-            p.index = param.param_index;
-            p.type = param.param_type;
-            char buf[17];
-            std::memset(buf, 0, 17);
-            std::memcpy(buf, param.param_id, 16);
-            p.name = buf;
-            p.value = param.param_value;
-            result.push_back(p);
-            paramCount = param.param_count;
-            if (param.param_index == param.param_count - 1) {
-                done = true;
-            }
-            if (waiting) {
-                paramReceived.post();
-            }
+        MavLinkParamValue param;
+        param.decode(message);
+
+        std::lock_guard<std::mutex> guard(download->mutex);
+        if (download->received.empty() && param.param_count > 0) {
+            download->received.resize(param.param_count);
+            download->params.resize(param.param_count);
+        }
+        // PARAM_VALUE for a parameter that was set is sent with index 65535
+        if (param.param_index >= download->received.size() || download->received[param.param_index]) {
+            return;
         }
+        MavLinkParameter& p = download->params[param.param_index];
+        p.index = param.param_index;
+        p.type = param.param_type;
+        char buf[17];
+        std::memset(buf, 0, 17);
+        std::memcpy(buf, param.param_id, 16);
+        p.name = buf;
+        p.value = param.param_value;
+        download->received[param.param_index] = true;
+        download->received_count++;
+        download->changed.notify_all();
     });
 
     //MAVLINK_MSG_ID_PARAM_REQUEST_LIST
@@ -334,53 +419,148 @@ std::vector<MavLinkParameter> MavLinkNodeImpl::getParamList()
     cmd.target_component = getTargetComponentId();
     sendMessage(cmd);
 
-    while (!done) {
-        waiting = true;
-        if (!paramReceived.timed_wait(3000)) {
-            // timeout, so we'll drop through to the code below which will try and fix this...
-            done = true;
-        }
-        waiting = false;
-    }
-    con->unsubscribe(subscription);
+    // the vehicle streams the whole list, wait for it to start and then until it stops.
+    download->waitFor(paramFirstResponseMilliseconds, [&] { return download->received_count > 0; });
+    download->waitFor(paramStallMilliseconds, [&] { return download->complete(); });
 
-    // note that UDP does not guarantee delivery of messages, so we have to also check if some parameters are missing and get them individually.
-    std::vector<size_t> missing;
-
-    for (size_t i = 0; i < paramCount; i++) {
-        // nested loop is inefficient, but it is needed because UDP also doesn't guarantee in-order delivery
-        bool found = false;
-        for (auto iter = result.begin(), end = result.end(); iter != end; iter++) {
-            MavLinkParameter p = *iter;
-            if (static_cast<size_t>(p.index) == i) {
-                found = true;
-                break;
+    // note that UDP does not guarantee delivery of messages, so we have to also check if some parameters are missing and get them
+    // individually, several at a time.  Responses are recorded by the subscription above whatever order they come in.
+    std::vector<int> missing;
+    {
+        std::lock_guard<std::mutex> guard(download->mutex);
+        missing = download->missing();
+    }
+    for (int round = 0; round < paramRepairRounds && !missing.empty(); round++) {
+        for (size_t start = 0; start < missing.size(); start += paramRequestWindow) {
+            size_t end = std::min(start + paramRequestWindow, missing.size());
+            for (size_t i = start; i < end; i++) {
+                MavLinkParamRequestRead read;
+                read.param_id[0] = '\0';
+                read.param_index = static_cast<int16_t>(missing[i]);
+                read.target_component = getTargetComponentId();
+                read.target_system = getTargetSystemId();
+                sendMessage(read);
             }
+            download->waitFor(paramStallMilliseconds, [&] {
+                for (size_t i = start; i < end; i++) {
+                    if (!download->received[missing[i]]) {
+                        return false;
+                    }
+                }
+                return true;
+            });
         }
-        if (!found) {
-            missing.push_back(i);
-        }
+        std::lock_guard<std::mutex> guard(download->mutex);
+        missing = download->missing();
     }
+    con->unsubscribe(subscription);
 
-    // ok, now fetch the missing parameters.
-    for (auto iter = missing.begin(), end = missing.end(); iter != end; iter++) {
-        size_t index = *iter;
-        MavLinkParameter r;
-        if (getParameterByIndex(static_cast<int16_t>(*iter)).wait(2000, &r)) {
-            result.push_back(r);
+    std::vector<MavLinkParameter> result;
+    std::lock_guard<std::mutex> guard(download->mutex);
+    for (size_t i = 0; i < download->received.size(); i++) {
+        if (download->received[i]) {
+            result.push_back(download->params[i]);
         }
         else {
-            Utils::log(Utils::stringf("Paremter %d does not seem to exist", index), Utils::kLogLevelWarn);
+            Utils::log(Utils::stringf("Parameter %d does not seem to exist", static_cast<int>(i)), Utils::kLogLevelWarn);
         }
     }
 
     std::sort(result.begin(), result.end(), [&](const MavLinkParameter& p1, const MavLinkParameter& p2) {
         return p1.name.compare(p2.name) < 0;
     });
+    return result;
+}
 
-    this->parameters_ = result;
+void MavLinkNodeImpl::setCachedParameters(const std::vector<MavLinkParameter>& params)
+{
+    parameters_ = params;
+    parameter_index_.clear();
+    for (size_t i = 0; i < parameters_.size(); i++) {
+        parameter_index_[parameters_[i].name] = i;
+    }
+}
 
-    return result;
+// PX4 answers a request for the _HASH_CHECK parameter with a hash of all parameter values.
+bool MavLinkNodeImpl::getParamHash(uint32_t& hash)
+{
+    auto con = ensureConnection();
+    assertNotPublishingThread();
+
+    static const char* hashName = "_HASH_CHECK";
+    auto result = std::make_shared<std::pair<Semaphore, uint32_t>>();
+    int subscription = con->subscribe({ MavLinkParamValue::kMessageId }, [result](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+        unused(connection);
+        MavLinkParamValue param;
+        param.decode(message);
+        if (std::strncmp(param.param_id, hashName, 16) == 0) {
+            // the hash is the raw bits of the value, not a number that UnpackParameter could convert.
+            std::memcpy(&result->second, &param.param_value, sizeof(uint32_t));
+            result->first.post();
+        }
+    });
+
+    MavLinkParamRequestRead cmd;
+    std::memset(cmd.param_id, 0, sizeof(cmd.param_id));
+    std::strncpy(cmd.param_id, hashName, sizeof(cmd.param_id));
+    cmd.param_index = -1;
+    cmd.target_component = getTargetComponentId();
+    cmd.target_system = getTargetSystemId();
+    sendMessage(cmd);
+
+    bool found = result->first.timed_wait(1000);
+    con->unsubscribe(subscription);
+    if (found) {
+        hash = result->second;
+    }
+    return found;
+}
+
+// one file per vehicle, and per firmware when we know it from AUTOPILOT_VERSION.
+std::string MavLinkNodeImpl::getParamCacheFile()
+{
+    std::string name = Utils::stringf("params_%d_%d", getTargetSystemId(), getTargetComponentId());
+    if (has_cap_) {
+        name += Utils::stringf("_%llx_%x", static_cast<unsigned long long>(cap_.uid), cap_.flight_sw_version);
+    }
+    return FileSystem::combine(param_cache_folder_, name + ".txt");
+}
+
+// the cache is a text file, "hash <hash>" followed by "<index> <type> <raw value bits> <name>" per parameter.
+bool MavLinkNodeImpl::loadParamCache(uint32_t hash, std::vector<MavLinkParameter>& result)
+{
+    std::ifstream file(getParamCacheFile());
+    std::string keyword;
+    uint32_t cachedHash = 0;
+    if (!(file >> keyword >> std::hex >> cachedHash) || keyword != "hash" || cachedHash != hash) {
+        return false;
+    }
+
+    result.clear();
+    MavLinkParameter p;
+    int type = 0;
+    uint32_t bits = 0;
+    while (file >> std::dec >> p.index >> type >> std::hex >> bits >> p.name) {
+        p.type = static_cast<uint8_t>(type);
+        std::memcpy(&p.value, &bits, sizeof(uint32_t));
+        result.push_back(p);
+    }
+    return !result.empty();
+}
+
+void MavLinkNodeImpl::saveParamCache(uint32_t hash, const std::vector<MavLinkParameter>& params)
+{
+    std::ofstream file(getParamCacheFile());
+    if (!file) {
+        Utils::log(Utils::stringf("Cannot write parameter cache '%s'", getParamCacheFile().c_str()), Utils::kLogLevelWarn);
+        return;
+    }
+    file << "hash " << std::hex << hash << "\n";
+    for (const MavLinkParameter& p : params) {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &p.value, sizeof(uint32_t));
+        file << std::dec << p.index << " " << static_cast<int>(p.type) << " " << std::hex << bits << " " << p.name << "\n";
+    }
 }
 
 MavLinkParameter MavLinkNodeImpl::getCachedParameter(const std::string& name)
@@ -389,14 +569,12 @@ MavLinkParameter MavLinkNodeImpl::getCachedParameter(const std::string& name)
         throw std::runtime_error("Error: please call getParamList during initialization so we have cached snapshot of the parameter values");
     }
 
-    for (int i = static_cast<int>(this->parameters_.size()) - 1; i >= 0; i--) {
-        MavLinkParameter p = this->parameters_[i];
-        if (p.name == name) {
-            return p;
-        }
+    auto found = parameter_index_.find(name);
+    if (found != parameter_index_.end()) {
+        return parameters_[found->second];
     }
 
-    throw std::runtime_error(Utils::stringf("Error: parameter name '%s' not found"));
+    throw std::runtime_error(Utils::stringf("Error: parameter name '%s' not found", name.c_str()));
 }
 
 AsyncResult<MavLinkParameter> MavLinkNodeImpl::getParameter(const std::string& name)
@@ -419,7 +597,7 @@ AsyncResult<MavLinkParameter> MavLinkNodeImpl::getParameter(const std::string& n
     cmd.target_component = getTargetComponentId();
     cmd.target_system = getTargetSystemId();
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+    int subscription = con->subscribe({ MavLinkParamValue::kMessageId }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
         unused(connection);
         if (message.msgid == MavLinkParamValue::kMessageId) {
             MavLinkParamValue param;
@@ -454,7 +632,7 @@ AsyncResult<MavLinkParameter> MavLinkNodeImpl::getParameterByIndex(int16_t index
     cmd.target_component = getTargetComponentId();
     cmd.target_system = getTargetSystemId();
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+    int subscription = con->subscribe({ MavLinkParamValue::kMessageId }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
         unused(connection);
         if (message.msgid == MavLinkParamValue::kMessageId) {
             MavLinkParamValue param;
@@ -512,7 +690,7 @@ AsyncResult<bool> MavLinkNodeImpl::setParameter(MavLinkParameter p)
     sendMessage(setparam);
 
     // confirmation of the PARAM_SET is to receive the updated PARAM_VALUE.
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+    int subscription = con->subscribe({ MavLinkParamValue::kMessageId }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
         unused(connection);
         if (message.msgid == MavLinkParamValue::kMessageId) {
             MavLinkParamValue param;
@@ -576,7 +754,7 @@ AsyncResult<bool> MavLinkNodeImpl::sendCommandAndWaitForAck(MavLinkCommand& comm
 
     uint16_t cmd = command.command;
 
-    int subscription = con->subscribe([=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
+    int subscription = con->subscribe({ MavLinkCommandAck::kMessageId }, [=](std::shared_ptr<MavLinkConnection> connection, const MavLinkMessage& message) {
         unused(connection);
         if (message.msgid == MavLinkCommandAck::kMessageId) {
             MavLinkCommandAck ack;
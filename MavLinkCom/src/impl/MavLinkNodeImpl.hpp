@@ -4,6 +4,9 @@
 #ifndef MavLinkCom_MavLinkNodeImpl_hpp
 #define MavLinkCom_MavLinkNodeImpl_hpp
 
+#include <atomic>
+#include <string>
+#include <unordered_map>
 #include "MavLinkNode.hpp"
 #include "MavLinkConnection.hpp"
 
@@ -30,6 +33,11 @@ public:
     // get the parameter value cached from last getParamList call.
     MavLinkParameter getCachedParameter(const std::string& name);
 
+    void setParamCacheFolder(const std::string& folder)
+    {
+        param_cache_folder_ = folder;
+    }
+
     // get up to date value of this parametr
     AsyncResult<MavLinkParameter> getParameter(const std::string& name);
 
@@ -95,14 +103,23 @@ protected:
 private:
     void sendHeartbeat();
     AsyncResult<MavLinkParameter> getParameterByIndex(int16_t index);
+    std::vector<MavLinkParameter> downloadParamList();
+    bool getParamHash(uint32_t& hash);
+    std::string getParamCacheFile();
+    bool loadParamCache(uint32_t hash, std::vector<MavLinkParameter>& result);
+    void saveParamCache(uint32_t hash, const std::vector<MavLinkParameter>& params);
+    void setCachedParameters(const std::vector<MavLinkParameter>& params);
     bool inside_handle_message_;
     std::shared_ptr<MavLinkConnection> connection_;
     int subscription_ = 0;
     int local_system_id;
     int local_component_id;
     std::vector<MavLinkParameter> parameters_; //cached snapshot.
+    std::unordered_map<std::string, size_t> parameter_index_; // name to position in parameters_
+    std::string param_cache_folder_;
     MavLinkAutopilotVersion cap_;
     bool has_cap_ = false;
+    std::atomic<int> autopilot_{ -1 }; // MAV_AUTOPILOT from the heartbeat of the target system, -1 until we get one
     bool req_cap_ = false;
     bool heartbeat_running_ = false;
     std::thread heartbeat_thread_;
@@ -11,6 +11,20 @@ public:
     // write to the port, return number of bytes written or -1 if error.
     virtual int write(const uint8_t* ptr, int count) = 0;
 
+    // write packetCount packets that are stored back to back in data, packet i being lengths[i] bytes long,
+    // return number of packets written or -1 if error. Ports that can send several packets per system call
+    // override this, by default they are written one at a time.
+    virtual int writePackets(const uint8_t* data, const int* lengths, int packetCount)
+    {
+        for (int i = 0; i < packetCount; i++) {
+            if (write(data, lengths[i]) < 0) {
+                return -1;
+            }
+            data += lengths[i];
+        }
+        return packetCount;
+    }
+
     // read a given number of bytes from the port (blocking until the requested bytes are available).
     // return the number of bytes read or -1 if error.
     virtual int read(uint8_t* buffer, int bytesToRead) = 0;
@@ -5,6 +5,7 @@
 #include "UdpClientPort.hpp"
 #include <stdio.h>
 #include <string.h>
+#include <atomic>
 #include "SocketInit.hpp"
 #include "wifi.h"
 
@@ -39,6 +40,12 @@ inline int GetSocketError()
 #include <errno.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <vector>
+#endif
 typedef int SOCKET;
 const int INVALID_SOCKET = -1;
 const int ERROR_ACCESS_DENIED = EACCES;
@@ -59,10 +66,22 @@ class UdpClientPort::UdpSocketImpl
     sockaddr_in localaddr;
     sockaddr_in remoteaddr;
     bool hasRemote = false;
-    bool closed_ = true;
+    std::atomic<bool> closed_{ true }; // set by close() while the reader thread is in read()
     int retries_ = 0;
     const int max_retries_ = 10;
 
+#ifdef __linux__
+    // datagrams received by the last recvmmsg call that read() has not returned yet.
+    static const int kBatchSize = 32;
+    static const int kMaxDatagramSize = 2048;
+    std::vector<uint8_t> batch_buffer_ = std::vector<uint8_t>(kBatchSize * kMaxDatagramSize);
+    mmsghdr batch_msgs_[kBatchSize];
+    iovec batch_iov_[kBatchSize];
+    sockaddr_in batch_addrs_[kBatchSize];
+    int batch_count_ = 0;
+    int batch_next_ = 0;
+#endif
+
 public:
     bool isClosed()
     {
@@ -227,6 +246,140 @@ public:
         return hr;
     }
 
+    int writePackets(const uint8_t* data, const int* lengths, int packetCount)
+    {
+#ifdef __linux__
+        if (closed_ || remoteaddr.sin_port == 0) {
+            return 0;
+        }
+
+        mmsghdr msgs[kBatchSize];
+        iovec iov[kBatchSize];
+        int sent = 0;
+        while (sent < packetCount) {
+            int n = std::min(packetCount - sent, static_cast<int>(kBatchSize));
+            for (int i = 0; i < n; i++) {
+                iov[i].iov_base = const_cast<uint8_t*>(data);
+                iov[i].iov_len = lengths[sent + i];
+                data += lengths[sent + i];
+
+                memset(&msgs[i], 0, sizeof(mmsghdr));
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                msgs[i].msg_hdr.msg_name = &remoteaddr;
+                msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            }
+
+            int i = 0;
+            while (i < n) {
+                // sendmmsg stops at the first datagram that fails, carry on from there.
+                int rc = sendmmsg(sock, msgs + i, n - i, 0);
+                if (rc == SOCKET_ERROR) {
+                    int hr = checkerror();
+                    if (hr == EINTR) {
+                        continue;
+                    }
+                    if (hr != 0) {
+                        remoteaddr.sin_port = 0;
+                        auto msg = Utils::stringf("UdpClientPort socket send failed with error: %d\n", hr);
+                        throw std::runtime_error(msg);
+                    }
+                    // reconnected, the remaining packets of this batch are lost like they would be for write().
+                    return sent + i;
+                }
+                i += rc;
+            }
+            sent += n;
+        }
+        return sent;
+#else
+        for (int i = 0; i < packetCount; i++) {
+            write(data, lengths[i]);
+            data += lengths[i];
+        }
+        return packetCount;
+#endif
+    }
+
+#ifdef __linux__
+    // true when the sender is the one we talk to, the first sender becomes that one if we did not know it yet.
+    bool acceptSender(const sockaddr_in& other)
+    {
+        if (remoteaddr.sin_port == 0) {
+            // we now have it.
+            remoteaddr.sin_family = other.sin_family;
+            remoteaddr.sin_addr = other.sin_addr;
+            remoteaddr.sin_port = other.sin_port;
+        }
+        else if (other.sin_addr.s_addr != remoteaddr.sin_addr.s_addr) {
+            // this is from someone we are not interested in.
+            return false;
+        }
+        return true;
+    }
+
+    int read(uint8_t* result, int bytesToRead)
+    {
+        while (!closed_) {
+            if (batch_next_ < batch_count_) {
+                int i = batch_next_++;
+                if (!acceptSender(batch_addrs_[i])) {
+                    continue;
+                }
+                int rc = static_cast<int>(batch_msgs_[i].msg_len);
+                if (rc == 0) {
+                    return -1;
+                }
+                // like recvfrom, the rest of a datagram larger than the buffer is dropped.
+                rc = std::min(rc, bytesToRead);
+                memcpy(result, batch_iov_[i].iov_base, rc);
+                return rc;
+            }
+
+            // block until something arrives instead of spinning on an empty socket, the timeout is
+            // important as it allows the readPackets thread to notice the connection is now closed.
+            pollfd pfd;
+            pfd.fd = sock;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            int rc = poll(&pfd, 1, 1000);
+            if (rc == 0) {
+                continue;
+            }
+            if (rc < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+
+            for (int i = 0; i < kBatchSize; i++) {
+                batch_iov_[i].iov_base = batch_buffer_.data() + i * kMaxDatagramSize;
+                batch_iov_[i].iov_len = kMaxDatagramSize;
+                memset(&batch_msgs_[i], 0, sizeof(mmsghdr));
+                batch_msgs_[i].msg_hdr.msg_iov = &batch_iov_[i];
+                batch_msgs_[i].msg_hdr.msg_iovlen = 1;
+                batch_msgs_[i].msg_hdr.msg_name = &batch_addrs_[i];
+                batch_msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            }
+            rc = recvmmsg(sock, batch_msgs_, kBatchSize, MSG_DONTWAIT, nullptr);
+            if (rc < 0) {
+                int hr = checkerror();
+                if (hr == EINTR || hr == EAGAIN || hr == EWOULDBLOCK) {
+                    // interrupted, or poll woke us up for an error that is now gone.
+                    continue;
+                }
+                return -1;
+            }
+            batch_count_ = rc;
+            batch_next_ = 0;
+        }
+        // only the reader thread touches the batch, so what is left of it is dropped here rather than in close()
+        batch_count_ = 0;
+        batch_next_ = 0;
+        return -1;
+    }
+#else
     int read(uint8_t* result, int bytesToRead)
     {
         sockaddr_in other;
@@ -287,6 +440,7 @@ public:
         }
         return -1;
     }
+#endif
 
     void close()
     {
@@ -340,6 +494,11 @@ int UdpClientPort::write(const uint8_t* ptr, int count)
     return impl_->write(ptr, count);
 }
 
+int UdpClientPort::writePackets(const uint8_t* data, const int* lengths, int packetCount)
+{
+    return impl_->writePackets(data, lengths, packetCount);
+}
+
 int UdpClientPort::read(uint8_t* buffer, int bytesToRead)
 {
     return impl_->read(buffer, bytesToRead);
@@ -22,7 +22,12 @@ public:
     // write the given bytes to the port, return number of bytes written or -1 if error.
     int write(const uint8_t* ptr, int count);
 
-    // read some bytes from the port, return the number of bytes read or -1 if error.
+    // send each packet as its own datagram, on linux with one sendmmsg call per batch.
+    int writePackets(const uint8_t* data, const int* lengths, int packetCount) override;
+
+    // read one datagram from the port, return the number of bytes read or -1 if error.
+    // On linux this waits in poll and receives all queued datagrams with one recvmmsg call,
+    // subsequent reads are served from those until they run out.
     int read(uint8_t* buffer, int bytesToRead);
 
     // close the port.
@@ -23,6 +23,7 @@ void SimModeWorldBase::initializeForPlay()
     physics_world_.reset(new msr::airlib::PhysicsWorld(std::move(physics_engine),
                                                        vehicles,
                                                        getPhysicsLoopPeriod()));
+    physics_world_->setParallelUpdate(getSettings().physics_update_threads);
 }
 
 void SimModeWorldBase::EndPlay()
@@ -62,7 +63,9 @@ std::unique_ptr<SimModeWorldBase::PhysicsEngineBase> SimModeWorldBase::createPhy
     else if (physics_engine_name == "FastPhysicsEngine") {
         msr::airlib::Settings fast_phys_settings;
         if (msr::airlib::Settings::singleton().getChild("FastPhysicsEngine", fast_phys_settings)) {
-            physics_engine.reset(new msr::airlib::FastPhysicsEngine(fast_phys_settings.getBool("EnableGroundLock", true)));
+            physics_engine.reset(new msr::airlib::FastPhysicsEngine(fast_phys_settings.getBool("EnableGroundLock", true),
+                                                                    msr::airlib::Vector3r::Zero(),
+                                                                    fast_phys_settings.getBool("BatchedUpdate", false)));
         }
         else {
             physics_engine.reset(new msr::airlib::FastPhysicsEngine());
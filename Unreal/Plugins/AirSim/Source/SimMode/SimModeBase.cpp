@@ -124,6 +124,8 @@ void ASimModeBase::BeginPlay()
 
     world_sim_api_.reset(new WorldSimApi(this));
     api_provider_.reset(new msr::airlib::ApiProvider(world_sim_api_.get()));
+    if (!isTelemetryUpdatedByPhysics())
+        api_provider_->getTelemetryPublisher()->reset();
 
     UAirBlueprintLib::setLogMessagesVisibility(getSettings().log_messages_visible);
 
@@ -356,6 +358,10 @@ void ASimModeBase::Tick(float DeltaSeconds)
 
     updateDebugReport(debug_reporter_);
 
+    //without a physics world nothing else samples the subscribed vehicles
+    if (!isTelemetryUpdatedByPhysics())
+        getApiProvider()->getTelemetryPublisher()->update();
+
     drawLidarDebugPoints();
 
     drawDistanceSensorDebugPoints();
@@ -416,10 +422,17 @@ void ASimModeBase::reset()
         for (auto& api : getApiProvider()->getVehicleSimApis()) {
             api->reset();
         }
+        if (!isTelemetryUpdatedByPhysics())
+            getApiProvider()->getTelemetryPublisher()->reset();
     },
                                              true);
 }
 
+bool ASimModeBase::isTelemetryUpdatedByPhysics() const
+{
+    return false;
+}
+
 std::string ASimModeBase::getDebugReport()
 {
     return debug_reporter_.getOutput();
@@ -504,6 +517,8 @@ void ASimModeBase::startApiServer()
 #endif
 
         try {
+            api_server_->setDispatchThreadCounts(getSettings().rpc_query_threads, getSettings().rpc_heavy_threads, getSettings().rpc_command_threads);
+            api_server_->setMaxPendingCalls(getSettings().rpc_max_pending_calls);
             api_server_->start(false, spawned_actors_.Num() + 4);
         }
         catch (std::exception& ex) {
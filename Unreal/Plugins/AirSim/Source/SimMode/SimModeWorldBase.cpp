@@ -16,11 +16,18 @@ void ASimModeWorldBase::initializeForPlay()
         vehicles.push_back(api);
     //TODO: directly accept getVehicleSimApis() using generic container
 
+    //telemetry is sampled on the physics thread so streamed frames match the vehicle state
+    vehicles.push_back(getApiProvider()->getTelemetryPublisher());
+
     std::unique_ptr<PhysicsEngineBase> physics_engine = createPhysicsEngine();
     physics_engine_ = physics_engine.get();
     physics_world_.reset(new msr::airlib::PhysicsWorld(std::move(physics_engine),
                                                        vehicles,
                                                        getPhysicsLoopPeriod()));
+    physics_world_->setParallelUpdate(getSettings().physics_update_threads);
+    physics_world_->setWaitStrategy(getSettings().physics_wait_strategy == "Hybrid"
+                                        ? common_utils::ScheduledExecutor::WaitStrategy::Hybrid
+                                        : common_utils::ScheduledExecutor::WaitStrategy::Spin);
 }
 
 void ASimModeWorldBase::registerPhysicsBody(msr::airlib::VehicleSimApiBase* physicsBody)
@@ -64,7 +71,9 @@ std::unique_ptr<ASimModeWorldBase::PhysicsEngineBase> ASimModeWorldBase::createP
     else if (physics_engine_name == "FastPhysicsEngine") {
         msr::airlib::Settings fast_phys_settings;
         if (msr::airlib::Settings::singleton().getChild("FastPhysicsEngine", fast_phys_settings)) {
-            physics_engine.reset(new msr::airlib::FastPhysicsEngine(fast_phys_settings.getBool("EnableGroundLock", true)));
+            physics_engine.reset(new msr::airlib::FastPhysicsEngine(fast_phys_settings.getBool("EnableGroundLock", true),
+                                                                    msr::airlib::Vector3r::Zero(),
+                                                                    fast_phys_settings.getBool("BatchedUpdate", false)));
         }
         else {
             physics_engine.reset(new msr::airlib::FastPhysicsEngine());
@@ -165,6 +174,12 @@ void ASimModeWorldBase::reset()
     //no need to call base reset because of our custom implementation
 }
 
+bool ASimModeWorldBase::isTelemetryUpdatedByPhysics() const
+{
+    //initializeForPlay inserts the publisher into the physics world
+    return true;
+}
+
 std::string ASimModeWorldBase::getDebugReport()
 {
     return physics_world_->getDebugReport();
@@ -38,6 +38,7 @@ protected:
     void startAsyncUpdator();
     void stopAsyncUpdator();
     virtual void updateDebugReport(msr::airlib::StateReporterWrapper& debug_reporter) override;
+    virtual bool isTelemetryUpdatedByPhysics() const override;
 
     //should be called by derived class once all api_provider_ is ready to use
     void initializeForPlay();
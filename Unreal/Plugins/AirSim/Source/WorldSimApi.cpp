@@ -7,9 +7,70 @@
 #include "DrawDebugHelpers.h"
 #include "Runtime/Engine/Classes/Engine/Engine.h"
 #include "ImageUtils.h"
+#include "Async/ParallelFor.h"
 #include <cstdlib>
 #include <ctime>
 
+namespace
+{
+// Box overlap test for a batch of UE-frame cell centres, spread over the task graph workers
+void overlapTestBatch(UWorld* world, const TArray<FVector>& positions, float box_size_cm, TArray<bool>& occupied)
+{
+    FCollisionQueryParams params;
+    params.bFindInitialOverlaps = true;
+    params.bTraceComplex = false;
+    params.TraceTag = "";
+    const FCollisionShape box = FCollisionShape::MakeBox(FVector(box_size_cm / 2));
+
+    occupied.SetNumUninitialized(positions.Num());
+    ParallelFor(positions.Num(), [&](int32 i) {
+        occupied[i] = world->OverlapBlockingTestByChannel(positions[i], FQuat::Identity, ECollisionChannel::ECC_Pawn, box, params);
+    });
+}
+
+// Flattens positions into the xyz triples the batch SDF queries take
+void packSDFQueryPoints(const std::vector<Vector3r>& positions, std::vector<double>& points)
+{
+    points.resize(positions.size() * 3);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        points[3 * i] = positions[i].x();
+        points[3 * i + 1] = positions[i].y();
+        points[3 * i + 2] = positions[i].z();
+    }
+}
+
+// Answers SDF occupancy one slab at a time with a batched overlap test
+class OverlapOccupancyProvider : public sdf_generation::OccupancyProvider
+{
+public:
+    OverlapOccupancyProvider(UWorld* world, const NedTransform& ned_transform, const Vector3r& position, float res)
+        : world_(world), ned_transform_(ned_transform), position_(position), box_size_cm_(res * 100)
+    {
+    }
+
+    virtual void QuerySlab(const EigenHelpers::VectorVector3d& cell_centers, sdf_generation::OccupancyBitmask& filled) const override
+    {
+        TArray<FVector> positions;
+        positions.SetNumUninitialized(cell_centers.size());
+        for (size_t i = 0; i < cell_centers.size(); ++i)
+            positions[i] = ned_transform_.fromGlobalNed(cell_centers[i].cast<float>() + position_);
+
+        TArray<bool> occupied;
+        overlapTestBatch(world_, positions, box_size_cm_, occupied);
+
+        filled.Reset(cell_centers.size());
+        for (size_t i = 0; i < cell_centers.size(); ++i)
+            filled.Set(i, occupied[i]);
+    }
+
+private:
+    UWorld* world_;
+    const NedTransform& ned_transform_;
+    Vector3r position_;
+    float box_size_cm_;
+};
+}
+
 WorldSimApi::WorldSimApi(ASimModeBase* simmode)
     : simmode_(simmode)
 {
@@ -234,19 +295,22 @@ bool WorldSimApi::createVoxelGrid(const Vector3r& position, const double& x_size
     voxel_grid_.resize(ncells_x * ncells_y * ncells_z);
 
     float scale_cm = res * 100;
-    FCollisionQueryParams params;
-    params.bFindInitialOverlaps = true;
-    params.bTraceComplex = false;
-    params.TraceTag = "";
     auto position_in_UE_frame = simmode_->getGlobalNedTransform().fromGlobalNed(position);
-    for (float i = 0; i < ncells_x; i++) {
-        for (float k = 0; k < ncells_z; k++) {
-            for (float j = 0; j < ncells_y; j++) {
-                int idx = i + ncells_x * (k + ncells_z * j);
-                FVector vposition = FVector((i - ncells_x / 2) * scale_cm, (j - ncells_y / 2) * scale_cm, (k - ncells_z / 2) * scale_cm) + position_in_UE_frame;
-                voxel_grid_[idx] = simmode_->GetWorld()->OverlapBlockingTestByChannel(vposition, FQuat::Identity, ECollisionChannel::ECC_Pawn, FCollisionShape::MakeBox(FVector(scale_cm / 2)), params);
+
+    // Test one j slab at a time so the overlap queries can run in parallel
+    TArray<FVector> positions;
+    TArray<bool> occupied;
+    positions.SetNumUninitialized(ncells_x * ncells_z);
+    for (int j = 0; j < ncells_y; j++) {
+        for (int k = 0; k < ncells_z; k++) {
+            for (int i = 0; i < ncells_x; i++) {
+                positions[i + ncells_x * k] = FVector((i - ncells_x / 2) * scale_cm, (j - ncells_y / 2) * scale_cm, (k - ncells_z / 2) * scale_cm) + position_in_UE_frame;
             }
         }
+        overlapTestBatch(simmode_->GetWorld(), positions, scale_cm, occupied);
+        const int slab_offset = ncells_x * ncells_z * j;
+        for (int idx = 0; idx < positions.Num(); ++idx)
+            voxel_grid_[slab_offset + idx] = occupied[idx];
     }
 
     std::ofstream output(output_file, std::ios::out | std::ios::binary);
@@ -301,64 +365,61 @@ bool WorldSimApi::buildSDF(const Vector3r& position, const double& x_size, const
     std::string frame_;
     bool success = false;
 
-    float scale_cm = res * 100;
-    FCollisionQueryParams params;
-    params.bFindInitialOverlaps = true;
-    params.bTraceComplex = false;
-    params.TraceTag = "";
-
     voxel_grid_temp = VoxelGrid::VoxelGrid<uint8_t>(origin_transform, res, x_size, y_size, z_size, 0);
 
-    std::function<bool(const VoxelGrid::GRID_INDEX&)> is_filled_fn = [&](const VoxelGrid::GRID_INDEX& index) {
-        // Convert SDF indices into a real-world location
-        const Eigen::Vector4d location = voxel_grid_temp.GridIndexToLocation(index);
+    OverlapOccupancyProvider occupancy(simmode_->GetWorld(), simmode_->getGlobalNedTransform(), position, res);
+    sdf_ = sdf_generation::ExtractSignedDistanceField(voxel_grid_temp, occupancy, INFINITY, "local", sdf_generation::PARALLEL_EDT).first;
+    sparse_sdf_.reset();
 
-        // use UE function here
-        Vector3r grid_position = location.head<3>().cast<float>();
-        FVector position_local = simmode_->getGlobalNedTransform().fromGlobalNed(grid_position + position);
-        bool occupied = simmode_->GetWorld()->OverlapBlockingTestByChannel(position_local, FQuat::Identity, ECollisionChannel::ECC_Pawn, FCollisionShape::MakeBox(FVector(scale_cm / 2)), params);
+    return success;
+}
 
-        if (occupied) {
-            // Mark as filled
-            return true;
-        }
-        else {
-            // Mark as free space
-            return false;
-        }
-    };
+bool WorldSimApi::buildSparseSDF(const Vector3r& position, const double& x_size, const double& y_size, const double& z_size, const float& res, const double& truncation_distance)
+{
+    Eigen::Isometry3d origin_transform = Eigen::Translation3d(-x_size / 2, -y_size / 2, -z_size / 2) * Eigen::Quaterniond::Identity();
 
-    sdf_ = sdf_generation::ExtractSignedDistanceField(voxel_grid_temp, is_filled_fn, INFINITY, "local", false).first;
+    std::unique_ptr<sdf_tools::SparseSignedDistanceField> sparse_sdf(new sdf_tools::SparseSignedDistanceField(
+        origin_transform, "local", res, x_size, y_size, z_size, truncation_distance, INFINITY));
+    OverlapOccupancyProvider occupancy(simmode_->GetWorld(), simmode_->getGlobalNedTransform(), position, res);
+    sparse_sdf->Build(occupancy);
+    sparse_sdf_ = std::move(sparse_sdf);
 
-    return success;
+    return true;
 }
 
 bool WorldSimApi::isOccupied(const Vector3r& position)
 {
-    std::pair<double, bool> dist = sdf_.EstimateDistance3d(position.cast<double>());
-    return (dist.first < 0.0);
+    return (getSignedDistance(position) < 0.0);
 }
 
 double WorldSimApi::getSignedDistance(const Vector3r& position)
 {
-    std::pair<double, bool> dist = sdf_.EstimateDistance3d(position.cast<double>());
+    std::pair<double, bool> dist = sparse_sdf_ ? sparse_sdf_->EstimateDistance3d(position.cast<double>())
+                                               : sdf_.EstimateDistance3d(position.cast<double>());
     return dist.first;
 }
 
 std::vector<double> WorldSimApi::getSignedDistances(const std::vector<Vector3r>& positions)
 {
     std::vector<double> distances;
-
-    for (auto& position : positions) {
-        std::pair<double, bool> dist = sdf_.EstimateDistance3d(position.cast<double>());
-        distances.push_back(dist.first);
+    if (sparse_sdf_) {
+        distances.reserve(positions.size());
+        for (const auto& position : positions)
+            distances.push_back(sparse_sdf_->EstimateDistance3d(position.cast<double>()).first);
+        return distances;
     }
+
+    std::vector<double> points;
+    packSDFQueryPoints(positions, points);
+
+    sdf_.EstimateDistancesBatch3d(points, distances);
     return distances;
 }
 
 Vector3r WorldSimApi::getSDFGradient(const Vector3r& position)
 {
-    std::vector<double> gradient = sdf_.GetAutoDiffGradient3d(position.cast<double>());
+    std::vector<double> gradient = sparse_sdf_ ? sparse_sdf_->GetAutoDiffGradient3d(position.cast<double>())
+                                               : sdf_.GetAutoDiffGradient3d(position.cast<double>());
     Eigen::Vector3d sdf_gradient;
 
     if (gradient.size() == 0) {
@@ -371,6 +432,29 @@ Vector3r WorldSimApi::getSDFGradient(const Vector3r& position)
     return sdf_gradient.cast<float>();
 }
 
+std::vector<Vector3r> WorldSimApi::getSDFGradients(const std::vector<Vector3r>& positions)
+{
+    if (sparse_sdf_) {
+        std::vector<Vector3r> result;
+        result.reserve(positions.size());
+        for (const auto& position : positions)
+            result.push_back(getSDFGradient(position));
+        return result;
+    }
+
+    std::vector<double> points;
+    packSDFQueryPoints(positions, points);
+
+    std::vector<double> distances, gradients;
+    sdf_.EstimateDistancesAndGradientsBatch3d(points, distances, gradients);
+
+    std::vector<Vector3r> result;
+    result.reserve(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i)
+        result.push_back(Vector3r(static_cast<float>(gradients[3 * i]), static_cast<float>(gradients[3 * i + 1]), static_cast<float>(gradients[3 * i + 2])));
+    return result;
+}
+
 bool WorldSimApi::checkInVolume(const Vector3r& position, const std::string& volume_actor_name)
 {
     FCollisionQueryParams params;
@@ -399,6 +483,7 @@ bool WorldSimApi::saveSDF(const std::string& filepath)
 bool WorldSimApi::loadSDF(const std::string& filepath)
 {
     sdf_ = sdf_.LoadFromFile(filepath);
+    sparse_sdf_.reset();
     return false;
 }
 
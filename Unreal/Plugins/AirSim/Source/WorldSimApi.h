@@ -8,7 +8,9 @@
 #include "Runtime/Engine/Classes/Engine/StaticMesh.h"
 #include "Engine/LevelStreamingDynamic.h"
 #include "AirBlueprintLib.h"
+#include "sdf_tools/sparse_sdf.hpp"
 #include <map>
+#include <memory>
 #include <string>
 
 class WorldSimApi : public msr::airlib::WorldSimApiBase
@@ -74,10 +76,12 @@ public:
     // Voxel grid/SDF API
     virtual bool createVoxelGrid(const Vector3r& position, const double& x_size, const double& y_size, const double& z_size, const float& res, const std::string& output_file) override;
     virtual bool buildSDF(const Vector3r& position, const double& x_size, const double& y_size, const double& z_size, const float& res) override;
+    virtual bool buildSparseSDF(const Vector3r& position, const double& x_size, const double& y_size, const double& z_size, const float& res, const double& truncation_distance) override;
     virtual Vector3r projectToCollisionFree(const Vector3r& position, const double& mindist) override;
     virtual double getSignedDistance(const Vector3r& position) override;
     virtual std::vector<double> getSignedDistances(const std::vector<Vector3r>& positions) override;
     virtual Vector3r getSDFGradient(const Vector3r& position) override;
+    virtual std::vector<Vector3r> getSDFGradients(const std::vector<Vector3r>& positions) override;
     virtual bool checkInVolume(const Vector3r& position, const std::string& volume_object_name) override;
     virtual bool isOccupied(const Vector3r& position) override;
     virtual bool saveSDF(const std::string& filepath) override;
@@ -112,6 +116,8 @@ private:
     VoxelGrid::VoxelGrid<uint8_t> voxel_grid_temp;
     std::vector<bool> voxel_grid_;
     sdf_tools::SignedDistanceField sdf_;
+    // set by buildSparseSDF and then queried instead of sdf_
+    std::unique_ptr<sdf_tools::SparseSignedDistanceField> sparse_sdf_;
 
     // Race API
     std::map<FString, Pose> gate_noise_map_;